@@ -0,0 +1,201 @@
+/*
+ * File:	Arena.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		arenas.
+ *
+ *		Memory comes in blocks, and everything is aligned as
+ *		strictly as malloc would align it.  Anything too large to
+ *		share a block gets a block of its own.  Releasing an arena
+ *		keeps its first block, so an arena that is reused, like the
+ *		one for function definitions, stops asking for memory once
+ *		it has seen its largest function.
+ */
+
+# include <cstdlib>
+# include <new>
+# include "Arena.h"
+
+using namespace std;
+
+# define ALIGNMENT alignof(max_align_t)
+# define ROUND(n) (((n) + ALIGNMENT - 1) & ~(ALIGNMENT - 1))
+
+thread_local Arena *Arena::_current = nullptr;
+
+
+/*
+ * Function:	Arena::Arena (constructor)
+ *
+ * Description:	Initialize this arena to be empty.  No memory is allocated
+ *		until the first object is.
+ */
+
+Arena::Arena()
+    : _next(nullptr), _limit(nullptr), _cleanups(nullptr)
+{
+}
+
+
+/*
+ * Function:	Arena::~Arena (destructor)
+ *
+ * Description:	Release this arena and give its memory back.
+ */
+
+Arena::~Arena()
+{
+    release();
+
+    if (!_blocks.empty())
+	free(_blocks[0]);
+}
+
+
+/*
+ * Function:	Arena::grow
+ *
+ * Description:	Allocate a new block large enough for SIZE bytes and
+ *		return its start.  A small request starts a new block
+ *		that later requests will also use; a large one gets a
+ *		block to itself, and the current block is kept.
+ */
+
+void *Arena::grow(size_t size)
+{
+    char *block;
+
+
+    if (size > BLOCK_SIZE / 4) {
+	if ((block = (char *) malloc(size)) == nullptr)
+	    throw bad_alloc();
+
+	_large.push_back(block);
+	return block;
+    }
+
+    if ((block = (char *) malloc(BLOCK_SIZE)) == nullptr)
+	throw bad_alloc();
+
+    _blocks.push_back(block);
+    _next = block + size;
+    _limit = block + BLOCK_SIZE;
+    return block;
+}
+
+
+/*
+ * Function:	Arena::allocate
+ *
+ * Description:	Allocate SIZE bytes from this arena.
+ */
+
+void *Arena::allocate(size_t size)
+{
+    void *p;
+
+
+    size = ROUND(size);
+
+    if (size > (size_t) (_limit - _next))
+	return grow(size);
+
+    p = _next;
+    _next += size;
+    return p;
+}
+
+
+/*
+ * Function:	Arena::adopt
+ *
+ * Description:	Arrange for the given object to be destroyed, using the
+ *		given function, when this arena is released.  Objects are
+ *		destroyed in the reverse order of their adoption.
+ */
+
+void Arena::adopt(void *object, Destructor destroy)
+{
+    Cleanup *cleanup = (Cleanup *) allocate(sizeof(Cleanup));
+
+
+    cleanup->destroy = destroy;
+    cleanup->object = object;
+    cleanup->next = _cleanups;
+    _cleanups = cleanup;
+}
+
+
+/*
+ * Function:	Arena::release
+ *
+ * Description:	Destroy the objects in this arena and make all of its
+ *		memory available again.  The first block is kept for
+ *		reuse; the rest go back to the system.
+ */
+
+void Arena::release()
+{
+    while (_cleanups != nullptr) {
+	Cleanup *cleanup = _cleanups;
+	_cleanups = cleanup->next;
+	cleanup->destroy(cleanup->object);
+    }
+
+    for (unsigned i = 0; i < _large.size(); i ++)
+	free(_large[i]);
+
+    for (unsigned i = 1; i < _blocks.size(); i ++)
+	free(_blocks[i]);
+
+    _large.clear();
+
+    if (_blocks.size() > 1)
+	_blocks.resize(1);
+
+    if (_blocks.empty())
+	_next = _limit = nullptr;
+    else {
+	_next = _blocks[0];
+	_limit = _blocks[0] + BLOCK_SIZE;
+    }
+}
+
+
+/*
+ * Function:	Arena::global
+ *
+ * Description:	Return the global arena, which lives as long as the
+ *		program does.
+ */
+
+Arena &Arena::global()
+{
+    static Arena global;
+    return global;
+}
+
+
+/*
+ * Function:	Arena::current (accessor)
+ *
+ * Description:	Return the current arena of the calling thread.
+ */
+
+Arena *Arena::current()
+{
+    return _current != nullptr ? _current : &global();
+}
+
+
+/*
+ * Function:	Arena::current (mutator)
+ *
+ * Description:	Make the given arena the current arena of the calling
+ *		thread.  A null arena means the global arena.
+ */
+
+void Arena::current(Arena *arena)
+{
+    _current = arena;
+}
@@ -0,0 +1,58 @@
+/*
+ * File:	Arena.h
+ *
+ * Description:	This file contains the class definition for an arena, a
+ *		region of memory from which objects are allocated simply
+ *		by bumping a pointer.  Objects are never freed one at a
+ *		time.  Instead, the whole arena is released at once, which
+ *		runs the destructors of any objects that asked for it.  An
+ *		object asks from its constructor, so an object that was
+ *		allocated but never constructed is never destroyed.
+ *
+ *		Each thread has a current arena, from which the scopes and
+ *		symbols get their memory.  By default, it is the global
+ *		arena, which is never released.  A compiler context makes an
+ *		arena of its own current while it compiles a unit, and the
+ *		parser makes a separate arena current while it compiles a
+ *		function definition, and releases it once the function is
+ *		done.
+ */
+
+# ifndef ARENA_H
+# define ARENA_H
+# include <cstddef>
+# include <vector>
+
+class Arena {
+    typedef void (*Destructor)(void *object);
+
+    struct Cleanup {
+	Destructor destroy;
+	void *object;
+	Cleanup *next;
+    };
+
+    enum { BLOCK_SIZE = 64 * 1024 };
+
+    char *_next, *_limit;
+    std::vector<char *> _blocks, _large;
+    Cleanup *_cleanups;
+
+    static thread_local Arena *_current;
+
+    void *grow(size_t size);
+
+public:
+    Arena();
+    ~Arena();
+
+    void *allocate(size_t size);
+    void adopt(void *object, Destructor destroy);
+    void release();
+
+    static Arena &global();
+    static Arena *current();
+    static void current(Arena *arena);
+};
+
+# endif /* ARENA_H */
@@ -0,0 +1,266 @@
+/*
+ * File:	AsmWriter.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the writer of assembly output.
+ */
+
+# include <cerrno>
+# include <cstring>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/uio.h>
+# include "AsmWriter.h"
+# include "Profile.h"
+
+using namespace std;
+
+
+/*
+ * Function:	AsmWriter::AsmWriter (constructor)
+ *
+ * Description:	Initialize this writer to write to the given file
+ *		descriptor, which is the standard output by default.  No
+ *		chunk is allocated until something is written, since many
+ *		writers never write a thing.
+ */
+
+AsmWriter::AsmWriter(int fd)
+    : _fd(fd), _error(0), _string(nullptr), _chunk(0), _line(LINE_START)
+{
+    for (unsigned i = 0; i < CHUNKS; i ++)
+	_chunks[i] = nullptr;
+
+    setp(nullptr, nullptr);
+}
+
+
+/*
+ * Function:	AsmWriter::~AsmWriter (destructor)
+ *
+ * Description:	Write out anything left, and close the file if we opened
+ *		it.  It is too late to report a failed write by now, so
+ *		anyone who cares must flush the stream first and then
+ *		check for an error.
+ */
+
+AsmWriter::~AsmWriter()
+{
+    drain();
+
+    if (_fd > 2)
+	close(_fd);
+
+    for (unsigned i = 0; i < CHUNKS; i ++)
+	delete[] _chunks[i];
+}
+
+
+/*
+ * Function:	AsmWriter::open
+ *
+ * Description:	Write to the named file from now on, creating it if it
+ *		doesn't exist.  Return whether the file could be opened.
+ */
+
+bool AsmWriter::open(const char *path)
+{
+    int fd;
+
+
+    if ((fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0)
+	return false;
+
+    drain();
+
+    if (_fd > 2)
+	close(_fd);
+
+    _fd = fd;
+    _error = 0;
+    _string = nullptr;
+    return true;
+}
+
+
+/*
+ * Function:	AsmWriter::open
+ *
+ * Description:	Append to the given string from now on.
+ */
+
+void AsmWriter::open(string &buffer)
+{
+    drain();
+
+    if (_fd > 2)
+	close(_fd);
+
+    _fd = -1;
+    _error = 0;
+    _string = &buffer;
+}
+
+
+/*
+ * Function:	AsmWriter::error (accessor)
+ *
+ * Description:	Return the error number of the first write that failed,
+ *		or zero if every write so far has succeeded.
+ */
+
+int AsmWriter::error() const
+{
+    return _error;
+}
+
+
+/*
+ * Function:	AsmWriter::drain
+ *
+ * Description:	Write all of the full chunks and whatever is in the
+ *		current one in as few system calls as possible, or append
+ *		them to our string if we have one, and start over with the
+ *		first chunk.  Return whether everything was written, and
+ *		remember why if it was not.
+ */
+
+bool AsmWriter::drain()
+{
+    struct iovec iov[CHUNKS];
+    unsigned count, first;
+    unsigned long instructions = 0;
+    ssize_t n;
+
+
+    for (count = 0; count < _chunk; count ++) {
+	iov[count].iov_base = _chunks[count];
+	iov[count].iov_len = CHUNK_SIZE;
+    }
+
+    iov[count].iov_base = _chunks[count];
+    iov[count].iov_len = pptr() - _chunks[count];
+    count ++;
+
+    _chunk = 0;
+
+    if (_chunks[0] != nullptr)
+	setp(_chunks[0], _chunks[0] + CHUNK_SIZE);
+
+    if (Timer::enabled()) {
+	for (first = 0; first < count; first ++)
+	    instructions += this->count((char *) iov[first].iov_base,
+		    (char *) iov[first].iov_base + iov[first].iov_len);
+
+	Timer::count(INSTRUCTIONS, instructions);
+    }
+
+    if (_string != nullptr) {
+	for (first = 0; first < count; first ++)
+	    _string->append((char *) iov[first].iov_base, iov[first].iov_len);
+
+	return true;
+    }
+
+    for (first = 0; first < count; ) {
+	if ((n = writev(_fd, iov + first, count - first)) < 0) {
+	    if (errno == EINTR)
+		continue;
+
+	    if (_error == 0)
+		_error = errno;
+
+	    return false;
+	}
+
+	while (first < count && (size_t) n >= iov[first].iov_len)
+	    n -= iov[first ++].iov_len;
+
+	if (first < count) {
+	    iov[first].iov_base = (char *) iov[first].iov_base + n;
+	    iov[first].iov_len -= n;
+	}
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	AsmWriter::count
+ *
+ * Description:	Return the number of instructions that begin in the given
+ *		text, which follows whatever we counted last, so a line
+ *		may well have begun in a chunk before.
+ */
+
+unsigned long AsmWriter::count(const char *p, const char *end)
+{
+    unsigned long instructions = 0;
+
+
+    while (p < end) {
+	if (_line == LINE_REST) {
+	    if ((p = (const char *) memchr(p, '\n', end - p)) == nullptr)
+		break;
+
+	    _line = LINE_START;
+	} else if (*p == '\n')
+	    _line = LINE_START;
+	else if (_line == LINE_START)
+	    _line = (*p == '\t' ? LINE_TAB : LINE_REST);
+	else {
+	    instructions += (*p != '.');
+	    _line = LINE_REST;
+	}
+
+	p ++;
+    }
+
+    return instructions;
+}
+
+
+/*
+ * Function:	AsmWriter::overflow
+ *
+ * Description:	Move on to the next chunk now that the current one is
+ *		full, writing everything out first if there are no more
+ *		chunks, and then store the given character.  A chunk is
+ *		allocated the first time we move on to it, and the first
+ *		chunk the first time anything is written.
+ */
+
+int AsmWriter::overflow(int c)
+{
+    if (pbase() == nullptr)
+	_chunk = 0;
+    else if (_chunk + 1 < CHUNKS)
+	_chunk ++;
+    else if (!drain())
+	return traits_type::eof();
+
+    if (_chunks[_chunk] == nullptr)
+	_chunks[_chunk] = new char[CHUNK_SIZE];
+
+    setp(_chunks[_chunk], _chunks[_chunk] + CHUNK_SIZE);
+
+    if (c != traits_type::eof()) {
+	*pptr() = c;
+	pbump(1);
+    }
+
+    return traits_type::not_eof(c);
+}
+
+
+/*
+ * Function:	AsmWriter::sync
+ *
+ * Description:	Write out everything written so far.
+ */
+
+int AsmWriter::sync()
+{
+    return drain() ? 0 : -1;
+}
@@ -0,0 +1,52 @@
+/*
+ * File:	AsmWriter.h
+ *
+ * Description:	This file contains the class definition for the writer
+ *		of assembly output.  It is a stream buffer, so the code
+ *		generator can use the usual output operators, but it holds
+ *		on to everything written until it has a good deal of it.
+ *		The output is kept in a number of fixed chunks, which are
+ *		handed to the system in a single gathering write when they
+ *		are all full, when the stream is flushed, or when the writer
+ *		is destroyed.  The chunks are then reused.  Each chunk is
+ *		only allocated once it is needed, so a writer that writes
+ *		little costs little.  Rather than a file, the writer can
+ *		also be given a string to append the chunks to, for a
+ *		compiler that is never to touch a file.  The first write
+ *		that fails is remembered, so that the compiler can report
+ *		it once it is done.  When we are profiling, the writer
+ *		counts the instructions that go through it: the lines that
+ *		begin with a tab that is not followed by a directive.
+ */
+
+# ifndef ASMWRITER_H
+# define ASMWRITER_H
+# include <string>
+# include <streambuf>
+
+class AsmWriter : public std::streambuf {
+    enum { CHUNK_SIZE = 64 * 1024, CHUNKS = 16 };
+    enum { LINE_START, LINE_TAB, LINE_REST };
+
+    int _fd, _error;
+    std::string *_string;
+    char *_chunks[CHUNKS];
+    unsigned _chunk, _line;
+
+    bool drain();
+    unsigned long count(const char *p, const char *end);
+
+protected:
+    virtual int overflow(int c);
+    virtual int sync();
+
+public:
+    AsmWriter(int fd = 1);
+    ~AsmWriter();
+
+    bool open(const char *path);
+    void open(std::string &buffer);
+    int error() const;
+};
+
+# endif /* ASMWRITER_H */
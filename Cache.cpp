@@ -0,0 +1,547 @@
+/*
+ * File:	Cache.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		digests and for the cache of generated code.
+ *
+ *		An entry is a text file.  Its first line holds the number
+ *		of literals, and the length and digest of the rest of the
+ *		entry.  Then comes each literal on a line of its own, an S
+ *		or R and its spelling, and then the code.  In the code, a
+ *		label of a literal is written with a dollar sign and the
+ *		place of the literal in place of its number, as in .L$0 or
+ *		.fp$1, which no label of ours can ever look like.
+ */
+
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <cctype>
+# include <ctime>
+# include <fcntl.h>
+# include <unistd.h>
+# include <dirent.h>
+# include <sys/stat.h>
+# include <algorithm>
+# include <map>
+# include <sstream>
+# include "Cache.h"
+
+using namespace std;
+
+/* The format of an entry is part of every digest, along with the digest
+   of the compiler itself, so that an entry written in another format, or
+   by another build, is never mistaken for one of ours.  Whenever what
+   goes into an entry changes, so must its format. */
+
+static const unsigned FORMAT = 2;
+
+/* An entry used within this many seconds is not touched again, which
+   saves a system call for every function of a unit compiled over and
+   over, and hardly matters to which entries are used least recently. */
+
+static const time_t RECENT = 60;
+
+
+/*
+ * Function:	Digest::Digest (constructor)
+ *
+ * Description:	Initialize this digest to the 128-bit FNV-1a offset basis,
+ *		followed by the build of the compiler if BUILT.  A digest
+ *		of something that outlives the build, or that is part of
+ *		working out what the build is, leaves it out.
+ */
+
+Digest::Digest()
+    : Digest(true)
+{
+}
+
+Digest::Digest(bool built)
+{
+    _state = (unsigned __int128) 0x6c62272e07bb0142ull << 64;
+    _state |= 0x62b821756295c58dull;
+
+    if (built)
+	add(build());
+}
+
+
+/*
+ * Function:	Digest::build
+ *
+ * Description:	Return the build of the compiler, which is worked out the
+ *		first time it is needed.
+ */
+
+const string &Digest::build()
+{
+    static const string digest = identify();
+
+    return digest;
+}
+
+
+/*
+ * Function:	Digest::identify
+ *
+ * Description:	Return the digest of the format of an entry and of the
+ *		executable of the running compiler, so that rebuilding it
+ *		with any change at all gives it a new build.  The
+ *		executable is large, so it is summed a word at a time
+ *		with the 64-bit FNV prime, which is much faster than
+ *		digesting it a byte at a time and still tells apart any
+ *		two executables that differ in one word.  If it cannot be
+ *		read, this run is made a build of its own, and nothing it
+ *		stores is ever used by another.
+ */
+
+string Digest::identify()
+{
+    Digest digest(false);
+    unsigned long words[1 << 13], sum = 0xcbf29ce484222325ul;
+    ssize_t n = -1;
+    int fd;
+
+
+    digest.add(FORMAT);
+
+    if ((fd = ::open("/proc/self/exe", O_RDONLY)) >= 0) {
+	while ((n = read(fd, words, sizeof(words))) > 0) {
+	    memset((char *) words + n, 0, -n & 7);
+
+	    for (ssize_t i = 0; i < (n + 7) / 8; i ++)
+		sum = (sum ^ words[i]) * 0x100000001b3ul;
+	}
+
+	close(fd);
+    }
+
+    if (n < 0)
+	digest.add(getpid()).add(time(nullptr)).add(clock());
+    else
+	digest.add(&sum, sizeof(sum));
+
+    return digest.str();
+}
+
+
+/*
+ * Function:	Digest::add
+ *
+ * Description:	Add the LENGTH bytes at DATA to this digest.
+ */
+
+Digest &Digest::add(const void *data, size_t length)
+{
+    const unsigned __int128 prime = ((unsigned __int128) 1 << 88) + 0x13b;
+    const unsigned char *p = (const unsigned char *) data;
+
+    for (size_t i = 0; i < length; i ++)
+	_state = (_state ^ p[i]) * prime;
+
+    return *this;
+}
+
+
+/*
+ * Function:	Digest::add
+ *
+ * Description:	Add the given string to this digest, preceded by its
+ *		length, so that no two sequences of strings can run
+ *		together into the same digest.
+ */
+
+Digest &Digest::add(const string &s)
+{
+    add(s.size());
+    return add(s.data(), s.size());
+}
+
+
+/*
+ * Function:	Digest::add
+ *
+ * Description:	Add the given number to this digest.
+ */
+
+Digest &Digest::add(unsigned n)
+{
+    return add(&n, sizeof(n));
+}
+
+
+/*
+ * Function:	Digest::str (accessor)
+ *
+ * Description:	Return this digest as 32 hexadecimal digits.
+ */
+
+string Digest::str() const
+{
+    static const char digits[] = "0123456789abcdef";
+    string s(32, '0');
+
+
+    for (unsigned i = 0; i < 32; i ++)
+	s[i] = digits[(unsigned) (_state >> (124 - 4 * i)) & 15];
+
+    return s;
+}
+
+
+/*
+ * Function:	Cache::Cache (constructor)
+ *
+ * Description:	Initialize this cache to keep its entries in the named
+ *		directory, which is trimmed back once it holds more than
+ *		LIMIT bytes of them.
+ */
+
+Cache::Cache(const string &directory, size_t limit)
+    : _directory(directory), _limit(limit), _hits(0), _misses(0),
+      _stored(0), _evicted(0)
+{
+}
+
+
+/*
+ * Function:	Cache::path
+ *
+ * Description:	Return the path of the entry with the given key.  Like
+ *		git, we use the first two digits as a subdirectory, so
+ *		that no one directory grows too large.
+ */
+
+string Cache::path(const string &key) const
+{
+    return _directory + "/" + key.substr(0, 2) + "/" + key.substr(2);
+}
+
+
+/*
+ * Function:	Cache::open
+ *
+ * Description:	Create the directory of this cache if it does not exist.
+ *		Return whether it is there now.
+ */
+
+bool Cache::open()
+{
+    struct stat st;
+
+    mkdir(_directory.c_str(), 0777);
+    return stat(_directory.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+
+/*
+ * Function:	Cache::fetch
+ *
+ * Description:	Look up the given entry by its key, and if it is there,
+ *		fill in its literals and its code, and touch it, since it
+ *		has just been used, unless it was used recently anyway.
+ *		Return whether it was there, and whole.
+ */
+
+bool Cache::fetch(CacheEntry &entry)
+{
+    string file = path(entry.key);
+    size_t start = 0, end, length = 0;
+    unsigned count = 0;
+    char digest[33];
+    struct stat st;
+    int fd;
+
+
+    entry.literals.clear();
+    entry.text.clear();
+
+    if ((fd = ::open(file.c_str(), O_RDONLY)) >= 0) {
+	if (fstat(fd, &st) == 0) {
+	    entry.text.resize(st.st_size);
+
+	    if (read(fd, &entry.text[0], st.st_size) != st.st_size)
+		entry.text.clear();
+
+	    if (st.st_mtime < time(nullptr) - RECENT)
+		futimens(fd, nullptr);
+	}
+
+	close(fd);
+    }
+
+    if ((end = entry.text.find('\n')) != string::npos &&
+	    sscanf(entry.text.c_str(), "%u %zu %32[0-9a-f]", &count, &length,
+		digest) == 3 && length == entry.text.size() - end - 1 &&
+	    Digest().add(&entry.text[end + 1], length).str() == digest)
+	start = end + 1;
+    else
+	count = 0;
+
+    while (entry.literals.size() < count) {
+	end = entry.text.find('\n', start);
+
+	if (end == string::npos || end - start < 2)
+	    break;
+
+	if (entry.text[start] != 'S' && entry.text[start] != 'R')
+	    break;
+
+	entry.literals.push_back(make_pair(entry.text[start],
+		    entry.text.substr(start + 2, end - start - 2)));
+	start = end + 1;
+    }
+
+    if (start == 0 || entry.literals.size() != count) {
+	entry.literals.clear();
+	entry.text.clear();
+	_misses ++;
+	return false;
+    }
+
+    entry.text.erase(0, start);
+    _hits ++;
+    return true;
+}
+
+
+/*
+ * Function:	Cache::store
+ *
+ * Description:	Store the given code as the given entry, whose literals
+ *		were given the labels listed with them.  If the code uses
+ *		the label of a literal that is not listed, we cannot tell
+ *		what it refers to, so we store nothing.
+ */
+
+void Cache::store(const CacheEntry &entry, const string &text)
+{
+    map<int, unsigned> strings, reals, *labels;
+    map<int, unsigned>::iterator it;
+    string file = path(entry.key), temp, header;
+    ostringstream out;
+    size_t i = 0, j;
+    int fd;
+
+
+    for (unsigned n = 0; n < entry.literals.size(); n ++)
+	if (entry.literals[n].first == 'S')
+	    strings.insert(make_pair(entry.labels[n], n));
+	else
+	    reals.insert(make_pair(entry.labels[n], n));
+
+    for (unsigned n = 0; n < entry.literals.size(); n ++)
+	out << entry.literals[n].first << ' ' << entry.literals[n].second << '\n';
+
+    while ((j = text.find('.', i)) != string::npos) {
+	out.write(text.data() + i, j - i);
+	i = j + 1;
+
+	if (text.compare(i, 1, "L") == 0 && isdigit(text[i + 1]))
+	    i += 1, labels = &strings;
+	else if (text.compare(i, 2, "fp") == 0 && isdigit(text[i + 2]))
+	    i += 2, labels = &reals;
+	else {
+	    out << '.';
+	    continue;
+	}
+
+	if ((it = labels->find(atoi(&text[i]))) == labels->end())
+	    return;
+
+	out << text.substr(j, i - j) << '$' << it->second;
+
+	while (isdigit(text[i]))
+	    i ++;
+    }
+
+    out << text.substr(i);
+
+    mkdir(file.substr(0, file.rfind('/')).c_str(), 0777);
+    temp = file + ".XXXXXX";
+    fd = mkstemp(&temp[0]);
+
+    if (fd < 0)
+	return;
+
+    const string &s = out.str();
+
+    header = to_string(entry.literals.size()) + ' ' + to_string(s.size());
+    header += ' ' + Digest().add(s.data(), s.size()).str() + '\n';
+
+    if (write(fd, header.data(), header.size()) == (ssize_t) header.size() &&
+	    write(fd, s.data(), s.size()) == (ssize_t) s.size() &&
+	    close(fd) == 0) {
+	if (rename(temp.c_str(), file.c_str()) == 0) {
+	    _stored ++;
+	    return;
+	}
+    } else
+	close(fd);
+
+    unlink(temp.c_str());
+}
+
+
+/*
+ * Function:	Cache::splice
+ *
+ * Description:	Return the code of the given entry, which has been
+ *		fetched, with the labels listed with its literals in place
+ *		of their places.
+ */
+
+string Cache::splice(const CacheEntry &entry) const
+{
+    const string &text = entry.text;
+    size_t i = 0, j, n;
+    string s;
+
+
+    s.reserve(text.size());
+
+    while ((j = text.find('$', i)) != string::npos) {
+	s.append(text, i, j - i);
+	i = j + 1;
+
+	n = isdigit(text[i]) ? atoi(&text[i]) : entry.labels.size();
+
+	if (n < entry.labels.size() && ((s.size() >= 2 &&
+		s.compare(s.size() - 2, 2, ".L") == 0) || (s.size() >= 3 &&
+		s.compare(s.size() - 3, 3, ".fp") == 0))) {
+	    s += to_string(entry.labels[n]);
+
+	    while (isdigit(text[i]))
+		i ++;
+	} else
+	    s += '$';
+    }
+
+    s.append(text, i, string::npos);
+    return s;
+}
+
+
+/*
+ * Function:	Cache::trim
+ *
+ * Description:	If the entries of this cache take up more than its limit,
+ *		remove the least recently used of them until they take up
+ *		no more than three quarters of it, so that we need not
+ *		trim it again the next time.  If nothing has been stored,
+ *		it cannot have grown, so we need not even look.
+ */
+
+void Cache::trim()
+{
+    struct File {
+	struct timespec used;
+	size_t size;
+	string path;
+
+	bool operator <(const File &rhs) const {
+	    if (used.tv_sec != rhs.used.tv_sec)
+		return used.tv_sec < rhs.used.tv_sec;
+
+	    return used.tv_nsec < rhs.used.tv_nsec;
+	}
+    };
+
+    vector<File> files;
+    size_t total = 0;
+    struct dirent *d, *e;
+    struct stat st;
+    DIR *dir, *sub;
+    string path;
+
+
+    if (_stored == 0 || (dir = opendir(_directory.c_str())) == nullptr)
+	return;
+
+    while ((d = readdir(dir)) != nullptr) {
+	if (d->d_name[0] == '.')
+	    continue;
+
+	path = _directory + "/" + d->d_name;
+
+	if ((sub = opendir(path.c_str())) == nullptr)
+	    continue;
+
+	while ((e = readdir(sub)) != nullptr) {
+	    File file;
+
+	    file.path = path + "/" + e->d_name;
+
+	    if (stat(file.path.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+		file.used = st.st_mtim;
+		file.size = st.st_blocks * 512;
+		total += file.size;
+		files.push_back(file);
+	    }
+	}
+
+	closedir(sub);
+    }
+
+    closedir(dir);
+
+    if (total <= _limit)
+	return;
+
+    sort(files.begin(), files.end());
+
+    for (unsigned i = 0; i < files.size() && total > _limit / 4 * 3; i ++)
+	if (unlink(files[i].path.c_str()) == 0) {
+	    total -= files[i].size;
+	    _evicted ++;
+	}
+}
+
+
+/*
+ * Function:	Cache::hits (accessor)
+ *
+ * Description:	Return the number of entries fetched.
+ */
+
+unsigned Cache::hits() const
+{
+    return _hits;
+}
+
+
+/*
+ * Function:	Cache::misses (accessor)
+ *
+ * Description:	Return the number of entries looked up but not found.
+ */
+
+unsigned Cache::misses() const
+{
+    return _misses;
+}
+
+
+/*
+ * Function:	Cache::stored (accessor)
+ *
+ * Description:	Return the number of entries stored.
+ */
+
+unsigned Cache::stored() const
+{
+    return _stored;
+}
+
+
+/*
+ * Function:	Cache::evicted (accessor)
+ *
+ * Description:	Return the number of entries removed to trim the cache.
+ */
+
+unsigned Cache::evicted() const
+{
+    return _evicted;
+}
@@ -0,0 +1,86 @@
+/*
+ * File:	Cache.h
+ *
+ * Description:	This file contains the class definitions for the cache of
+ *		generated code, which lets a unit reuse the code of each
+ *		function that has not changed since it was last compiled,
+ *		rather than parsing, checking, and generating it again.
+ *
+ *		The cache is a directory of entries, each holding the code
+ *		of one function definition and named by the digest of
+ *		everything that code depends on: the tokens of the body,
+ *		the type of the function and its parameters, the meaning
+ *		of each identifier in the body at file scope, the level of
+ *		commentary, the format of the entry, and the executable
+ *		of the compiler itself.  So an entry never needs to be
+ *		invalidated.  It is just never looked up again.  The
+ *		labels of the function are already qualified by its name,
+ *		but those of its string and real literals are numbered
+ *		across the unit, so an entry keeps the literals in the
+ *		order they were numbered and refers to them by their place
+ *		in that order instead.
+ *
+ *		Using an entry touches it, and once a cache grows past its
+ *		limit, it is trimmed back by removing the entries that
+ *		were used least recently.  Entries are written to a
+ *		temporary file and then renamed, so any number of
+ *		compilers can share a cache, even in different processes.
+ *		Each also records its length and digest, and one that does
+ *		not match them is not used, so an entry left truncated or
+ *		damaged by some other means is just a miss.
+ */
+
+# ifndef CACHE_H
+# define CACHE_H
+# include <atomic>
+# include <string>
+# include <vector>
+
+class Digest {
+    unsigned __int128 _state;
+
+    static const std::string &build();
+    static std::string identify();
+
+public:
+    Digest();
+    explicit Digest(bool built);
+
+    Digest &add(const void *data, size_t length);
+    Digest &add(const std::string &s);
+    Digest &add(unsigned n);
+    std::string str() const;
+};
+
+struct CacheEntry {
+    std::string key;
+    std::vector<std::pair<char, std::string> > literals;
+    std::vector<int> labels;
+    std::string text;
+};
+
+class Cache {
+    typedef std::string string;
+
+    string _directory;
+    size_t _limit;
+    std::atomic<unsigned> _hits, _misses, _stored, _evicted;
+
+    string path(const string &key) const;
+
+public:
+    Cache(const string &directory, size_t limit = 64 << 20);
+
+    bool open();
+    bool fetch(CacheEntry &entry);
+    void store(const CacheEntry &entry, const string &text);
+    string splice(const CacheEntry &entry) const;
+    void trim();
+
+    unsigned hits() const;
+    unsigned misses() const;
+    unsigned stored() const;
+    unsigned evicted() const;
+};
+
+# endif /* CACHE_H */
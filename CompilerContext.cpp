@@ -0,0 +1,413 @@
+/*
+ * File:	CompilerContext.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		compiler contexts, and the function for compiling a source
+ *		buffer in memory to assembly in memory.
+ */
+
+# include <cstring>
+# include <sstream>
+# include <stdexcept>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "CompilerContext.h"
+# include "Interner.h"
+# include "ThreadPool.h"
+# include "parser.h"
+
+using namespace std;
+
+__thread CompilerContext *context = nullptr;
+
+
+/*
+ * Function:	CompilerContext::CompilerContext (constructor)
+ *
+ * Description:	Initialize this context to read the standard input and
+ *		write to the standard output, reporting errors to the
+ *		given stream.
+ */
+
+CompilerContext::CompilerContext(ostream &stream)
+    : _mapping(nullptr), _mapped(0), names(Interner::current()),
+      source(nullptr), limit(nullptr), resume(nullptr), resumeLine(0),
+      tokenized(false), numErrors(0), lineno(1),
+      diagnostics(stream.rdbuf()), headers(nullptr), directives(0),
+      tokens(_tokens), current(0), reached(0), pending(0), lookahead(0),
+      unit(nullptr), cache(nullptr), snapshot(nullptr),
+      memo(nullptr), outermost(nullptr),
+      toplevel(nullptr), declarations(0), visible(0), out(&writer),
+      annotations(ANNOTATE_VERBOSE), strings(0), reals(0), pool(nullptr)
+{
+}
+
+
+/*
+ * Function:	CompilerContext::CompilerContext (constructor)
+ *
+ * Description:	Initialize this context to parse function bodies of the
+ *		given unit, reading its source and tokens.  It reports
+ *		errors to nowhere until it is given a stream.
+ */
+
+CompilerContext::CompilerContext(CompilerContext *unit)
+    : _mapping(nullptr), _mapped(0), names(unit->names),
+      source(unit->source), limit(unit->limit), resume(nullptr),
+      resumeLine(0), tokenized(true), numErrors(0), lineno(1),
+      diagnostics(nullptr), headers(unit->headers), directives(0),
+      tokens(unit->tokens), current(0), reached(0), pending(0),
+      lookahead(0), unit(unit), cache(unit->cache),
+      snapshot(unit->snapshot), memo(unit->memo), outermost(unit->outermost),
+      toplevel(nullptr), declarations(0), visible(0), out(&writer),
+      annotations(unit->annotations), strings(0), reals(0), pool(nullptr)
+{
+}
+
+
+/*
+ * Function:	CompilerContext::CompilerContext (constructor)
+ *
+ * Description:	Initialize this context to compile a source that has
+ *		already been tokenized into the given stream, which is
+ *		used in place, and so must outlive the compilation.  The
+ *		preprocessor will replace its tokens if it has any
+ *		directives.  Errors are reported to the given stream.
+ */
+
+CompilerContext::CompilerContext(TokenStream &tokens, ostream &stream)
+    : _mapping(nullptr), _mapped(0), names(Interner::current()),
+      source(nullptr), limit(nullptr), resume(nullptr), resumeLine(0),
+      tokenized(true), numErrors(0), lineno(1),
+      diagnostics(stream.rdbuf()), headers(nullptr), directives(0),
+      tokens(tokens), current(0), reached(0), pending(0), lookahead(0),
+      unit(nullptr), cache(nullptr), snapshot(nullptr),
+      memo(nullptr), outermost(nullptr),
+      toplevel(nullptr), declarations(0), visible(0), out(&writer),
+      annotations(ANNOTATE_VERBOSE), strings(0), reals(0), pool(nullptr)
+{
+}
+
+
+/*
+ * Function:	CompilerContext::~CompilerContext (destructor)
+ *
+ * Description:	Write out anything left, delete the contexts that parsed
+ *		our function bodies, and unmap the source if we mapped it.
+ *		The arenas are released along with the rest of the
+ *		members.
+ */
+
+CompilerContext::~CompilerContext()
+{
+    out.flush();
+
+    for (unsigned i = 0; i < parsers.size(); i ++)
+	delete parsers[i];
+
+    if (_mapping != nullptr)
+	munmap(_mapping, _mapped);
+}
+
+
+/*
+ * Function:	CompilerContext::open
+ *
+ * Description:	Make the named file the source, or the standard input
+ *		stream if no PATH is given.  A regular file is simply
+ *		mapped into memory.  Anything else is read into a buffer
+ *		all at once.  Headers that the source includes in quotes
+ *		are looked for in its directory, or in the current one
+ *		for the standard input.  Return false if the source
+ *		cannot be read.
+ */
+
+bool CompilerContext::open(const char *path)
+{
+    struct stat st;
+    char chunk[65536];
+    size_t slash;
+    ssize_t n;
+    void *addr;
+    int fd;
+
+
+    fd = (path != 0 ? ::open(path, O_RDONLY) : 0);
+
+    if (fd < 0)
+	return false;
+
+    directory = (path != 0 ? path : "");
+    slash = directory.rfind('/');
+    directory.erase(slash == string::npos ? 0 : slash == 0 ? 1 : slash);
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+	addr = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (addr != MAP_FAILED) {
+	    _mapping = addr;
+	    _mapped = st.st_size;
+	    source = (const char *) addr;
+	    limit = source + st.st_size;
+
+	    if (path != 0)
+		close(fd);
+
+	    return true;
+	}
+    }
+
+    _buffer.clear();
+
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0)
+	_buffer.append(chunk, n);
+
+    if (path != 0)
+	close(fd);
+
+    source = _buffer.data();
+    limit = source + _buffer.size();
+    return n == 0;
+}
+
+
+/*
+ * Function:	CompilerContext::open
+ *
+ * Description:	Make the LENGTH characters at BUFFER the source.  They
+ *		are not copied, so they must outlive the compilation.
+ */
+
+void CompilerContext::open(const char *buffer, size_t length)
+{
+    source = buffer;
+    limit = buffer + length;
+}
+
+
+/*
+ * Function:	CompilerContext::output
+ *
+ * Description:	Write the generated code to the named file rather than to
+ *		the standard output.  Return whether the file could be
+ *		opened.
+ */
+
+bool CompilerContext::output(const char *path)
+{
+    return writer.open(path);
+}
+
+
+/*
+ * Function:	CompilerContext::output
+ *
+ * Description:	Append the generated code to the given string rather than
+ *		writing it to the standard output.
+ */
+
+void CompilerContext::output(string &assembly)
+{
+    writer.open(assembly);
+}
+
+
+/*
+ * Function:	CompilerContext::annotate (mutator)
+ *
+ * Description:	Set how much commentary goes along with the generated
+ *		code: none at all, the source line of each statement, or
+ *		the verbose play-by-play we have always given.
+ */
+
+void CompilerContext::annotate(int level)
+{
+    annotations = level;
+}
+
+
+/*
+ * Function:	CompilerContext::root (mutator)
+ *
+ * Description:	Add the named function to the roots of this unit.  Once
+ *		there are any, the body of a function that cannot be
+ *		reached from one of them is skipped: it is neither
+ *		checked nor generated, and its errors go unreported.
+ */
+
+void CompilerContext::root(const string &name)
+{
+    roots.push_back(name);
+}
+
+
+/*
+ * Function:	CompilerContext::include (mutator)
+ *
+ * Description:	Look for included headers in the given directory, after
+ *		those already given.
+ */
+
+void CompilerContext::include(const string &directory)
+{
+    includes.push_back(directory);
+}
+
+
+/*
+ * Function:	CompilerContext::use (mutator)
+ *
+ * Description:	Reuse the code of the functions of this unit that are in
+ *		the given cache, and store the code of the rest in it.
+ *		The cache must outlive the compilation.
+ */
+
+void CompilerContext::use(Cache &cache)
+{
+    this->cache = &cache;
+}
+
+
+/*
+ * Function:	CompilerContext::use (mutator)
+ *
+ * Description:	Take included headers from the given cache, which may be
+ *		shared with other units, rather than from one of our own.
+ *		The cache must outlive the compilation.
+ */
+
+void CompilerContext::use(Headers &headers)
+{
+    this->headers = &headers;
+}
+
+
+/*
+ * Function:	CompilerContext::use (mutator)
+ *
+ * Description:	Only check this unit, recalling what each body reported
+ *		from the given memo if it has not changed since, rather
+ *		than parsing it again, and remembering what the others
+ *		report.  No code is generated for a recalled body, so the
+ *		code of the unit should be thrown away.  The memo must
+ *		outlive the compilation.
+ */
+
+void CompilerContext::use(Memo &memo)
+{
+    this->memo = &memo;
+}
+
+
+/*
+ * Function:	CompilerContext::seed (mutator)
+ *
+ * Description:	Declare the symbols of the given snapshot rather than
+ *		parsing them again, if the source begins with its source.
+ *		The snapshot must outlive the compilation.
+ */
+
+void CompilerContext::seed(const Snapshot &snapshot)
+{
+    this->snapshot = &snapshot;
+}
+
+
+/*
+ * Function:	CompilerContext::compile
+ *
+ * Description:	Compile the source, using the given pool of WORKERS to
+ *		tokenize it and to generate its functions.  While we do,
+ *		this is the current context of the calling thread, and our
+ *		arena and interner are its current ones.  Whatever code
+ *		was generated is written out even if there is a syntax
+ *		error, as it always has been.  Return false if there was
+ *		a syntax error, or if the source has more names than our
+ *		interner can hold or a function more nodes than its tree
+ *		can, or if the code could not be written, which are
+ *		reported along with the other errors.
+ */
+
+bool CompilerContext::compile(ThreadPool &workers)
+{
+    CompilerContext *caller = context;
+    Arena *outer = Arena::current();
+    Tree *tree = Tree::current();
+    Interner *interner = Interner::current();
+    bool parsed = true;
+
+
+    context = this;
+    pool = &workers;
+    Arena::current(&arena);
+    Interner::current(names);
+
+    try {
+	parse(workers);
+    } catch (const SyntaxError &) {
+	flushFunctions();
+	parsed = false;
+    } catch (const length_error &e) {
+	flushFunctions();
+	diagnostics << e.what() << endl;
+	numErrors ++;
+	parsed = false;
+    }
+
+    out.flush();
+
+    if (writer.error() != 0) {
+	diagnostics << "cannot write assembly: " << strerror(writer.error());
+	diagnostics << endl;
+	parsed = false;
+    }
+
+    Interner::current(interner);
+    Tree::current(tree);
+    Arena::current(outer);
+    context = caller;
+    return parsed;
+}
+
+
+/*
+ * Function:	CompilerContext::errors (accessor)
+ *
+ * Description:	Return the number of errors reported so far.
+ */
+
+unsigned CompilerContext::errors() const
+{
+    return numErrors;
+}
+
+
+/*
+ * Function:	compile
+ *
+ * Description:	Compile the LENGTH characters of source at SOURCE,
+ *		appending the code to ASSEMBLY and any errors to
+ *		DIAGNOSTICS, with the given level of commentary.  Return
+ *		whether there were no errors at all.  Any number of
+ *		threads may call this at once.
+ */
+
+bool compile(const char *source, size_t length, string &assembly,
+	string &diagnostics, int annotations)
+{
+    ostringstream errors;
+    CompilerContext unit(errors);
+    ThreadPool pool(1);
+    bool succeeded;
+
+
+    unit.open(source, length);
+    unit.output(assembly);
+    unit.annotate(annotations);
+    succeeded = unit.compile(pool) && unit.errors() == 0;
+
+    diagnostics += errors.str();
+    return succeeded;
+}
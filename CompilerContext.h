@@ -0,0 +1,182 @@
+/*
+ * File:	CompilerContext.h
+ *
+ * Description:	This file contains the class definition for a compiler
+ *		context, which holds everything needed to compile a single
+ *		translation unit: the source and the tokens, the state of
+ *		the parser and the checker, the scope bindings, the labels
+ *		and function buffers of the code generator, and the arenas
+ *		that the trees, scopes, and symbols come from.  Nothing
+ *		about a compilation is kept in globals, so any number of
+ *		units can be compiled in one process, from as many threads
+ *		as we like, provided that each has a context of its own.
+ *
+ *		The source can be a file, the standard input, or a buffer
+ *		in memory, and the code can be written to a file, the
+ *		standard output, or a string.  Errors are reported to the
+ *		given stream.  A context compiles one unit only.
+ *
+ *		With more than one thread, the function bodies of a unit
+ *		are parsed and checked by contexts of their own, which
+ *		share the source and tokens of the unit and see its
+ *		outermost scope, but report to streams of their own and
+ *		have scopes and literals of their own.  The unit merges
+ *		what they did back in order.
+ *
+ *		A unit may also be given the names of some functions as
+ *		roots, and then only the functions that they can reach by
+ *		calls are parsed, checked, and generated at all.
+ *
+ *		A unit may also be given a cache of generated code, which
+ *		may be shared with other units.  The code of a function
+ *		that is found in the cache is used as it is, and the code
+ *		of one that is not is stored there once it is generated.
+ *
+ *		A unit with preprocessor directives is preprocessed once
+ *		it has been tokenized.  Included headers are looked for
+ *		in the directory of the source, and then in the given
+ *		directories, and come from a cache of headers, which may
+ *		also be shared, so that each is only tokenized once.
+ *
+ *		A unit may also be seeded with a snapshot of declarations,
+ *		which may likewise be shared.  If the source begins with
+ *		the source of the snapshot, its symbols are declared
+ *		straight from it, and only the rest of the source is
+ *		tokenized and parsed.
+ *
+ *		A unit may instead be given a stream of tokens that it
+ *		uses in place of its own, so that whoever keeps the source
+ *		can keep its tokens up to date as it is edited.  It may
+ *		also be given a memo of checked bodies, and is then only
+ *		checked: a body that the memo recalls is not parsed again,
+ *		and the code of the unit is good for nothing.
+ *
+ *		While a context is compiling, it is the current context of
+ *		the calling thread, and the modules of the compiler find
+ *		their state through it.  The data members are public for
+ *		that reason, and each belongs to the module named beside
+ *		it.  Its interner, which is whichever was current when it
+ *		was made, is made current as well.  The interner and the
+ *		type table are the only things shared between contexts,
+ *		and they can look after themselves.
+ */
+
+# ifndef COMPILERCONTEXT_H
+# define COMPILERCONTEXT_H
+# include <map>
+# include <memory>
+# include <deque>
+# include <mutex>
+# include <string>
+# include <vector>
+# include <condition_variable>
+# include <ostream>
+# include <iostream>
+# include "Arena.h"
+# include "AsmWriter.h"
+# include "generator.h"
+# include "lexer.h"
+
+class Cache;
+class Headers;
+class Interner;
+class Memo;
+class Snapshot;
+class ThreadPool;
+struct Binding;
+struct Header;
+
+class CompilerContext {
+    typedef std::string string;
+
+    string _buffer;
+    void *_mapping;
+    size_t _mapped;
+    TokenStream _tokens;
+
+public:
+    /* lexer.cpp */
+
+    Interner *names;
+    const char *source, *limit, *resume;
+    unsigned resumeLine;
+    bool tokenized;
+    int numErrors, lineno;
+    std::ostream diagnostics;
+
+    /* preprocessor.cpp */
+
+    string directory;
+    std::vector<string> includes;
+    Headers *headers;
+    std::vector<std::shared_ptr<const Header> > included;
+    unsigned directives;
+
+    /* parser.cpp */
+
+    TokenStream &tokens;
+    unsigned current, reached, pending;
+    int lookahead;
+    Type returnType;
+    Symbols globals;
+    Arena arena;
+    CompilerContext *unit;
+    std::vector<CompilerContext *> parsers, idle;
+    std::vector<string> roots;
+    Cache *cache;
+    const Snapshot *snapshot;
+    Memo *memo;
+
+    /* checker.cpp and Scope.cpp */
+
+    Scope *outermost, *toplevel;
+    std::vector<Binding *> bindings;
+    unsigned declarations, visible;
+
+    /* generator.cpp and Tree.cpp */
+
+    AsmWriter writer;
+    std::ostream out;
+    int annotations;
+    int strings, reals;
+    std::map<unsigned, int> Labels;
+    std::vector<fLabel> fLabels;
+    Expressions literals;
+    ThreadPool *pool;
+    std::deque<FunctionCode> functions;
+    std::vector<FunctionCode *> spares;
+    std::deque<FunctionCode *> generating;
+    std::mutex mutex;
+    std::condition_variable written;
+
+    CompilerContext(std::ostream &stream = std::cerr);
+    explicit CompilerContext(CompilerContext *unit);
+    CompilerContext(TokenStream &tokens, std::ostream &stream = std::cerr);
+    ~CompilerContext();
+
+    bool open(const char *path = 0);
+    void open(const char *buffer, size_t length);
+    bool output(const char *path);
+    void output(string &assembly);
+    void annotate(int level);
+    void root(const string &name);
+    void include(const string &directory);
+    void use(Cache &cache);
+    void use(Headers &headers);
+    void use(Memo &memo);
+    void seed(const Snapshot &snapshot);
+
+    bool compile(ThreadPool &workers);
+    unsigned errors() const;
+};
+
+/* The current context is declared __thread rather than thread_local,
+   since a pointer needs no construction, and so the modules can use it
+   without first checking whether it has been constructed. */
+
+extern __thread CompilerContext *context;
+
+bool compile(const char *source, size_t length, std::string &assembly,
+	std::string &diagnostics, int annotations = ANNOTATE_VERBOSE);
+
+# endif /* COMPILERCONTEXT_H */
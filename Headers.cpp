@@ -0,0 +1,180 @@
+/*
+ * File:	Headers.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		headers and for the cache of headers.
+ */
+
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include "Headers.h"
+# include "preprocessor.h"
+
+using namespace std;
+
+
+/*
+ * Function:	Header::Header (constructor)
+ *
+ * Description:	Initialize this header to be empty and unreadable.
+ */
+
+Header::Header()
+    : size(0), mapping(nullptr), source(nullptr), limit(nullptr),
+      guarded(false), readable(false)
+{
+    modified.tv_sec = 0;
+    modified.tv_nsec = 0;
+}
+
+
+/*
+ * Function:	Header::~Header (destructor)
+ *
+ * Description:	Unmap the file of this header.
+ */
+
+Header::~Header()
+{
+    if (mapping != nullptr)
+	munmap(mapping, size);
+}
+
+
+/*
+ * Function:	Headers::Headers (constructor)
+ *
+ * Description:	Initialize this cache to be empty.
+ */
+
+Headers::Headers()
+    : _tokenized(0), _reused(0)
+{
+}
+
+
+/*
+ * Function:	Headers::tokenize
+ *
+ * Description:	Map the file of the given header into memory and tokenize
+ *		it, keeping the spellings of its names and strings.  A
+ *		header is small enough that it is tokenized by the calling
+ *		thread alone.  An empty file cannot be mapped, so
+ *		it is given an empty source of its own.  If the file has
+ *		changed since we looked at it, it is left unreadable, and
+ *		the next unit to include it will look again.
+ */
+
+void Headers::tokenize(Header &header)
+{
+    struct stat st;
+    void *addr;
+    int fd;
+
+
+    if ((fd = ::open(header.path.c_str(), O_RDONLY)) < 0)
+	return;
+
+    if (fstat(fd, &st) != 0 || st.st_size != header.size ||
+	    st.st_mtim.tv_sec != header.modified.tv_sec ||
+	    st.st_mtim.tv_nsec != header.modified.tv_nsec) {
+	close(fd);
+	return;
+    }
+
+    if (header.size > 0) {
+	addr = mmap(0, header.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (addr == MAP_FAILED)
+	    return;
+
+	header.mapping = addr;
+	header.source = (const char *) addr;
+    } else {
+	close(fd);
+	header.source = "";
+    }
+
+    header.limit = header.source + header.size;
+    ::tokenize(header.source, header.limit, header.tokens, header.spellings);
+    header.guarded = guarded(header.source, header.tokens);
+    header.readable = true;
+    _tokenized ++;
+}
+
+
+/*
+ * Function:	Headers::open
+ *
+ * Description:	Return the header at the given path, tokenizing it if it
+ *		has not been tokenized since its file was last modified.
+ *		The cache is only locked to find the header, so several
+ *		headers can be tokenized at once, but a header is only
+ *		ever tokenized by one thread, and any others that want it
+ *		wait for it.  Return null if there is no such file, or it
+ *		cannot be read.
+ */
+
+shared_ptr<const Header> Headers::open(const string &path)
+{
+    shared_ptr<Header> header;
+    struct stat st;
+    bool tokenized = false;
+
+
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+	return nullptr;
+
+    {
+	lock_guard<mutex> guard(_mutex);
+	shared_ptr<Header> &slot = _headers[path];
+
+	if (slot == nullptr || slot->size != st.st_size ||
+		slot->modified.tv_sec != st.st_mtim.tv_sec ||
+		slot->modified.tv_nsec != st.st_mtim.tv_nsec) {
+	    slot = make_shared<Header>();
+	    slot->path = path;
+	    slot->modified = st.st_mtim;
+	    slot->size = st.st_size;
+	}
+
+	header = slot;
+    }
+
+    call_once(header->tokenized, [&]() {
+	tokenize(*header);
+	tokenized = true;
+    });
+
+    if (!tokenized && header->readable)
+	_reused ++;
+
+    return header->readable ? header : nullptr;
+}
+
+
+/*
+ * Function:	Headers::tokenized (accessor)
+ *
+ * Description:	Return the number of headers tokenized.
+ */
+
+unsigned Headers::tokenized() const
+{
+    return _tokenized;
+}
+
+
+/*
+ * Function:	Headers::reused (accessor)
+ *
+ * Description:	Return the number of times a header was included that had
+ *		already been tokenized.
+ */
+
+unsigned Headers::reused() const
+{
+    return _reused;
+}
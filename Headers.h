@@ -0,0 +1,74 @@
+/*
+ * File:	Headers.h
+ *
+ * Description:	This file contains the class definitions for a header and
+ *		for the cache of headers used by the preprocessor.
+ *
+ *		A header is mapped into memory and tokenized just once,
+ *		the first time it is included, and its tokens are kept
+ *		along with it, since they do not depend on who includes
+ *		it.  Only what the preprocessor then does with them does.
+ *		Units may have interners of their own, so the names and
+ *		strings of a header are not interned.  Instead, its tokens
+ *		refer to a table of their spellings, which a unit interns
+ *		when it first includes the header.
+ *		Headers are kept by path, and a header whose file has been
+ *		modified since is mapped and tokenized again.  A unit holds
+ *		on to the headers it included, so an old version stays
+ *		mapped for as long as anyone is using it.
+ *
+ *		A header that is wholly within an #ifndef of some macro
+ *		that it then defines, which is how an include guard is
+ *		written, remembers that it is guarded, so that a unit that
+ *		has already defined the macro can skip the header without
+ *		even looking at the rest of its tokens.
+ *
+ *		The cache can be shared by any number of units at once,
+ *		and in a batch or a server, each header is tokenized only
+ *		once no matter how many units include it.
+ */
+
+# ifndef HEADERS_H
+# define HEADERS_H
+# include <atomic>
+# include <map>
+# include <memory>
+# include <mutex>
+# include <string>
+# include <sys/stat.h>
+# include "lexer.h"
+
+struct Header {
+    std::string path;
+    struct timespec modified;
+    off_t size;
+    void *mapping;
+    const char *source, *limit;
+    TokenStream tokens;
+    Spellings spellings;
+    bool guarded, readable;
+    std::once_flag tokenized;
+
+    Header();
+    ~Header();
+};
+
+class Headers {
+    typedef std::string string;
+
+    std::mutex _mutex;
+    std::map<string, std::shared_ptr<Header> > _headers;
+    std::atomic<unsigned> _tokenized, _reused;
+
+    void tokenize(Header &header);
+
+public:
+    Headers();
+
+    std::shared_ptr<const Header> open(const string &path);
+
+    unsigned tokenized() const;
+    unsigned reused() const;
+};
+
+# endif /* HEADERS_H */
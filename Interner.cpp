@@ -0,0 +1,222 @@
+/*
+ * File:	Interner.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the string interner for Simple C.  The hash table uses
+ *		open addressing with linear probing, and each slot holds
+ *		an id plus one, so that a zero slot is empty.
+ */
+
+# include <cstring>
+# include <stdexcept>
+# include "Interner.h"
+
+using namespace std;
+
+thread_local Interner *Interner::_current = nullptr;
+
+
+/*
+ * Function:	Interner::Interner (constructor)
+ *
+ * Description:	Initialize this interner to be empty.
+ */
+
+Interner::Interner()
+    : _slots(1024, 0), _count(0)
+{
+    memset(_blocks, 0, sizeof(_blocks));
+}
+
+
+/*
+ * Function:	Interner::~Interner (destructor)
+ *
+ * Description:	Free the blocks of strings.
+ */
+
+Interner::~Interner()
+{
+    for (unsigned i = 0; i < MAX_BLOCKS && _blocks[i] != 0; i ++)
+	delete[] _blocks[i];
+}
+
+
+/*
+ * Function:	Interner::hash
+ *
+ * Description:	Return the FNV-1a hash of the N characters at S.
+ */
+
+unsigned Interner::hash(const char *s, unsigned n)
+{
+    unsigned h = 2166136261u;
+
+    for (unsigned i = 0; i < n; i ++)
+	h = (h ^ (unsigned char) s[i]) * 16777619u;
+
+    return h;
+}
+
+
+/*
+ * Function:	Interner::insert
+ *
+ * Description:	Return the id of the N characters at S, adding them if
+ *		they haven't been seen before.  The caller holds the lock.
+ *		Once every block is full, there is no room for more.
+ */
+
+unsigned Interner::insert(const char *s, unsigned n)
+{
+    unsigned mask, i, id;
+
+
+    mask = _slots.size() - 1;
+
+    for (i = hash(s, n) & mask; _slots[i] != 0; i = (i + 1) & mask) {
+	const string &name = this->name(_slots[i] - 1);
+
+	if (name.size() == n && memcmp(name.data(), s, n) == 0)
+	    return _slots[i] - 1;
+    }
+
+    if (_count == (unsigned) BLOCK_SIZE * MAX_BLOCKS)
+	throw length_error("too many names");
+
+    id = _count ++;
+
+    if (_blocks[id / BLOCK_SIZE] == 0)
+	_blocks[id / BLOCK_SIZE] = new string[BLOCK_SIZE];
+
+    _blocks[id / BLOCK_SIZE][id % BLOCK_SIZE].assign(s, n);
+    _slots[i] = id + 1;
+
+
+    /* Keep the table at most half full. */
+
+    if (_count * 2 > _slots.size()) {
+	vector<unsigned> slots(_slots.size() * 2, 0);
+	mask = slots.size() - 1;
+
+	for (unsigned j = 0; j < _count; j ++) {
+	    const string &name = this->name(j);
+
+	    for (i = hash(name.data(), name.size()) & mask; slots[i] != 0; )
+		i = (i + 1) & mask;
+
+	    slots[i] = j + 1;
+	}
+
+	_slots.swap(slots);
+    }
+
+    return id;
+}
+
+
+/*
+ * Function:	Interner::intern
+ *
+ * Description:	Return the id of the N characters at S.
+ */
+
+unsigned Interner::intern(const char *s, unsigned n)
+{
+    lock_guard<mutex> lock(_mutex);
+    return insert(s, n);
+}
+
+
+/*
+ * Function:	Interner::intern
+ *
+ * Description:	Return the id of the given string.
+ */
+
+unsigned Interner::intern(const string &s)
+{
+    return intern(s.data(), s.size());
+}
+
+
+/*
+ * Function:	Interner::intern
+ *
+ * Description:	Intern COUNT strings at once, storing their ids in IDS.
+ *		The strings are interned in order, so the ids come out the
+ *		same as if they had been interned one at a time.
+ */
+
+void Interner::intern(const char *const *s, const unsigned *n,
+	unsigned count, unsigned *ids)
+{
+    lock_guard<mutex> lock(_mutex);
+
+    for (unsigned i = 0; i < count; i ++)
+	ids[i] = insert(s[i], n[i]);
+}
+
+
+/*
+ * Function:	Interner::name (accessor)
+ *
+ * Description:	Return the string with the given id.
+ */
+
+const string &Interner::name(unsigned id) const
+{
+    return _blocks[id / BLOCK_SIZE][id % BLOCK_SIZE];
+}
+
+
+/*
+ * Function:	Interner::size (accessor)
+ *
+ * Description:	Return the number of distinct strings interned.
+ */
+
+unsigned Interner::size() const
+{
+    return _count;
+}
+
+
+/*
+ * Function:	Interner::global
+ *
+ * Description:	Return the global interner, which lives as long as the
+ *		program does.
+ */
+
+Interner &Interner::global()
+{
+    static Interner global;
+    return global;
+}
+
+
+/*
+ * Function:	Interner::current (accessor)
+ *
+ * Description:	Return the current interner of the calling thread.
+ */
+
+Interner *Interner::current()
+{
+    return _current != nullptr ? _current : &global();
+}
+
+
+/*
+ * Function:	Interner::current (mutator)
+ *
+ * Description:	Make the given interner the current interner of the
+ *		calling thread.  A null interner means the global
+ *		interner.
+ */
+
+void Interner::current(Interner *interner)
+{
+    _current = interner;
+}
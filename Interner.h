@@ -0,0 +1,63 @@
+/*
+ * File:	Interner.h
+ *
+ * Description:	This file contains the class definition for the string
+ *		interner for Simple C.  Each distinct string is stored
+ *		once and is given a small integer id, so that names can be
+ *		compared, hashed, and stored as integers.  Ids are handed
+ *		out densely, in the order strings are first interned.
+ *
+ *		Each thread has a current interner, which by default is
+ *		the global interner that lives as long as the process.  A
+ *		server makes an interner of its own current instead, one
+ *		for each of its threads or documents, and replaces it once
+ *		it has grown too large, so that names are thrown away
+ *		rather than piling up for good.  An interner
+ *		may be shared by several threads.  Interning takes a lock,
+ *		so a caller with many strings should intern them in one
+ *		batch.  Looking up the string for an id takes no lock at
+ *		all: strings are kept in blocks that never move, and the
+ *		table of blocks never grows.  So, an interner can only
+ *		hold so many strings, and interning one more than that
+ *		throws a length error.
+ */
+
+# ifndef INTERNER_H
+# define INTERNER_H
+# include <mutex>
+# include <string>
+# include <vector>
+
+class Interner {
+    typedef std::string string;
+
+    enum { BLOCK_SIZE = 4096, MAX_BLOCKS = 65536 };
+
+    std::mutex _mutex;
+    std::vector<unsigned> _slots;
+    string *_blocks[MAX_BLOCKS];
+    unsigned _count;
+
+    static thread_local Interner *_current;
+
+    unsigned insert(const char *s, unsigned n);
+
+public:
+    Interner();
+    ~Interner();
+
+    unsigned intern(const char *s, unsigned n);
+    unsigned intern(const string &s);
+    void intern(const char *const *s, const unsigned *n, unsigned count,
+	    unsigned *ids);
+    const string &name(unsigned id) const;
+    unsigned size() const;
+
+    static unsigned hash(const char *s, unsigned n);
+
+    static Interner &global();
+    static Interner *current();
+    static void current(Interner *interner);
+};
+
+# endif /* INTERNER_H */
@@ -0,0 +1,660 @@
+/*
+ * File:	Json.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		JSON values.
+ */
+
+# include <algorithm>
+# include <cmath>
+# include <cstdio>
+# include <cstdlib>
+# include "Json.h"
+
+using namespace std;
+
+/* Nesting deeper than this is taken to be an error rather than risk
+   running out of stack on a malicious message. */
+
+static const unsigned MAX_DEPTH = 256;
+
+static const Json null;
+
+
+/*
+ * Function:	Json::Json (constructor)
+ *
+ * Description:	Initialize this value to be null.
+ */
+
+Json::Json()
+    : _kind(NUL), _boolean(false), _number(0)
+{
+}
+
+
+/*
+ * Function:	Json::Json (constructor)
+ *
+ * Description:	Initialize this value to be the given boolean.
+ */
+
+Json::Json(bool boolean)
+    : _kind(BOOLEAN), _boolean(boolean), _number(0)
+{
+}
+
+
+/*
+ * Function:	Json::Json (constructor)
+ *
+ * Description:	Initialize this value to be the given number.
+ */
+
+Json::Json(int number)
+    : _kind(NUMBER), _boolean(false), _number(number)
+{
+}
+
+
+/*
+ * Function:	Json::Json (constructor)
+ *
+ * Description:	Initialize this value to be the given number.
+ */
+
+Json::Json(unsigned number)
+    : _kind(NUMBER), _boolean(false), _number(number)
+{
+}
+
+
+/*
+ * Function:	Json::Json (constructor)
+ *
+ * Description:	Initialize this value to be the given number.
+ */
+
+Json::Json(double number)
+    : _kind(NUMBER), _boolean(false), _number(number)
+{
+}
+
+
+/*
+ * Function:	Json::Json (constructor)
+ *
+ * Description:	Initialize this value to be the given string.
+ */
+
+Json::Json(const char *s)
+    : _kind(STRING), _boolean(false), _number(0), _string(s)
+{
+}
+
+
+/*
+ * Function:	Json::Json (constructor)
+ *
+ * Description:	Initialize this value to be the given string.
+ */
+
+Json::Json(const string &s)
+    : _kind(STRING), _boolean(false), _number(0), _string(s)
+{
+}
+
+
+/*
+ * Function:	Json::array
+ *
+ * Description:	Return an empty array.
+ */
+
+Json Json::array()
+{
+    Json value;
+
+
+    value._kind = ARRAY;
+    return value;
+}
+
+
+/*
+ * Function:	Json::object
+ *
+ * Description:	Return an empty object.
+ */
+
+Json Json::object()
+{
+    Json value;
+
+
+    value._kind = OBJECT;
+    return value;
+}
+
+
+/*
+ * Function:	skip
+ *
+ * Description:	Skip any white space at P.
+ */
+
+static void skip(const char *&p, const char *end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+	p ++;
+}
+
+
+/*
+ * Function:	hex
+ *
+ * Description:	Read the four hexadecimal digits of an escape at P into
+ *		CODE.  Return false if they are not there.
+ */
+
+static bool hex(const char *&p, const char *end, unsigned &code)
+{
+    int c;
+
+
+    code = 0;
+
+    for (unsigned i = 0; i < 4; i ++, p ++) {
+	if (p == end)
+	    return false;
+
+	c = *p;
+
+	if (c >= '0' && c <= '9')
+	    code = code * 16 + c - '0';
+	else if (c >= 'a' && c <= 'f')
+	    code = code * 16 + c - 'a' + 10;
+	else if (c >= 'A' && c <= 'F')
+	    code = code * 16 + c - 'A' + 10;
+	else
+	    return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	encode
+ *
+ * Description:	Append the given code point to OUT in UTF-8.
+ */
+
+static void encode(unsigned code, string &out)
+{
+    if (code < 0x80)
+	out += (char) code;
+    else if (code < 0x800) {
+	out += (char) (0xc0 | code >> 6);
+	out += (char) (0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+	out += (char) (0xe0 | code >> 12);
+	out += (char) (0x80 | (code >> 6 & 0x3f));
+	out += (char) (0x80 | (code & 0x3f));
+    } else {
+	out += (char) (0xf0 | code >> 18);
+	out += (char) (0x80 | (code >> 12 & 0x3f));
+	out += (char) (0x80 | (code >> 6 & 0x3f));
+	out += (char) (0x80 | (code & 0x3f));
+    }
+}
+
+
+/*
+ * Function:	unquote
+ *
+ * Description:	Read the string at P, which starts with its opening quote,
+ *		into OUT.  An escaped surrogate pair is joined into the
+ *		code point it stands for.  Return false if it is not a
+ *		valid string.
+ */
+
+static bool unquote(const char *&p, const char *end, string &out)
+{
+    unsigned code, low;
+
+
+    for (p ++; p < end && *p != '"'; )
+	if (*p != '\\')
+	    out += *p ++;
+	else if (++ p == end)
+	    return false;
+	else {
+	    switch (*p ++) {
+	    case '"':	out += '"'; break;
+	    case '\\':	out += '\\'; break;
+	    case '/':	out += '/'; break;
+	    case 'b':	out += '\b'; break;
+	    case 'f':	out += '\f'; break;
+	    case 'n':	out += '\n'; break;
+	    case 'r':	out += '\r'; break;
+	    case 't':	out += '\t'; break;
+
+	    case 'u':
+		if (!hex(p, end, code))
+		    return false;
+
+		if (code >= 0xd800 && code < 0xdc00 && end - p >= 6 &&
+			p[0] == '\\' && p[1] == 'u') {
+		    p += 2;
+
+		    if (!hex(p, end, low) || low < 0xdc00 || low >= 0xe000)
+			return false;
+
+		    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+		}
+
+		encode(code, out);
+		break;
+
+	    default:
+		return false;
+	    }
+	}
+
+    if (p == end)
+	return false;
+
+    p ++;
+    return true;
+}
+
+
+/*
+ * Function:	Json::parse
+ *
+ * Description:	Read the value at P into VALUE, which is null, at the
+ *		given DEPTH of nesting.  Return false if it is not a
+ *		valid value.
+ */
+
+bool Json::parse(const char *&p, const char *end, Json &value,
+	unsigned depth)
+{
+    char *rest;
+    string key;
+
+
+    skip(p, end);
+
+    if (p == end || depth > MAX_DEPTH)
+	return false;
+
+    if (*p == '{') {
+	value._kind = OBJECT;
+	p ++, skip(p, end);
+
+	if (p < end && *p == '}') {
+	    p ++;
+	    return true;
+	}
+
+	while (1) {
+	    key.clear();
+	    skip(p, end);
+
+	    if (p == end || *p != '"' || !unquote(p, end, key))
+		return false;
+
+	    skip(p, end);
+
+	    if (p == end || *p ++ != ':')
+		return false;
+
+	    value._members.push_back(make_pair(key, Json()));
+
+	    if (!parse(p, end, value._members.back().second, depth + 1))
+		return false;
+
+	    skip(p, end);
+
+	    if (p == end)
+		return false;
+
+	    if (*p == '}') {
+		p ++;
+		return true;
+	    }
+
+	    if (*p ++ != ',')
+		return false;
+	}
+    }
+
+    if (*p == '[') {
+	value._kind = ARRAY;
+	p ++, skip(p, end);
+
+	if (p < end && *p == ']') {
+	    p ++;
+	    return true;
+	}
+
+	while (1) {
+	    value._elements.push_back(Json());
+
+	    if (!parse(p, end, value._elements.back(), depth + 1))
+		return false;
+
+	    skip(p, end);
+
+	    if (p == end)
+		return false;
+
+	    if (*p == ']') {
+		p ++;
+		return true;
+	    }
+
+	    if (*p ++ != ',')
+		return false;
+	}
+    }
+
+    if (*p == '"') {
+	value._kind = STRING;
+	return unquote(p, end, value._string);
+    }
+
+    if (end - p >= 4 && string(p, 4) == "null") {
+	p += 4;
+	return true;
+    }
+
+    if (end - p >= 4 && string(p, 4) == "true") {
+	value = Json(true);
+	p += 4;
+	return true;
+    }
+
+    if (end - p >= 5 && string(p, 5) == "false") {
+	value = Json(false);
+	p += 5;
+	return true;
+    }
+
+    if (*p == '-' || (*p >= '0' && *p <= '9')) {
+	key.assign(p, min<size_t>(end - p, 64));
+	value._kind = NUMBER;
+	value._number = strtod(key.c_str(), &rest);
+	p += rest - key.c_str();
+	return rest != key.c_str();
+    }
+
+    return false;
+}
+
+
+/*
+ * Function:	Json::parse
+ *
+ * Description:	Read the given text into VALUE.  Return false if it is
+ *		not a single valid value.
+ */
+
+bool Json::parse(const string &text, Json &value)
+{
+    const char *p = text.data(), *end = p + text.size();
+
+
+    value = Json();
+
+    if (!parse(p, end, value, 0))
+	return false;
+
+    skip(p, end);
+    return p == end;
+}
+
+
+/*
+ * Function:	Json::quote
+ *
+ * Description:	Append the given string to OUT as a JSON string, escaping
+ *		the quotes, backslashes, and control characters in it.
+ */
+
+void Json::quote(const string &s, string &out)
+{
+    char buf[8];
+
+
+    out += '"';
+
+    for (unsigned i = 0; i < s.size(); i ++)
+	if (s[i] == '"' || s[i] == '\\') {
+	    out += '\\';
+	    out += s[i];
+	} else if (s[i] == '\n')
+	    out += "\\n";
+	else if (s[i] == '\t')
+	    out += "\\t";
+	else if ((unsigned char) s[i] < 0x20) {
+	    snprintf(buf, sizeof(buf), "\\u%04x", s[i]);
+	    out += buf;
+	} else
+	    out += s[i];
+
+    out += '"';
+}
+
+
+/*
+ * Function:	Json::kind (accessor)
+ *
+ * Description:	Return the kind of this value.
+ */
+
+Json::Kind Json::kind() const
+{
+    return _kind;
+}
+
+
+/*
+ * Function:	Json::boolean (accessor)
+ *
+ * Description:	Return whether this value is true.
+ */
+
+bool Json::boolean() const
+{
+    return _kind == BOOLEAN && _boolean;
+}
+
+
+/*
+ * Function:	Json::number (accessor)
+ *
+ * Description:	Return the number of this value, or zero if it is not a
+ *		number.
+ */
+
+double Json::number() const
+{
+    return _number;
+}
+
+
+/*
+ * Function:	Json::str (accessor)
+ *
+ * Description:	Return the string of this value, or an empty string if it
+ *		is not a string.
+ */
+
+const string &Json::str() const
+{
+    return _string;
+}
+
+
+/*
+ * Function:	Json::size (accessor)
+ *
+ * Description:	Return the number of elements or members of this value.
+ */
+
+size_t Json::size() const
+{
+    return _kind == ARRAY ? _elements.size() : _members.size();
+}
+
+
+/*
+ * Function:	Json::operator [] (accessor)
+ *
+ * Description:	Return the element of this array at the given INDEX, or
+ *		null if there is none.
+ */
+
+const Json &Json::operator [](size_t index) const
+{
+    return index < _elements.size() ? _elements[index] : null;
+}
+
+
+/*
+ * Function:	Json::operator [] (accessor)
+ *
+ * Description:	Return the member of this object with the given KEY, or
+ *		null if there is none.
+ */
+
+const Json &Json::operator [](const string &key) const
+{
+    for (unsigned i = 0; i < _members.size(); i ++)
+	if (_members[i].first == key)
+	    return _members[i].second;
+
+    return null;
+}
+
+
+/*
+ * Function:	Json::add (mutator)
+ *
+ * Description:	Append the given element to this array.
+ */
+
+Json &Json::add(const Json &element)
+{
+    _elements.push_back(element);
+    return *this;
+}
+
+
+/*
+ * Function:	Json::set (mutator)
+ *
+ * Description:	Set the member of this object with the given KEY to the
+ *		given value, adding it if it is not there yet.
+ */
+
+Json &Json::set(const string &key, const Json &value)
+{
+    for (unsigned i = 0; i < _members.size(); i ++)
+	if (_members[i].first == key) {
+	    _members[i].second = value;
+	    return *this;
+	}
+
+    _members.push_back(make_pair(key, value));
+    return *this;
+}
+
+
+/*
+ * Function:	Json::write
+ *
+ * Description:	Append this value to OUT as JSON text.  A whole number is
+ *		written without a fraction, and a number that JSON cannot
+ *		hold is written as null.
+ */
+
+void Json::write(string &out) const
+{
+    char buf[32];
+
+
+    switch (_kind) {
+    case NUL:
+	out += "null";
+	break;
+
+    case BOOLEAN:
+	out += _boolean ? "true" : "false";
+	break;
+
+    case NUMBER:
+	if (!isfinite(_number))
+	    out += "null";
+	else if (_number == floor(_number) && fabs(_number) < 1e15) {
+	    snprintf(buf, sizeof(buf), "%.0f", _number);
+	    out += buf;
+	} else {
+	    snprintf(buf, sizeof(buf), "%.17g", _number);
+	    out += buf;
+	}
+
+	break;
+
+    case STRING:
+	quote(_string, out);
+	break;
+
+    case ARRAY:
+	out += '[';
+
+	for (unsigned i = 0; i < _elements.size(); i ++) {
+	    if (i > 0)
+		out += ',';
+
+	    _elements[i].write(out);
+	}
+
+	out += ']';
+	break;
+
+    case OBJECT:
+	out += '{';
+
+	for (unsigned i = 0; i < _members.size(); i ++) {
+	    if (i > 0)
+		out += ',';
+
+	    quote(_members[i].first, out);
+	    out += ':';
+	    _members[i].second.write(out);
+	}
+
+	out += '}';
+	break;
+    }
+}
+
+
+/*
+ * Function:	Json::text
+ *
+ * Description:	Return this value as JSON text.
+ */
+
+string Json::text() const
+{
+    string out;
+
+
+    write(out);
+    return out;
+}
@@ -0,0 +1,69 @@
+/*
+ * File:	Json.h
+ *
+ * Description:	This file contains the class definition for JSON values,
+ *		which is just enough JSON for the language server to read
+ *		the messages of its client and to write its own.
+ *
+ *		A value is null, a boolean, a number, a string, an array,
+ *		or an object, and is held by value like a type.  The
+ *		members of an object are kept in the order they were
+ *		added, and looking up a member that is not there gives
+ *		null rather than an error, since a client can leave out
+ *		almost anything.  Numbers are kept as doubles, which hold
+ *		any integer a client will send us.  Strings are kept in
+ *		UTF-8, which is what we read and write.
+ */
+
+# ifndef JSON_H
+# define JSON_H
+# include <string>
+# include <vector>
+
+class Json {
+    typedef std::string string;
+
+public:
+    enum Kind { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+private:
+    Kind _kind;
+    bool _boolean;
+    double _number;
+    string _string;
+    std::vector<Json> _elements;
+    std::vector<std::pair<string, Json> > _members;
+
+    static bool parse(const char *&p, const char *end, Json &value,
+	    unsigned depth);
+
+public:
+    Json();
+    Json(bool boolean);
+    Json(int number);
+    Json(unsigned number);
+    Json(double number);
+    Json(const char *s);
+    Json(const string &s);
+
+    static Json array();
+    static Json object();
+    static bool parse(const string &text, Json &value);
+    static void quote(const string &s, string &out);
+
+    Kind kind() const;
+    bool boolean() const;
+    double number() const;
+    const string &str() const;
+    size_t size() const;
+    const Json &operator [](size_t index) const;
+    const Json &operator [](const string &key) const;
+
+    Json &add(const Json &element);
+    Json &set(const string &key, const Json &value);
+
+    void write(string &out) const;
+    string text() const;
+};
+
+# endif /* JSON_H */
@@ -0,0 +1,628 @@
+/*
+ * File:	LanguageServer.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the language server.
+ */
+
+# include <algorithm>
+# include <chrono>
+# include <cstdlib>
+# include <cstring>
+# include <limits>
+# include <sstream>
+# include "CompilerContext.h"
+# include "LanguageServer.h"
+# include "ThreadPool.h"
+# include "tokens.h"
+
+using namespace std;
+using namespace std::chrono;
+
+/* The error codes of the protocol that we send. */
+
+enum {
+    PARSE_ERROR = -32700, INVALID_REQUEST = -32600,
+    METHOD_NOT_FOUND = -32601
+};
+
+/* The kinds of synchronization of the protocol, of which we ask for
+   incremental changes, and the severity of an error. */
+
+enum { SYNC_INCREMENTAL = 2, SEVERITY_ERROR = 1 };
+
+/* No message may be longer than this, so that a header that makes no
+   sense cannot make us allocate more than a real message would.  A
+   body is read this much at a time, so that we only allocate as much
+   as has actually arrived. */
+
+static const size_t MAX_LENGTH = 1 << 28;
+static const size_t CHUNK = 1 << 20;
+
+/* A document is tokenized again with a new interner once its interner
+   holds this many names more than twice as many as it did the last
+   time, so that the names of a long session do not pile up. */
+
+static const unsigned SPARE = 1 << 16;
+
+
+/*
+ * Function:	unescape
+ *
+ * Description:	Return the path of the given file URI, decoding any
+ *		escaped characters in it, or an empty string if it is not
+ *		a file URI.
+ */
+
+static string unescape(const string &uri)
+{
+    static const string scheme = "file://";
+    string path;
+
+
+    if (uri.compare(0, scheme.size(), scheme) != 0)
+	return "";
+
+    for (size_t i = scheme.size(); i < uri.size(); i ++)
+	if (uri[i] == '%' && i + 2 < uri.size()) {
+	    path += (char) strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+	    i += 2;
+	} else
+	    path += uri[i];
+
+    return path;
+}
+
+
+/*
+ * Function:	index
+ *
+ * Description:	Find where each line of the given document starts.
+ */
+
+static void index(Document &document)
+{
+    const char *text = document.text.data(), *p, *end;
+
+
+    end = text + document.text.size();
+    document.lines.assign(1, 0);
+
+    for (p = text; (p = (const char *) memchr(p, '\n', end - p)); p ++)
+	document.lines.push_back(p + 1 - text);
+}
+
+
+/*
+ * Function:	LanguageServer::LanguageServer (constructor)
+ *
+ * Description:	Initialize this server to read messages from IN and write
+ *		them to OUT, checking documents with the given pool and
+ *		taking included headers from the given cache.
+ */
+
+LanguageServer::LanguageServer(istream &in, ostream &out, ThreadPool &pool,
+	Headers &headers)
+    : _in(in), _out(out), _log(nullptr), _pool(pool), _headers(headers),
+      _utf8(false), _shutdown(false)
+{
+}
+
+
+/*
+ * Function:	LanguageServer::include (mutator)
+ *
+ * Description:	Look for headers included by a document in the given
+ *		directory, after its own directory and those already
+ *		given.
+ */
+
+void LanguageServer::include(const string &directory)
+{
+    _includes.push_back(directory);
+}
+
+
+/*
+ * Function:	LanguageServer::log (mutator)
+ *
+ * Description:	Write how long each check took, and how many bodies it
+ *		checked again, to the given stream.
+ */
+
+void LanguageServer::log(ostream &stream)
+{
+    _log = &stream;
+}
+
+
+/*
+ * Function:	LanguageServer::receive
+ *
+ * Description:	Read the next message into MESSAGE, which is null if it
+ *		is not valid JSON.  A message longer than we take is
+ *		skipped without being kept, and we answer it with an
+ *		error.  Return false at the end of the input.
+ */
+
+bool LanguageServer::receive(Json &message)
+{
+    static const string field = "content-length:";
+    size_t length = 0, size, n;
+    string line, body;
+    bool sized = false;
+
+
+    while (getline(_in, line)) {
+	if (!line.empty() && line[line.size() - 1] == '\r')
+	    line.erase(line.size() - 1);
+
+	if (line.empty()) {
+	    if (!sized)
+		continue;
+
+	    if (length > MAX_LENGTH) {
+		fail(Json(), INVALID_REQUEST, "message too long");
+		size = numeric_limits<streamsize>::max();
+		_in.ignore(min(length, size));
+
+		if ((size_t) _in.gcount() < length)
+		    return false;
+
+		length = 0;
+		sized = false;
+		continue;
+	    }
+
+	    for (size = 0; size < length; size += n) {
+		n = min(length - size, CHUNK);
+		body.resize(size + n);
+
+		if (!_in.read(&body[size], n))
+		    return false;
+	    }
+
+	    if (!Json::parse(body, message))
+		message = Json();
+
+	    return true;
+	}
+
+	transform(line.begin(), line.end(), line.begin(), ::tolower);
+
+	if (line.compare(0, field.size(), field) == 0) {
+	    length = strtoul(line.c_str() + field.size(), nullptr, 10);
+	    sized = true;
+	}
+    }
+
+    return false;
+}
+
+
+/*
+ * Function:	LanguageServer::send
+ *
+ * Description:	Write the given message.
+ */
+
+void LanguageServer::send(const Json &message)
+{
+    string body = message.text();
+
+
+    _out << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    _out.flush();
+}
+
+
+/*
+ * Function:	LanguageServer::respond
+ *
+ * Description:	Send the given result of the request with the given id.
+ */
+
+void LanguageServer::respond(const Json &id, const Json &result)
+{
+    Json response = Json::object();
+
+
+    response.set("jsonrpc", "2.0").set("id", id).set("result", result);
+    send(response);
+}
+
+
+/*
+ * Function:	LanguageServer::fail
+ *
+ * Description:	Send the given error in reply to the request with the
+ *		given id.
+ */
+
+void LanguageServer::fail(const Json &id, int code, const string &message)
+{
+    Json response = Json::object(), error = Json::object();
+
+
+    error.set("code", code).set("message", message);
+    response.set("jsonrpc", "2.0").set("id", id).set("error", error);
+    send(response);
+}
+
+
+/*
+ * Function:	LanguageServer::units
+ *
+ * Description:	Return the number of code units that the UTF-8 text from P
+ *		to END takes up, in the encoding of positions.  A code
+ *		point beyond the basic plane takes two UTF-16 units.
+ */
+
+unsigned LanguageServer::units(const char *p, const char *end) const
+{
+    unsigned count = 0;
+
+
+    if (_utf8)
+	return end - p;
+
+    for (; p < end; p ++)
+	if ((*p & 0xc0) != 0x80)
+	    count += ((*p & 0xf8) == 0xf0 ? 2 : 1);
+
+    return count;
+}
+
+
+/*
+ * Function:	LanguageServer::offset
+ *
+ * Description:	Return the offset in the text of the given document of the
+ *		given position.  A position past the end of its line is
+ *		taken to be at the end of the line.
+ */
+
+size_t LanguageServer::offset(const Document &document,
+	const Json &position) const
+{
+    const char *text = document.text.data(), *p, *q, *end;
+    double line = position["line"].number();
+    double character = position["character"].number();
+    unsigned count = 0;
+
+
+    if (line < 0 || line >= document.lines.size())
+	return document.text.size();
+
+    p = text + document.lines[(size_t) line];
+    end = text + document.text.size();
+
+    while (p < end && *p != '\n' && count < character) {
+	for (q = p + 1; q < end && (*q & 0xc0) == 0x80; q ++)
+	    continue;
+
+	count += units(p, q);
+	p = q;
+    }
+
+    return p - text;
+}
+
+
+/*
+ * Function:	LanguageServer::publish
+ *
+ * Description:	Publish the given diagnostics of the given document, each
+ *		of which is on a line of its own, and begins with the line
+ *		it was reported on.
+ */
+
+void LanguageServer::publish(const Document &document,
+	const string &diagnostics)
+{
+    Json params = Json::object(), list = Json::array();
+    Json notification = Json::object();
+    const char *text = document.text.data(), *p, *end;
+    istringstream in(diagnostics);
+    unsigned line, lines;
+    string message;
+    size_t colon;
+
+
+    lines = document.lines.size();
+
+    while (getline(in, message)) {
+	if (message.compare(0, 5, "line ") != 0 ||
+		(colon = message.find(": ")) == string::npos)
+	    continue;
+
+	line = strtoul(message.c_str() + 5, nullptr, 10);
+	line = (line > lines ? lines : line > 0 ? line : 1) - 1;
+
+	p = text + document.lines[line];
+	end = text + (line + 1 < lines ? document.lines[line + 1] - 1 :
+		document.text.size());
+
+	if (end > p && end[-1] == '\r')
+	    end --;
+
+	Json start = Json::object(), stop = Json::object();
+	Json range = Json::object(), diagnostic = Json::object();
+
+	start.set("line", line).set("character", 0);
+	stop.set("line", line).set("character", units(p, end));
+	range.set("start", start).set("end", stop);
+
+	diagnostic.set("range", range).set("severity", SEVERITY_ERROR);
+	diagnostic.set("source", "scc");
+	diagnostic.set("message", message.substr(colon + 2));
+	list.add(diagnostic);
+    }
+
+    params.set("uri", document.uri).set("diagnostics", list);
+    notification.set("jsonrpc", "2.0");
+    notification.set("method", "textDocument/publishDiagnostics");
+    notification.set("params", params);
+    send(notification);
+}
+
+
+/*
+ * Function:	LanguageServer::check
+ *
+ * Description:	Check the given document and publish its diagnostics.
+ *		The unit uses the tokens of the document in place, unless
+ *		it has directives, since the preprocessor would replace
+ *		them, and then it is given a copy.  Its code is thrown
+ *		away.
+ */
+
+void LanguageServer::check(Document &document)
+{
+    steady_clock::time_point start = steady_clock::now();
+    TokenStream copy, *tokens = &document.tokens;
+    Interner *interner = Interner::current();
+    string assembly;
+    stringbuf text;
+    ostream stream(&text);
+    double elapsed;
+
+
+    if (find(tokens->kind.begin(), tokens->kind.end(), HASH) !=
+	    tokens->kind.end()) {
+	copy = *tokens;
+	tokens = &copy;
+    }
+
+    Interner::current(document.names.get());
+
+    {
+	CompilerContext unit(*tokens, stream);
+
+	unit.open(document.text.data(), document.text.size());
+	unit.output(assembly);
+	unit.annotate(ANNOTATE_NONE);
+	unit.directory = document.directory;
+
+	for (unsigned i = 0; i < _includes.size(); i ++)
+	    unit.include(_includes[i]);
+
+	unit.use(_headers);
+	unit.use(document.memo);
+	unit.compile(_pool);
+    }
+
+    Interner::current(interner);
+
+    publish(document, text.str());
+    elapsed = duration<double>(steady_clock::now() - start).count();
+
+    if (_log != nullptr) {
+	*_log << document.uri << ": checked in " << elapsed * 1e3 << " ms, ";
+	*_log << document.memo.rechecked() << " of ";
+	*_log << document.memo.rechecked() + document.memo.recalled();
+	*_log << " bodies again" << endl;
+    }
+}
+
+
+/*
+ * Function:	LanguageServer::rebuild
+ *
+ * Description:	Tokenize the whole of the given document, with a new
+ *		interner that holds just the names it has now, and forget
+ *		what its bodies reported, since that was in terms of the
+ *		old one.
+ */
+
+void LanguageServer::rebuild(Document &document)
+{
+    const char *text = document.text.data();
+    Interner *interner = Interner::current();
+
+
+    document.names.reset(new Interner());
+    document.tokens = TokenStream();
+    document.memo = Memo();
+
+    Interner::current(document.names.get());
+    tokenize(text, text, text + document.text.size(), 1, document.tokens,
+	_pool);
+    Interner::current(interner);
+
+    document.interned = document.names->size();
+}
+
+
+/*
+ * Function:	LanguageServer::open
+ *
+ * Description:	Open the document given by PARAMS, tokenize it, and check
+ *		it.
+ */
+
+void LanguageServer::open(const Json &params)
+{
+    const Json &item = params["textDocument"];
+    const string &uri = item["uri"].str();
+    string path = unescape(uri);
+
+
+    Document &document = _documents[uri];
+
+    document.uri = uri;
+    document.directory = path.substr(0, path.rfind('/') + 1);
+    document.text = item["text"].str();
+    index(document);
+    rebuild(document);
+    check(document);
+}
+
+
+/*
+ * Function:	LanguageServer::change
+ *
+ * Description:	Apply the changes given by PARAMS to their document, in
+ *		order, and check it.  A change with a range replaces just
+ *		that range, and only the tokens around it are tokenized
+ *		again.  A change without one replaces the whole text.
+ *		If the interner of the document has grown too much, the
+ *		document is tokenized again with a new one.
+ */
+
+void LanguageServer::change(const Json &params)
+{
+    const Json &changes = params["contentChanges"];
+    map<string, Document>::iterator it;
+    Interner *interner = Interner::current();
+    size_t start, end;
+    const char *text;
+
+
+    it = _documents.find(params["textDocument"]["uri"].str());
+
+    if (it == _documents.end())
+	return;
+
+    Document &document = it->second;
+
+    for (unsigned i = 0; i < changes.size(); i ++) {
+	const Json &range = changes[i]["range"];
+	const string &replacement = changes[i]["text"].str();
+
+	if (range.kind() == Json::OBJECT) {
+	    start = offset(document, range["start"]);
+	    end = max(start, offset(document, range["end"]));
+	    document.text.replace(start, end - start, replacement);
+	    text = document.text.data();
+	    Interner::current(document.names.get());
+	    retokenize(text, text + document.text.size(), start, end,
+		replacement.size(), document.tokens);
+	    Interner::current(interner);
+	} else {
+	    document.text = replacement;
+	    rebuild(document);
+	}
+
+	index(document);
+    }
+
+    if (document.names->size() > 2 * document.interned + SPARE)
+	rebuild(document);
+
+    check(document);
+}
+
+
+/*
+ * Function:	LanguageServer::close
+ *
+ * Description:	Close the document given by PARAMS, and clear its
+ *		diagnostics.
+ */
+
+void LanguageServer::close(const Json &params)
+{
+    map<string, Document>::iterator it;
+
+
+    it = _documents.find(params["textDocument"]["uri"].str());
+
+    if (it == _documents.end())
+	return;
+
+    it->second.text.clear();
+    index(it->second);
+    publish(it->second, "");
+    _documents.erase(it);
+}
+
+
+/*
+ * Function:	LanguageServer::run
+ *
+ * Description:	Answer messages until the client tells us to exit, or the
+ *		input ends.  Return the exit status, which is only zero if
+ *		the client asked us to shut down first.
+ */
+
+int LanguageServer::run()
+{
+    Json message, result, capabilities, sync, info;
+    string method;
+
+
+    while (receive(message)) {
+	const Json &id = message["id"], &params = message["params"];
+
+	if (message.kind() != Json::OBJECT) {
+	    fail(Json(), PARSE_ERROR, "invalid message");
+	    continue;
+	}
+
+	method = message["method"].str();
+
+	if (method == "exit")
+	    return _shutdown ? 0 : 1;
+
+	if (_shutdown) {
+	    if (id.kind() != Json::NUL)
+		fail(id, INVALID_REQUEST, "server is shut down");
+
+	} else if (method == "initialize") {
+	    const Json &encodings =
+		params["capabilities"]["general"]["positionEncodings"];
+
+	    for (unsigned i = 0; i < encodings.size(); i ++)
+		_utf8 = _utf8 || encodings[i].str() == "utf-8";
+
+	    sync = Json::object();
+	    sync.set("openClose", true).set("change", SYNC_INCREMENTAL);
+	    capabilities = Json::object();
+	    capabilities.set("textDocumentSync", sync);
+	    capabilities.set("positionEncoding", _utf8 ? "utf-8" : "utf-16");
+	    info = Json::object();
+	    info.set("name", "scc");
+	    result = Json::object();
+	    result.set("capabilities", capabilities).set("serverInfo", info);
+	    respond(id, result);
+
+	} else if (method == "shutdown") {
+	    _shutdown = true;
+	    respond(id, Json());
+
+	} else if (method == "textDocument/didOpen")
+	    open(params);
+
+	else if (method == "textDocument/didChange")
+	    change(params);
+
+	else if (method == "textDocument/didClose")
+	    close(params);
+
+	else if (id.kind() != Json::NUL && !method.empty())
+	    fail(id, METHOD_NOT_FOUND, "method not found: " + method);
+    }
+
+    return 1;
+}
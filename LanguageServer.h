@@ -0,0 +1,91 @@
+/*
+ * File:	LanguageServer.h
+ *
+ * Description:	This file contains the class definition for a language
+ *		server, which speaks the Language Server Protocol over a
+ *		pair of streams, normally the standard input and output,
+ *		and publishes the diagnostics of each open document as it
+ *		is edited.  Each message is JSON text after a header that
+ *		gives its length.
+ *
+ *		A document keeps its text and its tokens between edits,
+ *		along with an interner of its own, so that its names go
+ *		when it is closed.  An edit replaces a range of the text,
+ *		and only the tokens around it are tokenized again (see
+ *		lexer.h).  Since the interner keeps every name that was
+ *		ever typed, the whole document is tokenized again with a
+ *		new one once the old one has grown well past what the
+ *		document needs.  The document
+ *		is then checked as a unit that uses its tokens in place,
+ *		with a memo of its function bodies (see Memo.h), so only
+ *		the bodies that the edit affected are parsed and checked
+ *		again.  What the others reported is recalled, and all of
+ *		it is published together, just as a compilation of the
+ *		whole document would have reported it.
+ *
+ *		Positions are in UTF-16 code units, as the protocol has
+ *		it, unless the client can take UTF-8, which is what we
+ *		would rather count in.  A diagnostic covers the whole of
+ *		the line it was reported on.
+ */
+
+# ifndef LANGUAGESERVER_H
+# define LANGUAGESERVER_H
+# include <iostream>
+# include <map>
+# include <memory>
+# include <string>
+# include <vector>
+# include "Interner.h"
+# include "Json.h"
+# include "Memo.h"
+# include "lexer.h"
+
+class Headers;
+class ThreadPool;
+
+struct Document {
+    std::string uri, directory, text;
+    std::vector<size_t> lines;
+    TokenStream tokens;
+    std::unique_ptr<Interner> names;
+    unsigned interned;
+    Memo memo;
+};
+
+class LanguageServer {
+    typedef std::string string;
+
+    std::istream &_in;
+    std::ostream &_out, *_log;
+    ThreadPool &_pool;
+    Headers &_headers;
+    std::vector<string> _includes;
+    std::map<string, Document> _documents;
+    bool _utf8, _shutdown;
+
+    bool receive(Json &message);
+    void send(const Json &message);
+    void respond(const Json &id, const Json &result);
+    void fail(const Json &id, int code, const string &message);
+
+    void open(const Json &params);
+    void change(const Json &params);
+    void close(const Json &params);
+    void rebuild(Document &document);
+    void check(Document &document);
+    void publish(const Document &document, const string &diagnostics);
+
+    size_t offset(const Document &document, const Json &position) const;
+    unsigned units(const char *p, const char *end) const;
+
+public:
+    LanguageServer(std::istream &in, std::ostream &out, ThreadPool &pool,
+	    Headers &headers);
+
+    void include(const string &directory);
+    void log(std::ostream &stream);
+    int run();
+};
+
+# endif /* LANGUAGESERVER_H */
@@ -0,0 +1,220 @@
+/*
+ * File:	Memo.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the memo of checked function bodies.
+ */
+
+# include <cstdlib>
+# include <cstring>
+# include "Memo.h"
+# include "Symbol.h"
+
+using namespace std;
+
+/* A body that has not been seen by this many checks in a row is
+   forgotten. */
+
+static const unsigned FORGET = 64;
+
+
+/*
+ * Function:	Memo::Memo (constructor)
+ *
+ * Description:	Initialize this memo to remember nothing.
+ */
+
+Memo::Memo()
+    : _changed(true), _checks(0), _recalled(0), _rechecked(0)
+{
+}
+
+
+/*
+ * Function:	Memo::begin
+ *
+ * Description:	Begin a check of the unit, whose declarations at file
+ *		scope are the given GLOBALS, noting whether they have
+ *		changed since the last check.
+ */
+
+void Memo::begin(const Symbols &globals)
+{
+    bool changed = globals.size() != _globals.size();
+
+
+    for (unsigned i = 0; !changed && i < globals.size(); i ++)
+	changed = globals[i]->id() != _globals[i].first ||
+	    !same(globals[i]->type(), _globals[i].second);
+
+    if (changed) {
+	_globals.clear();
+
+	for (unsigned i = 0; i < globals.size(); i ++)
+	    _globals.push_back(make_pair(globals[i]->id(), globals[i]->type()));
+    }
+
+    _changed = changed;
+    _checks ++;
+    _recalled = 0;
+    _rechecked = 0;
+}
+
+
+/*
+ * Function:	Memo::find
+ *
+ * Description:	Return what the body of the named function reported when
+ *		it was last checked, or null if it has not been.
+ */
+
+const Checked *Memo::find(unsigned name) const
+{
+    unordered_map<unsigned, Checked>::const_iterator it;
+
+
+    it = _checked.find(name);
+    return it != _checked.end() ? &it->second : nullptr;
+}
+
+
+/*
+ * Function:	Memo::recall
+ *
+ * Description:	Note that the body of the named function, which was found
+ *		in this memo, has been recalled by this check.
+ */
+
+void Memo::recall(unsigned name)
+{
+    _checked[name].seen = _checks;
+    _recalled ++;
+}
+
+
+/*
+ * Function:	Memo::remember
+ *
+ * Description:	Remember what the body of the named function reported
+ *		when it was checked just now.  The given record is left
+ *		empty.
+ */
+
+void Memo::remember(unsigned name, Checked &checked)
+{
+    checked.seen = _checks;
+    swap(_checked[name], checked);
+    _rechecked ++;
+}
+
+
+/*
+ * Function:	Memo::end
+ *
+ * Description:	End the check of the unit, forgetting the bodies that
+ *		have not been seen for too long.
+ */
+
+void Memo::end()
+{
+    unordered_map<unsigned, Checked>::iterator it;
+
+
+    for (it = _checked.begin(); it != _checked.end(); )
+	if (_checks - it->second.seen >= FORGET)
+	    it = _checked.erase(it);
+	else
+	    it ++;
+}
+
+
+/*
+ * Function:	Memo::changed (accessor)
+ *
+ * Description:	Return whether the declarations at file scope changed
+ *		since the last check.
+ */
+
+bool Memo::changed() const
+{
+    return _changed;
+}
+
+
+/*
+ * Function:	Memo::recalled (accessor)
+ *
+ * Description:	Return the number of bodies recalled by the last check.
+ */
+
+unsigned Memo::recalled() const
+{
+    return _recalled;
+}
+
+
+/*
+ * Function:	Memo::rechecked (accessor)
+ *
+ * Description:	Return the number of bodies checked again by the last
+ *		check.
+ */
+
+unsigned Memo::rechecked() const
+{
+    return _rechecked;
+}
+
+
+/*
+ * Function:	Memo::same
+ *
+ * Description:	Return whether the given types are the very same type.
+ *		Equality alone will not do, since a function type with an
+ *		unspecified parameter list is equal to one without.  Each
+ *		distinct parameter list is stored just once, so comparing
+ *		the lists themselves tells them apart.
+ */
+
+bool Memo::same(const Type &left, const Type &right)
+{
+    return left == right &&
+	(!left.isFunction() || left.parameters() == right.parameters());
+}
+
+
+/*
+ * Function:	Memo::rebase
+ *
+ * Description:	Return the given diagnostics, with the line of each moved
+ *		by the given number of LINES.
+ */
+
+string Memo::rebase(const string &diagnostics, long lines)
+{
+    const char *p, *q, *end;
+    string result;
+    char *rest;
+    long line;
+
+
+    p = diagnostics.data();
+    end = p + diagnostics.size();
+
+    while (p < end) {
+	q = (const char *) memchr(p, '\n', end - p);
+	q = (q != nullptr ? q + 1 : end);
+
+	if (q - p > 5 && strncmp(p, "line ", 5) == 0) {
+	    line = strtol(p + 5, &rest, 10);
+	    result.append(p, 5);
+	    result += to_string(line + lines);
+	    result.append(rest, q - rest);
+	} else
+	    result.append(p, q - p);
+
+	p = q;
+    }
+
+    return result;
+}
@@ -0,0 +1,82 @@
+/*
+ * File:	Memo.h
+ *
+ * Description:	This file contains the class definitions for the memo of
+ *		checked function bodies, which lets a unit that is checked
+ *		over and over, as it is edited, recall what each body the
+ *		edit did not affect reported, rather than parsing and
+ *		checking the body again.
+ *
+ *		A body is remembered by the name of its function, along
+ *		with everything that what it reported depends on: a
+ *		transcript of its tokens and of their lines relative to
+ *		the first, the type of its function and its parameters,
+ *		how much of the unit had been declared when it began, and
+ *		what each name in it was declared as at file scope.  That
+ *		last is only looked at again if the declarations at file
+ *		scope have changed since the last check, so recalling a
+ *		body normally costs no more than comparing its tokens.
+ *		Diagnostics are kept with their lines relative to the
+ *		first line of the body too, so a body that has merely
+ *		moved is still recalled.
+ *
+ *		A memo is only for a unit that is being checked rather
+ *		than compiled, since the code of a recalled body is never
+ *		generated.  It belongs to one unit, which is checked by
+ *		one thread at a time.  A body that has not been seen for
+ *		a while is forgotten, but not at once, since an edit that
+ *		hides a body for a moment, by opening a comment above it
+ *		say, is likely to be followed by one that brings it back.
+ */
+
+# ifndef MEMO_H
+# define MEMO_H
+# include <string>
+# include <unordered_map>
+# include <vector>
+# include "Scope.h"
+
+struct Use {
+    unsigned id;
+    bool declared;
+    Type type;
+};
+
+struct Checked {
+    std::string transcript;
+    Type type;
+    std::vector<std::pair<unsigned, Type> > params;
+    unsigned visible;
+    std::vector<Use> uses;
+    std::string diagnostics;
+    int errors;
+    bool failed;
+    unsigned seen;
+};
+
+class Memo {
+    typedef std::string string;
+
+    std::unordered_map<unsigned, Checked> _checked;
+    std::vector<std::pair<unsigned, Type> > _globals;
+    bool _changed;
+    unsigned _checks, _recalled, _rechecked;
+
+public:
+    Memo();
+
+    void begin(const Symbols &globals);
+    const Checked *find(unsigned name) const;
+    void recall(unsigned name);
+    void remember(unsigned name, Checked &checked);
+    void end();
+
+    bool changed() const;
+    unsigned recalled() const;
+    unsigned rechecked() const;
+
+    static bool same(const Type &left, const Type &right);
+    static string rebase(const string &diagnostics, long lines);
+};
+
+# endif /* MEMO_H */
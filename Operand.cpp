@@ -0,0 +1,116 @@
+/*
+ * File:	Operand.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		operands in the code generator for Simple C.
+ */
+
+# include <cassert>
+# include "Operand.h"
+# include "Interner.h"
+
+using namespace std;
+
+static const char *registers[] = { "%eax", "%ecx", "%edx" };
+
+
+/*
+ * Function:	Operand::Operand (constructor)
+ *
+ * Description:	Initialize this operand with the given kind and number.
+ */
+
+Operand::Operand(Kind kind, long value)
+    : _kind(kind), _address(false), _value(value)
+{
+}
+
+
+/*
+ * Function:	Operand::kind (accessor)
+ *
+ * Description:	Return the kind of this operand.
+ */
+
+Operand::Kind Operand::kind() const
+{
+    return _kind;
+}
+
+
+/*
+ * Function:	Operand::value (accessor)
+ *
+ * Description:	Return the number of this operand.
+ */
+
+long Operand::value() const
+{
+    return _value;
+}
+
+
+/*
+ * Function:	Operand::isLabel
+ *
+ * Description:	Return whether this operand is a label of either kind.
+ */
+
+bool Operand::isLabel() const
+{
+    return _kind == LABEL || _kind == REAL_LABEL;
+}
+
+
+/*
+ * Function:	Operand::address
+ *
+ * Description:	Return the address of this operand, which must be a
+ *		label, as an immediate.
+ */
+
+Operand Operand::address() const
+{
+    Operand operand(*this);
+
+
+    assert(isLabel());
+    operand._address = true;
+    return operand;
+}
+
+
+/*
+ * Function:	operator <<
+ *
+ * Description:	Write an operand in the syntax of the assembler.
+ */
+
+ostream &operator <<(ostream &ostr, const Operand &operand)
+{
+    if (operand._address)
+	ostr << "$";
+
+    switch (operand._kind) {
+    case Operand::IMMEDIATE:
+	return ostr << "$" << operand._value;
+
+    case Operand::FRAME:
+	return ostr << operand._value << "(%ebp)";
+
+    case Operand::GLOBAL:
+	return ostr << Interner::current()->name(operand._value);
+
+    case Operand::LABEL:
+	return ostr << ".L" << operand._value;
+
+    case Operand::REAL_LABEL:
+	return ostr << ".fp" << operand._value;
+
+    case Operand::REGISTER:
+	return ostr << registers[operand._value];
+
+    default:
+	return ostr;
+    }
+}
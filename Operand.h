@@ -0,0 +1,46 @@
+/*
+ * File:	Operand.h
+ *
+ * Description:	This file contains the class definition for operands in
+ *		the code generator for Simple C.  An operand is what an
+ *		instruction refers to: an immediate value, a location in
+ *		the stack frame, a global symbol, a label, or a register.
+ *		It is just a kind and a number, and is only turned into
+ *		text when an instruction using it is written out.
+ *
+ *		The number is the value of an immediate, the offset of a
+ *		frame location, the interned id of a global, the number of
+ *		a label, or the number of a register.  There are two kinds
+ *		of label: the ones for string literals and branches, and
+ *		the ones for real literals.  A label may also be used as an
+ *		immediate, meaning its address rather than its contents.
+ */
+
+# ifndef OPERAND_H
+# define OPERAND_H
+# include <ostream>
+
+class Operand {
+public:
+    enum Kind { NONE, IMMEDIATE, FRAME, GLOBAL, LABEL, REAL_LABEL, REGISTER };
+    enum Register { EAX, ECX, EDX };
+
+private:
+    Kind _kind;
+    bool _address;
+    long _value;
+
+public:
+    Operand(Kind kind = NONE, long value = 0);
+
+    Kind kind() const;
+    long value() const;
+    bool isLabel() const;
+    Operand address() const;
+
+    friend std::ostream &operator <<(std::ostream &ostr, const Operand &operand);
+};
+
+std::ostream &operator <<(std::ostream &ostr, const Operand &operand);
+
+# endif /* OPERAND_H */
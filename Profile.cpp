@@ -0,0 +1,524 @@
+/*
+ * File:	Profile.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the timers that instrument each phase of a compilation,
+ *		along with the report of what they found and the trace of
+ *		every span they timed.
+ *
+ *		Each thread keeps its own totals, counts, and spans, so
+ *		timing one thread never waits on another.  The threads
+ *		are only put together for the report and the trace,
+ *		which are written once the compilation is over and every
+ *		other thread is idle.
+ */
+
+# include <chrono>
+# include <cstdio>
+# include <ctime>
+# include <fstream>
+# include <iomanip>
+# include <map>
+# include <mutex>
+# include <unordered_map>
+# include <vector>
+# include "Json.h"
+# include "Profile.h"
+# include "Tree.h"
+
+using namespace std;
+using namespace std::chrono;
+
+struct Totals {
+    unsigned long calls;
+    long wall;
+    double cpu;
+};
+
+struct Span {
+    Phase phase;
+    string name;
+    long begin, end;
+};
+
+/* What a thread has timed and counted.  The wall time since the CPU
+   time was last read is kept for each phase, and for the time when no
+   timer was running, so that the CPU time can be shared out. */
+
+struct Thread {
+    unsigned tid;
+    Timer *current;
+    long since, cpu;
+    long pending[PHASES + 1];
+    Totals phases[PHASES];
+    unordered_map<const char *, Totals> labels;
+    unsigned long counts[COUNTERS];
+    vector<Span> spans;
+};
+
+static const char *phases[] = {
+    "lexing", "preprocessing", "parsing", "checking", "allocating",
+    "generating",
+};
+
+static const char *counters[] = {
+    "tokens", "symbols", "instructions",
+};
+
+static const char *kinds[] = {
+    "function", "block", "if", "return", "while", "add", "address",
+    "assign", "call", "cast", "dereference", "divide", "equal",
+    "greater or equal", "greater than", "identifier", "integer",
+    "less or equal", "less than", "logical and", "logical or",
+    "multiply", "negate", "not equal", "not", "real", "remainder",
+    "string", "subtract",
+};
+
+static mutex registry;
+static vector<Thread *> threads;
+static thread_local Thread *self = nullptr;
+static long origin;
+
+bool Timer::_enabled = false;
+bool Timer::_tracing = false;
+
+
+/*
+ * Function:	wall
+ *
+ * Description:	Return the time on the wall clock in nanoseconds.
+ */
+
+static long wall()
+{
+    steady_clock::duration now = steady_clock::now().time_since_epoch();
+
+    return duration_cast<nanoseconds>(now).count();
+}
+
+
+/*
+ * Function:	cpu
+ *
+ * Description:	Return the CPU time used by the calling thread in
+ *		nanoseconds.
+ */
+
+static long cpu()
+{
+    struct timespec now;
+
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+
+/*
+ * Function:	thread
+ *
+ * Description:	Return the record of the calling thread, creating it if
+ *		this is the first the thread has timed or counted.
+ */
+
+static Thread *thread()
+{
+    if (self == nullptr) {
+	self = new Thread();
+	self->since = wall();
+	self->cpu = cpu();
+
+	lock_guard<mutex> guard(registry);
+	threads.push_back(self);
+	self->tid = threads.size();
+    }
+
+    return self;
+}
+
+
+/*
+ * Function:	elapse
+ *
+ * Description:	Charge the wall time since the last time the given thread
+ *		started or stopped a timer to the phase of the timer that
+ *		was running, if any, and to the totals of its label, if it
+ *		has one, and return the time now.
+ */
+
+static long elapse(Thread *thread, Phase phase, Totals *totals)
+{
+    long now = wall(), elapsed = now - thread->since;
+
+
+    thread->since = now;
+    thread->pending[phase] += elapsed;
+
+    if (phase < PHASES)
+	thread->phases[phase].wall += elapsed;
+
+    if (totals != nullptr)
+	totals->wall += elapsed;
+
+    return now;
+}
+
+
+/*
+ * Function:	checkpoint
+ *
+ * Description:	Read the CPU time of the given thread, and share out what
+ *		it used since the last reading among the phases, in
+ *		proportion to the wall time spent in each.
+ */
+
+static void checkpoint(Thread *thread)
+{
+    long now = cpu(), used = now - thread->cpu, total = 0;
+
+
+    for (unsigned i = 0; i <= PHASES; i ++)
+	total += thread->pending[i];
+
+    for (unsigned i = 0; i < PHASES && total > 0; i ++)
+	thread->phases[i].cpu += (double) used * thread->pending[i] / total;
+
+    for (unsigned i = 0; i <= PHASES; i ++)
+	thread->pending[i] = 0;
+
+    thread->cpu = now;
+}
+
+
+/*
+ * Function:	Timer::Timer (constructor)
+ *
+ * Description:	Initialize a timer for the given phase, and start it if
+ *		profiling is enabled.  A label is a string constant, and
+ *		makes a fine timer.  A name makes a coarse one, and names
+ *		its span in the trace.
+ */
+
+Timer::Timer(Phase phase)
+    : _phase(phase), _label(nullptr), _totals(nullptr), _name(nullptr),
+      _running(false)
+{
+    if (_enabled)
+	start();
+}
+
+Timer::Timer(Phase phase, const char *label)
+    : _phase(phase), _label(label), _totals(nullptr), _name(nullptr),
+      _running(false)
+{
+    if (_enabled)
+	start();
+}
+
+Timer::Timer(Phase phase, const string &name)
+    : _phase(phase), _label(nullptr), _totals(nullptr), _name(&name),
+      _running(false)
+{
+    if (_enabled)
+	start();
+}
+
+
+/*
+ * Function:	Timer::~Timer (destructor)
+ *
+ * Description:	Stop this timer if it was started.
+ */
+
+Timer::~Timer()
+{
+    if (_running)
+	stop();
+}
+
+
+/*
+ * Function:	Timer::start
+ *
+ * Description:	Stop charging time to the running timer of this thread,
+ *		if there is one, and start charging it to this timer.
+ */
+
+void Timer::start()
+{
+    Thread *thread = ::thread();
+    Timer *outer = thread->current;
+
+
+    if (outer != nullptr)
+	_began = elapse(thread, outer->_phase, outer->_totals);
+    else
+	_began = elapse(thread, PHASES, nullptr);
+
+    _outer = outer;
+    _running = true;
+    thread->current = this;
+
+    if (_label != nullptr)
+	_totals = &thread->labels[_label];
+    else
+	checkpoint(thread);
+}
+
+
+/*
+ * Function:	Timer::stop
+ *
+ * Description:	Charge the time since this thread last started or stopped
+ *		a timer to this timer, and go back to charging it to the
+ *		timer this one was started within.  A coarse timer is also
+ *		recorded as a span if we are tracing.
+ */
+
+void Timer::stop()
+{
+    Thread *thread = ::thread();
+    long now;
+
+
+    now = elapse(thread, _phase, _totals);
+    thread->phases[_phase].calls ++;
+    thread->current = _outer;
+
+    if (_totals != nullptr) {
+	_totals->calls ++;
+	return;
+    }
+
+    checkpoint(thread);
+
+    if (_tracing) {
+	thread->spans.push_back(Span());
+	thread->spans.back().phase = _phase;
+	thread->spans.back().name = _name != nullptr ? *_name : phases[_phase];
+	thread->spans.back().begin = _began;
+	thread->spans.back().end = now;
+    }
+}
+
+
+/*
+ * Function:	Timer::enable
+ *
+ * Description:	Start profiling, and trace each span as well if TRACING.
+ *		The calling thread is the first in the trace.
+ */
+
+void Timer::enable(bool tracing)
+{
+    origin = wall();
+    thread();
+    _tracing = tracing;
+    _enabled = true;
+}
+
+
+/*
+ * Function:	Timer::enabled (accessor)
+ *
+ * Description:	Return whether we are profiling.
+ */
+
+bool Timer::enabled()
+{
+    return _enabled;
+}
+
+
+/*
+ * Function:	Timer::count
+ *
+ * Description:	Add the given number to the given counter of the calling
+ *		thread, if we are profiling.
+ */
+
+void Timer::count(Counter counter, unsigned long n)
+{
+    if (_enabled)
+	thread()->counts[counter] += n;
+}
+
+
+/*
+ * Function:	Timer::elapsed
+ *
+ * Description:	Return the wall time in seconds that every thread has
+ *		spent in the given phase so far.
+ */
+
+double Timer::elapsed(Phase phase)
+{
+    lock_guard<mutex> guard(registry);
+    long total = 0;
+
+
+    for (unsigned i = 0; i < threads.size(); i ++)
+	total += threads[i]->phases[phase].wall;
+
+    return total / 1e9;
+}
+
+
+/*
+ * Function:	row
+ *
+ * Description:	Write a row of the report with the given totals.  A fine
+ *		timer never reads the CPU time, so it has none to write.
+ */
+
+static void row(ostream &out, const string &name, const Totals &totals,
+	bool cpu)
+{
+    out << left << setw(24) << name << right << setw(10) << totals.calls;
+    out << setw(12) << totals.wall / 1e6;
+
+    if (cpu)
+	out << setw(12) << totals.cpu / 1e6;
+
+    out << '\n';
+}
+
+
+/*
+ * Function:	Timer::report
+ *
+ * Description:	Write a table of the wall and CPU time spent in each phase
+ *		by every thread, with the checks broken down by name,
+ *		followed by the counts of what was made.
+ */
+
+void Timer::report(ostream &out)
+{
+    Totals phase[PHASES] = {}, total = {};
+    map<string, Totals> checks;
+    map<string, Totals>::iterator it;
+    unordered_map<const char *, Totals>::iterator label;
+    unsigned long counts[COUNTERS] = {};
+    long elapsed = wall() - origin;
+    lock_guard<mutex> guard(registry);
+
+
+    for (unsigned i = 0; i < threads.size(); i ++) {
+	Thread *thread = threads[i];
+
+	for (unsigned j = 0; j < PHASES; j ++) {
+	    phase[j].calls += thread->phases[j].calls;
+	    phase[j].wall += thread->phases[j].wall;
+	    phase[j].cpu += thread->phases[j].cpu;
+	}
+
+	for (label = thread->labels.begin();
+		label != thread->labels.end(); label ++) {
+	    checks[label->first].calls += label->second.calls;
+	    checks[label->first].wall += label->second.wall;
+	}
+
+	for (unsigned j = 0; j < COUNTERS; j ++)
+	    counts[j] += thread->counts[j];
+    }
+
+    out << fixed << setprecision(3);
+    out << left << setw(24) << "phase" << right << setw(10) << "calls";
+    out << setw(12) << "wall ms" << setw(12) << "cpu ms" << '\n';
+
+    for (unsigned i = 0; i < PHASES; i ++) {
+	row(out, phases[i], phase[i], true);
+	total.wall += phase[i].wall;
+	total.cpu += phase[i].cpu;
+
+	if (i == CHECKING)
+	    for (it = checks.begin(); it != checks.end(); it ++)
+		row(out, "  " + it->first, it->second, false);
+    }
+
+    out << left << setw(24) << "total" << right << setw(10) << "";
+    out << setw(12) << total.wall / 1e6 << setw(12) << total.cpu / 1e6;
+    out << '\n' << '\n';
+
+    for (unsigned i = 0; i < COUNTERS; i ++)
+	out << left << setw(24) << counters[i] << right << setw(10)
+	    << counts[i] << '\n';
+
+    out << left << setw(24) << "nodes" << right << setw(10);
+    out << Tree::count() << '\n';
+
+    for (unsigned i = 0; i <= Tree::SUBTRACT_EXPR; i ++)
+	if (Tree::count((Tree::Kind) i) > 0)
+	    out << left << setw(24) << string("  ") + kinds[i] << right
+		<< setw(10) << Tree::count((Tree::Kind) i) << '\n';
+
+    out << '\n' << threads.size() << " threads, " << elapsed / 1e6;
+    out << " ms elapsed" << endl;
+    out.unsetf(ios::floatfield);
+    out << setprecision(6);
+}
+
+
+/*
+ * Function:	Timer::trace
+ *
+ * Description:	Write every span traced by every thread to the named
+ *		file as a JSON array of trace events, with a complete
+ *		event for each span, and the name of each thread.  Times
+ *		are in microseconds since profiling began.  Return
+ *		whether the trace could be written.
+ */
+
+bool Timer::trace(const char *path)
+{
+    ofstream file(path, ios::binary);
+    string text, name;
+    const char *separator = "";
+    lock_guard<mutex> guard(registry);
+
+
+    if (!file)
+	return false;
+
+    text = "{\"traceEvents\":[\n";
+
+    for (unsigned i = 0; i < threads.size(); i ++) {
+	Thread *thread = threads[i];
+	string tid = to_string(thread->tid);
+
+	name.clear();
+	Json::quote(i == 0 ? "main" : "thread " + tid, name);
+	text += separator;
+	text += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+	text += tid + ",\"args\":{\"name\":" + name + "}}";
+	separator = ",\n";
+
+	for (unsigned j = 0; j < thread->spans.size(); j ++) {
+	    const Span &span = thread->spans[j];
+	    char times[64];
+
+	    name.clear();
+	    Json::quote(span.name, name);
+	    snprintf(times, sizeof(times), "%.3f,\"dur\":%.3f",
+		    (span.begin - origin) / 1e3,
+		    (span.end - span.begin) / 1e3);
+
+	    text += separator;
+	    text += "{\"name\":" + name + ",\"cat\":\"";
+	    text += phases[span.phase];
+	    text += "\",\"ph\":\"X\",\"ts\":";
+	    text += times;
+	    text += ",\"pid\":1,\"tid\":" + tid + "}";
+
+	    if (text.size() > 1 << 16) {
+		file << text;
+		text.clear();
+	    }
+	}
+    }
+
+    text += "\n],\"displayTimeUnit\":\"ms\"}\n";
+    file << text;
+    file.close();
+    return !file.fail();
+}
@@ -0,0 +1,77 @@
+/*
+ * File:	Profile.h
+ *
+ * Description:	This file contains the class definition for the timers
+ *		that instrument each phase of a compilation, and the
+ *		function declarations for counting what each phase made
+ *		and for reporting it all.
+ *
+ *		A timer is a local variable that times the phase it is
+ *		given from its construction until its destruction, on
+ *		the thread that made it.  Timers nest, and the time of a
+ *		timer within another is taken out of the time of the
+ *		outer one, so parsing a function does not also count the
+ *		time spent checking it.  A timer may also have a label,
+ *		like the name of the check it times, or the name of the
+ *		function it works on.
+ *
+ *		Most timers are coarse, and read both the wall clock and
+ *		the CPU time of their thread.  A timer with a label that
+ *		is a string constant is a fine one, since there are a
+ *		great many of them, and only reads the wall clock, which
+ *		is much cheaper.  The CPU time between two coarse readings
+ *		is shared out among the phases in proportion to their
+ *		wall time.  Each coarse timer is also a span in the trace,
+ *		which is written in the trace event format that the
+ *		Chrome trace viewer reads.
+ *
+ *		Until profiling is enabled, a timer does nothing but test
+ *		whether it is, and nothing is counted.
+ */
+
+# ifndef PROFILE_H
+# define PROFILE_H
+# include <iostream>
+# include <string>
+
+enum Phase {
+    LEXING, PREPROCESSING, PARSING, CHECKING, ALLOCATING, GENERATING, PHASES
+};
+
+enum Counter {
+    TOKENS, SYMBOLS, INSTRUCTIONS, COUNTERS
+};
+
+struct Totals;
+
+class Timer {
+    typedef std::string string;
+
+    Phase _phase;
+    const char *_label;
+    Totals *_totals;
+    const string *_name;
+    Timer *_outer;
+    long _began;
+    bool _running;
+
+    static bool _enabled, _tracing;
+
+    void start();
+    void stop();
+
+public:
+    Timer(Phase phase);
+    Timer(Phase phase, const char *label);
+    Timer(Phase phase, const string &name);
+    ~Timer();
+
+    static void enable(bool tracing);
+    static bool enabled();
+    static void count(Counter counter, unsigned long n);
+    static double elapsed(Phase phase);
+    static void report(std::ostream &out);
+    static bool trace(const char *path);
+};
+
+# endif /* PROFILE_H */
@@ -11,24 +11,138 @@
  *
  *		Extra functionality:
  *		- retrieving the vector of symbols
+ *		- constant-time find and lookup
  */
 
 # include <cassert>
+# include <new>
+# include "Arena.h"
+# include "CompilerContext.h"
 # include "Scope.h"
 
+using namespace std;
+
+struct Binding {
+    const Scope *scope;
+    Symbol *symbol;
+    Binding *shadowed, *replaced;
+    unsigned number;
+};
+
 
 /*
  * Function:	Scope::Scope (constructor)
  *
- * Description:	Initialize this scope object.
+ * Description:	Initialize this scope object, which is destroyed when the
+ *		current arena, where it was allocated, is released.
  */
 
 Scope::Scope(Scope *enclosing)
-    : _enclosing(enclosing)
+    : _enclosing(enclosing), _arena(Arena::current())
+{
+    _depth = enclosing != nullptr ? enclosing->_depth + 1 : 0;
+    Arena::current()->adopt(this, destroy);
+}
+
+
+/*
+ * Function:	Scope::operator new
+ *
+ * Description:	Allocate a scope from the current arena.
+ */
+
+void *Scope::operator new(size_t size)
+{
+    return Arena::current()->allocate(size);
+}
+
+
+/*
+ * Function:	Scope::operator delete
+ *
+ * Description:	Do nothing, since the scope's memory belongs to its arena.
+ */
+
+void Scope::operator delete(void *object)
 {
 }
 
 
+/*
+ * Function:	Scope::destroy
+ *
+ * Description:	Destroy the scope at the given address.
+ */
+
+void Scope::destroy(void *object)
+{
+    static_cast<Scope *>(object)->~Scope();
+}
+
+
+/*
+ * Function:	unbind
+ *
+ * Description:	Unlink and return the binding of ID in the scope at the
+ *		given depth, or a null pointer if there is none.  Bindings
+ *		of the same id are stacked innermost first, so we only need
+ *		to skip past those of scopes nested more deeply.
+ */
+
+static Binding *unbind(unsigned id, unsigned depth)
+{
+    Binding **link, *binding;
+
+
+    if (id >= context->bindings.size())
+	return nullptr;
+
+    link = &context->bindings[id];
+
+    while (*link != nullptr && (*link)->scope->depth() > depth)
+	link = &(*link)->shadowed;
+
+    if ((binding = *link) == nullptr || binding->scope->depth() != depth)
+	return nullptr;
+
+    *link = binding->shadowed;
+    return binding;
+}
+
+
+/*
+ * Function:	Scope::bind
+ *
+ * Description:	Push a binding of the given symbol onto the stack of its
+ *		id, below those of any scopes nested more deeply, and
+ *		return it.  The binding lives in our arena, so it is never
+ *		freed by itself.
+ */
+
+Binding *Scope::bind(Symbol *symbol)
+{
+    Binding **link, *binding;
+    unsigned id = symbol->id();
+
+
+    if (id >= context->bindings.size())
+	context->bindings.resize(id + 1, nullptr);
+
+    link = &context->bindings[id];
+
+    while (*link != nullptr && (*link)->scope->_depth > _depth)
+	link = &(*link)->shadowed;
+
+    binding = new(_arena->allocate(sizeof(Binding))) Binding();
+    binding->scope = this;
+    binding->symbol = symbol;
+    binding->shadowed = *link;
+    binding->number = context->declarations ++;
+    *link = binding;
+    return binding;
+}
+
+
 /*
  * Function:	Scope::insert
  *
@@ -36,65 +150,172 @@ Scope::Scope(Scope *enclosing)
  *		already be inserted, or we fail big time.
  */
 
-
 void Scope::insert(Symbol *symbol)
 {
-    assert(find(symbol->name()) == nullptr);
+    assert(find(symbol->id()) == nullptr);
     _symbols.push_back(symbol);
+    bind(symbol);
 }
 
 
 /*
  * Function:	Scope::find
  *
- * Description:	Find and return the symbol with the given name in this
+ * Description:	Find and return the symbol with the given id in this
  *		scope.  If no such symbol is found, return a null pointer.
  */
 
-Symbol *Scope::find(const string &name) const
+Symbol *Scope::find(unsigned id) const
 {
-    for (unsigned i = 0; i < _symbols.size(); i ++)
-	if (name == _symbols[i]->name())
-	    return _symbols[i];
+    Binding *binding;
+
+
+    if (id >= context->bindings.size())
+	return nullptr;
+
+    binding = context->bindings[id];
 
-    return NULL;
+    while (binding != nullptr && binding->scope->_depth > _depth)
+	binding = binding->shadowed;
+
+    return binding != nullptr && binding->scope == this ? binding->symbol : nullptr;
 }
 
 
 /*
- * Function:	Scope::remove
+ * Function:	Scope::replace
  *
- * Description:	Remove the symbol with the given name from this scope.
- *		Yes, I know, I duplicated the search logic from above.
- *		And, yes, I still didn't use an iterator.  So sue me.
+ * Description:	Replace the symbol with the same id in this scope with the
+ *		given symbol, which goes to the end of the list of
+ *		symbols.  Finding the old binding is cheap, but the old
+ *		symbol must also come out of the list, which isn't.
+ *		Luckily, we only replace a symbol when it is redeclared,
+ *		which is an error.  The new binding remembers the old
+ *		one, for any function body that should still see it.
  */
 
-void Scope::remove(const string &name)
+void Scope::replace(Symbol *symbol)
 {
+    Binding *replaced = unbind(symbol->id(), _depth);
+
     for (unsigned i = 0; i < _symbols.size(); i ++)
-	if (name == _symbols[i]->name())
+	if (symbol->id() == _symbols[i]->id())
 	    _symbols.erase(_symbols.begin() + i);
+
+    _symbols.push_back(symbol);
+    bind(symbol)->replaced = replaced;
+}
+
+
+/*
+ * Function:	before
+ *
+ * Description:	Return the symbol of the given binding, or of the binding
+ *		it replaced, and so on, that was bound once the given
+ *		NUMBER of declarations had been made, or a null pointer if
+ *		there was none.
+ */
+
+static Symbol *before(Binding *binding, unsigned number)
+{
+    while (binding != nullptr && binding->number >= number)
+	binding = binding->replaced;
+
+    return binding != nullptr ? binding->symbol : nullptr;
+}
+
+
+/*
+ * Function:	Scope::find
+ *
+ * Description:	Find and return the symbol with the given id in this
+ *		scope once the given NUMBER of declarations had been made.
+ *		If no such symbol is found, return a null pointer.
+ */
+
+Symbol *Scope::find(unsigned id, unsigned number) const
+{
+    Binding *binding;
+
+
+    if (id >= context->bindings.size())
+	return nullptr;
+
+    binding = context->bindings[id];
+
+    while (binding != nullptr && binding->scope->_depth > _depth)
+	binding = binding->shadowed;
+
+    return binding != nullptr && binding->scope == this ? before(binding, number) : nullptr;
+}
+
+
+/*
+ * Function:	global
+ *
+ * Description:	Return the symbol with the given id that the function
+ *		body being parsed in the current context can see in the
+ *		outermost scope of its unit, or a null pointer if there is
+ *		none.  Only the outermost scope of the unit is open while
+ *		its bodies are parsed, and nothing is declared in it, so
+ *		we can search it from any number of threads at once.
+ */
+
+static Symbol *global(unsigned id)
+{
+    const CompilerContext *unit = context->unit;
+
+
+    if (id >= unit->bindings.size())
+	return nullptr;
+
+    return before(unit->bindings[id], context->visible);
 }
 
 
 /*
  * Function:	Scope::lookup
  *
- * Description:	Find and return the nearest symbol with the given name,
+ * Description:	Find and return the nearest symbol with the given id,
  *		starting the search in the given scope and moving into the
  *		enclosing scopes.  If no such symbol is found, return a
- *		null pointer.
+ *		null pointer.  Since only open scopes have bindings, the
+ *		nearest one not nested more deeply than us is it.  A
+ *		function body parsed in a context of its own has no
+ *		bindings for the outermost scope, so we look there last.
  */
 
-Symbol *Scope::lookup(const string &name) const
+Symbol *Scope::lookup(unsigned id) const
 {
-    Symbol *symbol;
+    Binding *binding = nullptr;
+
+
+    if (id < context->bindings.size()) {
+	binding = context->bindings[id];
 
+	while (binding != nullptr && binding->scope->_depth > _depth)
+	    binding = binding->shadowed;
+    }
 
-    if ((symbol = find(name)) != nullptr)
-	return symbol;
+    if (binding == nullptr)
+	return context->unit != nullptr ? global(id) : nullptr;
 
-    return _enclosing != nullptr ? _enclosing->lookup(name) : nullptr;
+    return binding->symbol;
+}
+
+
+/*
+ * Function:	Scope::close
+ *
+ * Description:	Close this scope by removing the bindings of all of its
+ *		symbols.  The symbols stay where they are, since others
+ *		still want to walk through them.
+ */
+
+void Scope::close()
+{
+    for (unsigned i = 0; i < _symbols.size(); i ++)
+	unbind(_symbols[i]->id(), _depth);
 }
 
 
@@ -120,3 +341,16 @@ const Symbols &Scope::symbols() const
 {
     return _symbols;
 }
+
+
+/*
+ * Function:	Scope::depth (accessor)
+ *
+ * Description:	Return the nesting depth of this scope.  The outermost
+ *		scope has depth zero.
+ */
+
+unsigned Scope::depth() const
+{
+    return _depth;
+}
@@ -2,16 +2,36 @@
  * File:	Scope.h
  *
  * Description:	This file contains the class definition for scopes in
- *		Simple C.  A scope consists simply of a list of symbols.
- *		We use a vector rather than a map because we want to keep
- *		the symbols in insertion order, and we expect the number of
- *		symbols inserted to be small.
+ *		Simple C.  A scope consists simply of a list of symbols,
+ *		kept in insertion order.
  *
  *		Each scope has a link to its enclosing scope.  By
  *		convention, a null scope is used if there is no enclosing
  *		scope.  The find function searches only the given scope,
  *		whereas the lookup function searches the given scope and
- *		all enclosing scopes.
+ *		all enclosing scopes.  Symbols are found by the interned
+ *		id of their name.
+ *
+ *		To make find and lookup take constant time, every id has a
+ *		stack of bindings, one for each open scope that declares
+ *		it, with the innermost on top.  Inserting a symbol pushes
+ *		a binding, and closing a scope pops the bindings of all
+ *		its symbols.  Scopes must therefore be closed in the
+ *		reverse order of their creation, and a closed scope can no
+ *		longer be searched, although its symbols remain.  The
+ *		stacks belong to the current compiler context, so scopes
+ *		may only be searched while their context is compiling.
+ *
+ *		A function body may also be parsed in a context of its own
+ *		on another thread, once the global declarations of its unit
+ *		have all been skimmed.  It then sees the outermost scope of
+ *		the unit as it was when the body began: the bindings of
+ *		that scope are numbered in order, and a symbol that is
+ *		replaced there is remembered by its replacement.
+ *
+ *		Scopes, like symbols, are allocated from the current arena.
+ *		A scope remembers its arena, since the bindings of its
+ *		symbols come from there too.
  */
 
 # ifndef SCOPE_H
@@ -20,23 +40,37 @@
 # include "nullptr.h"
 # include <vector>
 
+class Arena;
+struct Binding;
+
 typedef std::vector<Symbol *> Symbols;
 
 class Scope {
     typedef std::string string;
 
     Scope *_enclosing;
+    Arena *_arena;
     Symbols _symbols;
+    unsigned _depth;
+
+    static void destroy(void *object);
+    Binding *bind(Symbol *symbol);
 
 public:
     Scope(Scope *enclosing = nullptr);
 
+    static void *operator new(size_t size);
+    static void operator delete(void *object);
+
     void insert(Symbol *symbol);
-    void remove(const string &name);
-    Symbol *find(const string &name) const;
-    Symbol *lookup(const string &name) const;
+    void replace(Symbol *symbol);
+    Symbol *find(unsigned id) const;
+    Symbol *find(unsigned id, unsigned number) const;
+    Symbol *lookup(unsigned id) const;
+    void close();
 
     Scope *enclosing() const;
+    unsigned depth() const;
     const Symbols &symbols() const;
 };
 
@@ -0,0 +1,565 @@
+/*
+ * File:	Server.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the compile server, and the functions for reading and
+ *		writing the fields of its requests and replies.
+ */
+
+# include <algorithm>
+# include <cerrno>
+# include <cstring>
+# include <ctime>
+# include <memory>
+# include <sstream>
+# include <cstdlib>
+# include <unistd.h>
+# include <sys/socket.h>
+# include <sys/stat.h>
+# include <sys/time.h>
+# include <sys/un.h>
+# include "Cache.h"
+# include "CompilerContext.h"
+# include "Interner.h"
+# include "Server.h"
+# include "ThreadPool.h"
+
+using namespace std;
+
+static const unsigned MAGIC = 'S' | 'C' << 8 | 'C' << 16 | '2' << 24;
+
+/* A server trims its cache at most once in this many seconds, since
+   doing so means looking at every entry. */
+
+static const long TRIM = 60;
+
+/* A client that sends or reads nothing for this many seconds is hung up
+   on, so that it cannot tie up a thread of the pool forever. */
+
+static const long TIMEOUT = 30;
+
+/* No string in a request may be longer than this, and no list may have
+   more entries, so that a request that makes no sense cannot make us
+   allocate more than a real one would. */
+
+static const unsigned MAX_LENGTH = 1 << 28;
+static const unsigned MAX_COUNT = 1 << 16;
+
+/* A string is read this much at a time, so that we only allocate as
+   much as has actually arrived. */
+
+static const unsigned CHUNK = 1 << 20;
+
+/* Each thread of the pool keeps the interner it answers requests with,
+   so that the names they have in common are already there, until it
+   holds more than this many names, so that it cannot grow for good. */
+
+static const unsigned MAX_NAMES = 1 << 20;
+
+static thread_local unique_ptr<Interner> names;
+
+
+/*
+ * Function:	put
+ *
+ * Description:	Write the LENGTH bytes at DATA to the given socket.  A
+ *		peer that has gone away is no reason for us to die of a
+ *		broken pipe.  Return whether they could all be written.
+ */
+
+static bool put(int fd, const void *data, size_t length)
+{
+    const char *p = (const char *) data;
+    ssize_t n;
+
+
+    while (length > 0) {
+	n = send(fd, p, length, MSG_NOSIGNAL);
+
+	if (n < 0 && errno == EINTR)
+	    continue;
+
+	if (n <= 0)
+	    return false;
+
+	p += n;
+	length -= n;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	put
+ *
+ * Description:	Write the given count to the given socket.
+ */
+
+static bool put(int fd, unsigned n)
+{
+    return put(fd, &n, sizeof(n));
+}
+
+
+/*
+ * Function:	put
+ *
+ * Description:	Write the given string to the given socket, preceded by
+ *		its length.
+ */
+
+static bool put(int fd, const string &s)
+{
+    return put(fd, s.size()) && put(fd, s.data(), s.size());
+}
+
+
+/*
+ * Function:	get
+ *
+ * Description:	Read LENGTH bytes from the given socket into DATA.
+ *		Return whether they could all be read.
+ */
+
+static bool get(int fd, void *data, size_t length)
+{
+    char *p = (char *) data;
+    ssize_t n;
+
+
+    while (length > 0) {
+	n = recv(fd, p, length, 0);
+
+	if (n < 0 && errno == EINTR)
+	    continue;
+
+	if (n <= 0)
+	    return false;
+
+	p += n;
+	length -= n;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	get
+ *
+ * Description:	Read a count from the given socket.
+ */
+
+static bool get(int fd, unsigned &n)
+{
+    return get(fd, &n, sizeof(n));
+}
+
+
+/*
+ * Function:	get
+ *
+ * Description:	Read a string, preceded by its length, from the given
+ *		socket.  Return false if it could not be read, or if it
+ *		is longer than LIMIT.
+ */
+
+static bool get(int fd, string &s, unsigned limit = ~0u)
+{
+    unsigned n;
+    size_t size;
+
+
+    if (!get(fd, n) || n > limit)
+	return false;
+
+    s.clear();
+
+    while (s.size() < n) {
+	size = s.size();
+	s.resize(size + min(n - size, (size_t) CHUNK));
+
+	if (!get(fd, &s[size], s.size() - size))
+	    return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	address
+ *
+ * Description:	Fill in the address of the socket at the given path.
+ *		Return false if the path is too long to be one.
+ */
+
+static bool address(const string &path, sockaddr_un &addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof(addr.sun_path)) {
+	errno = ENAMETOOLONG;
+	return false;
+    }
+
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+
+/*
+ * Function:	trusted
+ *
+ * Description:	Return whether the process at the other end of the given
+ *		connection belongs to the same user as we do.
+ */
+
+static bool trusted(int fd)
+{
+    struct ucred peer;
+    socklen_t length = sizeof(peer);
+
+
+    return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &length) == 0 &&
+	length == sizeof(peer) && peer.uid == getuid();
+}
+
+
+/*
+ * Function:	owned
+ *
+ * Description:	Return whether the given path is a directory that belongs
+ *		to us and that no one else can reach into, making it so if
+ *		it is not there at all.
+ */
+
+static bool owned(const string &path)
+{
+    struct stat st;
+
+
+    if (mkdir(path.c_str(), 0700) != 0 && errno != EEXIST)
+	return false;
+
+    return lstat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode) &&
+	st.st_uid == getuid() && (st.st_mode & 077) == 0;
+}
+
+
+/*
+ * Function:	Server::Server (constructor)
+ *
+ * Description:	Initialize this server to listen at the given path and to
+ *		compile with the given pool of threads, using the given
+ *		cache and snapshot if there are any.
+ */
+
+Server::Server(const string &path, ThreadPool &pool, Cache *cache,
+	const Snapshot *snapshot)
+    : _path(path), _pool(pool), _cache(cache), _snapshot(snapshot), _fd(-1),
+      _requests(0), _trimmed(0)
+{
+}
+
+
+/*
+ * Function:	Server::~Server (destructor)
+ *
+ * Description:	Stop listening, and remove the socket if it is ours.
+ */
+
+Server::~Server()
+{
+    if (_fd >= 0) {
+	close(_fd);
+	unlink(_path.c_str());
+    }
+}
+
+
+/*
+ * Function:	Server::listen
+ *
+ * Description:	Start listening for requests.  A socket left behind by a
+ *		server that is no longer running is removed first, but
+ *		not one that a server is still listening at.  Return
+ *		whether we are listening.
+ */
+
+bool Server::listen()
+{
+    sockaddr_un addr;
+    int fd;
+
+
+    if (!address(_path, addr))
+	return false;
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+	return false;
+
+    if (connect(fd, (sockaddr *) &addr, sizeof(addr)) == 0) {
+	close(fd);
+	errno = EADDRINUSE;
+	return false;
+    }
+
+    if (errno == ECONNREFUSED)
+	unlink(_path.c_str());
+
+    if (bind(fd, (sockaddr *) &addr, sizeof(addr)) != 0 ||
+	    ::listen(fd, SOMAXCONN) != 0) {
+	close(fd);
+	return false;
+    }
+
+    _fd = fd;
+    return true;
+}
+
+
+/*
+ * Function:	Server::answer
+ *
+ * Description:	Read the request on the given connection, compile it with
+ *		a context of its own and the interner of this thread,
+ *		which is replaced first if it has grown too large, and
+ *		write the reply.  A request
+ *		from another user, or that makes no sense, or that is too
+ *		large, or that stops arriving, is simply hung up on.
+ *		Once the reply is on its way, we trim the cache if it is
+ *		time to.
+ */
+
+void Server::answer(int fd)
+{
+    struct timeval timeout = { TIMEOUT, 0 };
+    unsigned magic, level, count;
+    Interner *interner;
+    ostringstream errors;
+    Request request;
+    Reply reply;
+    long now;
+
+
+    if (!trusted(fd)) {
+	close(fd);
+	return;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    if (!get(fd, magic) || magic != MAGIC || !get(fd, level) ||
+	    level > ANNOTATE_VERBOSE || !get(fd, count) || count > MAX_COUNT) {
+	close(fd);
+	return;
+    }
+
+    request.roots.resize(count);
+
+    for (unsigned i = 0; i < count; i ++)
+	if (!get(fd, request.roots[i], MAX_LENGTH)) {
+	    close(fd);
+	    return;
+	}
+
+    if (!get(fd, request.directory, MAX_LENGTH) || !get(fd, count) ||
+	    count > MAX_COUNT) {
+	close(fd);
+	return;
+    }
+
+    request.includes.resize(count);
+
+    for (unsigned i = 0; i < count; i ++)
+	if (!get(fd, request.includes[i], MAX_LENGTH)) {
+	    close(fd);
+	    return;
+	}
+
+    if (!get(fd, request.source, MAX_LENGTH)) {
+	close(fd);
+	return;
+    }
+
+    if (names == nullptr || names->size() > MAX_NAMES)
+	names.reset(new Interner());
+
+    interner = Interner::current();
+    Interner::current(names.get());
+
+    {
+	CompilerContext unit(errors);
+	ThreadPool serial(1);
+
+	unit.open(request.source.data(), request.source.size());
+	unit.output(reply.assembly);
+	unit.annotate(level);
+
+	for (unsigned i = 0; i < request.roots.size(); i ++)
+	    unit.root(request.roots[i]);
+
+	for (unsigned i = 0; i < request.includes.size(); i ++)
+	    unit.include(request.includes[i]);
+
+	unit.directory = request.directory;
+	unit.use(_headers);
+
+	if (_cache != nullptr)
+	    unit.use(*_cache);
+
+	if (_snapshot != nullptr)
+	    unit.seed(*_snapshot);
+
+	reply.parsed = unit.compile(serial);
+	reply.errors = unit.errors();
+    }
+
+    Interner::current(interner);
+
+    reply.diagnostics = errors.str();
+
+    put(fd, reply.parsed) && put(fd, reply.errors) &&
+	put(fd, reply.assembly) && put(fd, reply.diagnostics);
+
+    close(fd);
+    _requests ++;
+
+    if (_cache != nullptr) {
+	lock_guard<mutex> guard(_mutex);
+
+	if ((now = time(nullptr)) - _trimmed >= TRIM) {
+	    _trimmed = now;
+	    _cache->trim();
+	}
+    }
+}
+
+
+/*
+ * Function:	Server::run
+ *
+ * Description:	Answer requests using the pool until we are told to stop,
+ *		and then finish those we have accepted.
+ */
+
+void Server::run(const volatile sig_atomic_t &stopping)
+{
+    int fd;
+
+
+    while (!stopping) {
+	fd = accept4(_fd, nullptr, nullptr, SOCK_CLOEXEC);
+
+	if (fd >= 0)
+	    _pool.submit([this, fd]() {
+		answer(fd);
+	    });
+	else if (errno != EINTR && errno != ECONNABORTED)
+	    break;
+    }
+
+    _pool.wait();
+}
+
+
+/*
+ * Function:	Server::requests (accessor)
+ *
+ * Description:	Return the number of requests answered.
+ */
+
+unsigned Server::requests() const
+{
+    return _requests;
+}
+
+
+/*
+ * Function:	Server::headers (accessor)
+ *
+ * Description:	Return the headers that requests have included.
+ */
+
+const Headers &Server::headers() const
+{
+    return _headers;
+}
+
+
+/*
+ * Function:	Server::path
+ *
+ * Description:	Return the path of the socket to use when none is named:
+ *		scc.sock in the runtime directory of the user if there is
+ *		one, and otherwise in a directory of our own in /tmp.
+ *		Either directory must belong to us and be closed to
+ *		everyone else, since anyone who could replace the socket
+ *		could answer our requests.  Return the empty string if
+ *		there is no such directory.
+ */
+
+string Server::path()
+{
+    const char *runtime = getenv("XDG_RUNTIME_DIR");
+    string directory;
+
+
+    if (runtime != nullptr && runtime[0] == '/')
+	directory = runtime;
+    else
+	directory = "/tmp/scc-" + to_string(getuid());
+
+    return owned(directory) ? directory + "/scc.sock" : "";
+}
+
+
+/*
+ * Function:	Server::request
+ *
+ * Description:	Send the given request to the server at the given path
+ *		and wait for its reply.  Return whether there was a
+ *		server there to answer it.  A server run by another user
+ *		is not sent the request, and so is as good as none.
+ */
+
+bool Server::request(const string &path, const Request &request,
+	Reply &reply)
+{
+    unsigned parsed = 0;
+    sockaddr_un addr;
+    bool answered;
+    int fd;
+
+
+    if (!address(path, addr))
+	return false;
+
+    if ((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+	return false;
+
+    answered = connect(fd, (sockaddr *) &addr, sizeof(addr)) == 0 &&
+	trusted(fd) && put(fd, MAGIC) && put(fd, request.annotations) &&
+	put(fd, request.roots.size());
+
+    for (unsigned i = 0; answered && i < request.roots.size(); i ++)
+	answered = put(fd, request.roots[i]);
+
+    answered = answered && put(fd, request.directory) &&
+	put(fd, request.includes.size());
+
+    for (unsigned i = 0; answered && i < request.includes.size(); i ++)
+	answered = put(fd, request.includes[i]);
+
+    answered = answered && put(fd, request.source) && get(fd, parsed) &&
+	get(fd, reply.errors) && get(fd, reply.assembly) &&
+	get(fd, reply.diagnostics);
+
+    reply.parsed = parsed != 0;
+    close(fd);
+    return answered;
+}
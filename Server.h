@@ -0,0 +1,98 @@
+/*
+ * File:	Server.h
+ *
+ * Description:	This file contains the class definition for a compile
+ *		server, which listens on a Unix domain socket and compiles
+ *		each source sent to it, sending back the assembly and the
+ *		diagnostics.  A server stays up between compilations, so
+ *		the type table, the pool of threads, the headers, and the
+ *		cache of generated code are all warm by the time a request
+ *		arrives, and a compilation costs no more than the
+ *		compilation itself.  So are the interners, one for each
+ *		thread of the pool, though each is replaced once it holds
+ *		too many names, since otherwise the names of every request
+ *		ever answered would be kept for good.
+ *
+ *		Each connection carries a single request and its reply.
+ *		Every field of either is a 32-bit count, in the byte order
+ *		of the machine, followed by that many bytes if it is a
+ *		string.  A request is the word SCC2, the level of
+ *		commentary, the number of roots and the roots, the
+ *		directory of the source and the number of directories to
+ *		look for headers in and those directories, all of them
+ *		absolute, and the source.  A reply is whether the source
+ *		could be parsed, the number of errors, the assembly, and
+ *		the diagnostics.  A request with a string or a list that
+ *		is too long, or from a client that stops sending or
+ *		reading for long enough, is hung up on.
+ *
+ *		The socket is only for the user who started the server.
+ *		Its default path is in a directory that only that user
+ *		can reach, and both ends check that the process at the
+ *		other end belongs to the same user before they send it
+ *		anything.
+ *
+ *		Requests are answered concurrently by the pool, each with
+ *		a context of its own, and each seeded with the snapshot of
+ *		the server if there is one.  They all share the headers of
+ *		the server, so each header is only tokenized once.
+ */
+
+# ifndef SERVER_H
+# define SERVER_H
+# include <atomic>
+# include <csignal>
+# include <mutex>
+# include <string>
+# include <vector>
+# include "Headers.h"
+
+class Cache;
+class Snapshot;
+class ThreadPool;
+
+struct Request {
+    int annotations;
+    std::vector<std::string> roots;
+    std::string directory;
+    std::vector<std::string> includes;
+    std::string source;
+};
+
+struct Reply {
+    bool parsed;
+    unsigned errors;
+    std::string assembly, diagnostics;
+};
+
+class Server {
+    typedef std::string string;
+
+    string _path;
+    ThreadPool &_pool;
+    Cache *_cache;
+    const Snapshot *_snapshot;
+    Headers _headers;
+    int _fd;
+    std::atomic<unsigned> _requests;
+    std::mutex _mutex;
+    long _trimmed;
+
+    void answer(int fd);
+
+public:
+    Server(const string &path, ThreadPool &pool, Cache *cache = nullptr,
+	    const Snapshot *snapshot = nullptr);
+    ~Server();
+
+    bool listen();
+    void run(const volatile sig_atomic_t &stopping);
+    unsigned requests() const;
+    const Headers &headers() const;
+
+    static string path();
+    static bool request(const string &path, const Request &request,
+	    Reply &reply);
+};
+
+# endif /* SERVER_H */
@@ -0,0 +1,461 @@
+/*
+ * File:	Snapshot.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		snapshots of declarations.
+ *
+ *		A type is written as its kind, specifier, and indirection,
+ *		followed by the length of an array, or for a function, one
+ *		more than the number of its parameters, or zero if they
+ *		are unspecified, and then the index of the type of each.
+ *		Every type comes after the types of its parameters.  A
+ *		symbol is written as the offset and length of its name and
+ *		the index of its type.  The digest in the header is of the
+ *		words of the header before it and of everything after it,
+ *		and leaves out the build, since a snapshot outlives it.
+ */
+
+# include <algorithm>
+# include <cerrno>
+# include <cstring>
+# include <fstream>
+# include <map>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include "Cache.h"
+# include "CompilerContext.h"
+# include "Interner.h"
+# include "Scope.h"
+# include "Snapshot.h"
+# include "machine.h"
+# include "tokens.h"
+
+using namespace std;
+
+enum { SCALAR_TYPE, ARRAY_TYPE, FUNCTION_TYPE, ERROR_TYPE };
+
+enum {
+    MAGIC, VERSION, LENGTH, LINES, TYPES, TYPE_WORDS, SYMBOLS, NAME_BYTES,
+    DIGEST, HEADER_WORDS = DIGEST + 8
+};
+
+static const unsigned magic = 'S' | 'C' << 8 | 'C' << 16 | 'D' << 24;
+static const unsigned version = 2;
+
+
+/*
+ * Function:	encode
+ *
+ * Description:	Return the index of the given type in the table of TYPES,
+ *		adding it and the types of its parameters if they are not
+ *		there yet.  The table is indexed by the words of each
+ *		type, which tell types apart even where the equality of
+ *		types does not.
+ */
+
+static unsigned encode(const Type &type, vector<unsigned> &types,
+	map<vector<unsigned>, unsigned> &indices)
+{
+    map<vector<unsigned>, unsigned>::iterator it;
+    const Parameters *params;
+    vector<unsigned> words;
+    unsigned index;
+
+
+    if (type.isArray())
+	words.push_back(ARRAY_TYPE);
+    else if (type.isFunction())
+	words.push_back(FUNCTION_TYPE);
+    else if (type.isError())
+	words.push_back(ERROR_TYPE);
+    else
+	words.push_back(SCALAR_TYPE);
+
+    words.push_back(type.specifier());
+    words.push_back(type.indirection());
+
+    if (type.isArray())
+	words.push_back(type.length());
+    else if (type.isFunction()) {
+	params = type.parameters();
+	words.push_back(params != nullptr ? params->size() + 1 : 0);
+
+	for (unsigned i = 0; params != nullptr && i < params->size(); i ++)
+	    words.push_back(encode((*params)[i], types, indices));
+    }
+
+    if ((it = indices.find(words)) != indices.end())
+	return it->second;
+
+    index = indices.size();
+    indices.insert(make_pair(words, index));
+    types.insert(types.end(), words.begin(), words.end());
+    return index;
+}
+
+
+/*
+ * Function:	sane
+ *
+ * Description:	Return whether a unit with a source of the given length
+ *		could have declared a type with the given specifier and
+ *		indirection, and the given length if it is an array: its
+ *		specifier must be one there is, each level of indirection
+ *		takes an asterisk in the source, and the size of an array
+ *		must fit in 32 bits.  Anything else can only come from a
+ *		damaged file, and a type with billions of levels of
+ *		indirection would take the rest of our lives to make.
+ */
+
+static bool sane(size_t source, unsigned specifier, unsigned indirection,
+	unsigned length = 0)
+{
+    unsigned size;
+
+
+    if ((specifier != INT && specifier != DOUBLE) || indirection > source)
+	return false;
+
+    if (indirection > 0)
+	size = SIZEOF_PTR;
+    else if (specifier == INT)
+	size = SIZEOF_INT;
+    else
+	size = SIZEOF_DOUBLE;
+
+    return length <= ~0u / size;
+}
+
+
+/*
+ * Function:	commented
+ *
+ * Description:	Return whether the source from P to LIMIT ends within a
+ *		comment, scanning it just as the lexer does.  The lexer
+ *		lets a comment run to the end of the source, but in a unit
+ *		that carries on from there, the comment would run on into
+ *		the rest of it.
+ */
+
+static bool commented(const char *p, const char *limit)
+{
+    while (p < limit)
+	if (*p == '"') {
+	    p ++;
+
+	    while (p < limit && *p != '"' && *p != '\n')
+		p ++;
+
+	    p ++;
+	} else if (*p == '/' && p + 1 < limit && p[1] == '*') {
+	    p += 2;
+
+	    while (p + 1 < limit && (p[0] != '*' || p[1] != '/'))
+		p ++;
+
+	    if (p + 1 >= limit)
+		return true;
+
+	    p += 2;
+	} else
+	    p ++;
+
+    return false;
+}
+
+
+/*
+ * Function:	Snapshot::Snapshot (constructor)
+ *
+ * Description:	Initialize this snapshot to be empty.
+ */
+
+Snapshot::Snapshot()
+    : _mapping(nullptr), _mapped(0), _source(nullptr), _length(0),
+      _lines(0)
+{
+}
+
+
+/*
+ * Function:	Snapshot::~Snapshot (destructor)
+ *
+ * Description:	Unmap the file of this snapshot.
+ */
+
+Snapshot::~Snapshot()
+{
+    if (_mapping != nullptr)
+	munmap(_mapping, _mapped);
+}
+
+
+/*
+ * Function:	Snapshot::open
+ *
+ * Description:	Map the named snapshot into memory and decode its types
+ *		and symbols.  Return false if it cannot be read, or if it
+ *		is not a snapshot of this version, or if it does not match
+ *		its digest, or if it has a type that its source could not
+ *		have declared.
+ */
+
+bool Snapshot::open(const char *path)
+{
+    const unsigned *words, *p, *end;
+    const char *bytes, *text;
+    vector<Type> types;
+    Parameters params;
+    struct stat st;
+    string sum;
+    size_t size;
+    unsigned n;
+    void *addr;
+    int fd;
+
+
+    if ((fd = ::open(path, O_RDONLY)) < 0)
+	return false;
+
+    if (fstat(fd, &st) != 0 || st.st_size < HEADER_WORDS * 4) {
+	close(fd);
+	return false;
+    }
+
+    size = st.st_size;
+    addr = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED)
+	return false;
+
+    _mapping = addr;
+    _mapped = size;
+    words = (const unsigned *) addr;
+
+    if (words[MAGIC] != magic || words[VERSION] != version)
+	return false;
+
+    if (size != HEADER_WORDS * 4 + ((size_t) words[TYPE_WORDS] +
+	    (size_t) words[SYMBOLS] * 3) * 4 + words[LENGTH] +
+	    words[NAME_BYTES])
+	return false;
+
+    sum = Digest(false).add(words, DIGEST * 4)
+	.add(words + HEADER_WORDS, size - HEADER_WORDS * 4).str();
+
+    if (sum.compare(0, 32, (const char *) (words + DIGEST), 32) != 0)
+	return false;
+
+    p = words + HEADER_WORDS;
+    end = p + words[TYPE_WORDS];
+    bytes = (const char *) (end + 3 * words[SYMBOLS]);
+    text = bytes + words[LENGTH];
+
+
+    /* Decode the types, each of which can only refer to those before
+       it. */
+
+    while (p < end && types.size() < words[TYPES]) {
+	if (end - p < 3)
+	    return false;
+
+	if (p[0] == ERROR_TYPE)
+	    types.push_back(Type()), p += 3;
+	else if (!sane(words[LENGTH], p[1], p[2], p[0] == ARRAY_TYPE &&
+		end - p >= 4 ? p[3] : 0))
+	    return false;
+	else if (p[0] == SCALAR_TYPE)
+	    types.push_back(Type(p[1], p[2])), p += 3;
+	else if (p[0] == ARRAY_TYPE && end - p >= 4)
+	    types.push_back(Type(p[1], p[2], p[3])), p += 4;
+	else if (p[0] == FUNCTION_TYPE && end - p >= 4) {
+	    n = (p[3] > 0 ? p[3] - 1 : 0);
+
+	    if ((size_t) (end - p - 4) < n)
+		return false;
+
+	    params.clear();
+
+	    for (unsigned i = 0; i < n; i ++)
+		if (p[4 + i] < types.size())
+		    params.push_back(types[p[4 + i]]);
+		else
+		    return false;
+
+	    types.push_back(Type(p[1], p[2], p[3] > 0 ? &params : nullptr));
+	    p += 4 + n;
+	} else
+	    return false;
+    }
+
+    if (p != end || types.size() != words[TYPES])
+	return false;
+
+
+    /* Decode the symbols, whose names stay where they are. */
+
+    _names.clear();
+    _lengths.clear();
+    _types.clear();
+
+    for (unsigned i = 0; i < words[SYMBOLS]; i ++, p += 3) {
+	if (p[0] > words[NAME_BYTES] || p[1] > words[NAME_BYTES] - p[0] ||
+		p[2] >= types.size())
+	    return false;
+
+	_names.push_back(text + p[0]);
+	_lengths.push_back(p[1]);
+	_types.push_back(types[p[2]]);
+    }
+
+    _source = bytes;
+    _length = words[LENGTH];
+    _lines = words[LINES];
+    return true;
+}
+
+
+/*
+ * Function:	Snapshot::begins
+ *
+ * Description:	Return whether the source from SOURCE to LIMIT begins with
+ *		the source of this snapshot.
+ */
+
+bool Snapshot::begins(const char *source, const char *limit) const
+{
+    return _source != nullptr && (size_t) (limit - source) >= _length &&
+	memcmp(source, _source, _length) == 0;
+}
+
+
+/*
+ * Function:	Snapshot::length (accessor)
+ *
+ * Description:	Return the length of the source of this snapshot.
+ */
+
+size_t Snapshot::length() const
+{
+    return _length;
+}
+
+
+/*
+ * Function:	Snapshot::lines (accessor)
+ *
+ * Description:	Return the number of lines in the source of this snapshot.
+ */
+
+unsigned Snapshot::lines() const
+{
+    return _lines;
+}
+
+
+/*
+ * Function:	Snapshot::symbols (accessor)
+ *
+ * Description:	Store the id and type of each symbol of this snapshot in
+ *		SYMBOLS, in the order they were declared, interning their
+ *		names with the current interner in one batch.
+ */
+
+void Snapshot::symbols(vector<pair<unsigned, Type> > &symbols) const
+{
+    vector<unsigned> ids(_names.size());
+
+
+    if (!_names.empty())
+	Interner::current()->intern(&_names[0], &_lengths[0], _names.size(),
+		&ids[0]);
+
+    symbols.clear();
+
+    for (unsigned i = 0; i < ids.size(); i ++)
+	symbols.push_back(make_pair(ids[i], _types[i]));
+}
+
+
+/*
+ * Function:	Snapshot::save
+ *
+ * Description:	Write a snapshot of the given unit, which has been
+ *		compiled, to the named file.  The unit must have no errors
+ *		and no function definitions, and must end with a newline
+ *		and outside of any comment, so that another unit can carry
+ *		on where it stops.  It must have no directives either,
+ *		since a snapshot does not keep the macros that they
+ *		define, and no array too large for its size to fit in 32
+ *		bits, since the snapshot would not be opened again.  A
+ *		function is only given a parameter list by its definition,
+ *		so that is how we tell.  Return null if the snapshot was
+ *		written, and otherwise why not.
+ */
+
+const char *Snapshot::save(const char *path, const CompilerContext &unit)
+{
+    const Symbols &symbols = unit.outermost->symbols();
+    map<vector<unsigned>, unsigned> indices;
+    vector<unsigned> header(HEADER_WORDS), types, words;
+    size_t length = unit.limit - unit.source;
+    ofstream out;
+    string text, sum;
+
+
+    if (unit.errors() > 0)
+	return "it has errors";
+
+    if (length > 0 && unit.limit[-1] != '\n')
+	return "it does not end with a newline";
+
+    if (commented(unit.source, unit.limit))
+	return "it ends within a comment";
+
+    if (unit.directives > 0)
+	return "it has preprocessor directives";
+
+    for (unsigned i = 0; i < symbols.size(); i ++) {
+	const Type &type = symbols[i]->type();
+
+	if (type.isFunction() && type.parameters() != nullptr)
+	    return "it defines a function";
+
+	if (type.isArray() && !sane(length, type.specifier(),
+		type.indirection(), type.length()))
+	    return "it declares an array that is too large";
+
+	words.push_back(text.size());
+	words.push_back(symbols[i]->name().size());
+	words.push_back(encode(type, types, indices));
+	text += symbols[i]->name();
+    }
+
+    header[MAGIC] = magic;
+    header[VERSION] = version;
+    header[LENGTH] = length;
+    header[LINES] = count(unit.source, unit.limit, '\n');
+    header[TYPES] = indices.size();
+    header[TYPE_WORDS] = types.size();
+    header[SYMBOLS] = symbols.size();
+    header[NAME_BYTES] = text.size();
+
+    sum = Digest(false).add(header.data(), DIGEST * 4)
+	.add(types.data(), types.size() * 4)
+	.add(words.data(), words.size() * 4).add(unit.source, length)
+	.add(text.data(), text.size()).str();
+    memcpy(&header[DIGEST], sum.data(), 32);
+
+    out.open(path, ios::binary);
+    out.write((const char *) &header[0], header.size() * 4);
+    out.write((const char *) types.data(), types.size() * 4);
+    out.write((const char *) words.data(), words.size() * 4);
+    out.write(unit.source, length);
+    out << text;
+    out.close();
+
+    return out ? nullptr : strerror(errno);
+}
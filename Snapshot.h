@@ -0,0 +1,63 @@
+/*
+ * File:	Snapshot.h
+ *
+ * Description:	This file contains the class definition for a snapshot of
+ *		the declarations of a unit, which spares a later unit that
+ *		begins with the same declarations from tokenizing and
+ *		parsing them again.
+ *
+ *		A snapshot is made of a unit that only declares things,
+ *		and keeps its source and the symbols of its outermost
+ *		scope, in order.  A unit whose source begins with exactly
+ *		that source has the symbols declared straight from the
+ *		snapshot, and only the rest of its source is tokenized.
+ *		Any other unit is compiled as if there were no snapshot
+ *		at all, so a snapshot can never change what a unit means.
+ *
+ *		The file is binary, but is still independent of the
+ *		process that wrote it, since names are kept as strings
+ *		and types as a table of their own.  It is a header of
+ *		32-bit words, the types and the symbols as more words,
+ *		and then the source and the names as bytes.  The header
+ *		ends with a digest of the rest of the file, so a snapshot
+ *		that has been damaged is refused.  A snapshot is
+ *		mapped into memory and decoded once, and can then be used
+ *		by any number of units at once.  Units may have interners
+ *		of their own, so the names are left as they are in the
+ *		file, and each unit interns them for itself.
+ */
+
+# ifndef SNAPSHOT_H
+# define SNAPSHOT_H
+# include <string>
+# include <vector>
+# include "Type.h"
+
+class CompilerContext;
+
+class Snapshot {
+    typedef std::string string;
+
+    void *_mapping;
+    size_t _mapped;
+    const char *_source;
+    size_t _length;
+    unsigned _lines;
+    std::vector<const char *> _names;
+    std::vector<unsigned> _lengths;
+    std::vector<Type> _types;
+
+public:
+    Snapshot();
+    ~Snapshot();
+
+    bool open(const char *path);
+    bool begins(const char *source, const char *limit) const;
+    size_t length() const;
+    unsigned lines() const;
+    void symbols(std::vector<std::pair<unsigned, Type> > &symbols) const;
+
+    static const char *save(const char *path, const CompilerContext &unit);
+};
+
+# endif /* SNAPSHOT_H */
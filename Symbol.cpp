@@ -6,7 +6,10 @@
  *		and an offset.
  */
 
+# include "Arena.h"
 # include "Symbol.h"
+# include "Interner.h"
+# include "Profile.h"
 
 using std::string;
 
@@ -14,12 +17,74 @@ using std::string;
 /*
  * Function:	Symbol::Symbol (constructor)
  *
- * Description:	Initialize a symbol object.
+ * Description:	Initialize a symbol object, and count it if we are
+ *		profiling.
  */
 
-Symbol::Symbol(const string &name, const Type &type)
-    : _name(name), _type(type), _offset(0)
+Symbol::Symbol(unsigned id, const Type &type)
+    : _id(id), _offset(0), _type(type)
 {
+    Timer::count(SYMBOLS, 1);
+}
+
+
+/*
+ * Function:	Symbol::operator new
+ *
+ * Description:	Allocate a symbol from the current arena.
+ */
+
+void *Symbol::operator new(size_t size)
+{
+    return Arena::current()->allocate(size);
+}
+
+
+/*
+ * Function:	Symbol::operator new
+ *
+ * Description:	Allocate a symbol from the given arena.
+ */
+
+void *Symbol::operator new(size_t size, Arena &arena)
+{
+    return arena.allocate(size);
+}
+
+
+/*
+ * Function:	Symbol::operator delete
+ *
+ * Description:	Do nothing, since the symbol's memory belongs to its
+ *		arena.
+ */
+
+void Symbol::operator delete(void *object)
+{
+}
+
+
+/*
+ * Function:	Symbol::operator delete
+ *
+ * Description:	Do nothing, as above.  This one is only called if the
+ *		constructor throws.
+ */
+
+void Symbol::operator delete(void *object, Arena &arena)
+{
+}
+
+
+/*
+ * Function:	Symbol::id (accessor)
+ *
+ * Description:	Return the interned id of the name of this symbol.
+ */
+
+unsigned Symbol::id() const
+{
+    return _id;
 }
 
 
@@ -31,7 +96,7 @@ Symbol::Symbol(const string &name, const Type &type)
 
 const string &Symbol::name() const
 {
-    return _name;
+    return Interner::current()->name(_id);
 }
 
 
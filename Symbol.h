@@ -3,7 +3,13 @@
  *
  * Description:	This file contains the class definition for symbols in
  *		Simple C.  A symbol consists of a name and a type, neither
- *		of which you can change, and an offset.
+ *		of which you can change, and an offset.  The name is kept
+ *		as its id in the interner, so comparing names is just
+ *		comparing integers.
+ *
+ *		Symbols are allocated from an arena, usually the current
+ *		one.  A symbol has nothing to destroy, so deleting one does
+ *		nothing at all.
  */
 
 # ifndef SYMBOL_H
@@ -13,12 +19,18 @@
 
 class Symbol {
     typedef std::string string;
-    string _name;
-    Type _type;
+    unsigned _id;
     int _offset;
+    Type _type;
 
 public:
-    Symbol(const string &name, const Type &type);
+    Symbol(unsigned id, const Type &type);
+
+    static void *operator new(size_t size);
+    static void *operator new(size_t size, class Arena &arena);
+    static void operator delete(void *object);
+    static void operator delete(void *object, class Arena &arena);
+    unsigned id() const;
     const string &name() const;
     const Type &type() const;
     int offset() const;
@@ -0,0 +1,200 @@
+/*
+ * File:	ThreadPool.cpp
+ *
+ * Description:	This file contains the member function definitions for
+ *		the pool of worker threads.
+ */
+
+# include <utility>
+# include "ThreadPool.h"
+
+using namespace std;
+
+thread_local ThreadPool *ThreadPool::_pool = nullptr;
+thread_local unsigned ThreadPool::_index = 0;
+
+
+/*
+ * Function:	ThreadPool::ThreadPool (constructor)
+ *
+ * Description:	Initialize this pool with the given number of threads.
+ *		A single thread needs no workers, since the calling thread
+ *		can just as well run each task itself.
+ */
+
+ThreadPool::ThreadPool(unsigned threads)
+    : _queues(threads > 1 ? threads : 0), _queued(0), _unfinished(0),
+      _next(0), _stopping(false)
+{
+    for (unsigned i = 0; threads > 1 && i < threads; i ++)
+	_workers.push_back(thread(&ThreadPool::work, this, i));
+}
+
+
+/*
+ * Function:	ThreadPool::~ThreadPool (destructor)
+ *
+ * Description:	Finish any outstanding tasks and then stop the workers.
+ */
+
+ThreadPool::~ThreadPool()
+{
+    wait();
+
+    {
+	lock_guard<mutex> lock(_mutex);
+	_stopping = true;
+    }
+
+    _ready.notify_all();
+
+    for (unsigned i = 0; i < _workers.size(); i ++)
+	_workers[i].join();
+}
+
+
+/*
+ * Function:	ThreadPool::take
+ *
+ * Description:	Take a task for the worker with the given INDEX: the
+ *		newest on its own queue, or failing that, the oldest on
+ *		the next queue that has any.  Return whether there was a
+ *		task to take.
+ */
+
+bool ThreadPool::take(unsigned index, Task &task)
+{
+    unsigned n = _queues.size();
+
+
+    for (unsigned i = 0; i < n; i ++) {
+	Queue &queue = _queues[(index + i) % n];
+	lock_guard<mutex> lock(queue.mutex);
+
+	if (!queue.tasks.empty()) {
+	    if (i == 0) {
+		task = move(queue.tasks.back());
+		queue.tasks.pop_back();
+	    } else {
+		task = move(queue.tasks.front());
+		queue.tasks.pop_front();
+	    }
+
+	    return true;
+	}
+    }
+
+    return false;
+}
+
+
+/*
+ * Function:	ThreadPool::work
+ *
+ * Description:	Run tasks until the pool is stopped, sleeping whenever
+ *		there are none left to take.  A task is counted as queued
+ *		before it is actually on a queue, so we may briefly find
+ *		nothing to take even though the count says otherwise, in
+ *		which case we just look again.
+ */
+
+void ThreadPool::work(unsigned index)
+{
+    Task task;
+
+
+    _pool = this;
+    _index = index;
+
+    while (1) {
+	{
+	    unique_lock<mutex> lock(_mutex);
+
+	    while (_queued == 0 && !_stopping)
+		_ready.wait(lock);
+
+	    if (_queued == 0)
+		return;
+	}
+
+	if (!take(index, task)) {
+	    this_thread::yield();
+	    continue;
+	}
+
+	{
+	    lock_guard<mutex> lock(_mutex);
+	    _queued --;
+	}
+
+	task();
+	task = nullptr;
+
+	{
+	    lock_guard<mutex> lock(_mutex);
+
+	    if (-- _unfinished == 0)
+		_idle.notify_all();
+	}
+    }
+}
+
+
+/*
+ * Function:	ThreadPool::submit
+ *
+ * Description:	Submit a task to be run by the pool.  If the pool has no
+ *		workers, the task is run immediately.
+ */
+
+void ThreadPool::submit(const Task &task)
+{
+    unsigned index;
+
+
+    if (_workers.empty()) {
+	task();
+	return;
+    }
+
+    {
+	lock_guard<mutex> lock(_mutex);
+	index = (_pool == this ? _index : _next ++ % _queues.size());
+	_queued ++;
+	_unfinished ++;
+    }
+
+    {
+	lock_guard<mutex> lock(_queues[index].mutex);
+	_queues[index].tasks.push_back(task);
+    }
+
+    _ready.notify_one();
+}
+
+
+/*
+ * Function:	ThreadPool::wait
+ *
+ * Description:	Wait until all submitted tasks have finished.
+ */
+
+void ThreadPool::wait()
+{
+    unique_lock<mutex> lock(_mutex);
+
+    while (_unfinished > 0)
+	_idle.wait(lock);
+}
+
+
+/*
+ * Function:	ThreadPool::size (accessor)
+ *
+ * Description:	Return the number of threads running tasks in this pool.
+ */
+
+unsigned ThreadPool::size() const
+{
+    return _workers.empty() ? 1 : _workers.size();
+}
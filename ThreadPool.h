@@ -0,0 +1,59 @@
+/*
+ * File:	ThreadPool.h
+ *
+ * Description:	This file contains the class definition for a simple pool
+ *		of worker threads, and wait() blocks until every submitted
+ *		task has finished.  A pool of size one has no workers at
+ *		all and simply runs each task as it is submitted, so
+ *		callers never need a separate sequential path.
+ *
+ *		Each worker has a queue of its own.  Tasks submitted from
+ *		outside the pool are dealt out to the queues in turn, and
+ *		a task submitted by a worker goes on that worker's queue.
+ *		A worker runs the newest task on its own queue first, and
+ *		once that is empty, steals the oldest task from another.
+ *		So, workers mostly take tasks from a queue that no one
+ *		else is using, and tasks of very different sizes still
+ *		keep every worker busy.
+ */
+
+# ifndef THREADPOOL_H
+# define THREADPOOL_H
+# include <deque>
+# include <mutex>
+# include <thread>
+# include <vector>
+# include <functional>
+# include <condition_variable>
+
+class ThreadPool {
+    typedef std::function<void()> Task;
+
+    struct Queue {
+	std::mutex mutex;
+	std::deque<Task> tasks;
+    };
+
+    std::vector<std::thread> _workers;
+    std::vector<Queue> _queues;
+    std::mutex _mutex;
+    std::condition_variable _ready, _idle;
+    unsigned _queued, _unfinished, _next;
+    bool _stopping;
+
+    static thread_local ThreadPool *_pool;
+    static thread_local unsigned _index;
+
+    bool take(unsigned index, Task &task);
+    void work(unsigned index);
+
+public:
+    ThreadPool(unsigned threads);
+    ~ThreadPool();
+
+    void submit(const Task &task);
+    void wait();
+    unsigned size() const;
+};
+
+# endif /* THREADPOOL_H */
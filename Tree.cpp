@@ -1,16 +1,17 @@
 /*
  * File:	Tree.cpp
  *
- * Description:	This file contains the constructor and accessor member
- *		function definitions for abstract syntax trees in Simple C.
+ * Description:	This file contains the member function definitions for
+ *		making the nodes of abstract syntax trees in Simple C, and
+ *		for getting at them.
  *
  *		The tree is actually built during semantic checking, where
  *		type information is readily available.  Any simplifications
  *		or canonicalizations of the tree are performed when it is
  *		constructed.
  *
- *		The functions here are just the constructors and accessors.
- *		The storage allocation and code generation functions are
+ *		The functions here just make nodes and get at them.  The
+ *		storage allocation and code generation functions are
  *		located elsewhere.  Most of these functions don't do
  *		anything interesting, and could easily be put in the header
  *		file, but we don't like to do that.
@@ -19,499 +20,775 @@
  *		- everything (it is optional to construct an AST)
  */
 
+# include <atomic>
+# include <stdexcept>
+# include "CompilerContext.h"
 # include "Tree.h"
 # include "tokens.h"
-# include <sstream>
+# include "Interner.h"
 
 using namespace std;
 
-int fLabel::counter = 0;
-vector<fLabel> fLabels;
+const Tree::Id Tree::NONE;
+
+thread_local Tree *Tree::_current = nullptr;
+static atomic<unsigned long> nodes[Tree::SUBTRACT_EXPR + 1];
+
 
 /*
- * Function:	Expression::Expression (constructor)
+ * Function:	Tree::kind
  *
- * Description:	Initialize the expression object to not be an lvalue and to
- *		have the specified type.
+ * Description:	Return the kind of the node with the given id, which is
+ *		in its top bits.
  */
 
-Expression::Expression(const Type &type)
-    : _type(type), _lvalue(false)
+Tree::Kind Tree::kind(Id id)
 {
+    return (Kind) (id >> INDEX_BITS);
 }
 
 
 /*
- * Function:	Expression::type (accessor)
+ * Function:	Tree::index
  *
- * Description:	Return the type of this expression.
+ * Description:	Return the index of the node with the given id into the
+ *		array for its kind.
  */
 
-const Type &Expression::type() const
+unsigned Tree::index(Id id)
 {
-    return _type;
+    return id & ((1u << INDEX_BITS) - 1);
 }
 
 
 /*
- * Function:	Expression::lvalue (accessor)
+ * Function:	Tree::add
  *
- * Description:	Return whether this expression is an lvalue.
+ * Description:	Add a record for a node of the given kind to the end of
+ *		the given array, and return it along with its id.  An
+ *		array can only hold as many records as there are indices,
+ *		and adding one more than that is an error.
  */
 
-bool Expression::lvalue() const
+template<class T>
+T &Tree::add(Kind kind, vector<T> &records, Id &id)
 {
-    return _lvalue;
+    if (records.size() >= 1u << INDEX_BITS)
+	throw length_error("too many nodes");
+
+    id = (Id) kind << INDEX_BITS | records.size();
+    records.emplace_back();
+    nodes[kind].fetch_add(1, memory_order_relaxed);
+    return records.back();
 }
 
 
 /*
- * Function:	String::String (constructor)
+ * Function:	Tree::spell
  *
- * Description:	Initialize this string literal.
+ * Description:	Keep the given spelling of a number, and return where it
+ *		is kept.  Each spelling is terminated by a null, so that
+ *		it can be converted as it is.
  */
 
-String::String(const string &value)
-    : Expression(Type(CHAR, 0, value.size() + 1)), _value(value)
+unsigned Tree::spell(const char *spelling, unsigned length)
 {
+    unsigned offset = _spellings.size();
+
+
+    _spellings.append(spelling, length);
+    _spellings.push_back('\0');
+    return offset;
 }
 
 
 /*
- * Function:	String::value (accessor)
+ * Function:	Tree::newIdentifier
  *
- * Description:	Return the value of this string.
+ * Description:	Make an identifier expression for the given symbol.
  */
 
-const string &String::value() const
+Tree::Id Tree::newIdentifier(const Symbol *symbol)
 {
-    return _value;
+    Id id;
+    Identifier &node = add(IDENTIFIER_EXPR, _identifiers, id);
+
+
+    node.type = symbol->type();
+    node.symbol = symbol;
+    return id;
 }
 
 
 /*
- * Function:	Identifier::Identifier (constructor)
+ * Function:	Tree::newInteger
  *
- * Description:	Initialize this identifier object.  An identifier is an
- *		lvalue if its type is a scalar type.
+ * Description:	Make an integer literal with the given spelling, which
+ *		always has type integer.
  */
 
-Identifier::Identifier(const Symbol *symbol)
-    : Expression(symbol->type()), _symbol(symbol)
+Tree::Id Tree::newInteger(const char *spelling, unsigned length)
 {
-    _lvalue = symbol->type().isScalar();
+    Id id;
+    Integer &node = add(INTEGER_EXPR, _integers, id);
+
+
+    node.type = Type(INT);
+    node.spelling = spell(spelling, length);
+    return id;
 }
 
 
 /*
- * Function:	Identifier::symbol (accessor)
+ * Function:	Tree::newInteger
  *
- * Description:	Return the symbol of this identifier.
+ * Description:	Make an integer literal with the given value, which
+ *		always has type integer.
  */
 
-const Symbol *Identifier::symbol() const
+Tree::Id Tree::newInteger(unsigned value)
 {
-    return _symbol;
+    std::string s = to_string(value);
+
+
+    return newInteger(s.data(), s.size());
 }
 
 
 /*
- * Function:	Integer::Integer (constructor)
+ * Function:	Tree::newReal
  *
- * Description:	Initialize an integer literal object, which always has type
- *		integer.
+ * Description:	Make a real literal with the given spelling, which
+ *		always has type double.  Its label is numbered here rather
+ *		than when code is generated, so it is the same whichever
+ *		thread generates the function it appears in.  In a
+ *		function body parsed by a context of its own, that waits
+ *		until the body is merged back into its unit.
  */
 
-Integer::Integer(const string &value)
-    : Expression(Type(INT)), _value(value)
+Tree::Id Tree::newReal(const char *spelling, unsigned length)
 {
+    Id id;
+    Real &node = add(REAL_EXPR, _reals, id);
+
+
+    node.type = Type(DOUBLE);
+    node.spelling = spell(spelling, length);
+
+    if (context->unit != nullptr)
+	context->literals.push_back(id);
+    else
+	number(id);
+
+    return id;
 }
 
 
 /*
- * Function:	Integer::Integer (constructor)
+ * Function:	Tree::newReal
  *
- * Description:	Initialize an integer literal object, which always has type
- *		integer.
+ * Description:	Make a real literal spelled just like the given integer
+ *		literal.
  */
 
-Integer::Integer(unsigned value)
-    : Expression(Type(INT))
+Tree::Id Tree::newReal(Id integer)
 {
-    stringstream ss;
+    std::string s = spelling(this->integer(integer).spelling);
+
 
-    ss << value;
-    _value = ss.str();
+    return newReal(s.data(), s.size());
 }
 
 
 /*
- * Function:	Integer::value (accessor)
+ * Function:	Tree::newString
  *
- * Description:	Return the value of this integer.
+ * Description:	Make a string literal from the interned id of its
+ *		spelling.  Its label is numbered just like that of a real.
  */
 
-const string &Integer::value() const
+Tree::Id Tree::newString(unsigned value)
 {
-    return _value;
+    Id id;
+    String &node = add(STRING_EXPR, _strings, id);
+
+
+    node.type = Type(CHAR, 0, Interner::current()->name(value).size() + 1);
+    node.value = value;
+
+    if (context->unit != nullptr)
+	context->literals.push_back(id);
+    else
+	number(id);
+
+    return id;
 }
 
 
 /*
- * Function:	Real::Real (constructor)
+ * Function:	Tree::newCall
  *
- * Description:	Initialize a real literal object, which always has type
- *		double.
+ * Description:	Make a function call expression, taking over the given
+ *		arguments from FIRST onward, which are removed.
  */
 
-Real::Real(const string &value)
-    : Expression(Type(DOUBLE)), _value(value), _label(fLabel(value))
+Tree::Id Tree::newCall(const Symbol *id, vector<Id> &args, unsigned first,
+	Type type)
 {
-    fLabels.push_back(_label);
+    Id call;
+    Call &node = add(CALL_EXPR, _calls, call);
+
+
+    node.type = type;
+    node.id = id;
+    node.first = _arguments.size();
+    node.count = args.size() - first;
+    _arguments.insert(_arguments.end(), args.begin() + first, args.end());
+    args.resize(first);
+    return call;
 }
 
 
 /*
- * Function:	Real::Real (constructor)
+ * Function:	Tree::newUnary
  *
- * Description:	Initialize a real literal object, which always has type
- *		double.
+ * Description:	Make a unary expression of the given kind: a logical or
+ *		arithmetic negation, a dereference, an address, or a
+ *		cast.
  */
 
-Real::Real(double value)
-    : Expression(Type(DOUBLE))
+Tree::Id Tree::newUnary(Kind kind, Id expr, Type type)
 {
-    stringstream ss;
+    Id id;
+    Unary &node = add(kind, _unaries, id);
+
 
+    node.type = type;
+    node.expr = expr;
+    return id;
+}
 
-    ss << value;
-    _value = ss.str();
 
-    _label = fLabel(_value);
-    fLabels.push_back(_label);
+/*
+ * Function:	Tree::newBinary
+ *
+ * Description:	Make a binary expression of the given kind, which may
+ *		also be an assignment.
+ */
+
+Tree::Id Tree::newBinary(Kind kind, Id left, Id right, Type type)
+{
+    Id id;
+    Binary &node = add(kind, _binaries, id);
+
+
+    node.type = type;
+    node.left = left;
+    node.right = right;
+    return id;
 }
 
 
 /*
- * Function:	Real::value (accessor)
+ * Function:	Tree::newReturn
  *
- * Description:	Return the value of this real.
+ * Description:	Make a return statement.
  */
 
-const string &Real::value() const
+Tree::Id Tree::newReturn(Id expr)
 {
-    return _value;
+    Id id;
+
+
+    add(RETURN_STMT, _returns, id).expr = expr;
+    return id;
 }
 
 
 /*
- * Function:	Call::Call (constructor)
+ * Function:	Tree::newBlock
  *
- * Description:	Initialize a function call expression.
+ * Description:	Make a block statement, taking over the given statements
+ *		from FIRST onward, which are removed.
  */
 
-Call::Call(const Symbol *id, const Expressions &args, const Type &type)
-    : Expression(type), _id(id), _args(args)
+Tree::Id Tree::newBlock(Scope *decls, vector<Statement> &stmts,
+	unsigned first)
 {
+    Id id;
+    Block &node = add(BLOCK_STMT, _blocks, id);
+
+
+    node.decls = decls;
+    node.first = _statements.size();
+    node.count = stmts.size() - first;
+    _statements.insert(_statements.end(), stmts.begin() + first, stmts.end());
+    stmts.resize(first);
+    return id;
 }
 
 
 /*
- * Function:	Not::Not (constructor)
+ * Function:	Tree::newWhile
  *
- * Description:	Initialize a logical negation expression.
+ * Description:	Make a while statement.
  */
 
-Not::Not(Expression *expr, const Type &type)
-    : Expression(type), _expr(expr)
+Tree::Id Tree::newWhile(Id expr, Id stmt)
 {
+    Id id;
+    While &node = add(WHILE_STMT, _whiles, id);
+
+
+    node.expr = expr;
+    node.stmt = stmt;
+    return id;
 }
 
 
 /*
- * Function:	Negate::Negate (constructor)
+ * Function:	Tree::newIf
  *
- * Description:	Initialize an arithmetic negation expression.
+ * Description:	Make an if-then or if-then-else statement.
  */
 
-Negate::Negate(Expression *expr, const Type &type)
-    : Expression(type), _expr(expr)
+Tree::Id Tree::newIf(Id expr, Id thenStmt, Id elseStmt)
 {
+    Id id;
+    If &node = add(IF_STMT, _ifs, id);
+
+
+    node.expr = expr;
+    node.thenStmt = thenStmt;
+    node.elseStmt = elseStmt;
+    return id;
 }
 
 
 /*
- * Function:	Dereference::Dereference (constructor)
+ * Function:	Tree::newFunction
  *
- * Description:	Initialize a dereference expression.
+ * Description:	Make a function definition.
  */
 
-Dereference::Dereference(Expression *expr, const Type &type)
-    : Expression(type), _expr(expr)
+Tree::Id Tree::newFunction(const Symbol *id, Id body)
 {
-    _lvalue = true;
+    Id function;
+    Function &node = add(FUNCTION_DEF, _functions, function);
+
+
+    node.id = id;
+    node.body = body;
+    return function;
 }
 
 
 /*
- * Function:	Address::Address (constructor)
+ * Function:	Tree::expression
  *
- * Description:	Initialize an address expression.
+ * Description:	Return the parts of the expression with the given id that
+ *		every expression has, from whichever array it is in.
  */
 
-Address::Address(Expression *expr, const Type &type)
-    : Expression(type), _expr(expr)
+Tree::Expression &Tree::expression(Id id)
 {
+    unsigned i = index(id);
+
+
+    switch (kind(id)) {
+    case IDENTIFIER_EXPR:
+	return _identifiers[i];
+
+    case INTEGER_EXPR:
+	return _integers[i];
+
+    case REAL_EXPR:
+	return _reals[i];
+
+    case STRING_EXPR:
+	return _strings[i];
+
+    case CALL_EXPR:
+	return _calls[i];
+
+    case ADDRESS_EXPR:
+    case CAST_EXPR:
+    case DEREFERENCE_EXPR:
+    case NEGATE_EXPR:
+    case NOT_EXPR:
+	return _unaries[i];
+
+    default:
+	return _binaries[i];
+    }
 }
 
 
 /*
- * Function:	Cast::Cast (constructor)
+ * Function:	Tree::expression
  *
- * Description:	Initialize a cast expression.
+ * Description:	Return the parts of the expression with the given id that
+ *		every expression has.
  */
 
-Cast::Cast(const Type &type, Expression *expr)
-    : Expression(type), _expr(expr)
+const Tree::Expression &Tree::expression(Id id) const
 {
+    return const_cast<Tree *>(this)->expression(id);
 }
 
 
 /*
- * Function:	Multiply::Multiply (constructor)
+ * Function:	Tree::type (accessor)
  *
- * Description:	Initialize a multiplication expression.
+ * Description:	Return the type of the expression with the given id.
  */
 
-Multiply::Multiply(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+const Type &Tree::type(Id id) const
 {
+    return expression(id).type;
 }
 
 
 /*
- * Function:	Divide::Divide (constructor)
+ * Function:	Tree::operand (accessor)
  *
- * Description:	Initialize a division expression.
+ * Description:	Return the operand of the expression with the given id.
  */
 
-Divide::Divide(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+const Operand &Tree::operand(Id id) const
 {
+    return expression(id).operand;
 }
 
 
 /*
- * Function:	Remainder::Remainder (constructor)
+ * Function:	Tree::lvalue (accessor)
  *
- * Description:	Initialize a remainder expression.
+ * Description:	Return whether the expression with the given id is an
+ *		lvalue.  An identifier is an lvalue if its type is a scalar
+ *		type, and a dereference always is.
  */
 
-Remainder::Remainder(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+bool Tree::lvalue(Id id) const
 {
+    if (kind(id) == IDENTIFIER_EXPR)
+	return _identifiers[index(id)].symbol->type().isScalar();
+
+    return kind(id) == DEREFERENCE_EXPR;
 }
 
 
 /*
- * Function:	Add::Add (constructor)
+ * Function:	Tree::identifier (accessor)
  *
- * Description:	Initialize an addition expression.
+ * Description:	Return the identifier with the given id.
  */
 
-Add::Add(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::Identifier &Tree::identifier(Id id)
 {
+    return _identifiers[index(id)];
 }
 
 
 /*
- * Function:	Subtract::Subtract (constructor)
+ * Function:	Tree::integer (accessor)
  *
- * Description:	Initialize a subtraction expression.
+ * Description:	Return the integer literal with the given id.
  */
 
-Subtract::Subtract(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::Integer &Tree::integer(Id id)
 {
+    return _integers[index(id)];
 }
 
 
 /*
- * Function:	LessThan::LessThan (constructor)
+ * Function:	Tree::real (accessor)
  *
- * Description:	Initialize a less-than expression.
+ * Description:	Return the real literal with the given id.
  */
 
-LessThan::LessThan(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::Real &Tree::real(Id id)
 {
+    return _reals[index(id)];
 }
 
 
 /*
- * Function:	GreaterThan
+ * Function:	Tree::string (accessor)
  *
- * Description:	Initialize a greater-than expression.
+ * Description:	Return the string literal with the given id.
  */
 
-GreaterThan::GreaterThan(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::String &Tree::string(Id id)
 {
+    return _strings[index(id)];
 }
 
 
 /*
- * Function:	LessOrEqual
+ * Function:	Tree::call (accessor)
  *
- * Description:	Initialize a less-than-or-equal expression.
+ * Description:	Return the function call with the given id.
  */
 
-LessOrEqual::LessOrEqual(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::Call &Tree::call(Id id)
 {
+    return _calls[index(id)];
 }
 
 
 /*
- * Function:	GreaterOrEqual
+ * Function:	Tree::unary (accessor)
  *
- * Description:	Initialize a greater-than-or-equal expression.
+ * Description:	Return the unary expression with the given id.
  */
 
-GreaterOrEqual::GreaterOrEqual(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::Unary &Tree::unary(Id id)
 {
+    return _unaries[index(id)];
 }
 
 
 /*
- * Function:	Equal::Equal (constructor)
+ * Function:	Tree::binary (accessor)
  *
- * Description:	Initialize an equality expression.
+ * Description:	Return the binary expression with the given id.
  */
 
-Equal::Equal(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::Binary &Tree::binary(Id id)
 {
+    return _binaries[index(id)];
 }
 
 
 /*
- * Function:	NotEqual::NotEqual (constructor)
+ * Function:	Tree::returnStmt (accessor)
  *
- * Description:	Initialize an inequality expression.
+ * Description:	Return the return statement with the given id.
  */
 
-NotEqual::NotEqual(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::Return &Tree::returnStmt(Id id)
 {
+    return _returns[index(id)];
 }
 
 
 /*
- * Function:	LogicalAnd::LogicalAnd (constructor)
+ * Function:	Tree::block (accessor)
  *
- * Description:	Initialize a logical-and expression.
+ * Description:	Return the block with the given id.
  */
 
-LogicalAnd::LogicalAnd(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::Block &Tree::block(Id id)
 {
+    return _blocks[index(id)];
 }
 
 
 /*
- * Function:	LogicalOr::LogicalOr (constructor)
+ * Function:	Tree::whileStmt (accessor)
  *
- * Description:	Initialize a logical-or expression.
+ * Description:	Return the while statement with the given id.
  */
 
-LogicalOr::LogicalOr(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::While &Tree::whileStmt(Id id)
 {
+    return _whiles[index(id)];
 }
 
 
 /*
- * Function:	Assign::Assign (constructor)
+ * Function:	Tree::ifStmt (accessor)
  *
- * Description:	Initialize an assignment expression.
+ * Description:	Return the if statement with the given id.
  */
 
-Assign::Assign(Expression *left, Expression *right, const Type &type)
-    : Expression(type), _left(left), _right(right)
+Tree::If &Tree::ifStmt(Id id)
 {
+    return _ifs[index(id)];
 }
 
 
 /*
- * Function:	Return::Return (constructor)
+ * Function:	Tree::function (accessor)
  *
- * Description:	Initialize a return statement.
+ * Description:	Return the function definition with the given id.
  */
 
-Return::Return(Expression *expr)
-    : _expr(expr)
+Tree::Function &Tree::function(Id id)
 {
+    return _functions[index(id)];
 }
 
 
 /*
- * Function:	Block::Block (constructor)
+ * Function:	Tree::argument (accessor)
  *
- * Description:	Initialize a block statement.
+ * Description:	Return the id of the given argument of the given call.
  */
 
-Block::Block(Scope *decls, const Statements &stmts)
-    : _decls(decls), _stmts(stmts)
+Tree::Id Tree::argument(const Call &call, unsigned i) const
 {
+    return _arguments[call.first + i];
 }
 
 
 /*
- * Function:	Block::declarations (accessor)
+ * Function:	Tree::statement (accessor)
  *
- * Description:	Return the declarations of this block.
+ * Description:	Return the given statement of the given block.
  */
 
-Scope *Block::declarations() const
+const Tree::Statement &Tree::statement(const Block &block, unsigned i) const
 {
-    return _decls;
+    return _statements[block.first + i];
+}
+
+
+/*
+ * Function:	Tree::spelling (accessor)
+ *
+ * Description:	Return the spelling of a number kept at the given place.
+ */
+
+const char *Tree::spelling(unsigned spelling) const
+{
+    return _spellings.data() + spelling;
+}
+
+
+/*
+ * Function:	Tree::number
+ *
+ * Description:	Give the string or real literal with the given id its
+ *		label in the current context.
+ */
+
+void Tree::number(Id literal)
+{
+    if (kind(literal) == STRING_EXPR)
+	string(literal).label = numberString(string(literal).value);
+    else
+	real(literal).label = numberReal(spelling(real(literal).spelling));
+}
+
+
+/*
+ * Function:	Tree::numberString
+ *
+ * Description:	Return the label of the string with the given value in
+ *		the current context, numbered after the others if it has
+ *		none yet, so each distinct string has the one label.
+ */
+
+int Tree::numberString(unsigned value)
+{
+    map<unsigned, int>::iterator it = context->Labels.find(value);
+
+    if (it == context->Labels.end())
+	it = context->Labels.insert(make_pair(value, context->strings ++)).first;
+
+    return it->second;
+}
+
+
+/*
+ * Function:	Tree::numberReal
+ *
+ * Description:	Return a label for a real with the given value, numbered
+ *		after the others of the current context.
+ */
+
+int Tree::numberReal(const std::string &value)
+{
+    fLabel label;
+
+
+    label.value = value;
+    label.number = context->reals ++;
+    context->fLabels.push_back(label);
+    return label.number;
+}
+
+
+/*
+ * Function:	Tree::clear
+ *
+ * Description:	Remove every node from this table, keeping the memory of
+ *		its arrays for the next function.
+ */
+
+void Tree::clear()
+{
+    _identifiers.clear();
+    _integers.clear();
+    _reals.clear();
+    _strings.clear();
+    _calls.clear();
+    _unaries.clear();
+    _binaries.clear();
+    _returns.clear();
+    _blocks.clear();
+    _whiles.clear();
+    _ifs.clear();
+    _functions.clear();
+    _arguments.clear();
+    _statements.clear();
+    _spellings.clear();
+}
+
+
+/*
+ * Function:	Tree::count
+ *
+ * Description:	Return the number of nodes made so far.
+ */
+
+unsigned long Tree::count()
+{
+    unsigned long total = 0;
+
+
+    for (unsigned i = 0; i <= SUBTRACT_EXPR; i ++)
+	total += nodes[i].load(memory_order_relaxed);
+
+    return total;
 }
 
 
 /*
- * Function:	While::While (constructor)
+ * Function:	Tree::count
  *
- * Description:	Initialize a while statement.
+ * Description:	Return the number of nodes of the given kind made so far.
  */
 
-While::While(Expression *expr, Statement *stmt)
-    : _expr(expr), _stmt(stmt)
+unsigned long Tree::count(Kind kind)
 {
+    return nodes[kind].load(memory_order_relaxed);
 }
 
 
 /*
- * Function:	If::If (constructor)
+ * Function:	Tree::current (accessor)
  *
- * Description:	Initialize an if-then or if-then-else statement.
+ * Description:	Return the current table of the calling thread.
  */
 
-If::If(Expression *expr, Statement *thenStmt, Statement *elseStmt)
-    : _expr(expr), _thenStmt(thenStmt), _elseStmt(elseStmt)
+Tree *Tree::current()
 {
+    return _current;
 }
 
 
 /*
- * Function:	Function::Function (constructor)
+ * Function:	Tree::current (mutator)
  *
- * Description:	Initialize a function object.
+ * Description:	Make the given table the current table of the calling
+ *		thread.
  */
 
-Function::Function(const Symbol *id, Block *body)
-    : _id(id), _body(body)
+void Tree::current(Tree *tree)
 {
+    _current = tree;
 }
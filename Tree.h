@@ -1,26 +1,49 @@
 /*
  * File:	Tree.h
  *
- * Description:	This file contains the class definitions for abstract
+ * Description:	This file contains the class definition for abstract
  *		syntax trees in Simple C.
  *
- *		The base class Node cannot not be instantiated (the
- *		constructor is private).  It provides empty functions for
- *		storage allocation and code generation.
+ *		A tree is flat.  Rather than being objects linked by
+ *		pointers, its nodes are plain records kept in a table, in
+ *		one contiguous array for each shape of node, and a node
+ *		refers to another by a 32-bit id.  An id holds the kind of
+ *		the node in its top bits and its index into the array for
+ *		that kind in the rest, so we know what a node is without
+ *		looking at it.  The statements of the blocks and the
+ *		arguments of the calls are kept in two more arrays, and a
+ *		block or call only says where its own begin and how many
+ *		there are.  The spellings of numbers are kept in the table
+ *		as well.  So, the records refer to nothing outside the
+ *		table but symbols, scopes, and types.
  *
- *		A Node is either a Function, representing a function
- *		definition, or a Statement, which also cannot be
- *		instantiated (again, the constructor is private).
+ *		Nothing is virtual, so no node carries a pointer to a
+ *		table of functions, and we don't need any run-time type
+ *		information: storage allocation and code generation are
+ *		loops that switch on the kind of each id.  Neither one
+ *		recurses.  Storage allocation keeps a worklist of ids still
+ *		to be visited, and code generation keeps a stack of frames,
+ *		one for each node whose code is partly generated.  Each
+ *		step of a node returns the child whose code must be
+ *		generated before the next step, or none when the node is
+ *		done.  So, how deeply a tree can nest is limited only by
+ *		memory, not by the size of the stack.
  *
  *		Since the compiler has a very functional design (semantic
- *		checking, storage allocation, code generation), its design
- *		doesn't necessarily mesh well with a tree designed using
- *		object-orientation.  So, here is my compromise:
+ *		checking, storage allocation, code generation), here is how
+ *		it is split up:
  *
- *		Tree.h - class definitions
- *		Tree.cpp - constructors and accessors
- *		allocator.cpp - member functions to do storage allocation
- *		generator.cpp - member functions to do code generation
+ *		Tree.h - class definition
+ *		Tree.cpp - making nodes and getting at them
+ *		allocator.cpp - storage allocation
+ *		generator.cpp - code generation
+ *
+ *		Each function definition has a table of its own, which
+ *		belongs to the buffer its code is generated into (see
+ *		generator.h), and is cleared rather than freed once the
+ *		code is done, so its arrays keep their memory for the next
+ *		function.  Each thread has a current table, into which the
+ *		parser and checker put the nodes they make.
  */
 
 # ifndef TREE_H
@@ -28,400 +51,213 @@
 # include <string>
 # include <vector>
 # include "Scope.h"
-
-typedef std::vector<class Statement *> Statements;
-typedef std::vector<class Expression *> Expressions;
+# include "Operand.h"
 
 struct fLabel {
     typedef std::string string;
     int number;
     string value;
-    static int counter;
-	fLabel(string val){
-	    value = val;
-	    number = counter++;
-	}
 	fLabel(){}
 };
 
 
-/* The base class */
-
-class Node {
-protected:
-    typedef std::string string;
-    Node() {}
-
-public:
-    virtual ~Node() {}
-    virtual void allocate(int &offset) const {}
-    virtual void generate() {}
-};
-
-
-/* Any type of statement: return, while, if, block, and expression */
-
-class Statement : public Node {
-protected:
-    Statement() {}
-};
-
-
-/* An expression, and yes, an expression is a statement */
-
-class Expression : public Statement {
-protected:
-    Type _type;
-    bool _lvalue;
-    string _operand;
-    Expression(const Type &_type = Type());
-
-public:
-    const Type &type() const;
-    bool lvalue() const;
-    virtual const string &operand() const;
-    virtual void operand(const string &operand);
-    virtual bool isPoint();
-    virtual void generate(bool &indirect);
-    virtual void generate();
-};
-
-
-/* A string literal (strings really are just not expressions syntactically) */
-
-class String : public Expression {
-    string _value;
-
-public:
-    String(const string &value);
-    const string &value() const;
-    virtual void generate();
-};
-
-
-/* An identifier expression */
-
-class Identifier : public Expression {
-    const Symbol *_symbol;
-
-public:
-    Identifier(const Symbol *symbol);
-    const Symbol *symbol() const;
-    virtual void generate();
-};
-
-
-/* An integer literal */
-
-class Integer : public Expression {
-    string _value;
-
-public:
-    Integer(unsigned value);
-    Integer(const string &value);
-    const string &value() const;
-    virtual void generate();
-};
-
-
-/* A real literal */
-
-class Real : public Expression {
-    string _value;
-    fLabel _label;
-
-public:
-    Real(double value);
-    Real(const string &value);
-    virtual void generate();
-    const string &value() const;
-};
-
-
-/* A function call expression: id ( args ) */
-
-class Call : public Expression {
-    const Symbol *_id;
-    Expressions _args;
-
-public:
-    Call(const Symbol *id, const Expressions &args, const Type &type);
-    virtual void generate();
-};
-
-
-/* A logical negation expression: ! expr */
-
-class Not : public Expression {
-    Expression *_expr;
-
-public:
-    Not(Expression *expr, const Type &type);
-    virtual void generate();
-};
-
-
-/* An arithmetic negation expression: - expr */
-
-class Negate : public Expression {
-    Expression *_expr;
-
-public:
-    Negate(Expression *expr, const Type &type);
-    virtual void generate();
-};
-
-
-/* A dereference expression: * expr */
-
-class Dereference : public Expression {
-    Expression *_expr;
-
-public:
-    Dereference(Expression *expr, const Type &type);
-    virtual void generate();
-    virtual void generate(bool &indirection);
-    virtual bool isPoint();
-};
-
-
-/* An address expression: & expr */
-
-class Address : public Expression {
-    Expression *_expr;
-
-public:
-    Address(Expression *expr, const Type &type);
-    virtual void generate();
-};
-
-
-/* A cast expression: (type) expr */
-
-class Cast : public Expression {
-    Expression *_expr;
-
-public:
-    Cast(const Type &type, Expression *expr);
-    virtual void generate();
-};
-
-
-/* A multiply expression: left * right */
-
-class Multiply : public Expression {
-    Expression *_left, *_right;
-
-public:
-    Multiply(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
-
-
-/* A divide expression: left / right */
-
-class Divide : public Expression {
-    Expression *_left, *_right;
-
-public:
-    Divide(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
-
-
-/* A remainder expression: left % right */
-
-class Remainder : public Expression {
-    Expression *_left, *_right;
-
-public:
-    Remainder(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
-
-
-/* An addition expression: left + right */
-
-class Add : public Expression {
-    Expression *_left, *_right;
-
-public:
-    Add(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
-
-
-/* A subtraction expression: left - right */
-
-class Subtract : public Expression {
-    Expression *_left, *_right;
-
-public:
-    Subtract(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
-
-
-/* A less-than expression: left < right */
-
-class LessThan : public Expression {
-    Expression *_left, *_right;
-
-public:
-    LessThan(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
-
-
-/* A greater-than expression: left > right */
-
-class GreaterThan : public Expression {
-    Expression *_left, *_right;
-
-public:
-    GreaterThan(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
-
-
-/* A less-than-or-equal expression: left <= right */
-
-class LessOrEqual : public Expression {
-    Expression *_left, *_right;
-
+class Tree {
 public:
-    LessOrEqual(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
-
-
-/* A greater-than-or-equal expression: left >= right */
-
-class GreaterOrEqual : public Expression {
-    Expression *_left, *_right;
-
-public:
-    GreaterOrEqual(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
-
-
-/* An equality expression: left == right */
-
-class Equal : public Expression {
-    Expression *_left, *_right;
+    enum Kind {
+	FUNCTION_DEF, BLOCK_STMT, IF_STMT, RETURN_STMT, WHILE_STMT,
+	ADD_EXPR, ADDRESS_EXPR, ASSIGN_EXPR, CALL_EXPR, CAST_EXPR,
+	DEREFERENCE_EXPR, DIVIDE_EXPR, EQUAL_EXPR, GREATER_OR_EQUAL_EXPR,
+	GREATER_THAN_EXPR, IDENTIFIER_EXPR, INTEGER_EXPR, LESS_OR_EQUAL_EXPR,
+	LESS_THAN_EXPR, LOGICAL_AND_EXPR, LOGICAL_OR_EXPR, MULTIPLY_EXPR,
+	NEGATE_EXPR, NOT_EQUAL_EXPR, NOT_EXPR, REAL_EXPR, REMAINDER_EXPR,
+	STRING_EXPR, SUBTRACT_EXPR
+    };
 
-public:
-    Equal(Expression *left, Expression *right, const Type &type);
-    void generate();
-};
+    typedef unsigned Id;
+    static const Id NONE = 0xffffffff;
 
 
-/* An inequality expression: left != right */
+    /* What every expression has, and yes, an expression is a statement */
 
-class NotEqual : public Expression {
-    Expression *_left, *_right;
+    struct Expression {
+	Type type;
+	Operand operand;
+    };
 
-public:
-    NotEqual(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
+    /* An identifier expression */
 
+    struct Identifier : Expression {
+	const Symbol *symbol;
+    };
 
-/* A logical-and expression: left && right */
+    /* An integer literal, spelled as in the source */
 
-class LogicalAnd: public Expression {
-    Expression *_left, *_right;
+    struct Integer : Expression {
+	unsigned spelling;
+    };
 
-public:
-    LogicalAnd(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
+    /* A real literal, spelled as in the source */
 
+    struct Real : Expression {
+	unsigned spelling;
+	int label;
+    };
 
-/* A logical-or expression: left || right */
+    /* A string literal (strings really are just not expressions
+       syntactically), whose value is the interned id of its spelling */
 
-class LogicalOr : public Expression {
-    Expression *_left, *_right;
+    struct String : Expression {
+	unsigned value;
+	int label;
+    };
 
-public:
-    LogicalOr(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
+    /* A function call expression: id ( args ) */
 
+    struct Call : Expression {
+	const Symbol *id;
+	unsigned first, count;
+    };
 
-/* An assignment expression: left = right */
+    /* A unary expression: ! expr, - expr, * expr, & expr, (type) expr */
 
-class Assign : public Expression {
-    Expression *_left, *_right;
+    struct Unary : Expression {
+	Id expr;
+    };
 
-public:
-    Assign(Expression *left, Expression *right, const Type &type);
-    virtual void generate();
-};
+    /* A binary expression, including an assignment: left op right */
 
+    struct Binary : Expression {
+	Id left, right;
+    };
 
-/* A return statement: return expr */
+    /* A return statement: return expr */
 
-class Return : public Statement {
-    Expression *_expr;
+    struct Return {
+	Id expr;
+    };
 
-public:
-    Return(Expression *expr);
-    virtual void generate();
-};
+    /* A block (compound) statement: { decls stmts } */
 
+    struct Block {
+	Scope *decls;
+	unsigned first, count;
+    };
 
-/* A block (compound) statement: { decls stmts } */
+    /* A while statement: while ( expr ) stmt */
 
-class Block : public Statement {
-    Scope *_decls;
-    Statements _stmts;
+    struct While {
+	Id expr, stmt;
+    };
 
-public:
-    Block(Scope *decls, const Statements &stmts);
-    Scope *declarations() const;
-    virtual void allocate(int &offset) const;
-    virtual void generate();
-};
+    /* An if-then or if-then-else statement: if ( expr ) thenStmt else
+       elseStmt, where elseStmt may be NONE */
 
+    struct If {
+	Id expr, thenStmt, elseStmt;
+    };
 
-/* A while statement: while ( expr ) stmt */
+    /* A function definition: id() { body } */
 
-class While : public Statement {
-    Expression *_expr;
-    Statement *_stmt;
+    struct Function {
+	const Symbol *id;
+	Id body;
+    };
 
-public:
-    While(Expression *expr, Statement *stmt);
-    void generate();
-    virtual void allocate(int &offset) const;
-};
+    /* A statement of a block, and the line on which it starts */
 
+    struct Statement {
+	Id node;
+	unsigned line;
+    };
 
-/* An if-then or if-then-else statement: if ( expr ) thenStmt else elseStmt */
+    /* A node whose code is partly generated */
 
-class If : public Statement {
-    Expression *_expr;
-    Statement *_thenStmt, *_elseStmt;
+    struct Frame {
+	Id node;
+	unsigned step;
+	int labels[2];
+    };
 
-public:
-    If(Expression *expr, Statement *thenStmt, Statement *elseStmt);
-    virtual void allocate(int &offset) const;
-    virtual void generate();
-};
+private:
+    enum { INDEX_BITS = 27 };
 
+    std::vector<Identifier> _identifiers;
+    std::vector<Integer> _integers;
+    std::vector<Real> _reals;
+    std::vector<String> _strings;
+    std::vector<Call> _calls;
+    std::vector<Unary> _unaries;
+    std::vector<Binary> _binaries;
+    std::vector<Return> _returns;
+    std::vector<Block> _blocks;
+    std::vector<While> _whiles;
+    std::vector<If> _ifs;
+    std::vector<Function> _functions;
+    std::vector<Id> _arguments;
+    std::vector<Statement> _statements;
+    std::string _spellings;
 
-/* A function definition: id() { body } */
+    static thread_local Tree *_current;
 
-class Function : public Node {
-    const Symbol *_id;
-    Block *_body;
+    template<class T> T &add(Kind kind, std::vector<T> &records, Id &id);
+    unsigned spell(const char *spelling, unsigned length);
 
 public:
-    Function(const Symbol *id, Block *body);
-    virtual void allocate(int &offset) const;
-    virtual void generate();
-};
+    static Kind kind(Id id);
+    static unsigned index(Id id);
+
+    Id newIdentifier(const Symbol *symbol);
+    Id newInteger(const char *spelling, unsigned length);
+    Id newInteger(unsigned value);
+    Id newReal(const char *spelling, unsigned length);
+    Id newReal(Id integer);
+    Id newString(unsigned value);
+    Id newCall(const Symbol *id, std::vector<Id> &args, unsigned first,
+	    Type type);
+    Id newUnary(Kind kind, Id expr, Type type);
+    Id newBinary(Kind kind, Id left, Id right, Type type);
+    Id newReturn(Id expr);
+    Id newBlock(Scope *decls, std::vector<Statement> &stmts, unsigned first);
+    Id newWhile(Id expr, Id stmt);
+    Id newIf(Id expr, Id thenStmt, Id elseStmt);
+    Id newFunction(const Symbol *id, Id body);
+
+    Expression &expression(Id id);
+    const Expression &expression(Id id) const;
+    const Type &type(Id id) const;
+    const Operand &operand(Id id) const;
+    bool lvalue(Id id) const;
+
+    Identifier &identifier(Id id);
+    Integer &integer(Id id);
+    Real &real(Id id);
+    String &string(Id id);
+    Call &call(Id id);
+    Unary &unary(Id id);
+    Binary &binary(Id id);
+    Return &returnStmt(Id id);
+    Block &block(Id id);
+    While &whileStmt(Id id);
+    If &ifStmt(Id id);
+    Function &function(Id id);
+    Id argument(const Call &call, unsigned i) const;
+    const Statement &statement(const Block &block, unsigned i) const;
+    const char *spelling(unsigned spelling) const;
+    void number(Id literal);
+    static int numberString(unsigned value);
+    static int numberReal(const std::string &value);
+
+    void allocate(Id node, int &offset);
+    void generate(Id node);
+    void clear();
+
+    static unsigned long count();
+    static unsigned long count(Kind kind);
+    static Tree *current();
+    static void current(Tree *tree);
+};
+
+typedef std::vector<Tree::Id> Expressions;
+typedef std::vector<Tree::Statement> Statements;
 
 # endif /* TREE_H */
@@ -13,17 +13,261 @@
  *		value types with access control instead of just always
  *		using pointer types.
  *
+ *		The type table is shared by every thread, so it is
+ *		guarded by a lock.  Scalar types are by far the most
+ *		common, so the ones with a few levels of indirection are
+ *		also kept in a small array that can be read without the
+ *		lock.  Entries are never deleted, so handles never dangle.
+ *
  *		Extra functionality:
  *		- equality and inequality operators
  *		- parameter lists for function types
  *		- predicate functions such as isArray()
  *		- the error type
+ *		- a table of unique types
  */
 
+# include <atomic>
 # include <cassert>
+# include <map>
+# include <mutex>
+# include <tuple>
 # include "Type.h"
+# include "machine.h"
 # include "tokens.h"
 
+using namespace std;
+
+# define SPECIFIERS (DONE - AUTO + 1)
+# define LEVELS 8
+
+struct Type::Entry {
+    Kind kind;
+    int specifier;
+    unsigned indirection;
+    unsigned length;
+    const Parameters *parameters;
+
+    unsigned size;
+    const Entry *promoted;
+    const Entry *dereferenced;
+};
+
+class Type::Table {
+    typedef tuple<int, int, unsigned, unsigned, const Parameters *> Key;
+
+    mutex _mutex;
+    map<Key, Entry *> _entries;
+    map<vector<const Entry *>, Parameters *> _lists;
+    atomic<const Entry *> _scalars[SPECIFIERS][LEVELS];
+    const Entry *_error;
+
+    const Entry *insert(Kind kind, int specifier, unsigned indirection,
+	    unsigned length, const Parameters *parameters);
+
+public:
+    Table();
+
+    const Entry *error() const;
+    const Entry *scalar(int specifier, unsigned indirection);
+    const Entry *find(Kind kind, int specifier, unsigned indirection,
+	    unsigned length, const Parameters *parameters);
+    const Parameters *list(const Parameters &parameters);
+};
+
+
+/*
+ * Function:	Type::Table::Table (constructor)
+ *
+ * Description:	Initialize the type table with just the error type.
+ */
+
+Type::Table::Table()
+{
+    for (unsigned i = 0; i < SPECIFIERS; i ++)
+	for (unsigned j = 0; j < LEVELS; j ++)
+	    _scalars[i][j] = nullptr;
+
+    _error = insert(ERROR, 0, 0, 0, nullptr);
+}
+
+
+/*
+ * Function:	Type::Table::insert
+ *
+ * Description:	Return the unique entry for the given type, creating it if
+ *		necessary.  The caller must hold the lock.  A new entry has
+ *		its size, promotion, and dereference computed right away,
+ *		which may in turn create the entries for those types.  A
+ *		pointer type may have any number of levels of indirection,
+ *		so the missing types it points to are created from the
+ *		bottom up, and each of those finds its own dereference
+ *		already there.
+ */
+
+const Type::Entry *Type::Table::insert(Kind kind, int specifier,
+	unsigned indirection, unsigned length, const Parameters *parameters)
+{
+    Key key(kind, specifier, indirection, length, parameters);
+    map<Key, Entry *>::iterator it;
+    Entry *entry;
+    unsigned count, level;
+
+
+    if ((it = _entries.find(key)) != _entries.end())
+	return it->second;
+
+    entry = new Entry();
+    entry->kind = kind;
+    entry->specifier = specifier;
+    entry->indirection = indirection;
+    entry->length = length;
+    entry->parameters = parameters;
+    _entries[key] = entry;
+
+    count = (kind == ARRAY ? length : 1);
+
+    if (kind == FUNCTION)
+	entry->size = 0;
+    else if (indirection > 0)
+	entry->size = count * SIZEOF_PTR;
+    else if (specifier == INT)
+	entry->size = count * SIZEOF_INT;
+    else
+	entry->size = count * SIZEOF_DOUBLE;
+
+    if (kind == ARRAY)
+	entry->promoted = insert(SCALAR, specifier, indirection + 1, 0, nullptr);
+    else if (kind == SCALAR && specifier == INT && indirection == 0)
+	entry->promoted = insert(SCALAR, DOUBLE, 0, 0, nullptr);
+    else
+	entry->promoted = entry;
+
+    if (indirection > 0) {
+	level = indirection - 1;
+
+	while (level > 0 && _entries.count(Key(SCALAR, specifier, level, 0,
+		    nullptr)) == 0)
+	    level --;
+
+	while (level < indirection - 1)
+	    insert(SCALAR, specifier, level ++, 0, nullptr);
+
+	entry->dereferenced = insert(SCALAR, specifier, indirection - 1, 0, nullptr);
+    } else
+	entry->dereferenced = nullptr;
+
+    return entry;
+}
+
+
+/*
+ * Function:	Type::Table::error
+ *
+ * Description:	Return the entry for the error type.
+ */
+
+const Type::Entry *Type::Table::error() const
+{
+    return _error;
+}
+
+
+/*
+ * Function:	Type::Table::scalar
+ *
+ * Description:	Return the entry for a scalar type, trying the array of
+ *		common scalar types before taking the lock.
+ */
+
+const Type::Entry *Type::Table::scalar(int specifier, unsigned indirection)
+{
+    const Entry *entry;
+    unsigned i = specifier - AUTO;
+
+
+    if (i >= SPECIFIERS || indirection >= LEVELS)
+	return find(SCALAR, specifier, indirection, 0, nullptr);
+
+    entry = _scalars[i][indirection].load(memory_order_acquire);
+
+    if (entry == nullptr) {
+	entry = find(SCALAR, specifier, indirection, 0, nullptr);
+	_scalars[i][indirection].store(entry, memory_order_release);
+    }
+
+    return entry;
+}
+
+
+/*
+ * Function:	Type::Table::find
+ *
+ * Description:	Return the unique entry for the given type.
+ */
+
+const Type::Entry *Type::Table::find(Kind kind, int specifier,
+	unsigned indirection, unsigned length, const Parameters *parameters)
+{
+    lock_guard<mutex> lock(_mutex);
+    return insert(kind, specifier, indirection, length, parameters);
+}
+
+
+/*
+ * Function:	Type::Table::list
+ *
+ * Description:	Return the unique copy of the given parameter list.  Since
+ *		its types are already unique, two lists are the same if
+ *		their entries are.
+ */
+
+const Parameters *Type::Table::list(const Parameters &parameters)
+{
+    vector<const Entry *> key;
+
+
+    key.reserve(parameters.size());
+
+    for (unsigned i = 0; i < parameters.size(); i ++)
+	key.push_back(parameters[i]._entry);
+
+    lock_guard<mutex> lock(_mutex);
+    Parameters *&copy = _lists[key];
+
+    if (copy == nullptr)
+	copy = new Parameters(parameters);
+
+    return copy;
+}
+
+
+/*
+ * Function:	Type::table
+ *
+ * Description:	Return the type table, creating it on first use.  Doing it
+ *		this way means that types may be created during static
+ *		initialization, such as for the error type in the checker.
+ */
+
+Type::Table &Type::table()
+{
+    static Table table;
+    return table;
+}
+
+
+/*
+ * Function:	Type::Type (constructor)
+ *
+ * Description:	Initialize this type as a handle to the given entry.
+ */
+
+Type::Type(const Entry *entry)
+    : _entry(entry)
+{
+}
+
 
 /*
  * Function:	Type::Type (constructor)
@@ -32,7 +276,7 @@
  */
 
 Type::Type()
-    : _kind(ERROR)
+    : _entry(table().error())
 {
 }
 
@@ -44,7 +288,7 @@ Type::Type()
  */
 
 Type::Type(int specifier, unsigned indirection)
-    : _specifier(specifier), _indirection(indirection), _kind(SCALAR)
+    : _entry(table().scalar(specifier, indirection))
 {
 }
 
@@ -56,56 +300,52 @@ Type::Type(int specifier, unsigned indirection)
  */
 
 Type::Type(int specifier, unsigned indirection, unsigned length)
-    : _specifier(specifier), _indirection(indirection), _length(length)
+    : _entry(table().find(ARRAY, specifier, indirection, length, nullptr))
 {
-    _kind = ARRAY;
 }
 
 
 /*
  * Function:	Type::Type (constructor)
  *
- * Description:	Initialize this type object as a function type.
+ * Description:	Initialize this type object as a function type.  The
+ *		parameter list is copied into the table, so the caller
+ *		keeps ownership of its own list.
  */
 
-Type::Type(int specifier, unsigned indirection, Parameters *parameters)
-    : _specifier(specifier), _indirection(indirection), _parameters(parameters)
+Type::Type(int specifier, unsigned indirection, const Parameters *parameters)
 {
-    _kind = FUNCTION;
+    if (parameters != nullptr)
+	parameters = table().list(*parameters);
+
+    _entry = table().find(FUNCTION, specifier, indirection, 0, parameters);
 }
 
 
 /*
  * Function:	Type::operator ==
  *
- * Description:	Return whether another type is equal to this type.
- *		The parameter lists are checked for function types.
+ * Description:	Return whether another type is equal to this type.  Types
+ *		are unique, so they are equal only if they are the same,
+ *		except that a function type with an unspecified parameter
+ *		list is equal to any function type with the same result.
  */
 
 bool Type::operator ==(const Type &rhs) const
 {
-    if (_kind != rhs._kind)
-	return false;
-
-    if (_kind == ERROR)
+    if (_entry == rhs._entry)
 	return true;
 
-    if (_specifier != rhs._specifier)
+    if (_entry->kind != FUNCTION || rhs._entry->kind != FUNCTION)
 	return false;
 
-    if (_indirection != rhs._indirection)
+    if (_entry->specifier != rhs._entry->specifier)
 	return false;
 
-    if (_kind == SCALAR)
-	return true;
-
-    if (_kind == ARRAY)
-	return _length == rhs._length;
-
-    if (!_parameters || !rhs._parameters)
-	return true;
+    if (_entry->indirection != rhs._entry->indirection)
+	return false;
 
-    return *_parameters == *rhs._parameters;
+    return !_entry->parameters || !rhs._entry->parameters;
 }
 
 
@@ -130,7 +370,7 @@ bool Type::operator !=(const Type &rhs) const
 
 bool Type::isArray() const
 {
-    return _kind == ARRAY;
+    return _entry->kind == ARRAY;
 }
 
 
@@ -142,7 +382,7 @@ bool Type::isArray() const
 
 bool Type::isScalar() const
 {
-    return _kind == SCALAR;
+    return _entry->kind == SCALAR;
 }
 
 
@@ -154,7 +394,7 @@ bool Type::isScalar() const
 
 bool Type::isFunction() const
 {
-    return _kind == FUNCTION;
+    return _entry->kind == FUNCTION;
 }
 
 
@@ -166,7 +406,7 @@ bool Type::isFunction() const
 
 bool Type::isError() const
 {
-    return _kind == ERROR;
+    return _entry->kind == ERROR;
 }
 
 
@@ -178,7 +418,7 @@ bool Type::isError() const
 
 bool Type::isReal() const
 {
-    return _kind == SCALAR && _specifier == DOUBLE && _indirection == 0;
+    return _entry->kind == SCALAR && _entry->specifier == DOUBLE && _entry->indirection == 0;
 }
 
 
@@ -190,7 +430,7 @@ bool Type::isReal() const
 
 bool Type::isInteger() const
 {
-    return _kind == SCALAR && _specifier == INT && _indirection == 0;
+    return _entry->kind == SCALAR && _entry->specifier == INT && _entry->indirection == 0;
 }
 
 
@@ -214,7 +454,7 @@ bool Type::isNumeric() const
 
 bool Type::isPointer() const
 {
-    return _indirection > 0 || _kind == ARRAY;
+    return _entry->indirection > 0 || _entry->kind == ARRAY;
 }
 
 
@@ -240,10 +480,7 @@ bool Type::isValue() const
 
 Type Type::promote() const
 {
-    if (_kind == ARRAY)
-	return Type(_specifier, _indirection + 1);
-
-    return isInteger() ? Type(DOUBLE) : *this;
+    return Type(_entry->promoted);
 }
 
 
@@ -256,8 +493,8 @@ Type Type::promote() const
 
 Type Type::deref() const
 {
-    assert(_indirection > 0);
-    return Type(_specifier, _indirection - 1);
+    assert(_entry->indirection > 0);
+    return Type(_entry->dereferenced);
 }
 
 
@@ -269,7 +506,7 @@ Type Type::deref() const
 
 int Type::specifier() const
 {
-    return _specifier;
+    return _entry->specifier;
 }
 
 
@@ -281,7 +518,7 @@ int Type::specifier() const
 
 unsigned Type::indirection() const
 {
-    return _indirection;
+    return _entry->indirection;
 }
 
 
@@ -295,8 +532,8 @@ unsigned Type::indirection() const
 
 unsigned Type::length() const
 {
-    assert(_kind == ARRAY);
-    return _length;
+    assert(_entry->kind == ARRAY);
+    return _entry->length;
 }
 
 
@@ -307,8 +544,22 @@ unsigned Type::length() const
  *		function type.
  */
 
-Parameters *Type::parameters() const
+const Parameters *Type::parameters() const
+{
+    assert(_entry->kind == FUNCTION);
+    return _entry->parameters;
+}
+
+
+/*
+ * Function:	Type::size
+ *
+ * Description:	Return the size of a type in bytes, which must not be a
+ *		function type.
+ */
+
+unsigned Type::size() const
 {
-    assert(_kind == FUNCTION);
-    return _parameters;
+    assert(_entry->kind != FUNCTION);
+    return _entry->size;
 }
@@ -20,6 +20,15 @@
  *		As we've designed them, types are essentially immutable,
  *		since we haven't included any mutators.  In practice, we'll
  *		be creating new types rather than changing existing types.
+ *
+ *		Since they are immutable, each distinct type is stored just
+ *		once, in a table, and a type object is only a handle to its
+ *		entry.  Copying a type copies a pointer, and two types are
+ *		equal if they have the same entry, except that a function
+ *		type with an unspecified parameter list matches any
+ *		function type with the same result.  The size, promotion,
+ *		and dereference of each type are computed when its entry
+ *		is created.  Parameter lists are stored once as well.
  */
 
 # ifndef TYPE_H
@@ -29,18 +38,20 @@
 typedef std::vector<class Type> Parameters;
 
 class Type {
-    int _specifier;
-    unsigned _indirection;
-    unsigned _length;
-    Parameters *_parameters;
+    struct Entry;
+    class Table;
+    const Entry *_entry;
+
+    enum Kind { ARRAY, ERROR, FUNCTION, SCALAR };
 
-    enum { ARRAY, ERROR, FUNCTION, SCALAR } _kind;
+    explicit Type(const Entry *entry);
+    static Table &table();
 
 public:
     Type();
     Type(int specifier, unsigned indirection = 0);
     Type(int specifier, unsigned indirection, unsigned length);
-    Type(int specifier, unsigned indirection, Parameters *parameters);
+    Type(int specifier, unsigned indirection, const Parameters *parameters);
 
     bool operator ==(const Type &rhs) const;
     bool operator !=(const Type &rhs) const;
@@ -61,7 +72,7 @@ public:
     int specifier() const;
     unsigned indirection() const;
     unsigned length() const;
-    Parameters *parameters() const;
+    const Parameters *parameters() const;
 
     unsigned size() const;
 };
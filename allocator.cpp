@@ -1,13 +1,14 @@
 /*
  * File:	allocator.cpp
  *
- * Description:	This file contains the member function definitions for
- *		functions dealing with storage allocation.  The actual
- *		classes are declared elsewhere, mainly in Tree.h.
+ * Description:	This file contains the member function definition for
+ *		storage allocation.  The tree itself is declared
+ *		elsewhere, in Tree.h.
  *
  *		Extra functionality:
  *		- maintaining minimum offset in nested blocks
  *		- allocation within while and if-then-else statements
+ *		- allocation without recursion, however deep the nesting
  */
 
 # include <cassert>
@@ -21,125 +22,95 @@ using namespace std;
 
 
 /*
- * Function:	Type::size
+ * Function:	Tree::allocate
  *
- * Description:	Return the size of a type in bytes.
- */
-
-unsigned Type::size() const
-{
-    Symbols symbols;
-    unsigned count;
-
-
-    assert(_kind != FUNCTION);
-    count = (_kind == ARRAY ? _length : 1);
-
-    if (_indirection > 0)
-	return count * SIZEOF_PTR;
-
-    if (_specifier == INT)
-	return count * SIZEOF_INT;
-
-    return count * SIZEOF_DOUBLE;
-}
-
-
-/*
- * Function:	Block::allocate
+ * Description:	Allocate storage for the given node and everything within
+ *		it.  Offsets are handed out from a single running offset in
+ *		the order the nodes appear in the source, so rather than
+ *		recursing, we keep a worklist of ids yet to be visited, and
+ *		look at the kind of each to see whether it has storage of
+ *		its own or children to add to the list.  Each thread keeps
+ *		its list from one call to the next, so its memory is only
+ *		allocated once.  Only functions and statements that contain
+ *		blocks have any storage to allocate.
+ *
+ *		For a function, the parameters are allocated offsets here,
+ *		and the body is left on the worklist to be allocated with
+ *		the running offset starting from zero.
+ *
+ *		For a block, we assign decreasing offsets for all symbols
+ *		declared within the block, and then for all symbols
+ *		declared within any nested block, by adding its statements
+ *		to the worklist so that the first comes off first.  Only
+ *		symbols that have not already been allocated an offset will
+ *		be assigned one, since the parameters are already assigned
+ *		special offsets.
  *
- * Description:	Allocate storage for this block.  We assign decreasing
- *		offsets for all symbols declared within this block, and
- *		then for all symbols declared within any nested block.
- *		Only symbols that have not already been allocated an
- *		offset will be assigned one, since the parameters are
- *		already assigned special offsets.
+ *		For a while or if statement, it essentially means
+ *		allocating storage for variables declared as part of its
+ *		statements, the then statement first.
  */
 
-void Block::allocate(int &offset) const
+void Tree::allocate(Id node, int &offset)
 {
-    int temp;
+    static thread_local vector<Id> work;
+    const Parameters *params;
     unsigned i;
-    Symbols symbols;
 
 
-    symbols = _decls->symbols();
-
-    for (i = 0; i < symbols.size(); i ++)
-	if (symbols[i]->offset() == 0) {
-	    offset -= symbols[i]->type().size();
-	    symbols[i]->offset(offset);
-	}
+    work.push_back(node);
 
-    temp = offset;
+    while (!work.empty()) {
+	node = work.back();
+	work.pop_back();
 
-    for (i = 0; i < _stmts.size(); i ++) {
-	_stmts[i]->allocate(temp);
-	offset = min(offset, temp);
-    }
-}
+	switch (kind(node)) {
+	case FUNCTION_DEF: {
+	    const Function &function = this->function(node);
+	    const Symbols &symbols = block(function.body).decls->symbols();
 
+	    params = function.id->type().parameters();
+	    offset = INIT_PARAM_OFFSET;
 
-/*
- * Function:	While::allocate
- *
- * Description:	Allocate storage for this while statement, which
- *		essentially means allocating storage for variables declared
- *		as part of its statement.
- */
-
-void While::allocate(int &offset) const
-{
-    _stmt->allocate(offset);
-}
-
-
-/*
- * Function:	If::allocate
- *
- * Description:	Allocate storage for this if-then or if-then-else
- *		statement, which essentially means allocating storage for
- *		variables declared as part of its statements.
- */
-
-void If::allocate(int &offset) const
-{
-    int temp;
+	    for (i = 0; i < params->size(); i ++) {
+		symbols[i]->offset(offset);
+		offset += (*params)[i].size();
+	    }
 
+	    offset = 0;
+	    work.push_back(function.body);
+	    break;
+	}
 
-    _thenStmt->allocate(offset);
+	case BLOCK_STMT: {
+	    const Block &block = this->block(node);
+	    const Symbols &symbols = block.decls->symbols();
 
-    if (_elseStmt != nullptr) {
-	temp = offset;
-	_elseStmt->allocate(temp);
-	offset = min(offset, temp);
-    }
-}
+	    for (i = 0; i < symbols.size(); i ++)
+		if (symbols[i]->offset() == 0) {
+		    offset -= symbols[i]->type().size();
+		    symbols[i]->offset(offset);
+		}
 
+	    for (i = block.count; i > 0; i --)
+		work.push_back(statement(block, i - 1).node);
 
-/*
- * Function:	Function::allocate
- *
- * Description:	Allocate storage for this function and return the number of
- *		bytes required.  The parameters are allocated offsets as
- *		well.
- */
+	    break;
+	}
 
-void Function::allocate(int &offset) const
-{
-    Parameters *params;
-    Symbols symbols;
+	case IF_STMT:
+	    if (ifStmt(node).elseStmt != NONE)
+		work.push_back(ifStmt(node).elseStmt);
 
+	    work.push_back(ifStmt(node).thenStmt);
+	    break;
 
-    params = _id->type().parameters();
-    symbols = _body->declarations()->symbols();
-    offset = INIT_PARAM_OFFSET;
+	case WHILE_STMT:
+	    work.push_back(whileStmt(node).stmt);
+	    break;
 
-    for (unsigned i = 0; i < params->size(); i ++) {
-	symbols[i]->offset(offset);
-	offset += (*params)[i].size();
+	default:
+	    break;
+	}
     }
-
-    offset = 0;
-    _body->allocate(offset);
 }
@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# File:		baseline.sh
+#
+# Description:	Time the compiler against a baseline build of it on the
+#		given source file.  The baseline is built from the given
+#		revision in a scratch worktree, which is removed when we
+#		are done.  Each compiler is run RUNS times, five by
+#		default, taking turns so that both see the same machine,
+#		and the best wall time of each is reported.  Since older
+#		revisions have no phase timers, the whole compilation is
+#		timed.  The code is thrown away rather than compared, since
+#		later revisions may number their labels differently.
+#
+
+if [ $# -ne 2 ]; then
+	echo "usage: $0 revision file" >&2
+	exit 1
+fi
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+runs=${RUNS:-5}
+scratch=$(mktemp -d) || exit 1
+tree=$scratch/tree
+trap 'rm -rf "$scratch"' EXIT
+
+git -C "$top" worktree add -q --detach "$tree" "$1" || exit 1
+trap 'git -C "$top" worktree remove --force "$tree"; rm -rf "$scratch"' EXIT
+make -C "$tree" scc > /dev/null || exit 1
+
+run() {
+	start=$(date +%s%N)
+	"$1" -a none "$2" > /dev/null || exit 1
+	elapsed=$(( ($(date +%s%N) - start) / 1000000 ))
+}
+
+for i in $(seq "$runs"); do
+	run "$tree/scc" "$2"
+	[ $i -eq 1 ] || [ $elapsed -lt $before ] && before=$elapsed
+	run "$top/scc" "$2"
+	[ $i -eq 1 ] || [ $elapsed -lt $after ] && after=$elapsed
+done
+
+echo "baseline $1: $before ms"
+echo "compiler: $after ms"
@@ -0,0 +1,516 @@
+/*
+ * File:	bench.cpp
+ *
+ * Description:	This file contains the main program for the benchmarks of
+ *		the Simple C compiler, which time parts of the library on
+ *		a source file, usually one written by generate.sh.  Each
+ *		is run a number of times, and the best time is reported,
+ *		since anything slower was only slowed down by something
+ *		else.
+ *
+ *		lex		tokenize the whole source, and report how
+ *				many tokens a second that is, with each
+ *				number of threads up to the given one and
+ *				with the scanner the lexer used to have
+ *
+ *		compile		compile the whole source, with no
+ *				commentary, to a string
+ *
+ *		parse		compile the whole source as above, and
+ *				report the time spent parsing alone, as
+ *				told by the timers of the phases
+ */
+
+# include <chrono>
+# include <cstdlib>
+# include <cstring>
+# include <iostream>
+# include <sstream>
+# include <string>
+# include <ctype.h>
+# include <getopt.h>
+# include "CompilerContext.h"
+# include "Profile.h"
+# include "ThreadPool.h"
+# include "lexer.h"
+# include "tokens.h"
+
+using namespace std;
+using namespace std::chrono;
+
+/* The scanner the lexer had before it was table-driven, which is kept
+   here so that the lexer has something to be measured against.  It
+   classifies each character with <ctype.h>, one at a time, and looks up
+   each name by comparing it with every keyword in turn. */
+
+static struct {
+    string lexeme;
+    int token;
+} keywords[] = {
+    {"auto",     AUTO},
+    {"break",    BREAK},
+    {"case",     CASE},
+    {"char",     CHAR},
+    {"const",    CONST},
+    {"continue", CONTINUE},
+    {"default",  DEFAULT},
+    {"do",       DO},
+    {"double",   DOUBLE},
+    {"else",     ELSE},
+    {"enum",     ENUM},
+    {"extern",   EXTERN},
+    {"float",    FLOAT},
+    {"for",      FOR},
+    {"goto",     GOTO},
+    {"if",       IF},
+    {"int",      INT},
+    {"long",     LONG},
+    {"register", REGISTER},
+    {"return",   RETURN},
+    {"short",    SHORT},
+    {"signed",   SIGNED},
+    {"sizeof",   SIZEOF},
+    {"static",   STATIC},
+    {"struct",   STRUCT},
+    {"switch",   SWITCH},
+    {"typedef",  TYPEDEF},
+    {"union",    UNION},
+    {"unsigned", UNSIGNED},
+    {"void",     VOID},
+    {"volatile", VOLATILE},
+    {"while",    WHILE},
+};
+
+# define numKeywords (sizeof(keywords) / sizeof(keywords[0]))
+
+struct Reference {
+    const char *cursor, *limit, *start;
+    unsigned line;
+
+    int advance();
+    int scan();
+};
+
+
+/*
+ * Function:	Reference::advance
+ *
+ * Description:	Move past the current character and return the next one,
+ *		or EOF if we have run off the end of the buffer.
+ */
+
+inline int Reference::advance()
+{
+    if (cursor < limit)
+	cursor ++;
+
+    return cursor < limit ? (unsigned char) *cursor : EOF;
+}
+
+
+/*
+ * Function:	Reference::scan
+ *
+ * Description:	Scan the next token, leaving START at its first character
+ *		and the cursor just past its last, just as the lexer once
+ *		did.  Errors are not reported, since the lexer has already
+ *		done that.
+ */
+
+int Reference::scan()
+{
+    unsigned i;
+    int c = cursor < limit ? (unsigned char) *cursor : EOF;
+
+
+    while (c != EOF) {
+	while (isspace(c)) {
+	    if (c == '\n')
+		line ++;
+
+	    c = advance();
+	}
+
+	start = cursor;
+
+	if (isalpha(c) || c == '_') {
+	    do
+		c = advance();
+	    while (isalnum(c) || c == '_');
+
+	    for (i = 0; i < numKeywords; i ++)
+		if (keywords[i].lexeme.compare(0, string::npos, start,
+			cursor - start) == 0)
+		    return keywords[i].token;
+
+	    return ID;
+
+	} else if (isdigit(c)) {
+	    do
+		c = advance();
+	    while (isdigit(c));
+
+	    if (c != '.')
+		return INTEGER;
+
+	    c = advance();
+
+	    if (isdigit(c)) {
+		do
+		    c = advance();
+		while (isdigit(c));
+
+		if (c == 'e' || c == 'E') {
+		    c = advance();
+
+		    if (c == '-' || c == '+')
+			c = advance();
+
+		    while (isdigit(c))
+			c = advance();
+		}
+	    }
+
+	    return REAL;
+
+	} else {
+	    switch(c) {
+	    case '|':
+		if (advance() == '|') {
+		    advance();
+		    return OR;
+		}
+
+		return ERROR;
+
+	    case '=':
+		if (advance() == '=') {
+		    advance();
+		    return EQL;
+		}
+
+		return '=';
+
+	    case '&':
+		if (advance() == '&') {
+		    advance();
+		    return AND;
+		}
+
+		return '&';
+
+	    case '!':
+		if (advance() == '=') {
+		    advance();
+		    return NEQ;
+		}
+
+		return '!';
+
+	    case '<':
+		if (advance() == '=') {
+		    advance();
+		    return LEQ;
+		}
+
+		return '<';
+
+	    case '>':
+		if (advance() == '=') {
+		    advance();
+		    return GEQ;
+		}
+
+		return '>';
+
+	    case '-':
+		c = advance();
+
+		if (c == '-') {
+		    advance();
+		    return DEC;
+
+		} else if (c == '>') {
+		    advance();
+		    return ARROW;
+		}
+
+		return '-';
+
+	    case '+':
+		if (advance() == '+') {
+		    advance();
+		    return INC;
+		}
+
+		return '+';
+
+	    case '*': case '%': case '.':
+	    case '(': case ')': case '[': case ']':
+	    case '{': case '}': case ';': case ',':
+		advance();
+		return c;
+
+	    case '/':
+		c = advance();
+
+		if (c == '*') {
+		    c = advance();
+
+		    do {
+			while (c != '*' && c != EOF) {
+			    if (c == '\n')
+				line ++;
+
+			    c = advance();
+			}
+
+			c = advance();
+		    } while (c != '/' && c != EOF);
+
+		    c = advance();
+		    break;
+
+		} else
+		    return '/';
+
+	    case '"':
+		c = advance();
+
+		while (c != '"' && c != '\n' && c != EOF)
+		    c = advance();
+
+		advance();
+		return STRING;
+
+	    case EOF:
+		return DONE;
+
+	    default:
+		c = advance();
+		break;
+	    }
+	}
+    }
+
+    start = cursor;
+    return DONE;
+}
+
+
+/*
+ * Function:	reference
+ *
+ * Description:	Tokenize the source from SOURCE to LIMIT with the old
+ *		scanner, keeping the kind, place, and line of each token
+ *		as the lexer does, but not interning any names, which the
+ *		old lexer left to the parser.
+ */
+
+static void reference(const char *source, const char *limit,
+	TokenStream &tokens)
+{
+    Reference r = { source, limit, source, 1 };
+    int token;
+
+
+    while ((token = r.scan()) != DONE) {
+	tokens.kind.push_back(token);
+	tokens.offset.push_back(r.start - source);
+	tokens.length.push_back(r.cursor - r.start);
+	tokens.line.push_back(r.line);
+    }
+}
+
+
+/*
+ * Function:	lex
+ *
+ * Description:	Tokenize the source of the given context the given number
+ *		of times with the old scanner and then with a pool of each
+ *		size from one to THREADS, and report the number of tokens,
+ *		and for each, the best rate and how much faster it is than
+ *		the old scanner and than a single thread.
+ */
+
+static void lex(CompilerContext &unit, unsigned runs, unsigned threads)
+{
+    double best = 0, elapsed, serial = 0, old = 0;
+    size_t tokens = 0;
+
+
+    for (unsigned i = 0; i < runs; i ++) {
+	TokenStream stream;
+	steady_clock::time_point start = steady_clock::now();
+
+	reference(unit.source, unit.limit, stream);
+	elapsed = duration<double>(steady_clock::now() - start).count();
+	tokens = stream.kind.size();
+
+	if (i == 0 || elapsed < old)
+	    old = elapsed;
+    }
+
+    cout << tokens << " tokens, " << unit.limit - unit.source << " bytes";
+    cout << endl << "old scanner: " << old * 1e3 << " ms, ";
+    cout << tokens / old / 1e6 << " M tokens/s" << endl;
+
+    for (unsigned n = 1; n <= threads; n ++) {
+	ThreadPool pool(n);
+
+	best = 0;
+
+	for (unsigned i = 0; i < runs; i ++) {
+	    TokenStream stream;
+	    steady_clock::time_point start = steady_clock::now();
+
+	    tokenize(unit.source, unit.source, unit.limit, 1, stream, pool);
+	    elapsed = duration<double>(steady_clock::now() - start).count();
+	    tokens = stream.kind.size();
+
+	    if (i == 0 || elapsed < best)
+		best = elapsed;
+	}
+
+	if (n == 1)
+	    serial = best;
+
+	cout << n << (n == 1 ? " thread:  " : " threads: ") << best * 1e3;
+	cout << " ms, " << tokens / best / 1e6 << " M tokens/s, ";
+	cout << old / best << "x the old scanner, " << serial / best << "x";
+	cout << endl;
+    }
+}
+
+
+/*
+ * Function:	compile
+ *
+ * Description:	Compile the source of the given context the given number
+ *		of times, and report the best time.  Return whether it
+ *		could be compiled without errors.
+ */
+
+static bool compile(CompilerContext &unit, unsigned runs)
+{
+    double best = 0, elapsed;
+    string assembly, diagnostics;
+    bool succeeded = true;
+
+
+    for (unsigned i = 0; i < runs; i ++) {
+	steady_clock::time_point start = steady_clock::now();
+
+	assembly.clear();
+	diagnostics.clear();
+	succeeded = compile(unit.source, unit.limit - unit.source, assembly,
+		diagnostics, ANNOTATE_NONE);
+	elapsed = duration<double>(steady_clock::now() - start).count();
+
+	if (i == 0 || elapsed < best)
+	    best = elapsed;
+    }
+
+    cerr << diagnostics;
+    cout << unit.limit - unit.source << " bytes: " << best * 1e3 << " ms";
+    cout << endl;
+    return succeeded;
+}
+
+
+/*
+ * Function:	parse
+ *
+ * Description:	Compile the source of the given context the given number
+ *		of times, and report the best time spent parsing, as told
+ *		by the timers of the phases.  Return whether it could be
+ *		compiled without errors.
+ */
+
+static bool parse(CompilerContext &source, unsigned runs)
+{
+    double best = 0, elapsed;
+    bool succeeded = true;
+    string assembly;
+
+
+    Timer::enable(false);
+
+    for (unsigned i = 0; i < runs; i ++) {
+	ostringstream errors;
+	CompilerContext unit(errors);
+	ThreadPool serial(1);
+
+	assembly.clear();
+	unit.open(source.source, source.limit - source.source);
+	unit.output(assembly);
+	unit.annotate(ANNOTATE_NONE);
+
+	elapsed = Timer::elapsed(PARSING);
+	succeeded = unit.compile(serial) && unit.errors() == 0 && succeeded;
+	elapsed = Timer::elapsed(PARSING) - elapsed;
+
+	if (i == 0 || elapsed < best)
+	    best = elapsed;
+
+	cerr << errors.str();
+    }
+
+    cout << source.limit - source.source << " bytes: " << best * 1e3 << " ms";
+    cout << endl;
+    return succeeded;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Run the named benchmark on the named source file.  With
+ *		-n, each is run the given number of times rather than
+ *		five.  With -j, the lexer is timed with up to the given
+ *		number of threads rather than just one.
+ */
+
+int main(int argc, char *argv[])
+{
+    unsigned runs = 5, threads = 1;
+    int c;
+
+
+    while ((c = getopt(argc, argv, "j:n:")) != -1)
+	if (c == 'j')
+	    threads = strtoul(optarg, NULL, 0);
+	else if (c == 'n')
+	    runs = strtoul(optarg, NULL, 0);
+	else
+	    goto usage;
+
+    if (optind + 2 != argc || runs == 0 || threads == 0 ||
+	    (strcmp(argv[optind], "lex") != 0 &&
+	    strcmp(argv[optind], "compile") != 0 &&
+	    strcmp(argv[optind], "parse") != 0)) {
+    usage:
+	cerr << "usage: " << argv[0] << " [-j threads] [-n runs] lex file";
+	cerr << endl;
+	cerr << "       " << argv[0] << " [-n runs] compile|parse file";
+	cerr << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    CompilerContext unit;
+
+    if (!unit.open(argv[optind + 1])) {
+	perror(argv[optind + 1]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (strcmp(argv[optind], "compile") == 0)
+	exit(compile(unit, runs) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    if (strcmp(argv[optind], "parse") == 0)
+	exit(parse(unit, runs) ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    context = &unit;
+    lex(unit, runs, threads);
+    exit(EXIT_SUCCESS);
+}
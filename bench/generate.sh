@@ -0,0 +1,113 @@
+#!/bin/sh
+#
+# File:		generate.sh
+#
+# Description:	Write a synthetic Simple C program of the given kind and
+#		size to the standard output, for the benchmarks to chew
+#		on.  The programs are the same every time.
+#
+#		chains N	N statements, each an arithmetic chain of
+#				64 operands at every level of precedence
+#		functions N	N functions of loops, calls, and comments
+#		globals N	N global variables, and a main function that
+#				assigns every seventh one
+#
+
+usage() {
+	echo "usage: $0 chains|functions|globals count" >&2
+	exit 1
+}
+
+[ $# -ge 2 ] || usage
+
+case "$1" in
+chains)
+	awk -v n="$2" 'BEGIN {
+		split("+ * - / + % - < + == * && - || + * != / > -", ops)
+		split("a b c d e", names)
+
+		print "int a, b, c, d, e, s;"
+		print ""
+		print "int main(void)"
+		print "{"
+
+		for (i = 0; i < n; i ++) {
+			line = "    s = " names[i % 5 + 1]
+
+			for (j = 1; j < 64; j ++)
+				line = line " " ops[(i + j) % 20 + 1] " " \
+				    (j % 3 == 0 ? j : names[(i + j) % 5 + 1])
+
+			print line ";"
+		}
+
+		print "    return s;"
+		print "}"
+	}'
+	;;
+functions)
+	awk -v n="$2" 'BEGIN {
+		print "int printf();"
+		print "int counter, table[100];"
+		print "double scale;"
+
+		for (i = 0; i < n; i ++) {
+			print ""
+			print "/*"
+			print " * Function:\tf" i
+			print " *"
+			print " * Description:\tAdd up part of the table."
+			print " */"
+			print ""
+			print "int f" i "(int a, int b)"
+			print "{"
+			print "    int i, s;"
+			print ""
+			print "    s = 0;"
+			print "    i = 0;"
+			print ""
+			print "    while (i < a) {"
+			print "\ts = s + table[i % 100] * b;"
+			print ""
+			print "\tif (s > 1000)"
+			print "\t    s = s - " i ";"
+			print ""
+			print "\ti = i + 1;"
+			print "    }"
+			print ""
+			print "    counter = counter + 1;"
+			print "    scale = scale * 2.5;"
+			print ""
+			print "    if (a == b)"
+			print "\tprintf(\"same %d\\n\", s);"
+			print ""
+			print "    return s + " (i > 0 ? "f" i - 1 "(a, b)" : "0") ";"
+			print "}"
+		}
+
+		print ""
+		print "int main(void)"
+		print "{"
+		print "    return f" n - 1 "(1, 2);"
+		print "}"
+	}'
+	;;
+globals)
+	awk -v n="$2" 'BEGIN {
+		for (i = 0; i < n; i ++)
+			print "int v" i ";"
+
+		print ""
+		print "int main(void)"
+		print "{"
+
+		for (i = 0; i < n; i += 7)
+			print "    v" i " = " i ";"
+
+		print "}"
+	}'
+	;;
+*)
+	usage
+	;;
+esac
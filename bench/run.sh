@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+# File:		run.sh
+#
+# Description:	Run the benchmarks on programs written by generate.sh,
+#		which are kept in a scratch directory until we are done.
+#		The directory holding the benchmark program is given, and
+#		is the directory of this script by default.  The lexer is
+#		timed with up to THREADS threads, which is the number of
+#		processors by default, and with the scanner it used to
+#		have, so that the two can be compared on the same run.
+#		If BASELINE names a revision, the compiler is also timed
+#		against a build of that revision on the chains.
+#
+
+dir=${1:-$(dirname "$0")}
+threads=${THREADS:-$(getconf _NPROCESSORS_ONLN)}
+scratch=$(mktemp -d) || exit 1
+trap 'rm -rf "$scratch"' EXIT
+
+sh "$dir/generate.sh" functions 20000 > "$scratch/functions.c" || exit 1
+
+echo "tokenizing $(wc -l < "$scratch/functions.c") lines of functions:"
+"$dir/bench" -j "$threads" lex "$scratch/functions.c" || exit 1
+
+for n in 10000 100000; do
+	sh "$dir/generate.sh" globals $n > "$scratch/globals.c" || exit 1
+	echo "compiling $n globals:"
+	"$dir/bench" compile "$scratch/globals.c" || exit 1
+done
+
+sh "$dir/generate.sh" chains 20000 > "$scratch/chains.c" || exit 1
+echo "compiling 20000 arithmetic chains:"
+"$dir/bench" compile "$scratch/chains.c" || exit 1
+echo "parsing 20000 arithmetic chains:"
+"$dir/bench" parse "$scratch/chains.c" || exit 1
+
+if [ -n "$BASELINE" ]; then
+	echo "compiling 20000 arithmetic chains, against $BASELINE:"
+	sh "$dir/baseline.sh" "$BASELINE" "$scratch/chains.c" || exit 1
+fi
@@ -12,6 +12,10 @@
 
 # include <iostream>
 # include "lexer.h"
+# include "Arena.h"
+# include "CompilerContext.h"
+# include "Profile.h"
+# include "Interner.h"
 # include "checker.h"
 # include "nullptr.h"
 # include "tokens.h"
@@ -21,7 +25,6 @@
 
 using namespace std;
 
-static Scope *outermost, *toplevel;
 static const Type error, integer(INT), real(DOUBLE);
 
 static string invalid_return = "invalid return type";
@@ -45,14 +48,18 @@ static string undeclared_identifier = "%s is undeclared";
  * Description:	Attempt to promote an array expression to a pointer.
  */
 
-static Type promote(Expression *&expr)
+static Type promote(Tree::Id &expr)
 {
-    if (expr->type().isArray()) {
+    Tree *tree = Tree::current();
+
+
+    if (tree->type(expr).isArray()) {
 	// cout << "promoting array to pointer" << endl;
-	expr = new Address(expr, expr->type().promote());
+	expr = tree->newUnary(Tree::ADDRESS_EXPR, expr,
+		tree->type(expr).promote());
     }
 
-    return expr->type();
+    return tree->type(expr);
 }
 
 
@@ -63,15 +70,18 @@ static Type promote(Expression *&expr)
  *		type.  If necessary, an array is also promoted.
  */
 
-static Type promote(Expression *&expr, Type type)
+static Type promote(Tree::Id &expr, Type type)
 {
-    if (expr->type() == integer && type == real) {
+    Tree *tree = Tree::current();
+
+
+    if (tree->type(expr) == integer && type == real) {
 	// cout << "promoting int to double" << endl;
 	//
-	if (dynamic_cast<Integer *>(expr))
-	    expr = new Real(((Integer *) expr)->value());
+	if (Tree::kind(expr) == Tree::INTEGER_EXPR)
+	    expr = tree->newReal(expr);
 	else
-	    expr = new Cast(real, expr);
+	    expr = tree->newUnary(Tree::CAST_EXPR, expr, real);
     }
 
     return promote(expr);
@@ -85,11 +95,14 @@ static Type promote(Expression *&expr, Type type)
  *		type by truncation or promotion.
  */
 
-static Type convert(Expression *&expr, Type type)
+static Type convert(Tree::Id &expr, Type type)
 {
-    if (expr->type() == real && type == integer) {
+    Tree *tree = Tree::current();
+
+
+    if (tree->type(expr) == real && type == integer) {
 	// cout << "converting double to int" << endl;
-	expr = new Cast(integer, expr);
+	expr = tree->newUnary(Tree::CAST_EXPR, expr, integer);
     }
 
     return promote(expr, type);
@@ -104,12 +117,12 @@ static Type convert(Expression *&expr, Type type)
 
 Scope *openScope()
 {
-    toplevel = new Scope(toplevel);
+    context->toplevel = new Scope(context->toplevel);
 
-    if (outermost == nullptr)
-	outermost = toplevel;
+    if (context->outermost == nullptr)
+	context->outermost = context->toplevel;
 
-    return toplevel;
+    return context->toplevel;
 }
 
 
@@ -122,8 +135,9 @@ Scope *openScope()
 
 Scope *closeScope()
 {
-    Scope *old = toplevel;
-    toplevel = toplevel->enclosing();
+    Scope *old = context->toplevel;
+    context->toplevel->close();
+    context->toplevel = context->toplevel->enclosing();
     return old;
 }
 
@@ -132,21 +146,25 @@ Scope *closeScope()
  * Function:	declareFunction
  *
  * Description:	Declare a function with the specified NAME and TYPE.  A
- *		function is always declared in the outermost scope.
+ *		function is always declared in the outermost scope, so its
+ *		symbol must outlive the arena of any function definition,
+ *		and comes from the arena of the whole unit instead.
  */
 
-Symbol *declareFunction(const string &name, const Type &type)
+Symbol *declareFunction(unsigned name, const Type &type)
 {
-    Symbol *symbol = outermost->find(name);
+    Symbol *symbol = context->outermost->find(name);
 
     if (symbol != nullptr) {
-	report(redeclared_function, name);
-	outermost->remove(name);
+	report(redeclared_function, Interner::current()->name(name));
 	delete symbol;
+	symbol = new(context->arena) Symbol(name, type);
+	context->outermost->replace(symbol);
+    } else {
+	symbol = new(context->arena) Symbol(name, type);
+	context->outermost->insert(symbol);
     }
 
-    symbol = new Symbol(name, type);
-    outermost->insert(symbol);
     return symbol;
 }
 
@@ -157,18 +175,20 @@ Symbol *declareFunction(const string &name, const Type &type)
  * Description:	Declare a variable with the specified NAME and TYPE.
  */
 
-Symbol *declareVariable(const string &name, const Type &type)
+Symbol *declareVariable(unsigned name, const Type &type)
 {
-    Symbol *symbol = toplevel->find(name);
+    Symbol *symbol = context->toplevel->find(name);
 
     if (symbol != nullptr) {
-	report(redeclared_variable, name);
-	toplevel->remove(name);
+	report(redeclared_variable, Interner::current()->name(name));
 	delete symbol;
+	symbol = new Symbol(name, type);
+	context->toplevel->replace(symbol);
+    } else {
+	symbol = new Symbol(name, type);
+	context->toplevel->insert(symbol);
     }
 
-    symbol = new Symbol(name, type);
-    toplevel->insert(symbol);
     return symbol;
 }
 
@@ -179,18 +199,20 @@ Symbol *declareVariable(const string &name, const Type &type)
  * Description:	Declare a parameter with the specified NAME and TYPE.
  */
 
-Symbol *declareParameter(const string &name, const Type &type)
+Symbol *declareParameter(unsigned name, const Type &type)
 {
-    Symbol *symbol = toplevel->find(name);
+    Symbol *symbol = context->toplevel->find(name);
 
     if (symbol != nullptr) {
-	report(redeclared_parameter, name);
-	toplevel->remove(name);
+	report(redeclared_parameter, Interner::current()->name(name));
 	delete symbol;
+	symbol = new Symbol(name, type);
+	context->toplevel->replace(symbol);
+    } else {
+	symbol = new Symbol(name, type);
+	context->toplevel->insert(symbol);
     }
 
-    symbol = new Symbol(name, type);
-    toplevel->insert(symbol);
     return symbol;
 }
 
@@ -203,14 +225,15 @@ Symbol *declareParameter(const string &name, const Type &type)
  *		future error messages.
  */
 
-Symbol *checkIdentifier(const string &name)
+Symbol *checkIdentifier(unsigned name)
 {
-    Symbol *symbol = toplevel->lookup(name);
+    Timer timer(CHECKING, "checkIdentifier");
+    Symbol *symbol = context->toplevel->lookup(name);
 
     if (symbol == nullptr) {
-	report(undeclared_identifier, name);
+	report(undeclared_identifier, Interner::current()->name(name));
 	symbol = new Symbol(name, error);
-	toplevel->insert(symbol);
+	context->toplevel->insert(symbol);
     }
 
     return symbol;
@@ -222,11 +245,14 @@ Symbol *checkIdentifier(const string &name)
  *
  * Description:	Check a function call expression: the type of the object
  *		being called must be a function type, and the number and
- *		types of arguments must agree.
+ *		types of arguments must agree.  The arguments are those on
+ *		ARGS from FIRST onward, and are moved into the call.
  */
 
-Expression *checkCall(const Symbol *id, Expressions &args)
+Tree::Id checkCall(const Symbol *id, Expressions &args, unsigned first)
 {
+    Timer timer(CHECKING, "checkCall");
+    Tree *tree = Tree::current();
     const Type &t = id->type();
     Type result = error;
 
@@ -236,28 +262,29 @@ Expression *checkCall(const Symbol *id, Expressions &args)
 	    report(invalid_function);
 
     	else {
-	    Parameters *params = t.parameters();
+	    const Parameters *params = t.parameters();
 	    result = Type(t.specifier(), t.indirection());
 
 	    if (params != nullptr) {
-		if (params->size() != args.size())
+		if (params->size() != args.size() - first)
 		    report(invalid_arguments);
 
 		else {
-		    for (unsigned i = 0; i < args.size(); i ++)
-			if (convert(args[i], (*params)[i]) != (*params)[i]) {
+		    for (unsigned i = first; i < args.size(); i ++)
+			if (convert(args[i], (*params)[i - first]) !=
+				(*params)[i - first]) {
 			    report(invalid_arguments);
 			    result = error;
 			    break;
 			}
 		}
 	    } else
-		for (unsigned i = 0; i < args.size(); i ++)
+		for (unsigned i = first; i < args.size(); i ++)
 		    promote(args[i]);
 	}
     }
 
-    return new Call(id, args, result);
+    return tree->newCall(id, args, first, result);
 }
 
 
@@ -271,14 +298,19 @@ Expression *checkCall(const Symbol *id, Expressions &args)
  *		pointer(T) x int -> T
  */
 
-Expression *checkArray(Expression *left, Expression *right)
+Tree::Id checkArray(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkArray");
+    Tree *tree = Tree::current();
     const Type &t1 = promote(left);
-    const Type &t2 = right->type();
+    Type t2 = tree->type(right);
     Type result = error;
 
-    right = new Multiply(right, new Integer(t1.deref().size()), integer);
-    Expression *expr = new Add(left, right, t1);
+    if (t1.isPointer())
+	right = tree->newBinary(Tree::MULTIPLY_EXPR, right,
+		tree->newInteger(t1.deref().size()), integer);
+
+    Tree::Id expr = tree->newBinary(Tree::ADD_EXPR, left, right, t1);
 
     if (t1 != error && t2 != error) {
 	if (t1.isPointer() && t2 == integer)
@@ -287,7 +319,7 @@ Expression *checkArray(Expression *left, Expression *right)
 	    report(invalid_operands, "[]");
     }
 
-    return new Dereference(expr, result);
+    return tree->newUnary(Tree::DEREFERENCE_EXPR, expr, result);
 }
 
 
@@ -302,8 +334,10 @@ Expression *checkArray(Expression *left, Expression *right)
  *		pointer(T) -> int
  */
 
-Expression *checkNot(Expression *expr)
+Tree::Id checkNot(Tree::Id expr)
 {
+    Timer timer(CHECKING, "checkNot");
+    Tree *tree = Tree::current();
     const Type &t = promote(expr);
     Type result = error;
 
@@ -315,7 +349,7 @@ Expression *checkNot(Expression *expr)
 	    report(invalid_operand, "!");
     }
 
-    return new Not(expr, result);
+    return tree->newUnary(Tree::NOT_EXPR, expr, result);
 }
 
 
@@ -329,9 +363,11 @@ Expression *checkNot(Expression *expr)
  *		double -> double
  */
 
-Expression *checkNegate(Expression *expr)
+Tree::Id checkNegate(Tree::Id expr)
 {
-    const Type &t = expr->type();
+    Timer timer(CHECKING, "checkNegate");
+    Tree *tree = Tree::current();
+    Type t = tree->type(expr);
     Type result = error;
 
 
@@ -342,7 +378,7 @@ Expression *checkNegate(Expression *expr)
 	    report(invalid_operand, "-");
     }
 
-    return new Negate(expr, result);
+    return tree->newUnary(Tree::NEGATE_EXPR, expr, result);
 }
 
 
@@ -355,8 +391,10 @@ Expression *checkNegate(Expression *expr)
  *		pointer(T) -> T
  */
 
-Expression *checkDereference(Expression *expr)
+Tree::Id checkDereference(Tree::Id expr)
 {
+    Timer timer(CHECKING, "checkDereference");
+    Tree *tree = Tree::current();
     const Type &t = promote(expr);
     Type result = error;
 
@@ -368,7 +406,7 @@ Expression *checkDereference(Expression *expr)
 	    report(invalid_operand, "*");
     }
 
-    return new Dereference(expr, result);
+    return tree->newUnary(Tree::DEREFERENCE_EXPR, expr, result);
 }
 
 
@@ -382,20 +420,47 @@ Expression *checkDereference(Expression *expr)
  *		T -> pointer(T)
  */
 
-Expression *checkAddress(Expression *expr)
+Tree::Id checkAddress(Tree::Id expr)
 {
-    const Type &t = expr->type();
+    Timer timer(CHECKING, "checkAddress");
+    Tree *tree = Tree::current();
+    Type t = tree->type(expr);
     Type result = error;
 
 
     if (t != error) {
-	if (expr->lvalue())
+	if (tree->lvalue(expr))
 	    result = Type(t.specifier(), t.indirection() + 1);
 	else
 	    report(invalid_lvalue);
     }
 
-    return new Address(expr, result);
+    return tree->newUnary(Tree::ADDRESS_EXPR, expr, result);
+}
+
+
+/*
+ * Function:	checkSizeof
+ *
+ * Description:	Check a sizeof expression: the operand must not have a
+ *		function type, and the result is the size of its type.
+ *
+ *		T -> int
+ */
+
+Tree::Id checkSizeof(Tree::Id expr)
+{
+    Timer timer(CHECKING, "checkSizeof");
+    Tree *tree = Tree::current();
+    Type t = tree->type(expr);
+
+
+    if (t.isFunction()) {
+	report(invalid_operand, "sizeof");
+	return tree->newInteger(0);
+    }
+
+    return tree->newInteger(t.size());
 }
 
 
@@ -415,8 +480,10 @@ Expression *checkAddress(Expression *expr)
  *		pointer(S) -> pointer(T)
  */
 
-Expression *checkCast(const Type &type, Expression *expr)
+Tree::Id checkCast(const Type &type, Tree::Id expr)
 {
+    Timer timer(CHECKING, "checkCast");
+    Tree *tree = Tree::current();
     const Type &t = promote(expr);
     Type result = error;
 
@@ -431,7 +498,7 @@ Expression *checkCast(const Type &type, Expression *expr)
 	    report(invalid_cast);
     }
 
-    return new Cast(result, expr);
+    return tree->newUnary(Tree::CAST_EXPR, expr, result);
 }
 
 
@@ -446,10 +513,11 @@ Expression *checkCast(const Type &type, Expression *expr)
  *		double x double -> double;
  */
 
-static Type checkMult(Expression *&left, Expression *&right, const string &op)
+static Type checkMult(Tree::Id &left, Tree::Id &right, const string &op)
 {
-    const Type &t1 = promote(left, right->type());
-    const Type &t2 = promote(right, left->type());
+    Tree *tree = Tree::current();
+    const Type &t1 = promote(left, tree->type(right));
+    const Type &t2 = promote(right, tree->type(left));
     Type result = error;
 
 
@@ -470,10 +538,12 @@ static Type checkMult(Expression *&left, Expression *&right, const string &op)
  * Description:	Check a multiplication expression.
  */
 
-Expression *checkMultiply(Expression *left, Expression *right)
+Tree::Id checkMultiply(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkMultiply");
+    Tree *tree = Tree::current();
     Type t = checkMult(left, right, "*");
-    return new Multiply(left, right, t);
+    return tree->newBinary(Tree::MULTIPLY_EXPR, left, right, t);
 }
 
 
@@ -483,10 +553,12 @@ Expression *checkMultiply(Expression *left, Expression *right)
  * Description:	Check a division expression.
  */
 
-Expression *checkDivide(Expression *left, Expression *right)
+Tree::Id checkDivide(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkDivide");
+    Tree *tree = Tree::current();
     Type t = checkMult(left, right, "/");
-    return new Divide(left, right, t);
+    return tree->newBinary(Tree::DIVIDE_EXPR, left, right, t);
 }
 
 
@@ -499,10 +571,12 @@ Expression *checkDivide(Expression *left, Expression *right)
  *		int x int -> int
  */
 
-Expression *checkRemainder(Expression *left, Expression *right)
+Tree::Id checkRemainder(Tree::Id left, Tree::Id right)
 {
-    const Type &t1 = left->type();
-    const Type &t2 = right->type();
+    Timer timer(CHECKING, "checkRemainder");
+    Tree *tree = Tree::current();
+    Type t1 = tree->type(left);
+    Type t2 = tree->type(right);
     Type result = error;
 
 
@@ -513,7 +587,7 @@ Expression *checkRemainder(Expression *left, Expression *right)
 	    report(invalid_operands, "%");
     }
 
-    return new Remainder(left, right, result);
+    return tree->newBinary(Tree::REMAINDER_EXPR, left, right, result);
 }
 
 
@@ -532,10 +606,12 @@ Expression *checkRemainder(Expression *left, Expression *right)
  *		int x pointer(T) -> pointer(T)
  */
 
-Expression *checkAdd(Expression *left, Expression *right)
+Tree::Id checkAdd(Tree::Id left, Tree::Id right)
 {
-    const Type &t1 = promote(left, right->type());
-    const Type &t2 = promote(right, left->type());
+    Timer timer(CHECKING, "checkAdd");
+    Tree *tree = Tree::current();
+    const Type &t1 = promote(left, tree->type(right));
+    const Type &t2 = promote(right, tree->type(left));
     Type result = error;
 
 
@@ -544,18 +620,20 @@ Expression *checkAdd(Expression *left, Expression *right)
 	    result = t1;
 
 	else if (t1.isPointer() && t2 == integer) {
-	    right = new Multiply(right, new Integer(t1.deref().size()), integer);
+	    right = tree->newBinary(Tree::MULTIPLY_EXPR, right,
+		tree->newInteger(t1.deref().size()), integer);
 	    result = t1;
 
 	} else if (t1 == integer && t2.isPointer()) {
-	    left = new Multiply(left, new Integer(t2.deref().size()), integer);
+	    left = tree->newBinary(Tree::MULTIPLY_EXPR, left,
+		tree->newInteger(t2.deref().size()), integer);
 	    result = t2;
 
 	} else
 	    report(invalid_operands, "+");
     }
 
-    return new Add(left, right, result);
+    return tree->newBinary(Tree::ADD_EXPR, left, right, result);
 }
 
 
@@ -575,11 +653,13 @@ Expression *checkAdd(Expression *left, Expression *right)
  *		pointer(T) x pointer(T) -> int
  */
 
-Expression *checkSubtract(Expression *left, Expression *right)
+Tree::Id checkSubtract(Tree::Id left, Tree::Id right)
 {
-    Expression *tree;
-    const Type &t1 = promote(left, right->type());
-    const Type &t2 = promote(right, left->type());
+    Timer timer(CHECKING, "checkSubtract");
+    Tree *tree = Tree::current();
+    Tree::Id expr;
+    const Type &t1 = promote(left, tree->type(right));
+    const Type &t2 = promote(right, tree->type(left));
     Type result = error;
     Type deref;
 
@@ -592,19 +672,21 @@ Expression *checkSubtract(Expression *left, Expression *right)
 	    result = integer;
 
 	else if (t1.isPointer() && t2 == integer) {
-	    right = new Multiply(right, new Integer(t1.deref().size()), integer);
+	    right = tree->newBinary(Tree::MULTIPLY_EXPR, right,
+		tree->newInteger(t1.deref().size()), integer);
 	    result = t1;
 
 	} else
 	    report(invalid_operands, "-");
     }
 
-    tree = new Subtract(left, right, result);
+    expr = tree->newBinary(Tree::SUBTRACT_EXPR, left, right, result);
 
     if (t1.isPointer() && t1 == t2)
-	tree = new Divide(tree, new Integer(t1.deref().size()), integer);
+	expr = tree->newBinary(Tree::DIVIDE_EXPR, expr,
+		tree->newInteger(t1.deref().size()), integer);
 
-    return tree;
+    return expr;
 }
 
 
@@ -620,10 +702,11 @@ Expression *checkSubtract(Expression *left, Expression *right)
  *		pointer(T) x pointer(T) -> int
  */
 
-static Type checkCompare(Expression *&left, Expression *&right, const string &op)
+static Type checkCompare(Tree::Id &left, Tree::Id &right, const string &op)
 {
-    const Type &t1 = promote(left, right->type());
-    const Type &t2 = promote(right, left->type());
+    Tree *tree = Tree::current();
+    const Type &t1 = promote(left, tree->type(right));
+    const Type &t2 = promote(right, tree->type(left));
     Type result = error;
 
 
@@ -644,10 +727,12 @@ static Type checkCompare(Expression *&left, Expression *&right, const string &op
  * Description:	Check an equality expression: left == right.
  */
 
-Expression *checkEqual(Expression *left, Expression *right)
+Tree::Id checkEqual(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkEqual");
+    Tree *tree = Tree::current();
     Type t = checkCompare(left, right, "==");
-    return new Equal(left, right, t);
+    return tree->newBinary(Tree::EQUAL_EXPR, left, right, t);
 }
 
 
@@ -657,10 +742,12 @@ Expression *checkEqual(Expression *left, Expression *right)
  * Description:	Check an inequality expression: left != right.
  */
 
-Expression *checkNotEqual(Expression *left, Expression *right)
+Tree::Id checkNotEqual(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkNotEqual");
+    Tree *tree = Tree::current();
     Type t = checkCompare(left, right, "!=");
-    return new NotEqual(left, right, t);
+    return tree->newBinary(Tree::NOT_EQUAL_EXPR, left, right, t);
 }
 
 
@@ -670,10 +757,12 @@ Expression *checkNotEqual(Expression *left, Expression *right)
  * Description:	Check a less-than expression: left < right.
  */
 
-Expression *checkLessThan(Expression *left, Expression *right)
+Tree::Id checkLessThan(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkLessThan");
+    Tree *tree = Tree::current();
     Type t = checkCompare(left, right, "<");
-    return new LessThan(left, right, t);
+    return tree->newBinary(Tree::LESS_THAN_EXPR, left, right, t);
 }
 
 
@@ -683,10 +772,12 @@ Expression *checkLessThan(Expression *left, Expression *right)
  * Description:	Check a greater-than expression: left > right.
  */
 
-Expression *checkGreaterThan(Expression *left, Expression *right)
+Tree::Id checkGreaterThan(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkGreaterThan");
+    Tree *tree = Tree::current();
     Type t = checkCompare(left, right, ">");
-    return new GreaterThan(left, right, t);
+    return tree->newBinary(Tree::GREATER_THAN_EXPR, left, right, t);
 }
 
 
@@ -696,10 +787,12 @@ Expression *checkGreaterThan(Expression *left, Expression *right)
  * Description:	Check a less-than-or-equal expression: left <= right.
  */
 
-Expression *checkLessOrEqual(Expression *left, Expression *right)
+Tree::Id checkLessOrEqual(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkLessOrEqual");
+    Tree *tree = Tree::current();
     Type t = checkCompare(left, right, "<=");
-    return new LessOrEqual(left, right, t);
+    return tree->newBinary(Tree::LESS_OR_EQUAL_EXPR, left, right, t);
 }
 
 
@@ -709,10 +802,12 @@ Expression *checkLessOrEqual(Expression *left, Expression *right)
  * Description:	Check a greater-than-or-equal expression: left >= right.
  */
 
-Expression *checkGreaterOrEqual(Expression *left, Expression *right)
+Tree::Id checkGreaterOrEqual(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkGreaterOrEqual");
+    Tree *tree = Tree::current();
     Type t = checkCompare(left, right, ">=");
-    return new GreaterOrEqual(left, right, t);
+    return tree->newBinary(Tree::GREATER_OR_EQUAL_EXPR, left, right, t);
 }
 
 
@@ -734,7 +829,7 @@ Expression *checkGreaterOrEqual(Expression *left, Expression *right)
  *		pointer(S) x pointer(T) -> int
  */
 
-static Type checkLogical(Expression *&left, Expression *&right, const string &op)
+static Type checkLogical(Tree::Id &left, Tree::Id &right, const string &op)
 {
     const Type &t1 = promote(left);
     const Type &t2 = promote(right);
@@ -758,10 +853,12 @@ static Type checkLogical(Expression *&left, Expression *&right, const string &op
  * Description:	Check a logical-and expression: left && right.
  */
 
-Expression *checkLogicalAnd(Expression *left, Expression *right)
+Tree::Id checkLogicalAnd(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkLogicalAnd");
+    Tree *tree = Tree::current();
     Type t = checkLogical(left, right, "&&");
-    return new LogicalAnd(left, right, t);
+    return tree->newBinary(Tree::LOGICAL_AND_EXPR, left, right, t);
 }
 
 
@@ -771,10 +868,12 @@ Expression *checkLogicalAnd(Expression *left, Expression *right)
  * Description:	Check a logical-or expression: left || right.
  */
 
-Expression *checkLogicalOr(Expression *left, Expression *right)
+Tree::Id checkLogicalOr(Tree::Id left, Tree::Id right)
 {
+    Timer timer(CHECKING, "checkLogicalOr");
+    Tree *tree = Tree::current();
     Type t = checkLogical(left, right, "||");
-    return new LogicalOr(left, right, t);
+    return tree->newBinary(Tree::LOGICAL_OR_EXPR, left, right, t);
 }
 
 
@@ -792,15 +891,17 @@ Expression *checkLogicalOr(Expression *left, Expression *right)
  *		pointer(T) x pointer(T) -> pointer(T)
  */
 
-Expression *checkAssign(Expression *left, Expression *right)
+Tree::Id checkAssign(Tree::Id left, Tree::Id right)
 {
-    const Type &t1 = left->type();
-    const Type &t2 = convert(right, left->type());
+    Timer timer(CHECKING, "checkAssign");
+    Tree *tree = Tree::current();
+    Type t1 = tree->type(left);
+    const Type &t2 = convert(right, tree->type(left));
     Type result = error;
 
 
     if (t1 != error && t2 != error) {
-	if (!left->lvalue())
+	if (!tree->lvalue(left))
 	    report(invalid_lvalue);
 
 	else if (t1 == t2 && t1.isValue())
@@ -810,7 +911,7 @@ Expression *checkAssign(Expression *left, Expression *right)
 	    report(invalid_operands, "=");
     }
 
-    return new Assign(left, right, result);
+    return tree->newBinary(Tree::ASSIGN_EXPR, left, right, result);
 }
 
 
@@ -822,8 +923,9 @@ Expression *checkAssign(Expression *left, Expression *right)
  *		return type of the enclosing function.
  */
 
-void checkReturn(Expression *&expr, const Type &type)
+void checkReturn(Tree::Id &expr, const Type &type)
 {
+    Timer timer(CHECKING, "checkReturn");
     const Type &t = convert(expr, type);
 
     if (t != error && t != type)
@@ -839,8 +941,9 @@ void checkReturn(Expression *&expr, const Type &type)
  *		a value type.
  */
 
-void checkTest(Expression *&expr)
+void checkTest(Tree::Id &expr)
 {
+    Timer timer(CHECKING, "checkTest");
     const Type &type = promote(expr);
 
 
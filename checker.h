@@ -12,34 +12,35 @@
 Scope *openScope();
 Scope *closeScope();
 
-Symbol *declareFunction(const std::string &name, const Type &type);
-Symbol *declareVariable(const std::string &name, const Type &type);
-Symbol *declareParameter(const std::string &name, const Type &type);
-Symbol *checkIdentifier(const std::string &name);
+Symbol *declareFunction(unsigned name, const Type &type);
+Symbol *declareVariable(unsigned name, const Type &type);
+Symbol *declareParameter(unsigned name, const Type &type);
+Symbol *checkIdentifier(unsigned name);
 
-Expression *checkCall(const Symbol *id, Expressions &args);
-Expression *checkArray(Expression *left, Expression *right);
-Expression *checkNot(Expression *expr);
-Expression *checkNegate(Expression *expr);
-Expression *checkDereference(Expression *expr);
-Expression *checkAddress(Expression *expr);
-Expression *checkCast(const Type &type, Expression *expr);
-Expression *checkMultiply(Expression *left, Expression *right);
-Expression *checkDivide(Expression *left, Expression *right);
-Expression *checkRemainder(Expression *left, Expression *right);
-Expression *checkAdd(Expression *left, Expression *right);
-Expression *checkSubtract(Expression *left, Expression *right);
-Expression *checkEqual(Expression *left, Expression *right);
-Expression *checkNotEqual(Expression *left, Expression *right);
-Expression *checkLessThan(Expression *left, Expression *right);
-Expression *checkGreaterThan(Expression *left, Expression *right);
-Expression *checkLessOrEqual(Expression *left, Expression *right);
-Expression *checkGreaterOrEqual(Expression *left, Expression *right);
-Expression *checkLogicalAnd(Expression *left, Expression *right);
-Expression *checkLogicalOr(Expression *left, Expression *right);
-Expression *checkAssign(Expression *left, Expression *right);
+Tree::Id checkCall(const Symbol *id, Expressions &args, unsigned first);
+Tree::Id checkArray(Tree::Id left, Tree::Id right);
+Tree::Id checkNot(Tree::Id expr);
+Tree::Id checkNegate(Tree::Id expr);
+Tree::Id checkDereference(Tree::Id expr);
+Tree::Id checkAddress(Tree::Id expr);
+Tree::Id checkSizeof(Tree::Id expr);
+Tree::Id checkCast(const Type &type, Tree::Id expr);
+Tree::Id checkMultiply(Tree::Id left, Tree::Id right);
+Tree::Id checkDivide(Tree::Id left, Tree::Id right);
+Tree::Id checkRemainder(Tree::Id left, Tree::Id right);
+Tree::Id checkAdd(Tree::Id left, Tree::Id right);
+Tree::Id checkSubtract(Tree::Id left, Tree::Id right);
+Tree::Id checkEqual(Tree::Id left, Tree::Id right);
+Tree::Id checkNotEqual(Tree::Id left, Tree::Id right);
+Tree::Id checkLessThan(Tree::Id left, Tree::Id right);
+Tree::Id checkGreaterThan(Tree::Id left, Tree::Id right);
+Tree::Id checkLessOrEqual(Tree::Id left, Tree::Id right);
+Tree::Id checkGreaterOrEqual(Tree::Id left, Tree::Id right);
+Tree::Id checkLogicalAnd(Tree::Id left, Tree::Id right);
+Tree::Id checkLogicalOr(Tree::Id left, Tree::Id right);
+Tree::Id checkAssign(Tree::Id left, Tree::Id right);
 
-void checkReturn(Expression *&expr, const Type &type);
-void checkTest(Expression *&expr);
+void checkReturn(Tree::Id &expr, const Type &type);
+void checkTest(Tree::Id &expr);
 
 # endif /* CHECKER_H */
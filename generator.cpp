@@ -6,298 +6,549 @@
  *
  *		Extra functionality:
  *		- putting all the global declarations at the end
+ *		- buffered output, optionally to a file
+ *		- selectable annotation of the generated code
  */
 
-# include <sstream>
+# include <cstdlib>
 # include <iostream>
 # include <map>
 # include "generator.h"
 # include "machine.h"
+# include "Interner.h"
+# include "ThreadPool.h"
+# include "CompilerContext.h"
+# include "Profile.h"
 
 using namespace std;
-extern vector<fLabel> fLabels;
 
-/*
- * Function:	assigntemp (allocator)
- *
- * Description:	Store values into a temporary variable location on the stack.
- * 		One does not simply do this. You DO IT AHDHFAJKSDAFKSDA:
- */
-static int tempoffset;
-int minoffset;
-int maxoffset;
+/* The number of functions per thread that may be parsed ahead of the
+   code written out, which bounds the memory held by their arenas. */
 
-struct Label{
-    int number;
-    static int counter;
-    Label(){
-	number = counter++;
-    }
-};
+static const unsigned AHEAD = 4;
 
-int Label::counter = 0;
-map<string, Label> Labels;
-Label returnLab;
+static __thread FunctionCode *code;
 
-void assigntemp(Expression *e)
-{
-    stringstream ss;
-
-    tempoffset -=  e->type().size();
-    ss <<  tempoffset << "(%ebp)";
-    
-    e->operand(ss.str());
-}
 
 /*
- * Function:	operator <<
+ * Function:	annotate
  *
- * Description:	Convenience function for writing the operand of an
- *		expression.
+ * Description:	Write the given comment, but only if we are being verbose.
  */
 
-ostream &operator <<(ostream &ostr, Expression *expr)
+static void annotate(const char *comment)
 {
-    return ostr << expr->operand();
+    if (context->annotations == ANNOTATE_VERBOSE)
+	code->out << comment;
 }
 
+
 /*
- * Function:	operator <<
+ * Function:	assigntemp (allocator)
  *
- * Description:	Convenience function for writing the operand of a fLabel.
+ * Description:	Store values into a temporary variable location on the stack.
+ * 		One does not simply do this. You DO IT AHDHFAJKSDAFKSDA:
  */
-
-ostream &operator << (ostream &ostr, fLabel &lbl)
+void assigntemp(Tree::Expression &e)
 {
-    return ostr << ".fp" << lbl.number; 
+    code->tempoffset -=  e.type.size();
+    e.operand = Operand(Operand::FRAME, code->tempoffset);
 }
 
 /*
  * Function:	operator <<
  *
- * Description:	Convenience function for writing the operand of a Label.
+ * Description:	Convenience function for writing the operand of a fLabel.
  */
 
-ostream &operator << (ostream &ostr, Label &lbl)
+ostream &operator << (ostream &ostr, fLabel &lbl)
 {
-    return ostr << ".L" << lbl.number;
+    return ostr << ".fp" << lbl.number; 
 }
 
 /*
- * Function:	Expression::operand (accessor)
+ * Function:	Label::Label (constructor)
  *
- * Description:	Return the operand for an expression as a string.
+ * Description:	Initialize a new label, numbered after the others of the
+ *		function being generated.
  */
 
-const string &Expression::operand() const
+Label::Label()
 {
-    return _operand;
+    number = code->labels ++;
 }
 
-
 /*
- * Function:	Expression::operand (mutator)
+ * Function:	operator <<
  *
- * Description:	Update the operand string for an expression.
+ * Description:	Convenience function for writing the operand of a Label,
+ *		which is qualified by the name of its function.
  */
 
-void Expression::operand(const string &operand)
+ostream &operator << (ostream &ostr, const Label &lbl)
 {
-    _operand = operand;
+    return ostr << ".L" << *code->name << "." << lbl.number;
 }
 
-
 /*
- * Function:	Identifier::generate
+ * Function:	generateIdentifier
  *
  * Description:	Generate code for an identifier.  Since there is really no
  *		code to generate, we simply update our operand.
  */
 
-void Identifier::generate()
+static void generateIdentifier(Tree::Identifier &node)
 {
-    stringstream ss;
-
-
-    if (_symbol->offset() != 0) {
-	ss << _symbol->offset() << "(%ebp)";
-	_operand = ss.str();
-    } else
-	_operand = _symbol->name();
+    if (node.symbol->offset() != 0)
+	node.operand = Operand(Operand::FRAME, node.symbol->offset());
+    else
+	node.operand = Operand(Operand::GLOBAL, node.symbol->id());
 }
 
 
 /*
- * Function:	Integer::generate
+ * Function:	generateInteger
  *
  * Description:	Generate code for an integer literal.  Since there is
  *		really no code to generate, we simply update our operand.
+ *		The lexer has already checked that the literal is a valid
+ *		octal or decimal constant that fits in an unsigned int.
  */
 
-void Integer::generate()
+static void generateInteger(Tree &tree, Tree::Integer &node)
 {
-    stringstream ss;
+    const char *value = tree.spelling(node.spelling);
+    unsigned base = value[0] == '0' ? 8 : 10;
 
 
-    ss << "$" << _value;
-    _operand = ss.str();
+    node.operand = Operand(Operand::IMMEDIATE, strtoul(value, NULL, base));
 }
 
 
 /*
- * Function:	Call::generate
+ * Function:	generateCall
  *
  * Description:	Generate code for a function call expression, in which each
- *		argument is simply a variable or an integer literal.
+ *		argument is simply a variable or an integer literal.  The
+ *		arguments are generated and pushed last to first, one per
+ *		step.
  */
 
-void Call::generate()
+static Tree::Id generateCall(Tree &tree, Tree::Frame &frame)
 {
-    unsigned numBytes = 0;
-
-
-    for (int i = _args.size() - 1; i >= 0; i --) {
-	_args[i]->generate();
-	if(_args[i]->type().isReal()){
-	    cout << "\tsubl\t$8, %esp\n";
-	    cout << "\tfldl\t" << _args[i] << endl;
-	    cout << "\tfstpl\t(%esp)\n";
+    Tree::Call &node = tree.call(frame.node);
+    unsigned numBytes = 0, n = node.count;
+    Tree::Id arg;
+    int i;
+
+
+    if (frame.step > 0) {
+	arg = tree.argument(node, n - frame.step);
+	if(tree.type(arg).isReal()){
+	    code->out << "\tsubl\t$8, %esp\n";
+	    code->out << "\tfldl\t" << tree.operand(arg) << '\n';
+	    code->out << "\tfstpl\t(%esp)\n";
 	}else{
-    	    cout << "\tpushl\t" << _args[i] << endl;
+    	    code->out << "\tpushl\t" << tree.operand(arg) << '\n';
 	}
-
-	numBytes += _args[i]->type().size();
-	
     }
 
-    cout << "\tcall\t" << _id->name() << endl;
+    if (frame.step < n)
+	return tree.argument(node, n - 1 - frame.step);
+
+    for (i = 0; i < (int) n; i ++)
+	numBytes += tree.type(tree.argument(node, i)).size();
+
+    code->out << "\tcall\t" << node.id->name() << '\n';
 
     if (numBytes > 0)
-	cout << "\taddl\t$" << numBytes << ", %esp" << endl;
-    assigntemp(this);
-    if(_type.isReal()){
-	cout << "#getting a double from a returned statement thing from the function up thereish^\n";
-	cout << "\tfstpl\t" << this << endl;
+	code->out << "\taddl\t$" << numBytes << ", %esp" << '\n';
+    assigntemp(node);
+    if(node.type.isReal()){
+	annotate("#getting a double from a returned statement thing from the function up thereish^\n");
+	code->out << "\tfstpl\t" << node.operand << '\n';
     }else{
-	cout << "#getting an int from a return.\n";
-    	cout << "\tmovl\t%eax, " << this << endl;
+	annotate("#getting an int from a return.\n");
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n';
     }
-    stringstream ss;
-    ss << this;
-    _operand = ss.str();
+
+    return Tree::NONE;
 }
 
 
 /*
- * Function:	Assign::generate
+ * Function:	generateAssign
  *
  * Description:	Generate code for this assignment statement, in which the
  *		right-hand side is an integer literal and the left-hand
  *		side is an integer scalar variable.  Actually, the way
  *		we've written things, the right-side can be a variable too.
+ *		If the left-hand side is a dereference, we only generate
+ *		the pointer, and store through it.
  */
 
-void Assign::generate()
+static Tree::Id generateAssign(Tree &tree, Tree::Frame &frame)
 {
-    bool indirect;
-    _left->generate(indirect);
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+    bool indirect = Tree::kind(node.left) == Tree::DEREFERENCE_EXPR;
+    Tree::Id pointer = Tree::NONE;
+
+    if (indirect)
+	pointer = tree.unary(node.left).expr;
+
+    switch (frame.step) {
+    case 0:
+	return indirect ? pointer : node.left;
+
+    case 1:
+	if (indirect)
+	    tree.expression(node.left).operand = tree.operand(pointer);
+
+	return node.right;
+    }
+
+    assigntemp(node);
 
-    cout << "#we are teh assignzorzezvillez\n";
-    if(_left->type().isReal()){
+    annotate("#we are teh assignzorzezvillez\n");
+    if(tree.type(node.left).isReal()){
 	if(indirect){
-	    cout << "#INDIRECT REAL ASSIGNMENT OH MY GOODIENESS\n";
-	    cout << "\tfldl\t" << _right << endl;
-	    cout << "\tmovl\t" << _left << ", %eax\n";
-	    cout << "\tfstl\t(%eax)\n";
-	    cout << "\tfstpl\t" << _left << endl;
-	    cout << "\tfstpl\t" << this << endl;
+	    annotate("#INDIRECT REAL ASSIGNMENT OH MY GOODIENESS\n");
+	    code->out << "\tfldl\t" << tree.operand(node.right) << '\n';
+	    code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+	    code->out << "\tfstl\t(%eax)\n";
+	    code->out << "\tfstpl\t" << tree.operand(node.left) << '\n';
+	    code->out << "\tfstpl\t" << node.operand << '\n';
 	}else{
-    	    cout << "\tfldl\t" << _right << endl;
-    	    cout << "\tfstpl\t" << _left << endl;
-	    cout << "\tfstpl\t" << this << endl;
+    	    code->out << "\tfldl\t" << tree.operand(node.right) << '\n';
+    	    code->out << "\tfstpl\t" << tree.operand(node.left) << '\n';
+	    code->out << "\tfstpl\t" << node.operand << '\n';
 	}
     }else{
 	if(indirect){
-	    cout << "#INDIRECT ASSIGNMENT OH MY GOODIENESS\n";
-	    cout << "\tmovl\t" << _right << ", %eax\n";
-	    cout << "\tmovl\t" << _left << ", %ecx\n";
-	    cout << "\tmovl\t%eax, (%ecx)\n";
-	    cout << "\tmovl\t%eax, " << _left << endl;
-	    cout << "\tmovl\t%eax, " << this << endl;
+	    annotate("#INDIRECT ASSIGNMENT OH MY GOODIENESS\n");
+	    code->out << "\tmovl\t" << tree.operand(node.right) << ", %eax\n";
+	    code->out << "\tmovl\t" << tree.operand(node.left) << ", %ecx\n";
+	    code->out << "\tmovl\t%eax, (%ecx)\n";
+	    code->out << "\tmovl\t%eax, " << tree.operand(node.left) << '\n';
+	    code->out << "\tmovl\t%eax, " << node.operand << '\n';
 	}else{
-    	    cout << "\tmovl\t" << _right << ", %eax" << endl;
-    	    cout << "\tmovl\t%eax, " << _left << endl;
-	    cout << "\tmovl\t%eax, " << this << endl;
+    	    code->out << "\tmovl\t" << tree.operand(node.right)
+		    << ", %eax" << '\n';
+    	    code->out << "\tmovl\t%eax, " << tree.operand(node.left) << '\n';
+	    code->out << "\tmovl\t%eax, " << node.operand << '\n';
 	}
     }
+
+    return Tree::NONE;
 }
 
 
 /*
- * Function:	Block::generate
+ * Function:	generateBlock
  *
  * Description:	Generate code for this block, which simply means we
- *		generate code for each statement within the block.
+ *		generate code for each statement within the block, one
+ *		per step.
  */
 
-void Block::generate()
+static Tree::Id generateBlock(Tree &tree, Tree::Frame &frame)
 {
-    for (unsigned i = 0; i < _stmts.size(); i ++){
-	_stmts[i]->generate();
-	if(tempoffset < maxoffset)
-	    maxoffset = tempoffset;
-	tempoffset = minoffset;
+    Tree::Block &node = tree.block(frame.node);
+    unsigned i = frame.step;
+
+    if (i > 0) {
+	if(code->tempoffset < code->maxoffset)
+	    code->maxoffset = code->tempoffset;
+	code->tempoffset = code->minoffset;
+    }
+
+    if (i < node.count) {
+	if (context->annotations == ANNOTATE_LINES)
+	    code->out << "# line " << tree.statement(node, i).line << '\n';
+	return tree.statement(node, i).node;
     }
+
+    return Tree::NONE;
 }
 
 
 /*
- * Function:	Function::generate
+ * Function:	generateFunction
  *
  * Description:	Generate code for this function, which entails allocating
  *		space for local variables, then emitting our prologue, the
  *		body of the function, and the epilogue.
  */
 
-void Function::generate()
+static Tree::Id generateFunction(Tree &tree, Tree::Frame &frame)
 {
-    int offset = 0;
-    Label ret;
-    returnLab = ret;
+    Tree::Function &node = tree.function(frame.node);
+
+
+    if (frame.step == 0) {
+	int offset = 0;
+	code->name = &node.id->name();
+	code->returnLab = Label();
+
+	/* Generate our prologue. */
 
-    /* Generate our prologue. */
+	{
+	    Timer timer(ALLOCATING, node.id->name());
 
-    allocate(offset);
-    tempoffset = offset;
-    minoffset = offset;
-    maxoffset = offset;
-    cout << _id->name() << ":" << endl;
-    cout << "\tpushl\t%ebp" << endl;
-    cout << "\tmovl\t%esp, %ebp" << endl;
+	    tree.allocate(frame.node, offset);
+	}
 
-    cout << "\tsubl\t$" << _id->name() << ".size, %esp" << endl;
+	code->tempoffset = offset;
+	code->minoffset = offset;
+	code->maxoffset = offset;
+	code->out << node.id->name() << ":" << '\n';
+	code->out << "\tpushl\t%ebp" << '\n';
+	code->out << "\tmovl\t%esp, %ebp" << '\n';
 
-    /* Generate the body of this function. */
+	code->out << "\tsubl\t$" << node.id->name() << ".size, %esp" << '\n';
 
-    _body->generate();
+	/* Generate the body of this function. */
+
+	return node.body;
+    }
 
 
     /* Generate our epilogue. */
 
-    cout << returnLab << ":\n";
-    cout << "\tmovl\t%ebp, %esp" << endl;
-    cout << "\tpopl\t%ebp" << endl;
-    cout << "\tret" << endl << endl;
+    code->out << code->returnLab << ":\n";
+    code->out << "\tmovl\t%ebp, %esp" << '\n';
+    code->out << "\tpopl\t%ebp" << '\n';
+    code->out << "\tret" << '\n' << '\n';
+
+    code->out << "\t.global\t" << node.id->name() << '\n';
+    code->out << "\t.set\t" << node.id->name() << ".size, ";
+    code->out << -code->maxoffset << '\n';
+    /*out << "#HELP WHY IS MAXOFFSET NOT RIGHT :C" << maxoffset << '\n';
+    out << "#minoffset: " << minoffset << '\n';
+    out << "#tempoffset: " << tempoffset << '\n';*/
+
+    code->out << '\n';
+
+    return Tree::NONE;
+}
+
+
+/*
+ * Function:	openFunction
+ *
+ * Description:	Return the buffer for the next function definition, whose
+ *		tree should be made in its table, and whose scopes and
+ *		symbols should be allocated from its arena.  With a single
+ *		thread, the one buffer is used over and over and simply
+ *		writes straight through.  Otherwise, we wait until there
+ *		are not too many functions ahead of the code written out.
+ */
+
+FunctionCode *openFunction()
+{
+    CompilerContext *unit = context;
+    FunctionCode *next;
+
+
+    if (unit->pool->size() == 1) {
+	if (unit->functions.empty()) {
+	    unit->functions.emplace_back();
+	    unit->functions.back().out.rdbuf(&unit->writer);
+	}
+
+	return &unit->functions.front();
+    }
+
+    unique_lock<mutex> lock(unit->mutex);
+
+    unit->written.wait(lock, [unit]() {
+	return unit->generating.size() < AHEAD * unit->pool->size();
+    });
+
+    if (!unit->spares.empty()) {
+	next = unit->spares.back();
+	unit->spares.pop_back();
+    } else {
+	unit->functions.emplace_back();
+	next = &unit->functions.back();
+    }
+
+    return next;
+}
+
+
+/*
+ * Function:	drain
+ *
+ * Description:	Write out the code of each function that has been
+ *		generated and that was defined after every function
+ *		already written, and make its buffer a spare.  The lock
+ *		of the context must be held.
+ */
+
+static void drain(CompilerContext *unit)
+{
+    FunctionCode *next;
+    string text;
+
+
+    while (!unit->generating.empty() && unit->generating.front()->done) {
+	next = unit->generating.front();
+	unit->generating.pop_front();
+
+	text = next->text.str();
+	unit->writer.sputn(text.data(), text.size());
+	next->text.str(string());
+	next->tree.clear();
+	next->arena.release();
+	next->done = false;
+	unit->spares.push_back(next);
+    }
+
+    unit->written.notify_all();
+}
+
+
+/*
+ * Function:	closeFunction
+ *
+ * Description:	Generate code for the given function, whose tree was
+ *		made in the table of the given buffer, and release the
+ *		table and the arena of the buffer.  If FUNCTION is NONE,
+ *		there is nothing to generate.
+ *		With more than one thread, the function is generated by
+ *		the pool while we go on parsing, and its code is written
+ *		out once every function defined before it has been.  If
+ *		the buffer has an entry, the code is stored in the cache
+ *		as well.
+ */
+
+void closeFunction(FunctionCode *next, Tree::Id function)
+{
+    CompilerContext *unit = context;
+    string text;
+
+
+    next->labels = 0;
+
+    if (function == Tree::NONE)
+	next->entry.key.clear();
+
+    if (unit->pool->size() == 1) {
+	if (function != Tree::NONE) {
+	    Timer timer(GENERATING, next->tree.function(function).id->name());
+
+	    if (!next->entry.key.empty())
+		next->out.rdbuf(&next->text);
+
+	    code = next;
+	    next->tree.generate(function);
+	    code = nullptr;
+	}
+
+	if (!next->entry.key.empty()) {
+	    text = next->text.str();
+	    next->text.str(string());
+	    next->out.rdbuf(&unit->writer);
+	    unit->writer.sputn(text.data(), text.size());
+	    unit->cache->store(next->entry, text);
+	    next->entry.key.clear();
+	}
+
+	next->tree.clear();
+	next->arena.release();
+	return;
+    }
+
+    lock_guard<mutex> guard(unit->mutex);
+
+    if (function == Tree::NONE) {
+	next->tree.clear();
+	next->arena.release();
+	unit->spares.push_back(next);
+	return;
+    }
+
+    unit->generating.push_back(next);
+
+    unit->pool->submit([unit, next, function]() {
+	CompilerContext *caller = context;
+	Arena *outer = Arena::current();
+	Interner *interner = Interner::current();
+
+	context = unit;
+	code = next;
+	Arena::current(&next->arena);
+	Interner::current(unit->names);
+
+	{
+	    Timer timer(GENERATING, next->tree.function(function).id->name());
+
+	    next->tree.generate(function);
+	}
+
+	Interner::current(interner);
+	Arena::current(outer);
+	code = nullptr;
+	context = caller;
+
+	if (!next->entry.key.empty()) {
+	    unit->cache->store(next->entry, next->text.str());
+	    next->entry.key.clear();
+	}
+
+	lock_guard<mutex> guard(unit->mutex);
+	next->done = true;
+	drain(unit);
+    });
+}
+
+
+/*
+ * Function:	spliceFunction
+ *
+ * Description:	Write out the given code of a function that was fetched
+ *		from the cache rather than generated, in its place among
+ *		the others.
+ */
+
+void spliceFunction(const string &text)
+{
+    CompilerContext *unit = context;
+    FunctionCode *next;
+
+
+    if (unit->pool->size() == 1) {
+	unit->writer.sputn(text.data(), text.size());
+	return;
+    }
+
+    next = openFunction();
+    next->out << text;
+
+    lock_guard<mutex> guard(unit->mutex);
+    next->done = true;
+    unit->generating.push_back(next);
+    drain(unit);
+}
+
+
+/*
+ * Function:	flushFunctions
+ *
+ * Description:	Wait until the code of every function has been written
+ *		out.
+ */
+
+void flushFunctions()
+{
+    CompilerContext *unit = context;
+    unique_lock<mutex> lock(unit->mutex);
 
-    cout << "\t.global\t" << _id->name() << endl;
-    cout << "\t.set\t" << _id->name() << ".size, " << -maxoffset << endl;
-    /*cout << "#HELP WHY IS MAXOFFSET NOT RIGHT :C" << maxoffset << endl;
-    cout << "#minoffset: " << minoffset << endl;
-    cout << "#tempoffset: " << tempoffset << endl;*/
 
-    cout << endl;
+    unit->written.wait(lock, [unit]() {
+	return unit->generating.empty();
+    });
 }
 
 
@@ -309,248 +560,340 @@ void Function::generate()
 
 void generateGlobals(const Symbols &globals)
 {
-    if ((globals.size() + fLabels.size() + Labels.size()) > 0)
-	cout << "\t.data" << endl;
+    Timer timer(GENERATING);
+
+
+    if (globals.size() + context->fLabels.size() + context->Labels.size() > 0)
+	context->out << "\t.data" << '\n';
 
     for (unsigned i = 0; i < globals.size(); i ++) {
-	cout << "\t.comm\t" << globals[i]->name();
-	cout << ", " << globals[i]->type().size() << ", 4" << endl;
+	context->out << "\t.comm\t" << globals[i]->name();
+	context->out << ", " << globals[i]->type().size() << ", 4" << '\n';
     }
 
-    for (unsigned i = 0; i<fLabels.size(); i ++) {
-	cout << fLabels[i] << ":\t.double\t" << fLabels[i].value << endl;
+    for (unsigned i = 0; i<context->fLabels.size(); i ++) {
+	context->out << context->fLabels[i] << ":\t.double\t";
+	context->out << context->fLabels[i].value << '\n';
     }
     
-    map<string, Label>::iterator it;
+    /* The literals are keyed by id, but are written in order of their
+       spelling, as they always have been. */
+
+    Interner *names = Interner::current();
+    map<string, int> sorted;
+    map<unsigned, int>::iterator it;
+    map<string, int>::iterator jt;
 
-    for (it = Labels.begin(); it != Labels.end(); it++) {
-	Label lab = it->second;
-	string value = it->first;
-	cout << lab << ":\t.asciz\t" << value << endl;
+    for (it = context->Labels.begin(); it != context->Labels.end(); it++)
+	sorted.insert(pair<string, int>(names->name(it->first), it->second));
+
+    for (jt = sorted.begin(); jt != sorted.end(); jt++) {
+	Operand lab(Operand::LABEL, jt->second);
+	context->out << lab << ":\t.asciz\t" << jt->first << '\n';
     }
 }
 
 /*
- * Function:	Add::generate
+ * Function:	generateAdd
  *
  * Description:	Generate code for Addition :)
  */
 
-void Add::generate()
+static Tree::Id generateAdd(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
+
+    switch (frame.step) {
+    case 0:
+	return node.left;
+
+    case 1:
+	return node.right;
+    }
 
-    cout << "\n#addition time y'all! :) <3\n";
-    if(_type.isReal()){
+    assigntemp(node);
+
+    annotate("\n#addition time y'all! :) <3\n");
+    if(node.type.isReal()){
 	//do floating point shizzzzz
-	cout << "#float the boat with plussesssszzzz <3<3\n";
-	cout << "\tfldl\t" << _left << endl;
-	cout << "\tfaddl\t" << _right << endl;
-	cout << "\tfstpl\t" << this << endl;
+	annotate("#float the boat with plussesssszzzz <3<3\n");
+	code->out << "\tfldl\t" << tree.operand(node.left) << '\n';
+	code->out << "\tfaddl\t" << tree.operand(node.right) << '\n';
+	code->out << "\tfstpl\t" << node.operand << '\n';
     }
     else{
-	cout << "\t#integerz adding plus! <3<3\n";
-    	cout << "\tmovl\t" << _left << ", %eax\n";
-    	cout << "\taddl\t" << _right << ", %eax\n";
-    	cout << "\tmovl\t%eax, " << this << endl;
+	annotate("\t#integerz adding plus! <3<3\n");
+    	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+    	code->out << "\taddl\t" << tree.operand(node.right) << ", %eax\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n';
     }
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	Multiply::generate
+ * Function:	generateMultiply
  *
  * Description:	Generate code for MULTIPLICATION YEAHHH DAWGI
  */
 
-void Multiply::generate()
+static Tree::Id generateMultiply(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
+
+    switch (frame.step) {
+    case 0:
+	return node.left;
+
+    case 1:
+	return node.right;
+    }
+
+    assigntemp(node);
 
-    cout << "\n#multiplication time y'all! :) <3\n";
-    if(_type.isReal()){
-	cout << "#floating point multiplication! <3 y'all :)\n";
-	cout << "\tfldl\t" << _left << endl;
-	cout << "\tfmull\t" << _right << endl;
-	cout << "\tfstpl\t" << this << endl;
+    annotate("\n#multiplication time y'all! :) <3\n");
+    if(node.type.isReal()){
+	annotate("#floating point multiplication! <3 y'all :)\n");
+	code->out << "\tfldl\t" << tree.operand(node.left) << '\n';
+	code->out << "\tfmull\t" << tree.operand(node.right) << '\n';
+	code->out << "\tfstpl\t" << node.operand << '\n';
     }else{
-	cout << "#integer multiplication! fuck the floats! <3\n";
-    	cout << "\tmovl\t" << _left << ", %eax\n";
-    	cout << "\timull\t" << _right << ", %eax\n";
-    	cout << "\tmovl\t%eax, " << this << endl;
+	annotate("#integer multiplication! fuck the floats! <3\n");
+    	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+    	code->out << "\timull\t" << tree.operand(node.right) << ", %eax\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n';
     }
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	Divide::generate
+ * Function:	generateDivide
  *
  * Description:	Generate assembly for division with EAX RAH
  */
 
-void Divide::generate()
+static Tree::Id generateDivide(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
+
+    switch (frame.step) {
+    case 0:
+	return node.left;
 
-    cout << "\n#division time y'all! :) <3\n";
-    if(_type.isReal()){
-	cout << "\tfldl\t" << _left << endl;
-	cout << "\tfdivl\t" << _right << endl;
-	cout << "\tfstpl\t" << this << endl;
+    case 1:
+	return node.right;
+    }
+
+    assigntemp(node);
+
+    annotate("\n#division time y'all! :) <3\n");
+    if(node.type.isReal()){
+	code->out << "\tfldl\t" << tree.operand(node.left) << '\n';
+	code->out << "\tfdivl\t" << tree.operand(node.right) << '\n';
+	code->out << "\tfstpl\t" << node.operand << '\n';
     }else{
-    	cout << "\tmovl\t" << _left << ", %eax\n";
-    	cout << "\tcltd\n";
-    	cout << "\tmovl\t" << _right << ", %ecx\n";
-    	cout << "\tidivl\t%ecx\n";
-    	cout << "\tmovl\t%eax, " << this << endl;
+    	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+    	code->out << "\tcltd\n";
+    	code->out << "\tmovl\t" << tree.operand(node.right) << ", %ecx\n";
+    	code->out << "\tidivl\t%ecx\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n';
     }
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	Subtract::generate
+ * Function:	generateSubtract
  *
  * Description:	Generate assembly language shit for subtracting shit BLAH
  */
 
-void Subtract::generate()
+static Tree::Id generateSubtract(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
 
-    cout << "\n#Subtacting things from things! <3<3<3\n";
-    if(_type.isReal()){
-	cout << "\tfldl\t" << _left << endl;
-	cout << "\tfsubl\t" << _right << endl;
-	cout << "\tfstpl\t" << this << endl;
+    switch (frame.step) {
+    case 0:
+	return node.left;
+
+    case 1:
+	return node.right;
+    }
+
+    assigntemp(node);
+
+    annotate("\n#Subtacting things from things! <3<3<3\n");
+    if(node.type.isReal()){
+	code->out << "\tfldl\t" << tree.operand(node.left) << '\n';
+	code->out << "\tfsubl\t" << tree.operand(node.right) << '\n';
+	code->out << "\tfstpl\t" << node.operand << '\n';
     }else{
-    	cout << "\tmovl\t" << _left << ", %eax\n";    
-	cout << "\tsubl\t" << _right << ", %eax\n";
-    	cout << "\tmovl\t%eax, " << this << endl;
+    	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+	code->out << "\tsubl\t" << tree.operand(node.right) << ", %eax\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n';
     }
+
+    return Tree::NONE;
 }
 
-void Cast::generate()
+static Tree::Id generateCast(Tree &tree, Tree::Frame &frame)
 {
-    _expr->generate();
-    assigntemp(this);
+    Tree::Unary &node = tree.unary(frame.node);
 
-    cout << "\n\t#Time to cast things!!! <3\n";
 
-    if(_type.isReal()){
-	if(_expr->type().isReal()){
-	    _operand = _expr->operand();
+    if (frame.step == 0)
+	return node.expr;
+
+    assigntemp(node);
+
+    annotate("\n\t#Time to cast things!!! <3\n");
+
+    if(node.type.isReal()){
+	if(tree.type(node.expr).isReal()){
+	    node.operand = tree.operand(node.expr);
 	}else{
-    	    cout << "\tfildl\t" << _expr << endl;
-	    cout << "\tfstpl\t" << this << endl;
+    	    code->out << "\tfildl\t" << tree.operand(node.expr) << '\n';
+	    code->out << "\tfstpl\t" << node.operand << '\n';
 	}
     }else{
-	if(_expr->type().isReal()){
-    	    cout << "\tfldl\t" << _expr << endl;
-    	    cout << "\tfistpl\t" << this << endl;
+	if(tree.type(node.expr).isReal()){
+    	    code->out << "\tfldl\t" << tree.operand(node.expr) << '\n';
+    	    code->out << "\tfistpl\t" << node.operand << '\n';
 	}else
-	    _operand = _expr->operand();
+	    node.operand = tree.operand(node.expr);
     }
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	NotEqual::generate
+ * Function:	generateNotEqual
  *
  * Description:	Generate the assembly language yeah donny finn fin we can do it
  */
 
-void NotEqual::generate()
+static Tree::Id generateNotEqual(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
 
-    cout << "#Equal time hashtag all the ballin'! <3\n";
-    if(_left->type().isReal()){
-	cout << "\tfldl\t" << _left << endl;
-	cout << "\tfcompl\t" << _right << endl;
-	cout << "\tfnstsw\t%ax\n";
-	cout << "\tsahf\n";
-	cout << "\tsene\t%al\n";
-	cout << "\tmovzbl\t%al, %eax\n";
-	cout << "\tmovl\t%eax, " << this << endl;
+    switch (frame.step) {
+    case 0:
+	return node.left;
+
+    case 1:
+	return node.right;
+    }
+
+    assigntemp(node);
+
+    annotate("#Equal time hashtag all the ballin'! <3\n");
+    if(tree.type(node.left).isReal()){
+	code->out << "\tfldl\t" << tree.operand(node.left) << '\n';
+	code->out << "\tfcompl\t" << tree.operand(node.right) << '\n';
+	code->out << "\tfnstsw\t%ax\n";
+	code->out << "\tsahf\n";
+	code->out << "\tsene\t%al\n";
+	code->out << "\tmovzbl\t%al, %eax\n";
+	code->out << "\tmovl\t%eax, " << node.operand << '\n';
     }else{
-    	cout << "\tmovl\t" << _left << ", %eax\n";
-    	cout << "\tcmpl\t" << _right << ", %eax\n";
-    	cout << "\tsetne\t%al\n";
-    	cout << "\tmovzbl\t%al, %eax\n";
-    	cout << "\tmovl\t%eax, " << this << endl << endl;
+    	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+    	code->out << "\tcmpl\t" << tree.operand(node.right) << ", %eax\n";
+    	code->out << "\tsetne\t%al\n";
+    	code->out << "\tmovzbl\t%al, %eax\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n' << '\n';
     }
+
+    return Tree::NONE;
 }
 
 
 
 /*
- * Function:	Equal::generate
+ * Function:	generateEqual
  *
  * Description:	Generate the assembly language code jizz shitasdjfksladjfklsad help
  */
 
-void Equal::generate()
+static Tree::Id generateEqual(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
 
-    cout << "#Equal time hashtag all the ballin'! <3\n";
-    if(_left->type().isReal()){
-	cout << "\tfldl\t" << _left << endl;
-	cout << "\tfcompl\t" << _right << endl;
-	cout << "\tfnstsw\t%ax\n";
-	cout << "\tsahf\n";
-	cout << "\tsete\t%al\n";
-	cout << "\tmovzbl\t%al, %eax\n";
-	cout << "\tmovl\t%eax, " << this << endl;
+    switch (frame.step) {
+    case 0:
+	return node.left;
+
+    case 1:
+	return node.right;
+    }
+
+    assigntemp(node);
+
+    annotate("#Equal time hashtag all the ballin'! <3\n");
+    if(tree.type(node.left).isReal()){
+	code->out << "\tfldl\t" << tree.operand(node.left) << '\n';
+	code->out << "\tfcompl\t" << tree.operand(node.right) << '\n';
+	code->out << "\tfnstsw\t%ax\n";
+	code->out << "\tsahf\n";
+	code->out << "\tsete\t%al\n";
+	code->out << "\tmovzbl\t%al, %eax\n";
+	code->out << "\tmovl\t%eax, " << node.operand << '\n';
     }else{
-    	cout << "\tmovl\t" << _left << ", %eax\n";
-    	cout << "\tcmpl\t" << _right << ", %eax\n";
-    	cout << "\tsete\t%al\n";
-    	cout << "\tmovzbl\t%al, %eax\n";
-    	cout << "\tmovl\t%eax, " << this << endl << endl;
+    	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+    	code->out << "\tcmpl\t" << tree.operand(node.right) << ", %eax\n";
+    	code->out << "\tsete\t%al\n";
+    	code->out << "\tmovzbl\t%al, %eax\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n' << '\n';
     }
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	Not::generate
+ * Function:	generateNot
  *
  * Description: generate all KINDS OF ASSEMBLY then run around naked outside
  */
 
-void Not::generate()
+static Tree::Id generateNot(Tree &tree, Tree::Frame &frame)
 {
-    _expr->generate();
-    assigntemp(this);
+    Tree::Unary &node = tree.unary(frame.node);
+
 
-    cout << "#NOT THE END OF THE WORLD MAYBE \n";
-    if(_expr->type().isReal()){
+    if (frame.step == 0)
+	return node.expr;
+
+    assigntemp(node);
+
+    annotate("#NOT THE END OF THE WORLD MAYBE \n");
+    if(tree.type(node.expr).isReal()){
 	
-    	cout << "\tfldl\t" << _expr << endl;
-	cout << "\tftst\n";
-    	cout << "\tfstp\t%st(0)\n";
-	cout << "\tfnstsw\t%ax\n";
-    	cout << "\tsahf\n";
-    	cout << "\tsete\t%al\n";
-    	cout << "\tmovzbl\t%al, %eax\n";
-    	cout << "\tmovl\t%eax, " << this << endl;
+    	code->out << "\tfldl\t" << tree.operand(node.expr) << '\n';
+	code->out << "\tftst\n";
+    	code->out << "\tfstp\t%st(0)\n";
+	code->out << "\tfnstsw\t%ax\n";
+    	code->out << "\tsahf\n";
+    	code->out << "\tsete\t%al\n";
+    	code->out << "\tmovzbl\t%al, %eax\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n';
 
     }else{
 
-	cout << "\tmovl\t" << _expr << ", %eax" << endl;
-	cout << "\ttestl\t%eax, %eax\n";
-	cout << "\tsete\t%al\n";
-	cout << "\tmovzbl\t%al, %eax\n";
-	cout << "\tmovl\t%eax, " << this << endl;
+	code->out << "\tmovl\t" << tree.operand(node.expr) << ", %eax" << '\n';
+	code->out << "\ttestl\t%eax, %eax\n";
+	code->out << "\tsete\t%al\n";
+	code->out << "\tmovzbl\t%al, %eax\n";
+	code->out << "\tmovl\t%eax, " << node.operand << '\n';
 
     }
+
+    return Tree::NONE;
 }
 
 /*
@@ -559,424 +902,637 @@ void Not::generate()
  * Description:	You can't figure it out? Why, when I was your age, we figured out ALLLL the shit.
  */
 
-void Real::generate()
+static void generateReal(Tree::Real &node)
 {
-    stringstream ss;
-    ss << _label;
-    _operand = ss.str();
+    node.operand = Operand(Operand::REAL_LABEL, node.label);
 }
 
 /*
- * Function:	LessOrEqual::generate
+ * Function:	generateLessOrEqual
  *
  * Description:	Output the assembly language for the happiness of the LessOrEqual stuff!
  */
 
-void LessOrEqual::generate()
+static Tree::Id generateLessOrEqual(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
+
+    switch (frame.step) {
+    case 0:
+	return node.left;
 
-    cout << "#LessOrEqual time hashtag ballin'! <3\n";
-    if(_left->type().isReal()){
-	cout << "\tfldl\t" << _left << endl;
-	cout << "\tfcompl\t" << _right << endl;
-	cout << "\tfnstsw\t%ax\n";
-	cout << "\tsahf\n";
-	cout << "\tsetbe\t%al\n";
-	cout << "\tmovzbl\t%al, %eax\n";
-	cout << "\tmovl\t%eax, " << this << endl;
+    case 1:
+	return node.right;
+    }
+
+    assigntemp(node);
+
+    annotate("#LessOrEqual time hashtag ballin'! <3\n");
+    if(tree.type(node.left).isReal()){
+	code->out << "\tfldl\t" << tree.operand(node.left) << '\n';
+	code->out << "\tfcompl\t" << tree.operand(node.right) << '\n';
+	code->out << "\tfnstsw\t%ax\n";
+	code->out << "\tsahf\n";
+	code->out << "\tsetbe\t%al\n";
+	code->out << "\tmovzbl\t%al, %eax\n";
+	code->out << "\tmovl\t%eax, " << node.operand << '\n';
     }else{
-    	cout << "\tmovl\t" << _left << ", %eax\n";
-    	cout << "\tcmpl\t" << _right << ", %eax\n";
-    	cout << "\tsetle\t%al\n";
-    	cout << "\tmovzbl\t%al, %eax\n";
-    	cout << "\tmovl\t%eax, " << this << endl << endl;
+    	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+    	code->out << "\tcmpl\t" << tree.operand(node.right) << ", %eax\n";
+    	code->out << "\tsetle\t%al\n";
+    	code->out << "\tmovzbl\t%al, %eax\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n' << '\n';
     }
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	LessThan::generate
+ * Function:	generateLessThan
  *
  * Description:	Generate the assembly code for the LessThan operator.
  */
 
-void LessThan::generate()
+static Tree::Id generateLessThan(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
+
+    switch (frame.step) {
+    case 0:
+	return node.left;
 
-    cout << "#LessThan time! hashtag sexy pieces ;)\n";
-    if(_left->type().isReal()){
-	cout << "\tfldl\t" << _left << endl;
-	cout << "\tfcompl\t" << _right << endl;
-	cout << "\tfnstsw\t%ax\n";
-	cout << "\tsahf\n";
-	cout << "\tsetb\t%al\n";
-	cout << "\tmovzbl\t%al, %eax\n";
-	cout << "\tmovl\t%eax, " << this << endl << endl;
+    case 1:
+	return node.right;
+    }
+
+    assigntemp(node);
+
+    annotate("#LessThan time! hashtag sexy pieces ;)\n");
+    if(tree.type(node.left).isReal()){
+	code->out << "\tfldl\t" << tree.operand(node.left) << '\n';
+	code->out << "\tfcompl\t" << tree.operand(node.right) << '\n';
+	code->out << "\tfnstsw\t%ax\n";
+	code->out << "\tsahf\n";
+	code->out << "\tsetb\t%al\n";
+	code->out << "\tmovzbl\t%al, %eax\n";
+	code->out << "\tmovl\t%eax, " << node.operand << '\n' << '\n';
     }else{
-    	cout << "\tmovl\t" << _left << ", %eax\n";
-    	cout << "\tcmpl\t" << _right << ", %eax\n";
-    	cout << "\tsetl\t%al\n";
-    	cout << "\tmovzbl\t%al, %eax\n";
-    	cout << "\tmovl\t%eax, " << this << endl << endl;
+    	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+    	code->out << "\tcmpl\t" << tree.operand(node.right) << ", %eax\n";
+    	code->out << "\tsetl\t%al\n";
+    	code->out << "\tmovzbl\t%al, %eax\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n' << '\n';
     }
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	GreaterThan::generate
+ * Function:	generateGreaterThan
  *
  * Description:	Generate the assembly language for the GreaterThan operator >.
  */
 
-void GreaterThan::generate()
+static Tree::Id generateGreaterThan(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
+
+    switch (frame.step) {
+    case 0:
+	return node.left;
 
-    cout << "#Time to do a GreaterThan calculation. amirite? <3 all y'all :) \n";
+    case 1:
+	return node.right;
+    }
+
+    assigntemp(node);
+
+    annotate("#Time to do a GreaterThan calculation. amirite? <3 all y'all :) \n");
 
-    if(_left->type().isReal()){
-	cout << "\tfldl\t" << _left << endl;
-	cout << "\tfcompl\t" << _right << endl;
-	cout << "\tfnstsw\t%ax\n";
-	cout << "\tsahf\n";
-	cout << "\tseta\t%al\n";
-	cout << "\tmovzbl\t%al, %eax\n";
-	cout << "\tmovl\t%eax, " << this << endl << endl;
+    if(tree.type(node.left).isReal()){
+	code->out << "\tfldl\t" << tree.operand(node.left) << '\n';
+	code->out << "\tfcompl\t" << tree.operand(node.right) << '\n';
+	code->out << "\tfnstsw\t%ax\n";
+	code->out << "\tsahf\n";
+	code->out << "\tseta\t%al\n";
+	code->out << "\tmovzbl\t%al, %eax\n";
+	code->out << "\tmovl\t%eax, " << node.operand << '\n' << '\n';
     }else{
-    	cout << "\tmovl\t" << _left << ", %eax\n";
-    	cout << "\tcmpl\t" << _right << ", %eax\n";
-    	cout << "\tsetg\t%al\n";
-    	cout << "\tmovzbl\t%al, %eax\n";
-    	cout << "\tmovl\t%eax, " << this << endl << endl;
+    	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+    	code->out << "\tcmpl\t" << tree.operand(node.right) << ", %eax\n";
+    	code->out << "\tsetg\t%al\n";
+    	code->out << "\tmovzbl\t%al, %eax\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n' << '\n';
     }
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	GreaterOrEqual::generate
+ * Function:	generateGreaterOrEqual
  *
  * Description:	Generate the Assembly code for the operator >=.
  *
  * I love you :) <3
  */
 
-void GreaterOrEqual::generate()
+static Tree::Id generateGreaterOrEqual(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
 
-    cout << "#Let us do all of the greater than or equal to operations! yes :)\n";
+    switch (frame.step) {
+    case 0:
+	return node.left;
 
+    case 1:
+	return node.right;
+    }
+
+    assigntemp(node);
+
+    annotate("#Let us do all of the greater than or equal to operations! yes :)\n");
 
-    if(_left->type().isReal()){
-	cout << "\tfldl\t" << _left << endl;
-	cout << "\tfcompl\t" << _right << endl;
-	cout << "\tfnstsw\t%ax\n";
-	cout << "\tsahf\n";
-	cout << "\tsetbe\t%al\n";
-	cout << "\tmovzbl\t%al, %eax\n";
-	cout << "\tmovl\t%eax, " << this << endl << endl;
+
+    if(tree.type(node.left).isReal()){
+	code->out << "\tfldl\t" << tree.operand(node.left) << '\n';
+	code->out << "\tfcompl\t" << tree.operand(node.right) << '\n';
+	code->out << "\tfnstsw\t%ax\n";
+	code->out << "\tsahf\n";
+	code->out << "\tsetbe\t%al\n";
+	code->out << "\tmovzbl\t%al, %eax\n";
+	code->out << "\tmovl\t%eax, " << node.operand << '\n' << '\n';
     }else{
-    	cout << "\tmovl\t" << _left << ", %eax\n";
-    	cout << "\tcmpl\t" << _right << ", %eax\n";
-    	cout << "\tsetle\t%al\n";
-    	cout << "\tmovzbl\t%al, %eax\n";
-    	cout << "\tmovl\t%eax, " << this << endl << endl;
+    	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+    	code->out << "\tcmpl\t" << tree.operand(node.right) << ", %eax\n";
+    	code->out << "\tsetle\t%al\n";
+    	code->out << "\tmovzbl\t%al, %eax\n";
+    	code->out << "\tmovl\t%eax, " << node.operand << '\n' << '\n';
     }
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	String::generate
+ * Function:	generateString
  *
  * Please help me... I'm trapped! :(
  *
  * Description:	I'm not actually sure what should happen here, so... yeah! :)
  */
 
-void String::generate()
+static void generateString(Tree::String &node)
 {
-    pair<map<string, Label>::iterator, bool> ret;
-    stringstream ss;
-    Label lab;
-    ret = Labels.insert(pair<string, Label>(_value, lab) );
-    if(ret.second){
-	ss << lab;
-    }else{
-	Label tempie = ret.first->second;
-	ss << tempie;
-    }
-    _operand = ss.str();
+    node.operand = Operand(Operand::LABEL, node.label);
 }
 
 /*
- * Function:	Remainder::generate
+ * Function:	generateRemainder
  *
  * Description:	Output the assembly language for Remainder (%).
  */
 
-void Remainder::generate()
+static Tree::Id generateRemainder(Tree &tree, Tree::Frame &frame)
 {
-    _left->generate();
-    _right->generate();
-    assigntemp(this);
+    Tree::Binary &node = tree.binary(frame.node);
+
+
+    switch (frame.step) {
+    case 0:
+	return node.left;
+
+    case 1:
+	return node.right;
+    }
+
+    assigntemp(node);
 
-    cout << "\n\t#Remainder time y'all! :) <3\n";
+    annotate("\n\t#Remainder time y'all! :) <3\n");
     
-    cout << "\tmovl\t" << _left << ", %eax\n";
-    cout << "\tcltd\n";
-    cout << "\tmovl\t" << _right << ", %ecx\n";
-    cout << "\tidivl\t%ecx\n";
-    cout << "\tmovl\t%edx, " << this << endl;
+    code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax\n";
+    code->out << "\tcltd\n";
+    code->out << "\tmovl\t" << tree.operand(node.right) << ", %ecx\n";
+    code->out << "\tidivl\t%ecx\n";
+    code->out << "\tmovl\t%edx, " << node.operand << '\n';
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	Negate::generate
+ * Function:	generateNegate
  *
  * Description:	output the assembly crapshitz for negating numberz. LBAH!
  */
 
-void Negate::generate()
+static Tree::Id generateNegate(Tree &tree, Tree::Frame &frame)
 {
-    _expr->generate();
-    assigntemp(this);
+    Tree::Unary &node = tree.unary(frame.node);
+
+
+    if (frame.step == 0)
+	return node.expr;
 
-    cout << "#all of the negationz <3 <3 <3 :) KSDFAJFKLDJSDFAKL\n";
+    assigntemp(node);
 
-    if(_type.isReal()){
+    annotate("#all of the negationz <3 <3 <3 :) KSDFAJFKLDJSDFAKL\n");
+
+    if(node.type.isReal()){
 	//how do I negate a real? just subtract it from 0! yeah! :)
-	cout << "\tfldl\t" << _expr << endl;
-	cout << "\tfchs\t\n";
-	cout << "\tfstpl\t" << this << endl;
+	code->out << "\tfldl\t" << tree.operand(node.expr) << '\n';
+	code->out << "\tfchs\t\n";
+	code->out << "\tfstpl\t" << node.operand << '\n';
     }else{
-	cout << "\tmovl\t" << _expr << ", %eax\n";
-	cout << "\tnegl\t%eax\n";
-	cout << "\tmovl\t%eax, " << this << endl;
+	code->out << "\tmovl\t" << tree.operand(node.expr) << ", %eax\n";
+	code->out << "\tnegl\t%eax\n";
+	code->out << "\tmovl\t%eax, " << node.operand << '\n';
     }
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	Address::generate
+ * Function:	generateAddress
  *
- * Description:	Get the Address of an Array :)
+ * Description:	Get the Address of an Array :)  The address of a
+ *		dereference is just the pointer, so that is all we
+ *		generate.
  */
 
-void Address::generate()
+static Tree::Id generateAddress(Tree &tree, Tree::Frame &frame)
 {
-    bool indirect;
-    _expr->generate(indirect);
+    Tree::Unary &node = tree.unary(frame.node);
+    bool indirect = Tree::kind(node.expr) == Tree::DEREFERENCE_EXPR;
+    Tree::Id pointer = Tree::NONE;
+
+    if (indirect)
+	pointer = tree.unary(node.expr).expr;
+
+    if (frame.step == 0)
+	return indirect ? pointer : node.expr;
+
+    if (indirect)
+	tree.expression(node.expr).operand = tree.operand(pointer);
 
     if(!indirect)
     {
-	if(_expr->operand()[0] == '.')
+	if(tree.operand(node.expr).isLabel())
 	{
-	    stringstream ss;
-	    ss << "$" << _expr->operand();
-	    _operand = ss.str();
+	    node.operand = tree.operand(node.expr).address();
 	}
 	else
 	{
-	    assigntemp(this);
-    	    cout << "#time to ADDRESS THINGS TO THINGS AND OH MY GOODINESS!\n";
-    	    cout << "\tleal\t" << _expr << ", %eax\n";
-    	    cout << "\tmovl\t%eax, " << this << endl;
+	    assigntemp(node);
+    	    annotate("#time to ADDRESS THINGS TO THINGS AND OH MY GOODINESS!\n");
+    	    code->out << "\tleal\t" << tree.operand(node.expr) << ", %eax\n";
+    	    code->out << "\tmovl\t%eax, " << node.operand << '\n';
 	}
     }
-    else _operand = _expr->operand();
+    else node.operand = tree.operand(node.expr);
+
+    return Tree::NONE;
 }
 
 /*
- * Function:	Expression::generate
+ * Function:	generateDereference
  *
- * Description:	Let's me know that I have not written this... xD
+ * Description:	Wheeeee the other thing.
  */
 
-void Expression::generate()
+static Tree::Id generateDereference(Tree &tree, Tree::Frame &frame)
 {
-    cerr << "woopsiez!\n";
-}
+    Tree::Unary &node = tree.unary(frame.node);
 
-/*
- * Function:	Expression::generate(bool &indirect)
- *
- * Description:	Makes things work well :)
- */
 
-void Expression::generate(bool &indirect)
-{
-    indirect = false;
-    generate();
-}
+    if (frame.step == 0)
+	return node.expr;
 
-/*
- * Function:	Dereference::generate(bool &indirect)
- *
- * Description:	Makes bools happen well xD (I don't know don't ask me AHHHHH)
- */
+    assigntemp(node);
+    annotate("#Dereferencing this here expression\n");
+    if(node.type.isReal()){
+	code->out << "\tmovl\t" << tree.operand(node.expr) << ", %eax\n";
+	code->out << "\tfldl\t(%eax)\n";
+	code->out << "\tfstpl\t" << node.operand << '\n';
+    }else{
+	code->out << "\tmovl\t" << tree.operand(node.expr) << ", %eax\n";
+	code->out << "\tmovl\t(%eax), %eax\n";
+	code->out << "\tmovl\t%eax, " << node.operand << '\n';
+    }
 
-void Dereference::generate(bool &indirect)
-{
-    indirect = true;
-    _expr->generate();
-    _operand = _expr->operand();
+    return Tree::NONE;
 }
 
 /*
- * Function:	Dereference::generate()
+ * Function:	generateReturn
  *
- * Description:	Wheeeee the other thing.
+ * Description:	Put the return value into the right register, in assembly language. Yeah.
  */
 
-void Dereference::generate()
+static Tree::Id generateReturn(Tree &tree, Tree::Frame &frame)
 {
-    _expr->generate();
-    assigntemp(this);
-    cout << "#Dereferencing this here expression\n";
-    if(_type.isReal()){
-	cout << "\tmovl\t" << _expr << ", %eax\n";
-	cout << "\tfldl\t(%eax)\n";
-	cout << "\tfstpl\t" << this << endl;
+    Tree::Return &node = tree.returnStmt(frame.node);
+
+
+    if (frame.step == 0)
+	return node.expr;
+
+    if(tree.type(node.expr).isReal()){
+	code->out << "\tfldl\t" << tree.operand(node.expr) << '\n';
     }else{
-	cout << "\tmovl\t" << _expr << ", %eax\n";
-	cout << "\tmovl\t(%eax), %eax\n";
-	cout << "\tmovl\t%eax, " << this << endl;
+    	code->out << "\tmovl\t" << tree.operand(node.expr) << ", %eax\n";
     }
+    code->out << "\tjmp\t" << code->returnLab << '\n';
+    return Tree::NONE;
 }
 
 /*
- * Function:	Dereference::isPoint
+ * Function: 	generateIf
  *
- * Description:	Return true.
+ * Description:	Generate the assembly language code for an IF statement.
+ *		The labels are made once the test is generated, and kept
+ *		in our frame until the statements are.
  */
 
-bool Dereference::isPoint()
+static Tree::Id generateIf(Tree &tree, Tree::Frame &frame)
 {
-    return true;
+    Tree::If &node = tree.ifStmt(frame.node);
+
+
+    switch (frame.step) {
+    case 0:
+	return node.expr;
+
+    case 1: {
+	Label skip, lou;
+	frame.labels[0] = skip.number;
+	frame.labels[1] = lou.number;
+	annotate("#iffin and iffin and yeah! C> ice cream! C>\n");
+	code->out << "\tmovl\t" << tree.operand(node.expr) << ", %eax" << '\n';
+	code->out << "\ttestl\t%eax, %eax\n";
+	code->out << "\tje\t" << skip << '\n';
+	return node.thenStmt;
+    }
+
+    case 2:
+	if(node.elseStmt != Tree::NONE){
+	    code->out << "\tjmp\t" << Label(frame.labels[1]) << '\n';
+	    code->out << Label(frame.labels[0]) << ":\n";
+	    return node.elseStmt;
+	}else{
+	    code->out << Label(frame.labels[0]) << ":\n";
+	    return Tree::NONE;
+	}
+    }
+
+    code->out << Label(frame.labels[1]) << ":\n";
+    return Tree::NONE;
 }
 
 /*
- * Function:	Expression::isPoint
+ * Function:	generateLogicalAnd
  *
- * Description:	Return false.
+ * Description:	Generate assembly for LogicalAnd
  */
 
-bool Expression::isPoint()
+static Tree::Id generateLogicalAnd(Tree &tree, Tree::Frame &frame)
 {
-    return false;
-}
+    Tree::Binary &node = tree.binary(frame.node);
+
+
+    switch (frame.step) {
+    case 0:
+	annotate("#all of the logical, AND THEN scream for all the ice and cream C> C> C> C> C> \n");
+	return node.left;
+
+    case 1: {
+	assigntemp(node);
+	Label lab;
+	frame.labels[0] = lab.number;
+	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax" << '\n';
+	code->out << "\ttestl\t%eax, %eax\n";
+	code->out << "\tje\t" << lab << '\n';
+	return node.right;
+    }
+    }
+
+    code->out << "\tmovl\t" << tree.operand(node.right) << ", %eax" << '\n';
+    code->out << "\ttestl\t%eax, %eax\n";
+    code->out << Label(frame.labels[0]) << ":\n";
+    code->out << "\tsetne\t%al\n";
+    code->out << "\tmovzbl\t%al, %eax\n";
+    code->out << "\tmovl\t%eax, " << node.operand << '\n';
+    return Tree::NONE;
+} 
 
 /*
- * Function:	Return::generate()
+ * Function:	generateLogicalOr
  *
- * Description:	Put the return value into the right register, in assembly language. Yeah.
+ * Description:	Generate assembly code for LogicalOr
  */
 
-void Return::generate()
+static Tree::Id generateLogicalOr(Tree &tree, Tree::Frame &frame)
 {
-    _expr->generate();
-    if(_expr->type().isReal()){
-	cout << "\tfldl\t" << _expr << endl;
-    }else{
-    	cout << "\tmovl\t" << _expr << ", %eax\n";
+    Tree::Binary &node = tree.binary(frame.node);
+
+
+    switch (frame.step) {
+    case 0:
+	annotate("#all of the logical, or scream for all the ice and cream C> C> C> C> C> \n");
+	return node.left;
+
+    case 1: {
+	assigntemp(node);
+	Label lab;
+	frame.labels[0] = lab.number;
+	code->out << "\tmovl\t" << tree.operand(node.left) << ", %eax" << '\n';
+	code->out << "\ttestl\t%eax, %eax\n";
+	code->out << "\tjne\t" << lab << '\n';
+	return node.right;
+    }
     }
-    cout << "\tjmp\t" << returnLab << endl;
-}
+
+    code->out << "\tmovl\t" << tree.operand(node.right) << ", %eax" << '\n';
+    code->out << "\ttestl\t%eax, %eax\n";
+    code->out << Label(frame.labels[0]) << ":\n";
+    code->out << "\tsetne\t%al\n";
+    code->out << "\tmovzbl\t%al, %eax\n";
+    code->out << "\tmovl\t%eax, " << node.operand << '\n';
+    return Tree::NONE;
+} 
 
 /*
- * Function: 	If::generate
+ * Function:	generateWhile
  *
- * Description:	Generate the assembly language code for an IF statement.
+ * Description:	Generate assembly frab for While loops :) <3
  */
 
-void If::generate()
-{
-    _expr->generate();
-    Label skip, lou;
-    cout << "#iffin and iffin and yeah! C> ice cream! C>\n";
-    cout << "\tmovl\t" << _expr << ", %eax" << endl;
-    cout << "\ttestl\t%eax, %eax\n";
-    cout << "\tje\t" << skip << endl;
-    _thenStmt->generate();
-    if(_elseStmt != nullptr){
-	cout << "\tjmp\t" << lou << endl;
-	cout << skip << ":\n";
-	_elseStmt->generate();
-	cout << lou << ":\n";
-    }else{
-    	cout << skip << ":\n";
+static Tree::Id generateWhile(Tree &tree, Tree::Frame &frame)
+{
+    Tree::While &node = tree.whileStmt(frame.node);
+
+
+    switch (frame.step) {
+    case 0: {
+	annotate("#while time! and i scream for all the ice and cream C> C> C> C> C> \n");
+	Label loop, exit;
+	frame.labels[0] = loop.number;
+	frame.labels[1] = exit.number;
+	code->out << loop << ":\n";
+	return node.expr;
     }
 
+    case 1:
+	code->out << "\tmovl\t" << tree.operand(node.expr) << ", %eax" << '\n';
+	code->out << "\ttestl\t%eax, %eax\n";
+	code->out << "\tje\t" << Label(frame.labels[1]) << '\n';
+	return node.stmt;
+    }
+
+    code->out << "\tjmp\t" << Label(frame.labels[0]) << '\n';
+    code->out << Label(frame.labels[1]) << ":\n";
+    return Tree::NONE;
 }
 
+
 /*
- * Function:	LogicalAnd::generate
+ * Function:	resume
  *
- * Description:	Generate assembly for LogicalAnd
+ * Description:	Take the next step in generating code for the node of the
+ *		given frame by calling the generate function for whatever
+ *		kind of node it is.  Return the child to generate before
+ *		the next step, if any.  Literals and identifiers have no
+ *		children, so they are done in one step.
  */
 
-void LogicalAnd::generate()
-{
-    cout << "#all of the logical, AND THEN scream for all the ice and cream C> C> C> C> C> \n";
-    _left->generate();
-    assigntemp(this);
-    Label lab;
-    cout << "\tmovl\t" << _left << ", %eax" << endl;
-    cout << "\ttestl\t%eax, %eax\n";
-    cout << "\tje\t" << lab << endl;
-    _right->generate();
-    cout << "\tmovl\t" << _right << ", %eax" << endl;
-    cout << "\ttestl\t%eax, %eax\n";
-    cout << lab << ":\n";
-    cout << "\tsetne\t%al\n";
-    cout << "\tmovzbl\t%al, %eax\n";
-    cout << "\tmovl\t%eax, " << this << endl;
-} 
+static Tree::Id resume(Tree &tree, Tree::Frame &frame)
+{
+    Tree::Id node = frame.node;
 
-/*
- * Function:	LogicalOr::generate
- *
- * Description:	Generate assembly code for LogicalOr
- */
+    switch (Tree::kind(node)) {
+    case Tree::FUNCTION_DEF:
+	return generateFunction(tree, frame);
+
+    case Tree::BLOCK_STMT:
+	return generateBlock(tree, frame);
+
+    case Tree::IF_STMT:
+	return generateIf(tree, frame);
+
+    case Tree::RETURN_STMT:
+	return generateReturn(tree, frame);
+
+    case Tree::WHILE_STMT:
+	return generateWhile(tree, frame);
+
+    case Tree::ADD_EXPR:
+	return generateAdd(tree, frame);
+
+    case Tree::ADDRESS_EXPR:
+	return generateAddress(tree, frame);
+
+    case Tree::ASSIGN_EXPR:
+	return generateAssign(tree, frame);
+
+    case Tree::CALL_EXPR:
+	return generateCall(tree, frame);
+
+    case Tree::CAST_EXPR:
+	return generateCast(tree, frame);
+
+    case Tree::DEREFERENCE_EXPR:
+	return generateDereference(tree, frame);
+
+    case Tree::DIVIDE_EXPR:
+	return generateDivide(tree, frame);
+
+    case Tree::EQUAL_EXPR:
+	return generateEqual(tree, frame);
+
+    case Tree::GREATER_OR_EQUAL_EXPR:
+	return generateGreaterOrEqual(tree, frame);
+
+    case Tree::GREATER_THAN_EXPR:
+	return generateGreaterThan(tree, frame);
+
+    case Tree::IDENTIFIER_EXPR:
+	generateIdentifier(tree.identifier(node));
+	break;
+
+    case Tree::INTEGER_EXPR:
+	generateInteger(tree, tree.integer(node));
+	break;
+
+    case Tree::LESS_OR_EQUAL_EXPR:
+	return generateLessOrEqual(tree, frame);
+
+    case Tree::LESS_THAN_EXPR:
+	return generateLessThan(tree, frame);
+
+    case Tree::LOGICAL_AND_EXPR:
+	return generateLogicalAnd(tree, frame);
+
+    case Tree::LOGICAL_OR_EXPR:
+	return generateLogicalOr(tree, frame);
+
+    case Tree::MULTIPLY_EXPR:
+	return generateMultiply(tree, frame);
+
+    case Tree::NEGATE_EXPR:
+	return generateNegate(tree, frame);
+
+    case Tree::NOT_EQUAL_EXPR:
+	return generateNotEqual(tree, frame);
+
+    case Tree::NOT_EXPR:
+	return generateNot(tree, frame);
+
+    case Tree::REAL_EXPR:
+	generateReal(tree.real(node));
+	break;
+
+    case Tree::REMAINDER_EXPR:
+	return generateRemainder(tree, frame);
+
+    case Tree::STRING_EXPR:
+	generateString(tree.string(node));
+	break;
+
+    case Tree::SUBTRACT_EXPR:
+	return generateSubtract(tree, frame);
+    }
+
+    return Tree::NONE;
+}
 
-void LogicalOr::generate()
-{
-    cout << "#all of the logical, or scream for all the ice and cream C> C> C> C> C> \n";
-    _left->generate();
-    assigntemp(this);
-    Label lab;
-    cout << "\tmovl\t" << _left << ", %eax" << endl;
-    cout << "\ttestl\t%eax, %eax\n";
-    cout << "\tjne\t" << lab << endl;
-    _right->generate();
-    cout << "\tmovl\t" << _right << ", %eax" << endl;
-    cout << "\ttestl\t%eax, %eax\n";
-    cout << lab << ":\n";
-    cout << "\tsetne\t%al\n";
-    cout << "\tmovzbl\t%al, %eax\n";
-    cout << "\tmovl\t%eax, " << this << endl;
-} 
 
 /*
- * Function:	While::generate
+ * Function:	Tree::generate
  *
- * Description:	Generate assembly frab for While loops :) <3
+ * Description:	Generate code for the given node.  Rather than recursing,
+ *		we keep a stack of frames for the nodes whose code is
+ *		partly generated, and keep taking the next step of the one
+ *		on top, pushing whatever child it asks for, until every
+ *		node is done.  Each thread keeps its stack from one call
+ *		to the next, so its memory is only allocated once.
  */
 
-void While::generate()
+void Tree::generate(Id node)
 {
-    cout << "#while time! and i scream for all the ice and cream C> C> C> C> C> \n";
-    Label loop, exit;
-    cout << loop << ":\n";
-    _expr->generate();
-    cout << "\tmovl\t" << _expr << ", %eax" << endl;
-    cout << "\ttestl\t%eax, %eax\n";
-    cout << "\tje\t" << exit << endl;
-    _stmt->generate();
-    cout << "\tjmp\t" << loop << endl;
-    cout << exit << ":\n";
+    static thread_local vector<Frame> frames;
+    Id child;
+
+
+    frames.push_back(Frame {node, 0, {0, 0}});
+
+    while (!frames.empty()) {
+	child = resume(*this, frames.back());
+	frames.back().step ++;
+
+	if (child != NONE)
+	    frames.push_back(Frame {child, 0, {0, 0}});
+	else
+	    frames.pop_back();
+    }
 }
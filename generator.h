@@ -2,14 +2,57 @@
  * File:	generator.h
  *
  * Description:	This file contains the function declarations for the code
- *		generator for Simple C.  Most of the function declarations
- *		are actually member functions provided as part of Tree.h.
+ *		generator for Simple C.  Generating the code of a tree is
+ *		itself a member function provided as part of Tree.h.
+ *
+ *		Each function definition is generated on its own, into a
+ *		buffer of its own, once it has been parsed and checked.
+ *		Its labels are numbered within the function and qualified
+ *		by its name, so the functions of a unit can be generated
+ *		concurrently by a pool of threads and still come out the
+ *		same.  Their code is written out in the order they were
+ *		defined.  The code of a function that has been given an
+ *		entry in the cache of its unit is stored there as well,
+ *		and code fetched from the cache is spliced in among the
+ *		rest.
  */
 
 # ifndef GENERATOR_H
 # define GENERATOR_H
+# include <sstream>
+# include "Arena.h"
+# include "Cache.h"
 # include "Tree.h"
 
+enum { ANNOTATE_NONE, ANNOTATE_LINES, ANNOTATE_VERBOSE };
+
+struct Label {
+    int number;
+    Label();
+    explicit Label(int n) : number(n) {}
+};
+
+struct FunctionCode {
+    Tree tree;
+    Arena arena;
+    const std::string *name;
+    std::stringbuf text;
+    std::ostream out;
+    int tempoffset, minoffset, maxoffset;
+    int labels;
+    Label returnLab;
+    CacheEntry entry;
+    bool done;
+
+    FunctionCode() : name(nullptr), out(&text),
+	tempoffset(0), minoffset(0), maxoffset(0), labels(0),
+	returnLab(0), done(false) {}
+};
+
+FunctionCode *openFunction();
+void closeFunction(FunctionCode *code, Tree::Id function);
+void spliceFunction(const std::string &text);
+void flushFunctions();
 void generateGlobals(const Symbols &globals);
 
 # endif /* GENERATOR_H */
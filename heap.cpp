@@ -0,0 +1,100 @@
+/*
+ * File:	heap.cpp
+ *
+ * Description:	This file contains the replacement global allocation
+ *		functions, which count each allocation from the heap
+ *		before handing it to malloc().  The counter is shared by
+ *		all threads, but nobody waits on it.
+ */
+
+# include <atomic>
+# include <cstdlib>
+# include <new>
+# include "heap.h"
+
+using namespace std;
+
+static atomic<unsigned long> counter(0);
+
+
+/*
+ * Function:	operator new
+ *
+ * Description:	Allocate the given number of bytes from the heap, and
+ *		count the allocation.  As the standard requires, we call
+ *		the new handler until the memory is available, and throw
+ *		if there is none.
+ */
+
+void *operator new(size_t size)
+{
+    void *p;
+
+
+    counter.fetch_add(1, memory_order_relaxed);
+
+    while ((p = malloc(size > 0 ? size : 1)) == nullptr) {
+	new_handler handler = get_new_handler();
+
+	if (handler == nullptr)
+	    throw bad_alloc();
+
+	handler();
+    }
+
+    return p;
+}
+
+
+/*
+ * Function:	operator new[]
+ *
+ * Description:	Allocate the given number of bytes for an array.
+ */
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+
+/*
+ * Function:	operator delete
+ *
+ * Description:	Return memory allocated by operator new to the heap.  We
+ *		replace every form, sized or not, so that none of them
+ *		can end up in a different allocator than ours.
+ */
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+    free(p);
+}
+
+
+/*
+ * Function:	allocations
+ *
+ * Description:	Return the number of allocations made from the heap so
+ *		far.
+ */
+
+unsigned long allocations()
+{
+    return counter.load(memory_order_relaxed);
+}
@@ -0,0 +1,17 @@
+/*
+ * File:	heap.h
+ *
+ * Description:	This file contains the function declarations for keeping
+ *		count of how often the compiler uses the heap.  Every
+ *		allocation with new, including those made by the standard
+ *		containers, goes through the replacement global allocation
+ *		functions, which count them, so we can tell how much we
+ *		allocate for each node of the tree.
+ */
+
+# ifndef HEAP_H
+# define HEAP_H
+
+unsigned long allocations();
+
+# endif /* HEAP_H */
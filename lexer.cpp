@@ -3,28 +3,104 @@
  *
  * Description:	This file contains the public and private function and
  *		variable definitions for the lexical analyzer for Simple C.
+ *
+ *		Extra functionality:
+ *		- lexing the whole source, which is already in memory, at
+ *		  once and handing out lexemes as views into that buffer
+ *		  rather than copying them character by character
+ *		- table-driven character classification, skipping runs of
+ *		  white space, comments, and identifiers sixteen characters
+ *		  at a time, and a perfect hash for the keywords
+ *		- tokenizing large buffers in parallel
+ *		- tokenizing only what an edit changed
  */
 
 # include <cstdio>
+# include <cstdlib>
 # include <string>
+# include <vector>
 # include <iostream>
-# include <ctype.h>
+# include <algorithm>
+# include <cstring>
+# ifdef __SSE2__
+# include <emmintrin.h>
+# endif
 # include "lexer.h"
 # include "tokens.h"
+# include "ThreadPool.h"
+# include "Interner.h"
+# include "CompilerContext.h"
+# include "Profile.h"
 
 using namespace std;
 
-int numErrors = 0;
-static int lineno = 1;
+/* The state of a scan is kept in its own structure rather than in
+   globals, so that several parts of the buffer can be scanned at once.
+   The limit is always the end of the buffer, since a token (or more
+   likely a comment) can run past the end of the part being scanned.
+   We note whether a token has been scanned yet, since a # is only a
+   token when it is the first on its line. */
+
+struct Scanner {
+    const char *cursor, *start, *limit;
+    unsigned line;
+    bool scanned;
+    TokenStream *tokens;
+};
+
+
+# define MIN_CHUNK	(256 * 1024)
+# define MAX_SEARCH	(64 * 1024)
 
 
-/* Yes, we could have used a map, but we'd probably initialize it with an
-   array anyway, and let's face it, it's pretty simple to search an array. */
+/* Character classes.  The table is indexed by a character plus one, so
+   that EOF (which is -1) can be classified like any other character
+   without a separate test.  The classes agree with isspace(), isalpha(),
+   and isdigit() in the C locale, except that an underscore is a letter. */
+
+enum { SPACE = 1, LETTER = 2, DIGIT = 4 };
+
+struct ClassTable {
+    unsigned char bits[257];
+};
+
+static constexpr ClassTable makeClassTable()
+{
+    ClassTable table = {};
+
+    for (int c = 0; c < 256; c ++) {
+	if (c == ' ' || (c >= '\t' && c <= '\r'))
+	    table.bits[c + 1] |= SPACE;
+
+	if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_')
+	    table.bits[c + 1] |= LETTER;
+
+	if (c >= '0' && c <= '9')
+	    table.bits[c + 1] |= DIGIT;
+    }
 
-static struct {
-    string lexeme;
+    return table;
+}
+
+static constexpr ClassTable classes = makeClassTable();
+
+# define isSpace(c)	(classes.bits[(c) + 1] & SPACE)
+# define isLetter(c)	(classes.bits[(c) + 1] & LETTER)
+# define isDigit(c)	(classes.bits[(c) + 1] & DIGIT)
+# define isWord(c)	(classes.bits[(c) + 1] & (LETTER | DIGIT))
+
+
+/* Keywords are found with a perfect hash over the first, second, and last
+   characters and the length.  The multipliers came from a brute-force
+   search; if the keywords ever change so that two of them collide, the
+   table below will simply fail to compile. */
+
+struct Keyword {
+    const char *lexeme;
     int token;
-} keywords[] = {
+};
+
+static constexpr Keyword keywords[] = {
     {"auto",     AUTO},
     {"break",    BREAK},
     {"case",     CASE},
@@ -60,16 +136,63 @@ static struct {
 };
 
 # define numKeywords (sizeof(keywords) / sizeof(keywords[0]))
+# define MIN_KEYWORD 2
+# define MAX_KEYWORD 8
+
+static constexpr unsigned lengthOf(const char *s)
+{
+    unsigned n = 0;
+
+    while (s[n] != 0)
+	n ++;
+
+    return n;
+}
+
+static constexpr unsigned hashKeyword(const char *s, unsigned n)
+{
+    return (12 * (unsigned char) s[0] + 2 * (unsigned char) s[1] +
+	    21 * (unsigned char) s[n - 1] + n) & 63;
+}
+
+struct KeywordTable {
+    signed char index[64];
+    unsigned char length[numKeywords];
+};
+
+static constexpr KeywordTable makeKeywordTable()
+{
+    KeywordTable table = {};
+
+    for (unsigned i = 0; i < 64; i ++)
+	table.index[i] = -1;
+
+    for (unsigned i = 0; i < numKeywords; i ++) {
+	unsigned n = lengthOf(keywords[i].lexeme);
+	unsigned h = hashKeyword(keywords[i].lexeme, n);
+
+	if (table.index[h] != -1 || n < MIN_KEYWORD || n > MAX_KEYWORD)
+	    throw "keyword hash is not perfect";
+
+	table.index[h] = i;
+	table.length[i] = n;
+    }
+
+    return table;
+}
+
+static constexpr KeywordTable keywordTable = makeKeywordTable();
 
 
 /*
  * Function:	report
  *
- * Description:	Report an error to the standard error prefixed with the
- *		line number.  We'll be using this a lot later with an
- *		optional string argument, but C++'s stupid streams don't do
- *		positional arguments, so we actually resort to snprintf.
- *		You just can't beat C for doing things down and dirty.
+ * Description:	Report an error to the diagnostics of the current context
+ *		prefixed with the line number.  We'll be using this a lot
+ *		later with an optional string argument, but C++'s stupid
+ *		streams don't do positional arguments, so we actually
+ *		resort to snprintf.  You just can't beat C for doing things
+ *		down and dirty.
  */
 
 void report(const string &str, const string &arg)
@@ -77,96 +200,397 @@ void report(const string &str, const string &arg)
     char buf[1000];
 
     snprintf(buf, sizeof(buf), str.c_str(), arg.c_str());
-    cerr << "line " << lineno << ": " << buf << endl;
-    numErrors ++;
+    context->diagnostics << "line " << context->lineno << ": ";
+    context->diagnostics << buf << endl;
+    context->numErrors ++;
+}
+
+
+/*
+ * Function:	Lexeme::Lexeme (constructor)
+ *
+ * Description:	Initialize this lexeme as a view of LENGTH characters
+ *		starting at OFFSET in the source buffer.
+ */
+
+Lexeme::Lexeme(unsigned offset, unsigned length)
+    : _offset(offset), _length(length)
+{
 }
 
 
 /*
- * Function:	lexan
+ * Function:	Lexeme::data (accessor)
  *
- * Description:	Read and tokenize the standard input stream.  The lexeme is
- *		stored in a buffer.
+ * Description:	Return a pointer to the first character of this lexeme.
+ *		The characters are not null-terminated.
  */
 
-int lexan(string &lexbuf)
+const char *Lexeme::data() const
 {
+    const TokenStream &tokens = context->tokens;
     unsigned i;
-    static int c = cin.get();
 
 
-    /* The invariant here is that the next character has already been read
-       and is ready to be classified.  In this way, we eliminate having to
-       push back characters onto the stream, merely to read them again. */
+    if (tokens.bases.empty() || _offset < tokens.bases[0])
+	return context->source + _offset;
 
-    while (!cin.eof()) {
-	lexbuf.clear();
+    i = upper_bound(tokens.bases.begin(), tokens.bases.end(), _offset) -
+	tokens.bases.begin() - 1;
+    return tokens.buffers[i] + (_offset - tokens.bases[i]);
+}
 
 
-	/* Ignore white space */
+/*
+ * Function:	Lexeme::offset (accessor)
+ *
+ * Description:	Return the offset of this lexeme in the source buffer,
+ *		or past its end if it is in an included header.
+ */
+
+unsigned Lexeme::offset() const
+{
+    return _offset;
+}
+
+
+/*
+ * Function:	Lexeme::length (accessor)
+ *
+ * Description:	Return the number of characters in this lexeme.
+ */
+
+unsigned Lexeme::length() const
+{
+    return _length;
+}
+
+
+/*
+ * Function:	Lexeme::str
+ *
+ * Description:	Return a copy of this lexeme as a string.  This is the
+ *		only place the characters of a lexeme are ever copied.
+ */
+
+string Lexeme::str() const
+{
+    return string(data(), _length);
+}
+
+
+/*
+ * Function:	complain
+ *
+ * Description:	Record a lexical error against the token being scanned.
+ *		The parser reports it when it reaches that token, so the
+ *		errors still come out in the same order as if we had been
+ *		lexing on demand.
+ */
+
+static void complain(Scanner &s, const char *message)
+{
+    LexicalError error;
+
+
+    error.token = s.tokens->kind.size();
+    error.message = message;
+    s.tokens->errors.push_back(error);
+}
+
+
+/*
+ * Function:	advance
+ *
+ * Description:	Move past the current character and return the next one,
+ *		or EOF if we have run off the end of the buffer.
+ */
+
+static inline int advance(Scanner &s)
+{
+    if (s.cursor < s.limit)
+	s.cursor ++;
+
+    return s.cursor < s.limit ? (unsigned char) *s.cursor : EOF;
+}
+
+
+/*
+ * Function:	current
+ *
+ * Description:	Return the character under the cursor, or EOF.
+ */
 
-	while (isspace(c)) {
-	    if (c == '\n')
-		lineno ++;
+static inline int current(Scanner &s)
+{
+    return s.cursor < s.limit ? (unsigned char) *s.cursor : EOF;
+}
+
+
+/*
+ * Function:	keyword
+ *
+ * Description:	Return the token for the keyword spelled by the N
+ *		characters at S, or ID if they don't spell a keyword.  Only
+ *		a single comparison is ever needed.
+ */
+
+static int keyword(const char *s, unsigned n)
+{
+    int i;
+
+
+    if (n < MIN_KEYWORD || n > MAX_KEYWORD)
+	return ID;
+
+    i = keywordTable.index[hashKeyword(s, n)];
+
+    if (i < 0 || keywordTable.length[i] != n)
+	return ID;
+
+    return memcmp(keywords[i].lexeme, s, n) == 0 ? keywords[i].token : ID;
+}
+
+
+# ifdef __SSE2__
+
+/* With SSE2 we classify sixteen characters at a time.  There are no
+   unsigned byte comparisons, so a range test lo <= c <= hi is done by
+   biasing c so that lo lands on -128 and comparing against the biased
+   upper bound. */
+
+static inline __m128i inRange(__m128i v, char lo, char hi)
+{
+    __m128i t = _mm_add_epi8(v, _mm_set1_epi8((char) (-128 - lo)));
+    return _mm_cmplt_epi8(t, _mm_set1_epi8((char) (-128 + hi - lo + 1)));
+}
+
+static inline unsigned lines(__m128i v, unsigned mask)
+{
+    unsigned nl = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    return __builtin_popcount(nl & mask);
+}
+
+# endif
 
-	    c = cin.get();
+
+/*
+ * Function:	skipSpace
+ *
+ * Description:	Move the cursor past any white space, counting lines as we
+ *		go.
+ */
+
+static void skipSpace(Scanner &s)
+{
+# ifdef __SSE2__
+    while (s.limit - s.cursor >= 16) {
+	__m128i v = _mm_loadu_si128((const __m128i *) s.cursor);
+	__m128i sp = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+				  inRange(v, '\t', '\r'));
+	unsigned mask = _mm_movemask_epi8(sp);
+
+	if (mask != 0xffff) {
+	    unsigned n = __builtin_ctz(~mask);
+	    s.line += lines(v, (1u << n) - 1);
+	    s.cursor += n;
+	    return;
 	}
 
+	s.line += lines(v, 0xffff);
+	s.cursor += 16;
+    }
+# endif
+
+    while (s.cursor < s.limit && isSpace((unsigned char) *s.cursor)) {
+	if (*s.cursor == '\n')
+	    s.line ++;
+
+	s.cursor ++;
+    }
+}
 
-	/* Check for an identifier or a keyword */
 
-	if (isalpha(c) || c == '_') {
-	    do {
-		lexbuf += c;
-		c = cin.get();
-	    } while (isalnum(c) || c == '_');
+/*
+ * Function:	skipWord
+ *
+ * Description:	Move the cursor past any letters, digits, and underscores.
+ */
+
+static void skipWord(Scanner &s)
+{
+# ifdef __SSE2__
+    while (s.limit - s.cursor >= 16) {
+	__m128i v = _mm_loadu_si128((const __m128i *) s.cursor);
+	__m128i w = _mm_or_si128(inRange(v, '0', '9'),
+				 _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+	w = _mm_or_si128(w, inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+				    'a', 'z'));
+	unsigned mask = _mm_movemask_epi8(w);
+
+	if (mask != 0xffff) {
+	    s.cursor += __builtin_ctz(~mask);
+	    return;
+	}
 
-	    for (i = 0; i < numKeywords; i ++)
-		if (keywords[i].lexeme == lexbuf)
-		    return keywords[i].token;
+	s.cursor += 16;
+    }
+# endif
+
+    while (s.cursor < s.limit && isWord((unsigned char) *s.cursor))
+	s.cursor ++;
+}
+
+
+/*
+ * Function:	skipComment
+ *
+ * Description:	Move the cursor past the end of a comment, which is the
+ *		first "*" "/" pair at or after the cursor, counting lines
+ *		as we go.  An unterminated comment runs to the end.
+ */
+
+static void skipComment(Scanner &s)
+{
+# ifdef __SSE2__
+    while (s.limit - s.cursor >= 16) {
+	__m128i v = _mm_loadu_si128((const __m128i *) s.cursor);
+	unsigned stars = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('*')));
+
+	while (stars != 0) {
+	    unsigned n = __builtin_ctz(stars);
+
+	    if (s.cursor + n + 1 < s.limit && s.cursor[n + 1] == '/') {
+		s.line += lines(v, (1u << n) - 1);
+		s.cursor += n + 2;
+		return;
+	    }
+
+	    stars &= stars - 1;
+	}
+
+	s.line += lines(v, 0xffff);
+	s.cursor += 16;
+    }
+# endif
+
+    while (s.cursor < s.limit) {
+	if (*s.cursor == '*' && s.cursor + 1 < s.limit && s.cursor[1] == '/') {
+	    s.cursor += 2;
+	    return;
+	}
+
+	if (*s.cursor == '\n')
+	    s.line ++;
+
+	s.cursor ++;
+    }
+}
+
+
+/*
+ * Function:	checkInteger
+ *
+ * Description:	Check the integer constant just scanned.  One with a
+ *		leading zero is octal, and so may not contain an 8 or a 9,
+ *		and no constant may be too large for an unsigned int.
+ */
+
+static void checkInteger(Scanner &s)
+{
+    unsigned long value = 0, base = *s.start == '0' ? 8 : 10;
+
+
+    for (const char *p = s.start; p < s.cursor; p ++) {
+	if ((unsigned long) (*p - '0') >= base) {
+	    complain(s, "invalid digit in octal constant");
+	    return;
+	}
+
+	value = value * base + (*p - '0');
+
+	if (value > 0xffffffff) {
+	    complain(s, "integer constant is too large");
+	    return;
+	}
+    }
+}
+
+
+/*
+ * Function:	scan
+ *
+ * Description:	Scan the next token from the source buffer, leaving START
+ *		at its first character and the cursor just past its last.
+ *		A # is only a token if no token comes before it on its
+ *		line.
+ */
+
+static int scan(Scanner &s)
+{
+    unsigned line = s.line;
+    bool follows = s.scanned;
+    int c;
+
+
+    s.scanned = true;
+
+    /* The invariant here is that the cursor is on the next character,
+       which is ready to be classified.  In this way, we eliminate having
+       to back up, merely to read characters again. */
+
+    while (s.cursor < s.limit) {
+
+
+	/* Ignore white space */
+
+	skipSpace(s);
+	s.start = s.cursor;
+	c = current(s);
+
+
+	/* Check for an identifier or a keyword */
 
-	    return ID;
+	if (isLetter(c)) {
+	    s.cursor ++;
+	    skipWord(s);
+	    return keyword(s.start, s.cursor - s.start);
 
 
 	/* Check for a number (integer or real). */
 
-	} else if (isdigit(c)) {
-	    do {
-		lexbuf += c;
-		c = cin.get();
-	    } while (isdigit(c));
+	} else if (isDigit(c)) {
+	    do
+		c = advance(s);
+	    while (isDigit(c));
 
-	    if (c != '.')
+	    if (c != '.') {
+		checkInteger(s);
 		return INTEGER;
+	    }
 
-	    lexbuf += c;
-	    c = cin.get();
+	    c = advance(s);
 
-	    if (isdigit(c)) {
-		do {
-		    lexbuf += c;
-		    c = cin.get();
-		} while (isdigit(c));
+	    if (isDigit(c)) {
+		do
+		    c = advance(s);
+		while (isDigit(c));
 
 		if (c == 'e' || c == 'E') {
-		    lexbuf += c;
-		    c = cin.get();
-
-		    if (c == '-' || c == '+') {
-			lexbuf += c;
-			c = cin.get();
-		    }
-
-		    if (isdigit(c)) {
-			do {
-			    lexbuf += c;
-			    c = cin.get();
-			} while (isdigit(c));
+		    c = advance(s);
+
+		    if (c == '-' || c == '+')
+			c = advance(s);
+
+		    if (isDigit(c)) {
+			do
+			    c = advance(s);
+			while (isDigit(c));
 		    } else
-			report("missing exponent of floating-point constant");
+			complain(s, "missing exponent of floating-point constant");
 		}
 	    } else
-		report("missing fractional part of floating-point constant");
+		complain(s, "missing fractional part of floating-point constant");
 
 	    return REAL;
 
@@ -177,19 +601,16 @@ int lexan(string &lexbuf)
 	   might as well do it now. */
 
 	} else {
-	    lexbuf += c;
-
 	    switch(c) {
 
 
 	    /* Check for '||' */
 
 	    case '|':
-		c = cin.get();
+		c = advance(s);
 
 		if (c == '|') {
-		    lexbuf += c;
-		    c = cin.get();
+		    advance(s);
 		    return OR;
 		}
 
@@ -199,11 +620,10 @@ int lexan(string &lexbuf)
 	    /* Check for '=' and '==' */
 
 	    case '=':
-		c = cin.get();
+		c = advance(s);
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
+		    advance(s);
 		    return EQL;
 		}
 
@@ -213,11 +633,10 @@ int lexan(string &lexbuf)
 	    /* Check for '&' and '&&' */
 
 	    case '&':
-		c = cin.get();
+		c = advance(s);
 
 		if (c == '&') {
-		    lexbuf += c;
-		    c = cin.get();
+		    advance(s);
 		    return AND;
 		}
 
@@ -227,11 +646,10 @@ int lexan(string &lexbuf)
 	    /* Check for '!' and '!=' */
 
 	    case '!':
-		c = cin.get();
+		c = advance(s);
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
+		    advance(s);
 		    return NEQ;
 		}
 
@@ -241,11 +659,10 @@ int lexan(string &lexbuf)
 	    /* Check for '<' and '<=' */
 
 	    case '<':
-		c = cin.get();
+		c = advance(s);
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
+		    advance(s);
 		    return LEQ;
 		}
 
@@ -255,11 +672,10 @@ int lexan(string &lexbuf)
 	    /* Check for '>' and '>=' */
 
 	    case '>':
-		c = cin.get();
+		c = advance(s);
 
 		if (c == '=') {
-		    lexbuf += c;
-		    c = cin.get();
+		    advance(s);
 		    return GEQ;
 		}
 
@@ -269,16 +685,14 @@ int lexan(string &lexbuf)
 	    /* Check for '-', '--', and '->' */
 
 	    case '-':
-		c = cin.get();
+		c = advance(s);
 
 		if (c == '-') {
-		    lexbuf += c;
-		    c = cin.get();
+		    advance(s);
 		    return DEC;
 
 		} else if (c == '>') {
-		    lexbuf += c;
-		    c = cin.get();
+		    advance(s);
 		    return ARROW;
 		}
 
@@ -288,11 +702,10 @@ int lexan(string &lexbuf)
 	    /* Check for '+' and '++' */
 
 	    case '+':
-		c = cin.get();
+		c = advance(s);
 
 		if (c == '+') {
-		    lexbuf += c;
-		    c = cin.get();
+		    advance(s);
 		    return INC;
 		}
 
@@ -304,30 +717,30 @@ int lexan(string &lexbuf)
 	    case '*': case '%': case '.':
 	    case '(': case ')': case '[': case ']':
 	    case '{': case '}': case ';': case ',':
-		c = cin.get();
-		return lexbuf[0];
+		advance(s);
+		return c;
 
 
-	    /* Check for '/' or a comment */
+	    /* Check for a '#' that starts a directive.  Any other '#' is
+	       ignored, as is any stray character. */
 
-	    case '/':
-		c = cin.get();
+	    case '#':
+		advance(s);
 
-		if (c == '*') {
-		    c = cin.get();
+		if (!follows || s.line != line)
+		    return '#';
+
+		break;
 
-		    do {
-			while (c != '*' && !cin.eof()) {
-			    if (c == '\n')
-				lineno ++;
 
-			    c = cin.get();
-			}
+	    /* Check for '/' or a comment */
 
-			c = cin.get();
-		    } while (c != '/' && !cin.eof());
+	    case '/':
+		c = advance(s);
 
-		    c = cin.get();
+		if (c == '*') {
+		    s.cursor ++;
+		    skipComment(s);
 		    break;
 
 		} else
@@ -337,18 +750,16 @@ int lexan(string &lexbuf)
 	    /* Check for a string literal */
 
 	    case '"':
-		c = cin.get();
+		c = advance(s);
 
-		while (c != '"' && c != '\n' && !cin.eof()) {
-		    lexbuf += c;
-		    c = cin.get();
-		}
+		while (c != '"' && c != '\n' && c != EOF)
+		    c = advance(s);
 
-		if (c == '\n' || cin.eof())
-		    report("premature end of string literal");
+		if (c == '\n' || c == EOF)
+		    complain(s, "premature end of string literal");
+		else
+		    advance(s);
 
-		lexbuf += c;
-		c = cin.get();
 		return STRING;
 
 
@@ -361,11 +772,538 @@ int lexan(string &lexbuf)
 	    /* Ignore everything else */
 
 	    default:
-		c = cin.get();
+		c = advance(s);
 		break;
 	    }
 	}
     }
 
+    s.start = s.cursor;
     return DONE;
 }
+
+
+/*
+ * Function:	Spellings::add
+ *
+ * Description:	Return the index of the N characters at S in this table,
+ *		adding them if they haven't been seen before.
+ */
+
+unsigned Spellings::add(const char *s, unsigned n)
+{
+    unsigned mask, i;
+
+
+    mask = slots.size() - 1;
+
+    for (i = Interner::hash(s, n) & mask; slots[i] != 0; i = (i + 1) & mask)
+	if (length[slots[i] - 1] == n && memcmp(text[slots[i] - 1], s, n) == 0)
+	    return slots[i] - 1;
+
+    text.push_back(s);
+    length.push_back(n);
+    slots[i] = text.size();
+
+    if (text.size() * 2 > slots.size()) {
+	slots.assign(slots.size() * 2, 0);
+	mask = slots.size() - 1;
+
+	for (unsigned j = 0; j < text.size(); j ++) {
+	    for (i = Interner::hash(text[j], length[j]) & mask; slots[i] != 0; )
+		i = (i + 1) & mask;
+
+	    slots[i] = j + 1;
+	}
+    }
+
+    return text.size() - 1;
+}
+
+
+/*
+ * Function:	Spellings::intern
+ *
+ * Description:	Intern all the spellings in this table with the current
+ *		interner, in order, and store their ids.
+ */
+
+void Spellings::intern(vector<unsigned> &ids) const
+{
+    ids.resize(text.size());
+
+    if (!text.empty())
+	Interner::current()->intern(&text[0], &length[0], text.size(),
+		&ids[0]);
+}
+
+
+/*
+ * Function:	scanRange
+ *
+ * Description:	Tokenize the part of the buffer from SOURCE to LIMIT that
+ *		starts at BEGIN into TOKENS, stopping at the first token
+ *		that starts at or after END.
+ *		That token is not recorded, unless it is the DONE token at
+ *		the end of the last part.  Lines are counted starting with
+ *		the given LINE.  Return where the next token starts, and
+ *		the line it is on.  The ids of names and strings are left
+ *		as indices into SPELLINGS.
+ */
+
+static const char *scanRange(const char *source, const char *limit,
+	const char *begin, const char *end, unsigned &line,
+	TokenStream &tokens, Spellings &spellings)
+{
+    Scanner s;
+    int token;
+
+
+    s.cursor = begin;
+    s.limit = limit;
+    s.line = line;
+    s.scanned = false;
+    s.tokens = &tokens;
+
+    while (1) {
+	token = scan(s);
+
+	if (token == DONE ? end <= limit : s.start >= end) {
+	    while (!tokens.errors.empty() &&
+		    tokens.errors.back().token == tokens.kind.size())
+		tokens.errors.pop_back();
+
+	    break;
+	}
+
+	tokens.kind.push_back(token);
+	tokens.offset.push_back(s.start - source);
+	tokens.length.push_back(s.cursor - s.start);
+	tokens.line.push_back(s.line);
+
+	if (token == ID || token == STRING)
+	    tokens.id.push_back(spellings.add(s.start, s.cursor - s.start));
+	else
+	    tokens.id.push_back(0);
+
+	if (token == DONE)
+	    break;
+    }
+
+    line = s.line;
+    return s.start;
+}
+
+
+/*
+ * Function:	boundary
+ *
+ * Description:	Find a place at or after P to split the buffer, which
+ *		ends at LIMIT.  We prefer the start of the line after a
+ *		closing brace in the first column, which is almost
+ *		certainly at the end of a function and outside any
+ *		comment.  Failing that, any line will do.  Correctness
+ *		doesn't depend on the choice, since every split is checked
+ *		afterwards.
+ */
+
+static const char *boundary(const char *p, const char *limit)
+{
+    const char *q, *nl;
+
+
+    for (q = p; q < limit && q < p + MAX_SEARCH; q = nl + 1) {
+	nl = (const char *) memchr(q, '\n', limit - q);
+
+	if (nl == 0 || nl + 2 >= limit)
+	    break;
+
+	if (nl[1] == '}' && nl[2] == '\n')
+	    return nl + 3;
+    }
+
+    nl = (const char *) memchr(p, '\n', limit - p);
+    return nl != 0 ? nl + 1 : limit;
+}
+
+
+/*
+ * Function:	tokenize
+ *
+ * Description:	Tokenize the buffer from SOURCE to LIMIT into the given
+ *		stream, starting at START, which is at the start of the
+ *		given LINE.  Rather than copying each lexeme, we just
+ *		record where it is in the buffer.  The stream always ends
+ *		with a DONE token, whose line is the number of lines in
+ *		the source.
+ *
+ *		A large buffer is split at line boundaries into parts that
+ *		are tokenized concurrently, each counting lines from zero.
+ *		Since a split might fall inside a comment, a part is only
+ *		kept if the previous part stopped exactly where this part
+ *		found its first token; otherwise, it is tokenized again
+ *		from where the previous part did stop.  Since tokens can't
+ *		span lines, that is the only way for a split to go wrong,
+ *		and the result is exactly the same as tokenizing the whole
+ *		buffer in one go.
+ */
+
+void tokenize(const char *source, const char *start, const char *limit,
+	unsigned line, TokenStream &tokens, ThreadPool &pool)
+{
+    vector<TokenStream> parts;
+    vector<Spellings> spellings;
+    vector<vector<unsigned> > ids;
+    vector<const char *> begin, end, first, resume;
+    vector<unsigned> firstLine, resumeLine, base, index;
+    size_t size = limit - start;
+    unsigned i, n;
+    const char *p;
+
+
+    n = min<size_t>(pool.size() * 4, size / MIN_CHUNK);
+
+    if (n < 2) {
+	spellings.resize(1);
+	ids.resize(1);
+	scanRange(source, limit, start, limit + 1, line, tokens,
+		spellings[0]);
+	spellings[0].intern(ids[0]);
+
+	for (i = 0; i < tokens.id.size(); i ++)
+	    if (tokens.kind[i] == ID || tokens.kind[i] == STRING)
+		tokens.id[i] = ids[0][tokens.id[i]];
+
+	return;
+    }
+
+
+    /* Choose the split points. */
+
+    begin.push_back(start);
+
+    for (i = 1; i < n; i ++) {
+	p = boundary(start + size / n * i, limit);
+
+	if (p > begin.back() && p < limit)
+	    begin.push_back(p);
+    }
+
+    n = begin.size();
+    end.assign(begin.begin() + 1, begin.end());
+    end.push_back(limit + 1);
+
+
+    /* Tokenize each part.  We also note where each part found its first
+       token, by scanning past any white space and comments. */
+
+    parts.resize(n);
+    spellings.resize(n);
+    first.resize(n);
+    firstLine.resize(n);
+    resume.resize(n);
+    resumeLine.resize(n);
+
+    for (i = 0; i < n; i ++)
+	pool.submit([&, i]() {
+	    Timer timer(LEXING);
+	    TokenStream none;
+	    Spellings unused;
+
+	    firstLine[i] = 0;
+	    first[i] = scanRange(source, limit, begin[i], begin[i],
+		    firstLine[i], none, unused);
+	    resumeLine[i] = 0;
+	    resume[i] = scanRange(source, limit, begin[i], end[i],
+		    resumeLine[i], parts[i], spellings[i]);
+	});
+
+    pool.wait();
+
+
+    /* Check each split, and redo any part that started in the middle of
+       a comment.  The base is the line number of the start of a part. */
+
+    base.resize(n);
+    base[0] = line;
+
+    for (i = 1; i < n; i ++) {
+	line = base[i - 1] + resumeLine[i - 1];
+
+	if (resume[i - 1] == first[i])
+	    base[i] = line - firstLine[i];
+
+	else {
+	    parts[i] = TokenStream();
+	    spellings[i] = Spellings();
+	    base[i] = line;
+	    resumeLine[i] = 0;
+
+	    if (resume[i - 1] < end[i])
+		resume[i] = scanRange(source, limit, resume[i - 1], end[i],
+			resumeLine[i], parts[i], spellings[i]);
+	    else
+		resume[i] = resume[i - 1];
+	}
+    }
+
+
+    /* Intern the names in order, and then stitch the parts together,
+       again concurrently. */
+
+    ids.resize(n);
+
+    for (i = 0; i < n; i ++)
+	spellings[i].intern(ids[i]);
+
+    index.resize(n + 1);
+    index[0] = 0;
+
+    for (i = 0; i < n; i ++)
+	index[i + 1] = index[i] + parts[i].kind.size();
+
+    tokens.kind.resize(index[n]);
+    tokens.offset.resize(index[n]);
+    tokens.length.resize(index[n]);
+    tokens.line.resize(index[n]);
+    tokens.id.resize(index[n]);
+
+    for (i = 0; i < n; i ++)
+	pool.submit([&, i]() {
+	    const TokenStream &part = parts[i];
+
+	    copy(part.kind.begin(), part.kind.end(),
+		    tokens.kind.begin() + index[i]);
+	    copy(part.offset.begin(), part.offset.end(),
+		    tokens.offset.begin() + index[i]);
+	    copy(part.length.begin(), part.length.end(),
+		    tokens.length.begin() + index[i]);
+
+	    for (unsigned j = 0; j < part.line.size(); j ++) {
+		tokens.line[index[i] + j] = part.line[j] + base[i];
+
+		if (part.kind[j] == ID || part.kind[j] == STRING)
+		    tokens.id[index[i] + j] = ids[i][part.id[j]];
+	    }
+	});
+
+    pool.wait();
+
+    for (i = 0; i < n; i ++)
+	for (unsigned j = 0; j < parts[i].errors.size(); j ++) {
+	    tokens.errors.push_back(parts[i].errors[j]);
+	    tokens.errors.back().token += index[i];
+	}
+}
+
+
+/*
+ * Function:	tokenize
+ *
+ * Description:	Tokenize the whole buffer from SOURCE to LIMIT into the
+ *		given stream, leaving the id of each name and string as
+ *		the index of its spelling in SPELLINGS rather than
+ *		interning it, so that the stream does not depend on any
+ *		interner.
+ */
+
+void tokenize(const char *source, const char *limit, TokenStream &tokens,
+	Spellings &spellings)
+{
+    unsigned line = 1;
+
+    scanRange(source, limit, source, limit + 1, line, tokens, spellings);
+}
+
+
+/*
+ * Function:	tokenize
+ *
+ * Description:	Tokenize about the next WINDOW bytes of the buffer from
+ *		SOURCE to LIMIT onto the end of the given stream, starting
+ *		at START, where a token may start, on the given LINE.  We
+ *		stop at the first token to start on a line past the
+ *		window.  Return where the next token starts, and set LINE
+ *		to the line it is on, or return null once the stream has
+ *		its DONE token.  Each window is tokenized just as the whole
+ *		buffer would be, so tokenizing it a window at a time gives
+ *		exactly the same stream.
+ */
+
+const char *tokenize(const char *source, const char *start,
+	const char *limit, unsigned &line, TokenStream &tokens, size_t window)
+{
+    size_t first = tokens.kind.size();
+    Spellings spellings;
+    vector<unsigned> ids;
+    const char *end;
+
+
+    if ((size_t) (limit - start) > window)
+	end = boundary(start + window, limit);
+    else
+	end = limit;
+
+    start = scanRange(source, limit, start, end < limit ? end : limit + 1,
+	    line, tokens, spellings);
+    spellings.intern(ids);
+
+    for (size_t i = first; i < tokens.id.size(); i ++)
+	if (tokens.kind[i] == ID || tokens.kind[i] == STRING)
+	    tokens.id[i] = ids[tokens.id[i]];
+
+    if (!tokens.kind.empty() && tokens.kind.back() == DONE)
+	return nullptr;
+
+    return start;
+}
+
+
+/*
+ * Function:	splice
+ *
+ * Description:	Replace the elements of V from FIRST up to LAST with those
+ *		of WITH.
+ */
+
+template<class T>
+static void splice(vector<T> &v, unsigned first, unsigned last,
+	const vector<T> &with)
+{
+    if (with.size() > last - first)
+	v.insert(v.begin() + last, with.size() - (last - first), T());
+    else
+	v.erase(v.begin() + first + with.size(), v.begin() + last);
+
+    copy(with.begin(), with.end(), v.begin() + first);
+}
+
+
+/*
+ * Function:	retokenize
+ *
+ * Description:	Bring the given stream, which has not been preprocessed,
+ *		up to date after an edit to its source, which now runs
+ *		from SOURCE to LIMIT.  The edit replaced the characters
+ *		from START up to END of the old source with the LENGTH
+ *		characters now at START.  We scan again from the end of
+ *		the last token that ended before the edit, until we find
+ *		a token after the edit that starts just where one of the
+ *		old stream did, once moved by the edit.  Every scan from
+ *		there on sees the very same characters as before, so the
+ *		rest of the old stream still holds, once its offsets and
+ *		lines are moved too.  Since tokens can't span lines, a
+ *		scan never starts in the middle of one.  Return the number
+ *		of tokens scanned.
+ */
+
+unsigned retokenize(const char *source, const char *limit, unsigned start,
+	unsigned end, unsigned length, TokenStream &tokens)
+{
+    vector<unsigned>::iterator it;
+    vector<LexicalError> errors;
+    vector<unsigned> ids;
+    unsigned first, last, after, moved, n;
+    long delta = (long) length - (long) (end - start);
+    long lines = 0;
+    Spellings spellings;
+    TokenStream fresh;
+    Scanner s;
+    int token;
+
+
+    it = lower_bound(tokens.offset.begin(), tokens.offset.end(), start);
+    first = it - tokens.offset.begin();
+
+    while (first > 0 &&
+	    tokens.offset[first - 1] + tokens.length[first - 1] >= start)
+	first --;
+
+    s.cursor = source;
+    s.line = 1;
+    s.scanned = first > 0;
+
+    if (first > 0) {
+	s.cursor += tokens.offset[first - 1] + tokens.length[first - 1];
+	s.line = tokens.line[first - 1];
+    }
+
+    s.limit = limit;
+    s.tokens = &fresh;
+    last = tokens.kind.size();
+    after = start + length;
+
+    while (1) {
+	token = scan(s);
+
+	if ((unsigned) (s.start - source) >= after) {
+	    moved = s.start - source - delta;
+	    it = lower_bound(tokens.offset.begin() + first,
+		    tokens.offset.end(), moved);
+	    n = it - tokens.offset.begin();
+
+	    if (n < last && tokens.offset[n] == moved &&
+		    tokens.kind[n] == token) {
+		while (!fresh.errors.empty() &&
+			fresh.errors.back().token == fresh.kind.size())
+		    fresh.errors.pop_back();
+
+		lines = (long) s.line - (long) tokens.line[n];
+		last = n;
+		break;
+	    }
+	}
+
+	fresh.kind.push_back(token);
+	fresh.offset.push_back(s.start - source);
+	fresh.length.push_back(s.cursor - s.start);
+	fresh.line.push_back(s.line);
+
+	if (token == ID || token == STRING)
+	    fresh.id.push_back(spellings.add(s.start, s.cursor - s.start));
+	else
+	    fresh.id.push_back(0);
+
+	if (token == DONE)
+	    break;
+    }
+
+    spellings.intern(ids);
+
+    for (unsigned i = 0; i < fresh.id.size(); i ++)
+	if (fresh.kind[i] == ID || fresh.kind[i] == STRING)
+	    fresh.id[i] = ids[fresh.id[i]];
+
+
+    /* Move what is left of the old stream, and then splice in the new
+       tokens and their errors in place of the old ones. */
+
+    for (unsigned i = last; i < tokens.kind.size(); i ++) {
+	tokens.offset[i] += delta;
+	tokens.line[i] += lines;
+    }
+
+    for (unsigned i = 0; i < tokens.errors.size(); i ++)
+	if (tokens.errors[i].token < first)
+	    errors.push_back(tokens.errors[i]);
+
+    for (unsigned i = 0; i < fresh.errors.size(); i ++) {
+	errors.push_back(fresh.errors[i]);
+	errors.back().token += first;
+    }
+
+    for (unsigned i = 0; i < tokens.errors.size(); i ++)
+	if (tokens.errors[i].token >= last) {
+	    errors.push_back(tokens.errors[i]);
+	    errors.back().token += fresh.kind.size() - (last - first);
+	}
+
+    splice(tokens.kind, first, last, fresh.kind);
+    splice(tokens.offset, first, last, fresh.offset);
+    splice(tokens.length, first, last, fresh.length);
+    splice(tokens.line, first, last, fresh.line);
+    splice(tokens.id, first, last, fresh.id);
+    tokens.errors.swap(errors);
+
+    return fresh.kind.size();
+}
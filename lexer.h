@@ -3,14 +3,92 @@
  *
  * Description:	This file contains the public function and variable
  *		declarations for the lexical analyzer for Simple C.
+ *
+ *		The entire source is in memory before lexing begins (see
+ *		CompilerContext.h), so a lexeme is just a view into that
+ *		buffer: an offset and a length.
+ *		The characters are only copied into a string when someone
+ *		actually asks for one.
+ *
+ *		The whole translation unit is tokenized in one pass into a
+ *		token stream, which keeps the kind, offset, length, and
+ *		line of each token in parallel arrays.  The parser walks
+ *		the stream by index, so it can look as far ahead as it
+ *		likes.  The spelling of each identifier and string literal
+ *		is interned as it is tokenized, and its id is kept in the
+ *		stream as well.  Lexical errors are recorded in the stream
+ *		against the token being scanned and are reported by the
+ *		parser when it gets there.  A large source can be
+ *		tokenized by a pool of threads, with exactly the same
+ *		result, or a window at a time, so that the parser can
+ *		forget the tokens it is done with.  After an edit, a
+ *		stream can be brought up to date by tokenizing just the
+ *		part around the edit again.
+ *
+ *		Once the preprocessor has been at it, the stream may also
+ *		hold tokens of included headers.  Each header is given
+ *		offsets of its own beyond the end of the source, and the
+ *		stream keeps where each header begins in that space and
+ *		where it is in memory, so a lexeme can still find its
+ *		characters from its offset alone.
  */
 
 # ifndef LEXER_H
 # define LEXER_H
+# include <string>
+# include <vector>
+
+class Lexeme {
+    unsigned _offset, _length;
+
+public:
+    Lexeme(unsigned offset = 0, unsigned length = 0);
+    const char *data() const;
+    unsigned offset() const;
+    unsigned length() const;
+    std::string str() const;
+};
+
+struct LexicalError {
+    unsigned token;
+    const char *message;
+};
+
+struct TokenStream {
+    std::vector<unsigned short> kind;
+    std::vector<unsigned> offset, length, line, id;
+    std::vector<LexicalError> errors;
+    std::vector<unsigned> bases;
+    std::vector<const char *> buffers;
+};
+
+/* While part of the buffer is being scanned, the spellings of names and
+   strings are first collected in a table of their own, so that threads
+   scanning different parts never contend for the interner.  Each token
+   records the index of its spelling in that table until the table is
+   interned in one batch, which gives the same ids as interning each
+   name as it was scanned.  A stream that is shared by units with
+   interners of their own, like that of a header, keeps the indices and
+   the table, and each unit interns the table for itself. */
+
+struct Spellings {
+    std::vector<unsigned> slots;
+    std::vector<const char *> text;
+    std::vector<unsigned> length;
 
-extern int numErrors;
+    Spellings() : slots(256, 0) {}
+    unsigned add(const char *s, unsigned n);
+    void intern(std::vector<unsigned> &ids) const;
+};
 
-int lexan(std::string &lexbuf);
+void tokenize(const char *source, const char *start, const char *limit,
+	unsigned line, TokenStream &tokens, class ThreadPool &pool);
+void tokenize(const char *source, const char *limit, TokenStream &tokens,
+	Spellings &spellings);
+const char *tokenize(const char *source, const char *start,
+	const char *limit, unsigned &line, TokenStream &tokens, size_t window);
+unsigned retokenize(const char *source, const char *limit, unsigned start,
+	unsigned end, unsigned length, TokenStream &tokens);
 void report(const std::string &str, const std::string &arg = "");
 
 # endif /* LEXER_H */
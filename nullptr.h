@@ -13,10 +13,14 @@
    The new C++ standard, which is still in development, introduces a new
    constant nullptr.  Until it's supported, this class comes as close as you
    can get to mimicking it.  The final four functions don't seem to be
-   needed under all versions of GCC, but they seem to work regardless. */
+   needed under all versions of GCC, but they seem to work regardless.
+
+   Now that the standard is out and nullptr is a keyword, we only define
+   our own when compiling as C++98. */
 
 # ifndef NULLPTR_H
 # define NULLPTR_H
+# if __cplusplus < 201103L
 
 const class nullptr_t {
     void operator &() const;
@@ -30,4 +34,5 @@ template<class T> bool operator ==(T *lhs, nullptr_t rhs) { return lhs == 0; }
 template<class T> bool operator !=(nullptr_t lhs, T *rhs) { return rhs != 0; }
 template<class T> bool operator !=(T *lhs, nullptr_t rhs) { return lhs != 0; }
 
+# endif /* __cplusplus */
 # endif /* NULLPTR_H */
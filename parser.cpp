@@ -2,43 +2,276 @@
  * File:	parser.c
  *
  * Description:	This file contains the public and private function and
- *		variable definitions for the recursive-descent parser for
- *		Simple C.
+ *		variable definitions for the parser for Simple C.  It is a
+ *		recursive-descent parser at heart, but it keeps unfinished
+ *		constructs on a stack of its own rather than recursing.
  */
 
+# include <algorithm>
 # include <cstdlib>
-# include <iostream>
+# include <cstring>
+# include <deque>
+# include <map>
+# include <sstream>
+# include <stdexcept>
+# include "parser.h"
 # include "generator.h"
 # include "checker.h"
 # include "tokens.h"
 # include "lexer.h"
+# include "preprocessor.h"
+# include "Arena.h"
+# include "Cache.h"
+# include "CompilerContext.h"
+# include "Interner.h"
+# include "Memo.h"
+# include "Profile.h"
+# include "Snapshot.h"
+# include "ThreadPool.h"
 
 using namespace std;
 
-static int lookahead, nexttoken;
-static string lexbuf, nextbuf;
-static Type returnType;
+static Lexeme lexeme(unsigned n);
+
+struct Operator {
+    unsigned precedence;
+    Tree::Id (*check)(Tree::Id left, Tree::Id right);
+};
+
+static const struct Operators {
+    Operator table[DONE + 1];
+
+    Operators() : table() {
+	add(OR, 1, checkLogicalOr);
+	add(AND, 2, checkLogicalAnd);
+	add(EQL, 3, checkEqual);
+	add(NEQ, 3, checkNotEqual);
+	add('<', 4, checkLessThan);
+	add('>', 4, checkGreaterThan);
+	add(LEQ, 4, checkLessOrEqual);
+	add(GEQ, 4, checkGreaterOrEqual);
+	add('+', 5, checkAdd);
+	add('-', 5, checkSubtract);
+	add('*', 6, checkMultiply);
+	add('/', 6, checkDivide);
+	add('%', 6, checkRemainder);
+    }
+
+    void add(int token, unsigned precedence,
+	    Tree::Id (*check)(Tree::Id, Tree::Id)) {
+	table[token].precedence = precedence;
+	table[token].check = check;
+    }
+} operators;
+
+
+/*
+ * The parser does not recurse on nested expressions and statements,
+ * so that how deeply they nest is limited only by memory, not by the
+ * size of the stack.  Instead, a construct waiting for a nested
+ * expression, operand, or statement to be parsed is pushed on a stack of
+ * unfinished constructs, and is finished once the nested one is.  The
+ * arguments of unfinished calls and the statements of unfinished blocks
+ * are kept on two more stacks, each construct remembering where its own
+ * begin, so that a finished one takes just its own into the tree and the
+ * stacks are never freed.  None of them outlives a construct, so rather
+ * than belonging to a compiler context, they belong to a thread.
+ */
+
+enum {
+    EXPRESSION, PARENTHESES, SUBSCRIPT, ARGUMENT, ASSIGNMENT, BINARY,
+    PREFIX, CAST, COMPOUND, LOOP, CONDITIONAL
+};
+
+struct Pending {
+    int construct;
+    unsigned line, first;
+    union {
+	int token;
+	const Operator *op;
+	const Symbol *symbol;
+	Scope *decls;
+	Tree::Id stmt;
+    };
+    Tree::Id expr;
+    Type type;
+};
+
+static thread_local vector<Pending> unfinished;
+static thread_local Expressions arguments;
+static thread_local Statements statements;
+
+
+/*
+ * With more than one thread, the global declarations of a unit are
+ * parsed first, and each function body is only skimmed: its braces are
+ * matched and we move on.  The bodies are then parsed and checked
+ * concurrently, each by a context of its own, and merged back into the
+ * unit in order.  A body remembers the tokens it spans, the function it
+ * belongs to, and how much of the unit had been declared and reported
+ * when it began.  It comes back with its tree, its diagnostics, and its
+ * literals, which are only numbered once it is merged.  At most AHEAD
+ * bodies per thread are parsed ahead of the one being merged.
+ *
+ * If the unit has roots, the same is done even with one thread, but
+ * only the bodies reachable from the roots are parsed at all.  If it
+ * has a cache, the same is done as well, and a body whose code is in
+ * the cache is not parsed either: its code and its literals come from
+ * the cache instead.  If it has a memo, the same is done once more, and
+ * a body whose diagnostics the memo recalls is not parsed either: they
+ * are merged back, but it is never generated.
+ */
+
+struct Body {
+    Symbol *symbol;
+    Type returnType;
+    vector<pair<unsigned, Type> > params;
+    unsigned first, last, visible;
+    size_t skimmed;
+    int reported, errors;
+    FunctionCode *code;
+    Tree::Id function;
+    string diagnostics;
+    Expressions literals;
+    CacheEntry entry;
+    string transcript;
+    bool reached, cached, recalled, failed, done;
+};
+
+static const unsigned AHEAD = 4;
+
 
-static Expression *expression();
-static Statement *statement();
+/*
+ * Otherwise, a unit whose source has no directives is tokenized a window
+ * of about WINDOW bytes at a time, as the parser reaches the end of what
+ * has been tokenized so far, and the tokens it is done with are dropped
+ * once they make up half of the stream.  The tokens of a large unit are
+ * then never all in memory at once, just as its trees are not.
+ */
 
-static Symbols globals;
+static const size_t WINDOW = 1 << 20;
 
 
 /*
  * Function:	error
  *
- * Description:	Report a syntax error to standard error.
+ * Description:	Report a syntax error and give up on the unit, since our
+ *		parser does not do error recovery.
  */
 
 static void error()
 {
-    if (lookahead == DONE)
+    if (context->lookahead == DONE)
 	report("syntax error at end of file");
     else
-	report("syntax error at '%s'", lexbuf);
+	report("syntax error at '%s'", lexeme(context->current).str());
+
+    throw SyntaxError();
+}
+
+
+/*
+ * Function:	lexeme
+ *
+ * Description:	Return the lexeme of the Nth token in the stream.
+ */
+
+static Lexeme lexeme(unsigned n)
+{
+    return Lexeme(context->tokens.offset[n], context->tokens.length[n]);
+}
+
+
+/*
+ * Function:	extend
+ *
+ * Description:	Tokenize the next window of the source of the current
+ *		context onto the end of its stream.
+ */
+
+static void extend()
+{
+    Timer timer(LEXING);
+    TokenStream &tokens = context->tokens;
+    size_t count = tokens.kind.size();
+
+
+    context->resume = tokenize(context->source, context->resume,
+	context->limit, context->resumeLine, tokens, WINDOW);
+    Timer::count(TOKENS, tokens.kind.size() - count);
+}
+
+
+/*
+ * Function:	release
+ *
+ * Description:	Drop the tokens of the current context before the
+ *		lookahead, if its source is being tokenized a window at a
+ *		time and they are at least half of its stream.  The rest
+ *		are renumbered from zero, and so are their errors, which
+ *		are all that is left to report.
+ */
+
+static void release()
+{
+    TokenStream &tokens = context->tokens;
+    unsigned n = context->current;
+
+
+    if (context->resume == nullptr || n < tokens.kind.size() / 2)
+	return;
+
+    tokens.kind.erase(tokens.kind.begin(), tokens.kind.begin() + n);
+    tokens.offset.erase(tokens.offset.begin(), tokens.offset.begin() + n);
+    tokens.length.erase(tokens.length.begin(), tokens.length.begin() + n);
+    tokens.line.erase(tokens.line.begin(), tokens.line.begin() + n);
+    tokens.id.erase(tokens.id.begin(), tokens.id.begin() + n);
+
+    tokens.errors.erase(tokens.errors.begin(),
+	tokens.errors.begin() + context->pending);
+
+    for (unsigned i = 0; i < tokens.errors.size(); i ++)
+	tokens.errors[i].token -= n;
+
+    context->current = 0;
+    context->reached -= n;
+    context->pending = 0;
+}
+
+
+/*
+ * Function:	reach
+ *
+ * Description:	Note that the parser has looked as far ahead as the Nth
+ *		token, tokenizing more of the source if need be.  Any
+ *		lexical errors up to that token are reported, and the line
+ *		number is updated, so that errors come out exactly as if
+ *		we had been reading tokens one at a time.
+ */
+
+static unsigned reach(unsigned n)
+{
+    const TokenStream &tokens = context->tokens;
+    unsigned &reached = context->reached, &pending = context->pending;
+
+
+    while (n >= tokens.kind.size() && context->resume != nullptr)
+	extend();
+
+    if (n >= tokens.kind.size())
+	n = tokens.kind.size() - 1;
 
-    exit(EXIT_FAILURE);
+    while (reached <= n) {
+	context->lineno = tokens.line[reached];
+
+	while (pending < tokens.errors.size() &&
+		tokens.errors[pending].token == reached)
+	    report(tokens.errors[pending ++].message);
+
+	reached ++;
+    }
+
+    return n;
 }
 
 
@@ -46,37 +279,29 @@ static void error()
  * Function:	match
  *
  * Description:	Match the next token against the specified token.  A
- *		failure indicates a syntax error and will terminate the
- *		program since our parser does not do error recovery.
+ *		failure indicates a syntax error.
  */
 
 static void match(int t)
 {
-    if (lookahead != t)
+    if (context->lookahead != t)
 	error();
 
-    if (nexttoken) {
-	lookahead = nexttoken;
-	lexbuf = nextbuf;
-	nexttoken = 0;
-    } else
-	lookahead = lexan(lexbuf);
+    context->current = reach(context->current + 1);
+    context->lookahead = context->tokens.kind[context->current];
 }
 
 
 /*
  * Function:	peek
  *
- * Description:	Return the next token in the input stream and save it so
- *		that match() will later return it.
+ * Description:	Return the token N tokens past the lookahead without
+ *		consuming anything.
  */
 
-static int peek()
+static int peek(unsigned n = 1)
 {
-    if (!nexttoken)
-	nexttoken = lexan(nextbuf);
-
-    return nexttoken;
+    return context->tokens.kind[reach(context->current + n)];
 }
 
 
@@ -84,19 +309,34 @@ static int peek()
  * Function:	expect
  *
  * Description:	Match the next token against the specified token, and
- *		return its lexeme.  We must save the contents of the buffer
- *		from the lexical analyzer before matching, since matching
- *		will advance to the next token.
+ *		return its lexeme.  A lexeme is only a view into the
+ *		source, so this is cheap.
  */
 
-static string expect(int t)
+static Lexeme expect(int t)
 {
-    string buf = lexbuf;
+    Lexeme buf = lexeme(context->current);
     match(t);
     return buf;
 }
 
 
+/*
+ * Function:	expectId
+ *
+ * Description:	Match the next token against the specified token, which
+ *		should be an identifier or a string literal, and return
+ *		the interned id of its spelling.
+ */
+
+static unsigned expectId(int t)
+{
+    unsigned id = context->tokens.id[context->current];
+    match(t);
+    return id;
+}
+
+
 /*
  * Function:	specifier
  *
@@ -110,12 +350,12 @@ static string expect(int t)
 
 static int specifier()
 {
-    if (lookahead == INT) {
+    if (context->lookahead == INT) {
 	match(INT);
 	return INT;
     }
 
-    if (lookahead == DOUBLE) {
+    if (context->lookahead == DOUBLE) {
 	match(DOUBLE);
 	return DOUBLE;
     }
@@ -140,7 +380,7 @@ static unsigned pointers()
     unsigned count = 0;
 
 
-    while (lookahead == '*') {
+    while (context->lookahead == '*') {
 	match('*');
 	count ++;
     }
@@ -163,15 +403,15 @@ static unsigned pointers()
 static void declarator(int typespec)
 {
     unsigned indirection, length;
-    string name;
+    unsigned name;
 
 
     indirection = pointers();
-    name = expect(ID);
+    name = expectId(ID);
 
-    if (lookahead == '[') {
+    if (context->lookahead == '[') {
 	match('[');
-	length = strtoul(expect(INTEGER).c_str(), NULL, 0);
+	length = strtoul(expect(INTEGER).str().c_str(), NULL, 0);
 	declareVariable(name, Type(typespec, indirection, length));
 	match(']');
 
@@ -203,7 +443,7 @@ static void declaration()
     typespec = specifier();
     declarator(typespec);
 
-    while (lookahead == ',') {
+    while (context->lookahead == ',') {
 	match(',');
 	declarator(typespec);
     }
@@ -224,36 +464,87 @@ static void declaration()
 
 static void declarations()
 {
-    while (lookahead == INT || lookahead == DOUBLE)
+    while (context->lookahead == INT || context->lookahead == DOUBLE)
 	declaration();
 }
 
 
+/*
+ * Function:	push
+ *
+ * Description:	Push a construct on the stack of unfinished constructs,
+ *		and return it so the caller can fill in the rest.
+ */
+
+static Pending &push(int construct, Tree::Id expr = Tree::NONE)
+{
+    unfinished.emplace_back();
+    unfinished.back().construct = construct;
+    unfinished.back().expr = expr;
+    return unfinished.back();
+}
+
+
 /*
  * Function:	argument
  *
- * Description:	Parse an argument to a function call.  The only place
+ * Description:	Parse the arguments of the call on top of the stack,
+ *		given the argument just parsed, if any.  The only place
  *		string literals are allowed in Simple C is here, to
- *		facilitate calling printf(), scanf(), and the like.
+ *		facilitate calling printf(), scanf(), and the like, so we
+ *		take those ourselves.  If we reach an argument that is an
+ *		expression, we return null, leaving the call unfinished
+ *		while the expression is parsed.  Otherwise, we return the
+ *		finished call.
+ *
+ *		argument-list:
+ *		  argument
+ *		  argument , argument-list
  *
  *		argument:
  *		  string
  *		  expression
  */
 
-static Expression *argument()
+static Tree::Id argument(Tree::Id arg)
 {
-    if (lookahead == STRING)
-	return new String(expect(STRING));
+    Tree::Id call;
+
+
+    if (arg != Tree::NONE || context->lookahead != ')') {
+	while (true) {
+	    if (arg == Tree::NONE) {
+		if (context->lookahead != STRING)
+		    return Tree::NONE;
+
+		arg = Tree::current()->newString(expectId(STRING));
+	    }
+
+	    arguments.push_back(arg);
 
-    return expression();
+	    if (context->lookahead != ',')
+		break;
+
+	    match(',');
+	    arg = Tree::NONE;
+	}
+    }
+
+    Pending &top = unfinished.back();
+
+    call = checkCall(top.symbol, arguments, top.first);
+    unfinished.pop_back();
+    match(')');
+    return call;
 }
 
 
 /*
  * Function:	primaryExpression
  *
- * Description:	Parse a primary expression.
+ * Description:	Parse a primary expression.  A parenthesized expression
+ *		or a call with an expression as an argument is left
+ *		unfinished, and we return null.
  *
  *		primary-expression:
  *		  ( expression )
@@ -262,92 +553,56 @@ static Expression *argument()
  *		  identifier
  *		  integer
  *		  real
- *
- *		argument-list:
- *		  argument
- *		  argument , argument-list
  */
 
-static Expression *primaryExpression()
+static Tree::Id primaryExpression()
 {
-    Expressions args;
-    Expression *expr;
+    Tree *tree = Tree::current();
     Symbol *symbol;
+    Lexeme number;
 
 
-    if (lookahead == '(') {
+    if (context->lookahead == '(') {
 	match('(');
-	expr = expression();
-	match(')');
-
-    } else if (lookahead == INTEGER) {
-	expr = new Integer(expect(INTEGER));
-
-    } else if (lookahead == REAL) {
-	expr = new Real(expect(REAL));
-
-    } else if (lookahead == ID) {
-	symbol = checkIdentifier(expect(ID));
-
-	if (lookahead == '(') {
-	    match('(');
-
-	    if (lookahead != ')') {
-		args.push_back(argument());
-
-		while (lookahead == ',') {
-		    match(',');
-		    args.push_back(argument());
-		}
-	    }
-
-	    expr = checkCall(symbol, args);
-	    match(')');
-
-	} else
-	    expr = new Identifier(symbol);
-
-    } else {
-	expr = nullptr;
-	error();
+	push(PARENTHESES);
+	return Tree::NONE;
     }
 
-    return expr;
-}
-
-
-/*
- * Function:	postfixExpression
- *
- * Description:	Parse a postfix expression.
- *
- *		postfix-expression:
- *		  primary-expression
- *		  postfix-expression [ expression ]
- */
+    if (context->lookahead == INTEGER) {
+	number = expect(INTEGER);
+	return tree->newInteger(number.data(), number.length());
+    }
 
-static Expression *postfixExpression()
-{
-    Expression *left, *right;
+    if (context->lookahead == REAL) {
+	number = expect(REAL);
+	return tree->newReal(number.data(), number.length());
+    }
 
+    if (context->lookahead == ID) {
+	symbol = checkIdentifier(expectId(ID));
 
-    left = primaryExpression();
+	if (context->lookahead != '(')
+	    return tree->newIdentifier(symbol);
 
-    while (lookahead == '[') {
-	match('[');
-	right = expression();
-	left = checkArray(left, right);
-	match(']');
+	match('(');
+	push(ARGUMENT).symbol = symbol;
+	unfinished.back().first = arguments.size();
+	return argument(Tree::NONE);
     }
 
-    return left;
+    error();
+    return Tree::NONE;
 }
 
 
 /*
  * Function:	unaryExpression
  *
- * Description:	Parse a unary expression.
+ * Description:	Parse the start of a unary expression.  Each prefix
+ *		operator is left unfinished until its operand is parsed,
+ *		and then we parse the primary expression.  Since only a
+ *		primary expression may be followed by a subscript, we
+ *		also say whether that is what we have.
  *
  *		unary-expression:
  *		  postfix-expression
@@ -359,96 +614,126 @@ static Expression *postfixExpression()
  *		  sizeof ( specifier pointers )
  */
 
-static Expression *unaryExpression()
+static Tree::Id unaryExpression(bool &primary)
 {
-    Expression *expr;
     unsigned indirection;
     int typespec;
-    Type type;
-
 
-    if (lookahead == '!') {
-	match('!');
-	expr = unaryExpression();
-	expr = checkNot(expr);
 
-    } else if (lookahead == '-') {
-	match('-');
-	expr = unaryExpression();
-	expr = checkNegate(expr);
-
-    } else if (lookahead == '*') {
-	match('*');
-	expr = unaryExpression();
-	expr = checkDereference(expr);
-
-    } else if (lookahead == '&') {
-	match('&');
-	expr = unaryExpression();
-	expr = checkAddress(expr);
-
-    } else if (lookahead == SIZEOF) {
-	match(SIZEOF);
-
-	if (lookahead == '(' && (peek() == INT || peek() == DOUBLE)) {
-	    match('(');
-	    typespec = specifier();
-	    indirection = pointers();
-	    match(')');
-	    type = Type(typespec, indirection);
-
-	} else {
-	    expr = unaryExpression();
-	    type = expr->type();
-	}
+    while (true) {
+	if (context->lookahead == '!' || context->lookahead == '-' ||
+		context->lookahead == '*' || context->lookahead == '&') {
+	    push(PREFIX).token = context->lookahead;
+	    match(context->lookahead);
+
+	} else if (context->lookahead == SIZEOF) {
+	    match(SIZEOF);
+
+	    if (context->lookahead == '(' &&
+		    (peek() == INT || peek() == DOUBLE)) {
+		match('(');
+		typespec = specifier();
+		indirection = pointers();
+		match(')');
+		primary = false;
+		return Tree::current()->newInteger(
+			Type(typespec, indirection).size());
+	    }
 
-	expr = new Integer(type.size());
+	    push(PREFIX).token = SIZEOF;
 
-    } else
-	expr = postfixExpression();
+	} else
+	    break;
+    }
 
-    return expr;
+    primary = true;
+    return primaryExpression();
 }
 
 
 /*
  * Function:	castExpression
  *
- * Description:	Parse a cast expression.  If the token after the opening
- *		parenthesis is not a type specifier, we could have a
- *		parenthesized expression instead.
+ * Description:	Parse the start of a cast expression.  If the token after
+ *		the opening parenthesis is not a type specifier, we could
+ *		have a parenthesized expression instead.  Each cast is
+ *		left unfinished until its operand is parsed.
  *
  *		cast-expression:
  *		  unary-expression
  *		  ( specifier pointers ) cast-expression
  */
 
-static Expression *castExpression()
+static Tree::Id castExpression(bool &primary)
 {
-    Expression *expr;
     unsigned indirection;
     int typespec;
 
 
-    if (lookahead == '(' && (peek() == INT || peek() == DOUBLE)) {
+    while (context->lookahead == '(' && (peek() == INT || peek() == DOUBLE)) {
 	match('(');
 	typespec = specifier();
 	indirection = pointers();
 	match(')');
-	expr = castExpression();
-	expr = checkCast(Type(typespec, indirection), expr);
-
-    } else
-	expr = unaryExpression();
+	push(CAST).type = Type(typespec, indirection);
+    }
 
-    return expr;
+    return unaryExpression(primary);
 }
 
 
 /*
- * Function:	multiplicativeExpression
+ * Function:	finish
+ *
+ * Description:	Finish whatever constructs we can, given the expression
+ *		just parsed, and return the expression asked for once it
+ *		is finished, or null if another operand must be parsed
+ *		first.
+ *
+ *		First come any subscripts of a primary expression, then
+ *		the unfinished prefix operators and casts.  Binary
+ *		operators are parsed by precedence climbing: as long as
+ *		the next token is a binary operator with a higher
+ *		precedence than the one on top of the stack, it is left
+ *		unfinished while its right operand is parsed, which makes
+ *		all of the operators left-associative; otherwise, the one
+ *		on top is finished.  This does the work of the usual tower
+ *		of functions, one for each level of precedence, in one
+ *		loop.  Note that Simple C does not have shift operators,
+ *		bitwise operators, or the comma operator.  Assignment is
+ *		right-associative, so its left operand is left unfinished
+ *		until the whole right side is parsed.  Once the
+ *		expression is complete, we finish whatever it is enclosed
+ *		in, which in turn may be a primary expression.
+ *
+ *		postfix-expression:
+ *		  primary-expression
+ *		  postfix-expression [ expression ]
+ *
+ *		logical-or-expression:
+ *		  logical-and-expression
+ *		  logical-or-expression || logical-and-expression
+ *
+ *		logical-and-expression:
+ *		  equality-expression
+ *		  logical-and-expression && equality-expression
+ *
+ *		equality-expression:
+ *		  relational-expression
+ *		  equality-expression == relational-expression
+ *		  equality-expression != relational-expression
+ *
+ *		relational-expression:
+ *		  additive-expression
+ *		  relational-expression < additive-expression
+ *		  relational-expression > additive-expression
+ *		  relational-expression <= additive-expression
+ *		  relational-expression >= additive-expression
  *
- * Description:	Parse a multiplicative expression.
+ *		additive-expression:
+ *		  multiplicative-expression
+ *		  additive-expression + multiplicative-expression
+ *		  additive-expression - multiplicative-expression
  *
  *		multiplicative-expression:
  *		  cast-expression
@@ -457,342 +742,272 @@ static Expression *castExpression()
  *		  multiplicative-expression % cast-expression
  */
 
-static Expression *multiplicativeExpression()
+static Tree::Id finish(Tree::Id expr, bool primary)
 {
-    Expression *left, *right;
+    const Operator *op;
+    unsigned minimum;
 
 
-    left = castExpression();
+    while (true) {
+	if (primary && context->lookahead == '[') {
+	    match('[');
+	    push(SUBSCRIPT, expr);
+	    return Tree::NONE;
+	}
 
-    while (1) {
-	if (lookahead == '*') {
-	    match('*');
-	    right = castExpression();
-	    left = checkMultiply(left, right);
+	while (unfinished.back().construct == PREFIX ||
+		unfinished.back().construct == CAST) {
+	    Pending &top = unfinished.back();
+
+	    if (top.construct == CAST)
+		expr = checkCast(top.type, expr);
+	    else if (top.token == '!')
+		expr = checkNot(expr);
+	    else if (top.token == '-')
+		expr = checkNegate(expr);
+	    else if (top.token == '*')
+		expr = checkDereference(expr);
+	    else if (top.token == '&')
+		expr = checkAddress(expr);
+	    else
+		expr = checkSizeof(expr);
+
+	    unfinished.pop_back();
+	}
 
-	} else if (lookahead == '/') {
-	    match('/');
-	    right = castExpression();
-	    left = checkDivide(left, right);
+	while (true) {
+	    Pending &top = unfinished.back();
 
-	} else if (lookahead == '%') {
-	    match('%');
-	    right = castExpression();
-	    left = checkRemainder(left, right);
+	    minimum = top.construct == BINARY ? top.op->precedence + 1 : 1;
+	    op = &operators.table[context->lookahead];
 
-	} else
-	    break;
-    }
+	    if (op->precedence >= minimum) {
+		match(context->lookahead);
+		push(BINARY, expr).op = op;
+		return Tree::NONE;
+	    }
 
-    return left;
-}
+	    if (top.construct != BINARY)
+		break;
 
+	    expr = top.op->check(top.expr, expr);
+	    unfinished.pop_back();
+	}
 
-/*
- * Function:	additiveExpression
- *
- * Description:	Parse an additive expression.
- *
- *		additive-expression:
- *		  multiplicative-expression
- *		  additive-expression + multiplicative-expression
- *		  additive-expression - multiplicative-expression
- */
+	if (context->lookahead == '=') {
+	    match('=');
+	    push(ASSIGNMENT, expr);
+	    return Tree::NONE;
+	}
 
-static Expression *additiveExpression()
-{
-    Expression *left, *right;
+	while (unfinished.back().construct == ASSIGNMENT) {
+	    expr = checkAssign(unfinished.back().expr, expr);
+	    unfinished.pop_back();
+	}
 
+	Pending &top = unfinished.back();
+
+	if (top.construct == PARENTHESES) {
+	    unfinished.pop_back();
+	    match(')');
 
-    left = multiplicativeExpression();
+	} else if (top.construct == SUBSCRIPT) {
+	    expr = checkArray(top.expr, expr);
+	    unfinished.pop_back();
+	    match(']');
 
-    while (1) {
-	if (lookahead == '+') {
-	    match('+');
-	    right = multiplicativeExpression();
-	    left = checkAdd(left, right);
+	} else if (top.construct == ARGUMENT) {
+	    if ((expr = argument(expr)) == Tree::NONE)
+		return Tree::NONE;
 
-	} else if (lookahead == '-') {
-	    match('-');
-	    right = multiplicativeExpression();
-	    left = checkSubtract(left, right);
+	} else {
+	    unfinished.pop_back();
+	    return expr;
+	}
 
-	} else
-	    break;
+	primary = true;
     }
-
-    return left;
 }
 
 
 /*
- * Function:	relationalExpression
+ * Function:	expression
  *
- * Description:	Parse a relational expression.  Note that Simple C does not
- *		have shift operators, so we go immediately to additive
- *		expressions.
+ * Description:	Parse an expression, or more specifically, an assignment
+ *		expression, since Simple C does not allow comma as an
+ *		expression operator.  We keep parsing the start of an
+ *		operand and finishing what we can until the expression is
+ *		done.
  *
- *		relational-expression:
- *		  additive-expression
- *		  relational-expression < additive-expression
- *		  relational-expression > additive-expression
- *		  relational-expression <= additive-expression
- *		  relational-expression >= additive-expression
+ *		expression:
+ *		  logical-or-expression
+ *		  logical-or-expression = expression
  */
 
-static Expression *relationalExpression()
+static Tree::Id expression()
 {
-    Expression *left, *right;
-
-
-    left = additiveExpression();
+    Tree::Id expr;
+    bool primary;
 
-    while (1) {
-	if (lookahead == '<') {
-	    match('<');
-	    right = additiveExpression();
-	    left = checkLessThan(left, right);
 
-	} else if (lookahead == '>') {
-	    match('>');
-	    right = additiveExpression();
-	    left = checkGreaterThan(left, right);
+    push(EXPRESSION);
 
-	} else if (lookahead == LEQ) {
-	    match(LEQ);
-	    right = additiveExpression();
-	    left = checkLessOrEqual(left, right);
+    do {
+	expr = castExpression(primary);
 
-	} else if (lookahead == GEQ) {
-	    match(GEQ);
-	    right = additiveExpression();
-	    left = checkGreaterOrEqual(left, right);
+	if (expr != Tree::NONE)
+	    expr = finish(expr, primary);
 
-	} else
-	    break;
-    }
+    } while (expr == Tree::NONE);
 
-    return left;
+    return expr;
 }
 
 
 /*
- * Function:	equalityExpression
+ * Function:	statement
  *
- * Description:	Parse an equality expression.
+ * Description:	Parse the start of a statement.  Note that Simple C has
+ *		so few statements that we handle them all in this one
+ *		function.  A return or expression statement is parsed in
+ *		full and returned, but a block, while, or if statement is
+ *		left unfinished while its statements are parsed, and we
+ *		return null.
  *
- *		equality-expression:
- *		  relational-expression
- *		  equality-expression == relational-expression
- *		  equality-expression != relational-expression
+ *		statement:
+ *		  { declarations statements }
+ *		  return expression ;
+ *		  while ( expression ) statement
+ *		  if ( expression ) statement
+ *		  if ( expression ) statement else statement
+ *		  expression ;
  */
 
-static Expression *equalityExpression()
+static Tree::Id statement()
 {
-    Expression *left, *right;
-
-
-    left = relationalExpression();
-
-    while (1) {
-	if (lookahead == EQL) {
-	    match(EQL);
-	    right = relationalExpression();
-	    left = checkEqual(left, right);
+    Tree *tree = Tree::current();
+    Scope *decls;
+    Tree::Id expr;
 
-	} else if (lookahead == NEQ) {
-	    match(NEQ);
-	    right = relationalExpression();
-	    left = checkNotEqual(left, right);
 
-	} else
-	    break;
-    }
-
-    return left;
-}
-
-
-/*
- * Function:	logicalAndExpression
- *
- * Description:	Parse a logical-and expression.  Note that Simple C does
- *		not have bitwise-and expressions.
- *
- *		logical-and-expression:
- *		  equality-expression
- *		  logical-and-expression && equality-expression
- */
-
-static Expression *logicalAndExpression()
-{
-    Expression *left, *right;
-
-
-    left = equalityExpression();
-
-    while (lookahead == AND) {
-	match(AND);
-	right = equalityExpression();
-	left = checkLogicalAnd(left, right);
+    if (context->lookahead == '{') {
+	match('{');
+	decls = openScope();
+	declarations();
+	push(COMPOUND).decls = decls;
+	unfinished.back().first = statements.size();
+	return Tree::NONE;
     }
-
-    return left;
-}
-
-
-/*
- * Function:	logicalOrExpression
- *
- * Description:	Parse a logical-or expression.  Note that Simple C does not
- *		have bitwise-or expressions.
- *
- *		logical-or-expression:
- *		  logical-and-expression
- *		  logical-or-expression || logical-and-expression
- */
-
-static Expression *logicalOrExpression()
-{
-    Expression *left, *right;
-
-
-    left = logicalAndExpression();
-
-    while (lookahead == OR) {
-	match(OR);
-	right = logicalAndExpression();
-	left = checkLogicalOr(left, right);
+    
+    if (context->lookahead == RETURN) {
+	match(RETURN);
+	expr = expression();
+	checkReturn(expr, context->returnType);
+	match(';');
+	return tree->newReturn(expr);
     }
-
-    return left;
-}
-
-
-/*
- * Function:	expression
- *
- * Description:	Parse an expression, or more specifically, an assignment
- *		expression, since Simple C does not allow comma as an
- *		expression operator.
- *
- *		expression:
- *		  logical-or-expression
- *		  logical-or-expression = expression
- */
-
-static Expression *expression()
-{
-    Expression *left, *right;
-
-
-    left = logicalOrExpression();
-
-    if (lookahead == '=') {
-	match('=');
-	right = expression();
-	left = checkAssign(left, right);
+    
+    if (context->lookahead == WHILE) {
+	match(WHILE);
+	match('(');
+	expr = expression();
+	checkTest(expr);
+	match(')');
+	push(LOOP, expr);
+	return Tree::NONE;
     }
+    
+    if (context->lookahead == IF) {
+	match(IF);
+	match('(');
+	expr = expression();
+	checkTest(expr);
+	match(')');
+	push(CONDITIONAL, expr).stmt = Tree::NONE;
+	return Tree::NONE;
+    } 
 
-    return left;
+    expr = expression();
+    match(';');
+    return expr;
 }
 
 
 /*
- * Function:	statements
+ * Function:	block
  *
- * Description:	Parse a possibly empty sequence of statements.  Rather than
- *		checking if the next token starts a statement, we check if
- *		the next token ends the sequence, since a sequence of
- *		statements is always terminated by a closing brace.
+ * Description:	Parse the declarations and statements of a block whose
+ *		scope is already open, up to and including the closing
+ *		brace, and return the block.  Rather than checking if the
+ *		next token starts a statement, we check if the next token
+ *		ends the sequence, since a sequence of statements is
+ *		always terminated by a closing brace.  Each statement
+ *		remembers the line on which it starts.  Since statements
+ *		may contain blocks and other statements, we keep
+ *		parsing the start of a statement and finishing what we
+ *		can until our own block is done.
  *
  *		statements:
  *		  empty
  *		  statement statements
  */
 
-static Statements statements()
+static Tree::Id block(Scope *decls)
 {
-    Statements stmts;
+    Tree *tree = Tree::current();
+    size_t depth = unfinished.size();
+    Tree::Id stmt;
 
 
-    while (lookahead != '}')
-	stmts.push_back(statement());
+    declarations();
+    push(COMPOUND).decls = decls;
+    unfinished.back().first = statements.size();
 
-    return stmts;
-}
+    while (true) {
+	Pending &next = unfinished.back();
 
+	if (next.construct == COMPOUND && context->lookahead == '}') {
+	    closeScope();
+	    match('}');
+	    stmt = tree->newBlock(next.decls, statements, next.first);
+	    unfinished.pop_back();
 
-/*
- * Function:	statement
- *
- * Description:	Parse a statement.  Note that Simple C has so few
- *		statements that we handle them all in this one function.
- *
- *		statement:
- *		  { declarations statements }
- *		  return expression ;
- *		  while ( expression ) statement
- *		  if ( expression ) statement
- *		  if ( expression ) statement else statement
- *		  expression ;
- */
+	    if (unfinished.size() == depth)
+		return stmt;
 
-static Statement *statement()
-{
-    Scope *decls;
-    Statements stmts;
-    Expression *expr;
-    Statement *stmt;
+	} else {
+	    if (next.construct == COMPOUND)
+		next.line = context->tokens.line[context->current];
 
+	    stmt = statement();
+	}
 
-    if (lookahead == '{') {
-	match('{');
-	decls = openScope();
-	declarations();
-	stmts = statements();
-	closeScope();
-	match('}');
-	return new Block(decls, stmts);
+	while (stmt != Tree::NONE) {
+	    Pending &top = unfinished.back();
 
-    }
-    
-    if (lookahead == RETURN) {
-	match(RETURN);
-	expr = expression();
-	checkReturn(expr, returnType);
-	match(';');
-	return new Return(expr);
-    }
-    
-    if (lookahead == WHILE) {
-	match(WHILE);
-	match('(');
-	expr = expression();
-	checkTest(expr);
-	match(')');
-	stmt = statement();
-	return new While(expr, stmt);
-    }
-    
-    if (lookahead == IF) {
-	match(IF);
-	match('(');
-	expr = expression();
-	checkTest(expr);
-	match(')');
-	stmt = statement();
+	    if (top.construct == COMPOUND) {
+		statements.push_back(Tree::Statement {stmt, top.line});
+		stmt = Tree::NONE;
 
-	if (lookahead != ELSE)
-	    return new If(expr, stmt, nullptr);
+	    } else if (top.construct == LOOP) {
+		stmt = tree->newWhile(top.expr, stmt);
+		unfinished.pop_back();
 
-	match(ELSE);
-	return new If(expr, stmt, statement());
-    } 
+	    } else if (top.stmt == Tree::NONE && context->lookahead == ELSE) {
+		match(ELSE);
+		top.stmt = stmt;
+		stmt = Tree::NONE;
 
-    expr = expression();
-    match(';');
-    return expr;
+	    } else {
+		if (top.stmt == Tree::NONE)
+		    stmt = tree->newIf(top.expr, stmt, Tree::NONE);
+		else
+		    stmt = tree->newIf(top.expr, top.stmt, stmt);
+
+		unfinished.pop_back();
+	    }
+	}
+    }
 }
 
 
@@ -810,12 +1025,12 @@ static Type parameter()
 {
     unsigned indirection;
     int typespec;
-    string name;
+    unsigned name;
 
 
     typespec = specifier();
     indirection = pointers();
-    name = expect(ID);
+    name = expectId(ID);
 
     Type type = Type(typespec, indirection);
     declareParameter(name, type);
@@ -838,22 +1053,79 @@ static Type parameter()
  *		  parameter , parameter-list
  */
 
-static Parameters *parameters()
+static void parameters(Parameters &params)
 {
-    Parameters *params = new Parameters();
-
-    if (lookahead == VOID)
+    if (context->lookahead == VOID)
 	match(VOID);
     else {
-	params->push_back(parameter());
+	params.push_back(parameter());
 
-	while (lookahead == ',') {
+	while (context->lookahead == ',') {
 	    match(',');
-	    params->push_back(parameter());
+	    params.push_back(parameter());
 	}
     }
+}
+
+
+/*
+ * Function:	skim
+ *
+ * Description:	Record the body of the function just declared, whose
+ *		parameters are in the given scope, and move past it by
+ *		matching its braces, leaving it to be parsed later.  The
+ *		lexical errors of the body, and of the token after it, are
+ *		left for whoever parses it to report, just as if it had
+ *		been parsed here.
+ */
+
+static void skim(deque<Body> &bodies, Symbol *symbol, Scope *decls)
+{
+    const TokenStream &tokens = context->tokens;
+    const Symbols &symbols = decls->symbols();
+    unsigned depth = 0, n = context->current;
+
+
+    if (context->lookahead != '{')
+	error();
+
+    bodies.emplace_back();
+    Body &body = bodies.back();
+
+    body.symbol = symbol;
+    body.function = Tree::NONE;
+    body.reached = context->roots.empty();
+    body.returnType = context->returnType;
+    body.first = n;
+    body.visible = context->declarations;
+    body.skimmed = context->diagnostics.tellp();
+    body.reported = context->numErrors;
+
+    for (unsigned i = 0; i < symbols.size(); i ++)
+	body.params.push_back(make_pair(symbols[i]->id(), symbols[i]->type()));
+
+    closeScope();
+
+    while (tokens.kind[n] != DONE) {
+	if (tokens.kind[n] == '{')
+	    depth ++;
+	else if (tokens.kind[n] == '}' && -- depth == 0)
+	    break;
+
+	n ++;
+    }
+
+    body.last = n;
+    n = min(n + 1, (unsigned) tokens.kind.size() - 1);
+
+    while (context->pending < tokens.errors.size() &&
+	    tokens.errors[context->pending].token <= n)
+	context->pending ++;
 
-    return params;
+    context->reached = n + 1;
+    context->current = n;
+    context->lineno = tokens.line[n];
+    context->lookahead = tokens.kind[n];
 }
 
 
@@ -861,7 +1133,13 @@ static Parameters *parameters()
  * Function:	globalDeclaration
  *
  * Description:	Parse a global variable declaration, function declaration,
- *		or function definition.
+ *		or function definition.  A function definition is built in
+ *		its own tree and arena and handed to the code generator,
+ *		which clears the tree and releases the arena once the code
+ *		has been generated, perhaps by another thread while we go
+ *		on parsing.  If we are given a list of BODIES, the body of
+ *		a function is only skimmed and added to it instead, and
+ *		the parameters come from a scratch arena.
  *
  *		global-declaration:
  *		  specifier global-declarator-list ;
@@ -879,82 +1157,97 @@ static Parameters *parameters()
  *		  specifier pointers identifier ( parameters ) { ... }
  */
 
-static void globalDeclaration()
+static void globalDeclaration(deque<Body> *bodies)
 {
     Symbol *symbol;
     unsigned indirection, length;
     int typespec;
-    string name;
+    unsigned name;
 
 
     typespec = specifier();
     indirection = pointers();
-    name = expect(ID);
+    name = expectId(ID);
 
-    if (lookahead == '[') {
+    if (context->lookahead == '[') {
 	match('[');
-	length = strtoul(expect(INTEGER).c_str(), NULL, 0);
+	length = strtoul(expect(INTEGER).str().c_str(), NULL, 0);
 	symbol = declareVariable(name, Type(typespec, indirection, length));
-	globals.push_back(symbol);
+	context->globals.push_back(symbol);
 	match(']');
 
-    } else if (lookahead == '(') {
+    } else if (context->lookahead == '(') {
 	match('(');
 
-	if (lookahead == ')') {
+	if (context->lookahead == ')') {
 	    match(')');
 	    declareFunction(name, Type(typespec, indirection, nullptr));
 
 	} else {
+	    static thread_local Parameters params;
+	    static thread_local Arena scratch;
+	    Arena *outer = Arena::current();
+	    Tree *tree = Tree::current();
+	    FunctionCode *code = nullptr;
 	    Scope *decls;
-	    Function *function;
-	    Statements stmts;
-	    Parameters *params;
+	    Tree::Id function;
+
+	    if (bodies != nullptr)
+		Arena::current(&scratch);
+	    else {
+		code = openFunction();
+		Arena::current(&code->arena);
+		Tree::current(&code->tree);
+	    }
 
 	    decls = openScope();
-	    params = parameters();
-	    returnType = Type(typespec, indirection);
-	    symbol = declareFunction(name, Type(typespec, indirection, params));
+	    params.clear();
+	    parameters(params);
+	    context->returnType = Type(typespec, indirection);
+	    symbol = declareFunction(name, Type(typespec, indirection, &params));
 	    match(')');
-	    match('{');
-	    declarations();
-	    stmts = statements();
-	    closeScope();
-	    match('}');
 
-	    function = new Function(symbol, new Block(decls, stmts));
+	    if (bodies != nullptr) {
+		skim(*bodies, symbol, decls);
+		Arena::current(outer);
+		scratch.release();
+		return;
+	    }
 
-	    if (numErrors == 0)
-		function->generate();
+	    match('{');
+	    function = code->tree.newFunction(symbol, block(decls));
 
+	    Arena::current(outer);
+	    Tree::current(tree);
+	    closeFunction(code, context->numErrors == 0 ? function : Tree::NONE);
 	    return;
 	}
 
     } else {
 	symbol = declareVariable(name, Type(typespec, indirection));
-	globals.push_back(symbol);
+	context->globals.push_back(symbol);
     }
 
-    while (lookahead == ',') {
+    while (context->lookahead == ',') {
 	match(',');
 	indirection = pointers();
-	name = expect(ID);
+	name = expectId(ID);
 
-	if (lookahead == '[') {
+	if (context->lookahead == '[') {
 	    match('[');
-	    length = strtoul(expect(INTEGER).c_str(), NULL, 0);
+	    length = strtoul(expect(INTEGER).str().c_str(), NULL, 0);
 	    symbol = declareVariable(name, Type(typespec, indirection, length));
-	    globals.push_back(symbol);
+	    context->globals.push_back(symbol);
 	    match(']');
 
-	} else if (lookahead == '(') {
+	} else if (context->lookahead == '(') {
 	    match('(');
 	    match(')');
 	    declareFunction(name, Type(typespec, indirection, nullptr));
 
 	} else {
 	    symbol = declareVariable(name, Type(typespec, indirection));
-	    globals.push_back(symbol);
+	    context->globals.push_back(symbol);
 	}
     }
 
@@ -963,23 +1256,814 @@ static void globalDeclaration()
 
 
 /*
- * Function:	main
+ * Function:	reachable
+ *
+ * Description:	Mark the skimmed bodies that are reachable from the roots
+ *		of the unit.  The body of a root is reachable, and so is
+ *		the body of any function that a reachable body calls: that
+ *		is, whose name it follows with an opening parenthesis,
+ *		and which was declared as that name when the body began.
+ *		Since a local variable may hide the function, we may reach
+ *		more than we need, but never less.  The names of any roots
+ *		that have no body are added to UNDEFINED.
+ */
+
+static void reachable(deque<Body> &bodies, vector<string> &undefined)
+{
+    const TokenStream &tokens = context->tokens;
+    map<const Symbol *, unsigned> definitions;
+    map<const Symbol *, unsigned>::iterator it;
+    vector<const Symbol *> called;
+    unsigned id;
+
+
+    for (unsigned i = 0; i < bodies.size(); i ++)
+	definitions[bodies[i].symbol] = i;
+
+    for (unsigned i = 0; i < context->roots.size(); i ++) {
+	id = Interner::current()->intern(context->roots[i]);
+	called.push_back(context->outermost->find(id));
+
+	if (definitions.count(called.back()) == 0)
+	    undefined.push_back(context->roots[i]);
+    }
+
+    while (!called.empty()) {
+	it = definitions.find(called.back());
+	called.pop_back();
+
+	if (it == definitions.end() || bodies[it->second].reached)
+	    continue;
+
+	Body &body = bodies[it->second];
+	body.reached = true;
+
+	for (unsigned n = body.first; n < body.last; n ++)
+	    if (tokens.kind[n] == ID && tokens.kind[n + 1] == '(') {
+		id = tokens.id[n];
+		called.push_back(context->outermost->find(id, body.visible));
+	    }
+    }
+}
+
+
+/*
+ * Function:	fingerprint
+ *
+ * Description:	Add the given type to the given digest.
+ */
+
+static void fingerprint(Digest &digest, const Type &type)
+{
+    const Parameters *params;
+
+
+    digest.add(type.isArray() ? 1 : type.isFunction() ? 2 : type.isError());
+    digest.add(type.specifier()).add(type.indirection());
+
+    if (type.isArray())
+	digest.add(type.length());
+    else if (type.isFunction()) {
+	params = type.parameters();
+	digest.add(params != nullptr ? params->size() + 1 : 0);
+
+	for (unsigned i = 0; params != nullptr && i < params->size(); i ++)
+	    fingerprint(digest, (*params)[i]);
+    }
+}
+
+
+/*
+ * Function:	flawed
+ *
+ * Description:	Return whether the given body has lexical errors, or its
+ *		closing brace is followed by a token with lexical errors,
+ *		in which case its tokens do not tell us what it would
+ *		report.
+ */
+
+static bool flawed(const Body &body)
+{
+    const TokenStream &tokens = context->tokens;
+    vector<LexicalError>::const_iterator it;
+
+
+    it = lower_bound(tokens.errors.begin(), tokens.errors.end(), body.first + 1,
+	    [](const LexicalError &error, unsigned token) {
+		return error.token < token;
+	    });
+
+    return it != tokens.errors.end() && it->token <= body.last + 1;
+}
+
+
+/*
+ * Function:	fingerprint
+ *
+ * Description:	Give the given body the key of its entry in the cache: the
+ *		digest of its function and parameters, of its tokens, and
+ *		of what each identifier among them was declared as at
+ *		file scope when the body began.  If lines are annotated,
+ *		the line of each token matters too.  A flawed body is left
+ *		without a key.
+ */
+
+static void fingerprint(Body &body)
+{
+    const TokenStream &tokens = context->tokens;
+    const Symbol *symbol;
+    Digest digest;
+
+
+    body.entry.key.clear();
+
+    if (flawed(body))
+	return;
+
+    digest.add(context->annotations).add(body.symbol->name());
+    fingerprint(digest, body.symbol->type());
+    digest.add(body.params.size());
+
+    for (unsigned i = 0; i < body.params.size(); i ++) {
+	digest.add(Interner::current()->name(body.params[i].first));
+	fingerprint(digest, body.params[i].second);
+    }
+
+    for (unsigned n = body.first; n <= body.last; n ++) {
+	digest.add(tokens.kind[n]).add(tokens.length[n]);
+	digest.add(lexeme(n).data(), tokens.length[n]);
+
+	if (context->annotations == ANNOTATE_LINES)
+	    digest.add(tokens.line[n]);
+
+	if (tokens.kind[n] == ID) {
+	    symbol = context->outermost->find(tokens.id[n], body.visible);
+	    digest.add(symbol != nullptr);
+
+	    if (symbol != nullptr)
+		fingerprint(digest, symbol->type());
+	}
+    }
+
+    body.entry.key = digest.str();
+}
+
+
+/*
+ * Function:	parseBody
+ *
+ * Description:	Parse and check the given function body of the given unit
+ *		with one of its idle contexts, or a new one, and with the
+ *		tree and arena of the function current.  The context
+ *		starts at the opening brace, with the parameters in a
+ *		scope of their own and the outermost scope of the unit as
+ *		it was then.  A body with more nodes than its tree can
+ *		hold fails just like one with a syntax error.
+ */
+
+static void parseBody(CompilerContext *unit, Body *body)
+{
+    Timer timer(PARSING, unit->names->name(body->symbol->id()));
+    CompilerContext *caller = context, *parser;
+    Arena *outer = Arena::current();
+    Tree *tree = Tree::current();
+    Interner *interner = Interner::current();
+    const TokenStream &tokens = unit->tokens;
+    vector<LexicalError>::const_iterator it;
+    stringbuf text;
+    Scope *decls;
+
+
+    {
+	lock_guard<mutex> guard(unit->mutex);
+
+	if (unit->idle.empty()) {
+	    unit->parsers.push_back(new CompilerContext(unit));
+	    unit->idle.push_back(unit->parsers.back());
+	}
+
+	parser = unit->idle.back();
+	unit->idle.pop_back();
+    }
+
+    context = parser;
+    Arena::current(&body->code->arena);
+    Tree::current(&body->code->tree);
+    Interner::current(unit->names);
+    unfinished.clear();
+    arguments.clear();
+    statements.clear();
+
+    it = lower_bound(tokens.errors.begin(), tokens.errors.end(), body->first + 1,
+	    [](const LexicalError &error, unsigned token) {
+		return error.token < token;
+	    });
+
+    parser->diagnostics.rdbuf(&text);
+    parser->numErrors = 0;
+    parser->lineno = tokens.line[body->first];
+    parser->current = body->first;
+    parser->reached = body->first + 1;
+    parser->pending = it - tokens.errors.begin();
+    parser->lookahead = tokens.kind[body->first];
+    parser->returnType = body->returnType;
+    parser->toplevel = unit->outermost;
+    parser->visible = body->visible;
+
+    decls = openScope();
+
+    for (unsigned i = 0; i < body->params.size(); i ++)
+	decls->insert(new Symbol(body->params[i].first, body->params[i].second));
+
+    try {
+	match('{');
+	body->function = body->code->tree.newFunction(body->symbol,
+		block(decls));
+    } catch (const SyntaxError &) {
+	parser->bindings.assign(parser->bindings.size(), nullptr);
+	body->failed = true;
+    } catch (const length_error &e) {
+	parser->diagnostics << e.what() << endl;
+	parser->numErrors ++;
+	parser->bindings.assign(parser->bindings.size(), nullptr);
+	body->failed = true;
+    }
+
+    body->errors = parser->numErrors;
+    body->diagnostics = text.str();
+    body->literals.swap(parser->literals);
+    parser->literals.clear();
+    parser->diagnostics.rdbuf(nullptr);
+
+    Interner::current(interner);
+    Tree::current(tree);
+    Arena::current(outer);
+    context = caller;
+
+    lock_guard<mutex> guard(unit->mutex);
+    unit->idle.push_back(parser);
+    body->done = true;
+    unit->written.notify_all();
+}
+
+
+/*
+ * Function:	skipped
+ *
+ * Description:	Report the lexical errors of the token after the given
+ *		body, which is not to be parsed, and return how many there
+ *		were.
+ */
+
+static int skipped(const Body &body)
+{
+    const TokenStream &tokens = context->tokens;
+    vector<LexicalError>::const_iterator it;
+    unsigned n = body.last + 1;
+    int count = 0;
+
+
+    if (n >= tokens.kind.size())
+	return 0;
+
+    it = lower_bound(tokens.errors.begin(), tokens.errors.end(), n,
+	    [](const LexicalError &error, unsigned token) {
+		return error.token < token;
+	    });
+
+    context->lineno = tokens.line[n];
+
+    for (; it != tokens.errors.end() && it->token == n; it ++, count ++)
+	report(it->message);
+
+    return count;
+}
+
+
+/*
+ * Function:	reuse
+ *
+ * Description:	Merge back the given body, whose code was fetched from the
+ *		cache: its literals are numbered as if it had been parsed,
+ *		and its code is written out if there have been no errors
+ *		so far.
+ */
+
+static void reuse(Body &body)
+{
+    CacheEntry &entry = body.entry;
+    Interner *names = Interner::current();
+    unsigned value;
+
+
+    entry.labels.clear();
+
+    for (unsigned i = 0; i < entry.literals.size(); i ++)
+	if (entry.literals[i].first == 'S') {
+	    value = names->intern(entry.literals[i].second);
+	    entry.labels.push_back(Tree::numberString(value));
+	} else
+	    entry.labels.push_back(Tree::numberReal(entry.literals[i].second));
+
+    if (context->numErrors == 0)
+	spliceFunction(context->cache->splice(entry));
+}
+
+
+/*
+ * Function:	keep
+ *
+ * Description:	Give the buffer of the given body, which has just been
+ *		merged back, the entry of the body, along with the
+ *		literals of the body and the labels they were given, so
+ *		that its code is stored in the cache once it is
+ *		generated.
+ */
+
+static void keep(Body &body)
+{
+    CacheEntry &entry = body.code->entry;
+    Interner *names = Interner::current();
+    Tree &tree = body.code->tree;
+    Tree::Id id;
+
+
+    entry.key.swap(body.entry.key);
+    entry.literals.clear();
+    entry.labels.clear();
+
+    for (unsigned i = 0; i < body.literals.size(); i ++) {
+	id = body.literals[i];
+
+	if (Tree::kind(id) == Tree::STRING_EXPR) {
+	    Tree::String &s = tree.string(id);
+	    entry.literals.push_back(make_pair('S', names->name(s.value)));
+	    entry.labels.push_back(s.label);
+	} else {
+	    Tree::Real &r = tree.real(id);
+	    entry.literals.push_back(make_pair('R', tree.spelling(r.spelling)));
+	    entry.labels.push_back(r.label);
+	}
+    }
+}
+
+
+/*
+ * Function:	transcribe
+ *
+ * Description:	Write a transcript of the tokens of the given body to
+ *		TRANSCRIPT: the kind of each, its line relative to the
+ *		first line of the body, and the id of its spelling if it
+ *		is a name or a string, or otherwise its length and its
+ *		spelling if it is a number or an error.  The spelling of
+ *		any other token follows from its kind.  Two bodies with
+ *		the same transcript are the same tokens in the same
+ *		places.
+ */
+
+static void transcribe(const Body &body, string &transcript)
+{
+    const TokenStream &tokens = context->tokens;
+    unsigned words[3];
+    int kind;
+
+
+    transcript.clear();
+
+    for (unsigned n = body.first; n <= body.last; n ++) {
+	kind = tokens.kind[n];
+	words[0] = kind;
+	words[1] = tokens.line[n] - tokens.line[body.first];
+	words[2] = tokens.id[n];
+
+	if (kind == INTEGER || kind == REAL || kind == ERROR) {
+	    words[2] = tokens.length[n];
+	    transcript.append((const char *) words, sizeof(words));
+	    transcript.append(lexeme(n).data(), tokens.length[n]);
+	} else
+	    transcript.append((const char *) words, sizeof(words));
+    }
+}
+
+
+/*
+ * Function:	current
+ *
+ * Description:	Return whether what the given body reported when it was
+ *		checked, as remembered in CHECKED, still holds, given that
+ *		its tokens are the same: its function and parameters must
+ *		be the same, and each name in it must still mean what it
+ *		did at file scope.  We need only look at the names again
+ *		if the body sees different declarations than it did.
+ */
+
+static bool current(const Checked &checked, const Body &body)
+{
+    const Symbol *symbol;
+
+
+    if (!Memo::same(checked.type, body.symbol->type()) ||
+	    checked.params.size() != body.params.size())
+	return false;
+
+    for (unsigned i = 0; i < body.params.size(); i ++)
+	if (checked.params[i].first != body.params[i].first ||
+		!Memo::same(checked.params[i].second, body.params[i].second))
+	    return false;
+
+    if (!context->memo->changed() && checked.visible == body.visible)
+	return true;
+
+    for (unsigned i = 0; i < checked.uses.size(); i ++) {
+	symbol = context->outermost->find(checked.uses[i].id, body.visible);
+
+	if (checked.uses[i].declared != (symbol != nullptr))
+	    return false;
+
+	if (symbol != nullptr && !Memo::same(checked.uses[i].type,
+		symbol->type()))
+	    return false;
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	recall
  *
- * Description:	Analyze the standard input stream.
+ * Description:	Look for the given body in the memo of the unit, and if
+ *		its tokens are the same as they were and what it reported
+ *		still holds, give it that, with the lines moved to where
+ *		it is now, and return true.  A body that is not recalled
+ *		keeps its transcript, so that it can be remembered once
+ *		it is checked.  A flawed body is never recalled.
  */
 
-int main()
+static bool recall(Body &body)
 {
+    static thread_local string transcript;
+    const TokenStream &tokens = context->tokens;
+    Memo &memo = *context->memo;
+    const Checked *checked;
+
+
+    if (flawed(body))
+	return false;
+
+    transcribe(body, transcript);
+    checked = memo.find(body.symbol->id());
+
+    if (checked == nullptr || checked->transcript != transcript ||
+	    !current(*checked, body)) {
+	body.transcript = transcript;
+	return false;
+    }
+
+    body.diagnostics = Memo::rebase(checked->diagnostics,
+	    tokens.line[body.first]);
+    body.errors = checked->errors;
+    body.failed = checked->failed;
+    memo.recall(body.symbol->id());
+    return true;
+}
+
+
+/*
+ * Function:	remember
+ *
+ * Description:	Remember what the given body, which has just been merged
+ *		back, reported, along with what each name in it meant at
+ *		file scope, in the memo of the unit.
+ */
+
+static void remember(Body &body)
+{
+    const TokenStream &tokens = context->tokens;
+    const Symbol *symbol;
+    vector<unsigned> ids;
+    Checked checked;
+    Use use;
+
+
+    if (body.transcript.empty())
+	return;
+
+    for (unsigned n = body.first; n <= body.last; n ++)
+	if (tokens.kind[n] == ID)
+	    ids.push_back(tokens.id[n]);
+
+    sort(ids.begin(), ids.end());
+    ids.erase(unique(ids.begin(), ids.end()), ids.end());
+
+    for (unsigned i = 0; i < ids.size(); i ++) {
+	symbol = context->outermost->find(ids[i], body.visible);
+	use.id = ids[i];
+	use.declared = (symbol != nullptr);
+	use.type = (symbol != nullptr ? symbol->type() : Type());
+	checked.uses.push_back(use);
+    }
+
+    checked.transcript.swap(body.transcript);
+    checked.type = body.symbol->type();
+    checked.params = body.params;
+    checked.visible = body.visible;
+    checked.diagnostics = Memo::rebase(body.diagnostics,
+	    -(long) tokens.line[body.first]);
+    checked.errors = body.errors;
+    checked.failed = body.failed;
+    context->memo->remember(body.symbol->id(), checked);
+}
+
+
+/*
+ * Function:	parseBodies
+ *
+ * Description:	Parse the global declarations of the unit, skimming the
+ *		function bodies, and then parse the bodies using the given
+ *		pool.  Each body is merged back in order: the diagnostics
+ *		reported before it and by it are written out, its
+ *		literals are numbered, and it is handed to the code
+ *		generator if there have been no errors so far.  So
+ *		everything comes out exactly as if we had parsed the unit
+ *		from start to finish.  A syntax error stops us where it
+ *		would have then, and so does a root that is not defined,
+ *		once the rest is skimmed.  A body that is not reached is left
+ *		alone, except for the lexical errors of the token after
+ *		it, which it would otherwise have reported.  A body whose
+ *		code is in the cache is not parsed either, but is merged
+ *		back just the same, and the code of any other body that
+ *		is generated is stored there.  Nor is a body that the memo
+ *		recalls, which is merged back without being generated,
+ *		and every other body is remembered there.
+ */
+
+static void parseBodies(ThreadPool &pool)
+{
+    CompilerContext *unit = context;
+    streambuf *stream = unit->diagnostics.rdbuf();
+    Arena *outer = Arena::current();
+    unsigned next = 0, window = AHEAD * pool.size();
+    int skimmed, parsed = 0;
+    bool failed = false;
+    size_t written = 0;
+    vector<string> undefined;
+    deque<Body> bodies;
+    stringbuf text;
+    string skim;
+
+
+    unit->diagnostics.rdbuf(&text);
+
+    try {
+	while (unit->lookahead != DONE)
+	    globalDeclaration(&bodies);
+
+    } catch (const SyntaxError &) {
+	while (unit->toplevel != unit->outermost)
+	    closeScope();
+
+	Arena::current(outer);
+	failed = true;
+    }
+
+    if (!unit->roots.empty())
+	reachable(bodies, undefined);
+
+    if (!failed && !undefined.empty()) {
+	for (unsigned i = 0; i < undefined.size(); i ++) {
+	    unit->diagnostics << "root " << undefined[i];
+	    unit->diagnostics << " is not defined" << endl;
+	    unit->numErrors ++;
+	}
+
+	for (unsigned i = 0; i < bodies.size(); i ++)
+	    bodies[i].reached = false;
+
+	failed = true;
+    }
+
+    unit->diagnostics.rdbuf(stream);
+    skim = text.str();
+    skimmed = unit->numErrors;
+
+    if (unit->memo != nullptr)
+	unit->memo->begin(unit->outermost->symbols());
+
+    /* A single thread has a single function buffer to parse into. */
+
+    if (pool.size() == 1)
+	window = 1;
+
+    for (unsigned i = 0; i < bodies.size(); i ++) {
+	Body &body = bodies[i];
+
+	for (; next < bodies.size() && next < i + window; next ++) {
+	    Body *waiting = &bodies[next];
+
+	    if (!waiting->reached)
+		continue;
+
+	    if (unit->memo != nullptr && recall(*waiting)) {
+		waiting->recalled = waiting->done = true;
+		continue;
+	    }
+
+	    if (unit->cache != nullptr) {
+		fingerprint(*waiting);
+
+		if (!waiting->entry.key.empty() &&
+			unit->cache->fetch(waiting->entry)) {
+		    waiting->cached = waiting->done = true;
+		    continue;
+		}
+	    }
+
+	    waiting->code = openFunction();
+	    pool.submit([unit, waiting]() {
+		parseBody(unit, waiting);
+	    });
+	}
+
+	if (!body.reached) {
+	    unit->diagnostics << skim.substr(written, body.skimmed - written);
+	    written = body.skimmed;
+	    parsed += skipped(body);
+	    continue;
+	}
+
+	if (body.cached) {
+	    unit->diagnostics << skim.substr(written, body.skimmed - written);
+	    written = body.skimmed;
+	    unit->numErrors = body.reported + parsed;
+	    reuse(body);
+	    continue;
+	}
+
+	{
+	    unique_lock<mutex> lock(unit->mutex);
+
+	    unit->written.wait(lock, [&body]() {
+		return body.done;
+	    });
+	}
+
+	unit->diagnostics << skim.substr(written, body.skimmed - written);
+	unit->diagnostics << body.diagnostics << flush;
+	written = body.skimmed;
+	parsed += body.errors;
+	unit->numErrors = body.reported + parsed;
+
+	if (unit->memo != nullptr && !body.recalled)
+	    remember(body);
+
+	if (body.failed) {
+	    unique_lock<mutex> lock(unit->mutex);
+
+	    unit->written.wait(lock, [&bodies, next]() {
+		for (unsigned j = 0; j < next; j ++)
+		    if (bodies[j].reached && !bodies[j].done)
+			return false;
+
+		return true;
+	    });
+
+	    if (unit->memo != nullptr)
+		unit->memo->end();
+
+	    throw SyntaxError();
+	}
+
+	if (body.recalled)
+	    continue;
+
+	for (unsigned j = 0; j < body.literals.size(); j ++)
+	    body.code->tree.number(body.literals[j]);
+
+	if (unit->numErrors == 0 && !body.entry.key.empty())
+	    keep(body);
+
+	closeFunction(body.code,
+		unit->numErrors == 0 ? body.function : Tree::NONE);
+    }
+
+    unit->diagnostics << skim.substr(written) << flush;
+    unit->numErrors = skimmed + parsed;
+
+    if (unit->memo != nullptr)
+	unit->memo->end();
+
+    if (failed)
+	throw SyntaxError();
+}
+
+
+/*
+ * Function:	seed
+ *
+ * Description:	If the source of the current context begins with the
+ *		source of its snapshot, declare the symbols of the snapshot
+ *		just as parsing that source would have, and return where
+ *		the rest of the source begins.  Otherwise, return the
+ *		start of the source, since there is nothing to skip.
+ */
+
+static const char *seed(unsigned &line)
+{
+    const Snapshot *snapshot = context->snapshot;
+    vector<pair<unsigned, Type> > symbols;
+    Symbol *symbol;
+
+
+    line = 1;
+
+    if (snapshot == nullptr ||
+	    !snapshot->begins(context->source, context->limit))
+	return context->source;
+
+    snapshot->symbols(symbols);
+
+    for (unsigned i = 0; i < symbols.size(); i ++)
+	if (symbols[i].second.isFunction())
+	    declareFunction(symbols[i].first, symbols[i].second);
+	else {
+	    symbol = declareVariable(symbols[i].first, symbols[i].second);
+	    context->globals.push_back(symbol);
+	}
+
+    line += snapshot->lines();
+    return context->source + snapshot->length();
+}
+
+
+/*
+ * Function:	parse
+ *
+ * Description:	Parse the source of the current context as a translation
+ *		unit, checking it and generating code for it as we go,
+ *		with the given pool tokenizing it, and parsing and
+ *		generating its functions.  It is preprocessed once it has
+ *		been tokenized, unless it has no directives and we parse
+ *		it alone, in which case it is tokenized a window at a time
+ *		instead.  Any part of it that is in the snapshot of the
+ *		context is declared from there instead, unless the context
+ *		was given its tokens already.
+ *		The stacks of unfinished constructs are emptied first, in
+ *		case a syntax error in an earlier unit left them full.
+ */
+
+void parse(ThreadPool &pool)
+{
+    Timer timer(PARSING);
+    const char *start;
+    unsigned line;
+    bool whole;
+
+
+    unfinished.clear();
+    arguments.clear();
+    statements.clear();
+
     openScope();
-    lookahead = lexan(lexbuf);
 
-    while (lookahead != DONE)
-	globalDeclaration();
+    whole = pool.size() > 1 || !context->roots.empty() ||
+	context->cache != nullptr || context->memo != nullptr;
 
-    closeScope();
+    if (!context->tokenized) {
+	start = seed(line);
+
+	if (!whole && memchr(start, '#', context->limit - start) == nullptr) {
+	    context->resume = start;
+	    context->resumeLine = line;
 
-    if (numErrors == 0)
-	generateGlobals(globals);
+	} else {
+	    Timer lexing(LEXING);
+
+	    tokenize(context->source, start, context->limit, line,
+		context->tokens, pool);
+	}
+    }
+
+    if (context->resume == nullptr) {
+	Timer preprocessing(PREPROCESSING);
+
+	preprocess();
+	Timer::count(TOKENS, context->tokens.kind.size());
+    }
+
+    context->lookahead = context->tokens.kind[reach(0)];
+
+    if (whole)
+	parseBodies(pool);
+    else
+	while (context->lookahead != DONE) {
+	    globalDeclaration(nullptr);
+	    release();
+	}
+
+    closeScope();
+    flushFunctions();
 
-    exit(EXIT_SUCCESS);
+    if (context->numErrors == 0)
+	generateGlobals(context->globals);
 }
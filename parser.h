@@ -0,0 +1,18 @@
+/*
+ * File:	parser.h
+ *
+ * Description:	This file contains the public function declarations for
+ *		the parser for Simple C.  The parser has no error recovery:
+ *		after reporting a syntax error, it throws a SyntaxError and
+ *		the rest of the unit is abandoned.
+ */
+
+# ifndef PARSER_H
+# define PARSER_H
+
+struct SyntaxError {
+};
+
+void parse(class ThreadPool &pool);
+
+# endif /* PARSER_H */
@@ -0,0 +1,577 @@
+/*
+ * File:	preprocessor.cpp
+ *
+ * Description:	This file contains the public and private function
+ *		definitions for the preprocessor for Simple C.
+ *
+ *		A new token stream is built from the tokens of the unit
+ *		and of the headers it includes, leaving out directives and
+ *		whatever they exclude, and replacing each macro with its
+ *		tokens.  A macro is never replaced within its own
+ *		replacement, so a macro that refers to itself is left as
+ *		it is, as in C.
+ */
+
+# include <algorithm>
+# include <cstdlib>
+# include <map>
+# include "preprocessor.h"
+# include "tokens.h"
+# include "CompilerContext.h"
+# include "Headers.h"
+
+using namespace std;
+
+/* An include nested this deeply is almost certainly a header including
+   itself, which would otherwise never end. */
+
+static const unsigned MAX_DEPTH = 200;
+
+struct Token {
+    unsigned short kind;
+    unsigned offset, length, id;
+};
+
+struct Conditional {
+    unsigned line;
+    bool enclosing, on, elsed;
+};
+
+struct File {
+    const TokenStream *tokens;
+    const vector<unsigned> *ids;
+    const char *text;
+    unsigned base;
+    string directory;
+    vector<Conditional> conditionals;
+};
+
+struct Preprocessor {
+    Headers *headers;
+    TokenStream out;
+    map<unsigned, vector<Token> > macros;
+    vector<unsigned> expanding;
+    map<const Header *, unsigned> bases;
+    map<const Header *, vector<unsigned> > names;
+    unsigned long long next;
+    unsigned depth, directives;
+};
+
+static void run(Preprocessor &pp, File &file);
+
+
+/*
+ * Function:	error
+ *
+ * Description:	Report an error in the directive on the given line.
+ */
+
+static void error(unsigned line, const string &str, const string &arg = "")
+{
+    context->lineno = line;
+    report(str, arg);
+}
+
+
+/*
+ * Function:	spelling
+ *
+ * Description:	Return the characters of the Nth token of the given file.
+ */
+
+static string spelling(const File &file, unsigned n)
+{
+    return string(file.text + file.tokens->offset[n], file.tokens->length[n]);
+}
+
+
+/*
+ * Function:	id
+ *
+ * Description:	Return the id of the Nth token of the given file.  The
+ *		tokens of a header refer to its spellings instead, so the
+ *		id of a name or string of a header is the id that its
+ *		spelling was interned as.
+ */
+
+static unsigned id(const File &file, unsigned n)
+{
+    const TokenStream &in = *file.tokens;
+
+    if (file.ids != nullptr && (in.kind[n] == ID || in.kind[n] == STRING))
+	return (*file.ids)[in.id[n]];
+
+    return in.id[n];
+}
+
+
+/*
+ * Function:	directive
+ *
+ * Description:	Return the name of the directive whose # is the Nth token
+ *		of the given stream, and which ends before the END token.
+ *		A directive with no name, or with a number for a name,
+ *		which is a line marker, has the empty name.
+ */
+
+static string directive(const char *text, const TokenStream &tokens,
+	unsigned n, unsigned end)
+{
+    if (n + 1 == end || tokens.kind[n + 1] == INTEGER)
+	return "";
+
+    return string(text + tokens.offset[n + 1], tokens.length[n + 1]);
+}
+
+
+/*
+ * Function:	starts
+ *
+ * Description:	Return whether the Nth token of the given stream is a #
+ *		that starts a directive, which it does if it is the first
+ *		token on its line.
+ */
+
+static bool starts(const TokenStream &tokens, unsigned n)
+{
+    return tokens.kind[n] == HASH &&
+	(n == 0 || tokens.line[n - 1] != tokens.line[n]);
+}
+
+
+/*
+ * Function:	line
+ *
+ * Description:	Return the index of the first token of the given stream
+ *		after the Nth that is not on its line, which is where a
+ *		directive starting there ends.
+ */
+
+static unsigned line(const TokenStream &tokens, unsigned n)
+{
+    unsigned end = n + 1, last = tokens.kind.size() - 1;
+
+    while (end < last && tokens.line[end] == tokens.line[n])
+	end ++;
+
+    return end;
+}
+
+
+/*
+ * Function:	guarded
+ *
+ * Description:	Return whether the tokens of the given header, whose
+ *		source is at SOURCE, are guarded by the macro named by
+ *		their third token.  They are if they are wholly within an
+ *		#ifndef of that macro, with no #else, since then they are
+ *		all left out whenever it is defined.
+ */
+
+bool guarded(const char *source, const TokenStream &tokens)
+{
+    unsigned n, end, last = tokens.kind.size() - 1, depth = 0;
+    string name;
+
+
+    if (last < 3 || !starts(tokens, 0) || line(tokens, 0) != 3 ||
+	    directive(source, tokens, 0, 3) != "ifndef" ||
+	    tokens.kind[2] != ID)
+	return false;
+
+    for (n = 0; n < last; n = end) {
+	end = starts(tokens, n) ? line(tokens, n) : n + 1;
+
+	if (end == n + 1)
+	    continue;
+
+	name = directive(source, tokens, n, end);
+
+	if (name == "if" || name == "ifdef" || name == "ifndef")
+	    depth ++;
+	else if (name == "else" && depth == 1)
+	    return false;
+	else if (name == "endif" && -- depth == 0)
+	    return end == last;
+    }
+
+    return false;
+}
+
+
+/*
+ * Function:	skipping
+ *
+ * Description:	Return whether the tokens of the given file are being left
+ *		out at the moment.
+ */
+
+static bool skipping(const File &file)
+{
+    return !file.conditionals.empty() && !file.conditionals.back().on;
+}
+
+
+/*
+ * Function:	emit
+ *
+ * Description:	Add the given token to the output on the given line.
+ */
+
+static void emit(Preprocessor &pp, const Token &token, unsigned line)
+{
+    pp.out.kind.push_back(token.kind);
+    pp.out.offset.push_back(token.offset);
+    pp.out.length.push_back(token.length);
+    pp.out.line.push_back(line);
+    pp.out.id.push_back(token.id);
+}
+
+
+/*
+ * Function:	expand
+ *
+ * Description:	Add the given token to the output on the given line, or
+ *		if it names a macro that is not already being replaced,
+ *		the tokens of the macro in its place.
+ */
+
+static void expand(Preprocessor &pp, const Token &token, unsigned line)
+{
+    map<unsigned, vector<Token> >::const_iterator it = pp.macros.end();
+
+
+    if (token.kind == ID)
+	it = pp.macros.find(token.id);
+
+    if (it == pp.macros.end() || find(pp.expanding.begin(),
+	    pp.expanding.end(), token.id) != pp.expanding.end()) {
+	emit(pp, token, line);
+	return;
+    }
+
+    pp.expanding.push_back(token.id);
+
+    for (unsigned i = 0; i < it->second.size(); i ++)
+	expand(pp, it->second[i], line);
+
+    pp.expanding.pop_back();
+}
+
+
+/*
+ * Function:	dirname
+ *
+ * Description:	Return the directory of the given path, or the empty
+ *		string for the current directory.
+ */
+
+static string dirname(const string &path)
+{
+    size_t slash = path.rfind('/');
+
+    if (slash == string::npos)
+	return "";
+
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+
+/*
+ * Function:	include
+ *
+ * Description:	Include the header named by the #include directive from
+ *		the Nth token of the given file up to the END token.  A
+ *		header named in quotes is first looked for in the
+ *		directory of the file, and then like one named in angle
+ *		brackets, in each of the directories of the unit in turn.
+ *		The spellings of a header are interned the first time the
+ *		unit includes it.  A header whose guard is already defined
+ *		is skipped.
+ */
+
+static void include(Preprocessor &pp, File &file, unsigned n, unsigned end)
+{
+    const TokenStream &in = *file.tokens;
+    shared_ptr<const Header> header;
+    vector<unsigned> *ids;
+    vector<string> paths;
+    unsigned first = n + 2;
+    string name;
+    File nested;
+
+
+    if (first + 1 == end && in.kind[first] == STRING &&
+	    in.length[first] >= 2 &&
+	    file.text[in.offset[first] + in.length[first] - 1] == '"') {
+	name = string(file.text + in.offset[first] + 1, in.length[first] - 2);
+	paths.push_back(file.directory);
+    } else if (first + 2 < end && in.kind[first] == LTN &&
+	    in.kind[end - 1] == GTN)
+	name = string(file.text + in.offset[first] + 1,
+		file.text + in.offset[end - 1]);
+    else {
+	error(in.line[n], "#include expects \"file\" or <file>");
+	return;
+    }
+
+    if (pp.depth >= MAX_DEPTH) {
+	error(in.line[n], "#include of %s nested too deeply", name);
+	return;
+    }
+
+    if (!name.empty() && name[0] == '/')
+	paths.assign(1, "");
+    else
+	paths.insert(paths.end(), context->includes.begin(),
+		context->includes.end());
+
+    for (unsigned i = 0; header == nullptr && i < paths.size(); i ++)
+	if (!name.empty())
+	    header = pp.headers->open(paths[i].empty() ? name :
+		    paths[i] + "/" + name);
+
+    if (header == nullptr) {
+	error(in.line[n], "cannot open included file %s", name);
+	return;
+    }
+
+    ids = &pp.names[header.get()];
+
+    if (ids->size() != header->spellings.text.size())
+	header->spellings.intern(*ids);
+
+    if (header->guarded && pp.macros.count((*ids)[header->tokens.id[2]]) > 0)
+	return;
+
+    if (pp.bases.count(header.get()) == 0) {
+	if (pp.next + header->size >= ~0u) {
+	    error(in.line[n], "included file %s is too large", name);
+	    return;
+	}
+
+	pp.bases[header.get()] = pp.next;
+	pp.out.bases.push_back(pp.next);
+	pp.out.buffers.push_back(header->source);
+	pp.next += header->size + 1;
+	context->included.push_back(header);
+    }
+
+    nested.tokens = &header->tokens;
+    nested.ids = ids;
+    nested.text = header->source;
+    nested.base = pp.bases[header.get()];
+    nested.directory = dirname(header->path);
+
+    pp.depth ++;
+    run(pp, nested);
+    pp.depth --;
+}
+
+
+/*
+ * Function:	begin
+ *
+ * Description:	Start a conditional directive of the given file on the
+ *		given line, whose tokens are included if it is ON and so
+ *		is the one that encloses it.
+ */
+
+static void begin(File &file, unsigned line, bool on)
+{
+    Conditional c;
+
+
+    c.line = line;
+    c.enclosing = !skipping(file);
+    c.on = c.enclosing && on;
+    c.elsed = false;
+    file.conditionals.push_back(c);
+}
+
+
+/*
+ * Function:	directive
+ *
+ * Description:	Carry out the directive from the Nth token of the given
+ *		file up to the END token.  While tokens are being left
+ *		out, only the conditional directives are even looked at,
+ *		and only to see where they start and end.
+ */
+
+static void directive(Preprocessor &pp, File &file, unsigned n, unsigned end)
+{
+    const TokenStream &in = *file.tokens;
+    string name = directive(file.text, in, n, end);
+    unsigned first = n + 2, line = in.line[n];
+    Token token;
+
+
+    if (name == "if" || name == "ifdef" || name == "ifndef") {
+	if (skipping(file))
+	    begin(file, line, false);
+	else if (name == "if" && first + 1 == end && in.kind[first] == INTEGER)
+	    begin(file, line, strtoul(spelling(file, first).c_str(),
+			nullptr, 0) != 0);
+	else if (name != "if" && first + 1 == end && in.kind[first] == ID)
+	    begin(file, line, (pp.macros.count(id(file, first)) > 0) ==
+		    (name == "ifdef"));
+	else {
+	    error(line, name == "if" ? "#if expects an integer" :
+		    "#%s expects a macro name", name);
+	    begin(file, line, false);
+	}
+
+    } else if (name == "else") {
+	if (file.conditionals.empty())
+	    error(line, "#else without #if");
+	else if (file.conditionals.back().elsed)
+	    error(line, "#else after #else");
+	else {
+	    Conditional &c = file.conditionals.back();
+	    c.on = c.enclosing && !c.on;
+	    c.elsed = true;
+	}
+
+    } else if (name == "endif") {
+	if (file.conditionals.empty())
+	    error(line, "#endif without #if");
+	else
+	    file.conditionals.pop_back();
+
+    } else if (skipping(file) || name == "" || name == "pragma") {
+	return;
+
+    } else if (name == "include") {
+	include(pp, file, n, end);
+
+    } else if (name == "define") {
+	if (first == end || in.kind[first] != ID)
+	    error(line, "macro name must be an identifier");
+	else if (first + 1 < end && in.kind[first + 1] == LPAREN &&
+		in.offset[first + 1] == in.offset[first] + in.length[first])
+	    error(line, "function-like macros are not supported");
+	else {
+	    vector<Token> &tokens = pp.macros[id(file, first)];
+	    tokens.clear();
+
+	    for (unsigned i = first + 1; i < end; i ++) {
+		token.kind = in.kind[i];
+		token.offset = file.base + in.offset[i];
+		token.length = in.length[i];
+		token.id = id(file, i);
+		tokens.push_back(token);
+	    }
+	}
+
+    } else if (name == "undef") {
+	if (first + 1 != end || in.kind[first] != ID)
+	    error(line, "macro name must be an identifier");
+	else
+	    pp.macros.erase(id(file, first));
+
+    } else
+	error(line, "unknown directive #%s", name);
+}
+
+
+/*
+ * Function:	run
+ *
+ * Description:	Preprocess the tokens of the given file, up to but not
+ *		including its DONE token.  Its lexical errors are moved
+ *		to the output along with the tokens they were recorded
+ *		against, or to the next token if those are not output.
+ *		Those in a directive are reported along with the errors
+ *		of the directive itself, and those of tokens left out by
+ *		a conditional are dropped with them.
+ */
+
+static void run(Preprocessor &pp, File &file)
+{
+    const TokenStream &in = *file.tokens;
+    unsigned n, end, last = in.kind.size() - 1, e = 0;
+    LexicalError lexical;
+    Token token;
+
+
+    for (n = 0; n < last; n = end) {
+	end = starts(in, n) ? line(in, n) : n + 1;
+
+	for (; e < in.errors.size() && in.errors[e].token < end; e ++)
+	    if (skipping(file))
+		continue;
+	    else if (starts(in, n))
+		error(in.line[n], in.errors[e].message);
+	    else {
+		lexical.token = pp.out.kind.size();
+		lexical.message = in.errors[e].message;
+		pp.out.errors.push_back(lexical);
+	    }
+
+	if (starts(in, n)) {
+	    directive(pp, file, n, end);
+	    pp.directives ++;
+	} else if (!skipping(file)) {
+	    token.kind = in.kind[n];
+	    token.offset = file.base + in.offset[n];
+	    token.length = in.length[n];
+	    token.id = id(file, n);
+	    expand(pp, token, in.line[n]);
+	}
+    }
+
+    for (; e < in.errors.size(); e ++) {
+	lexical.token = pp.out.kind.size();
+	lexical.message = in.errors[e].message;
+	pp.out.errors.push_back(lexical);
+    }
+
+    if (!file.conditionals.empty())
+	error(file.conditionals.back().line, "unterminated conditional");
+}
+
+
+/*
+ * Function:	preprocess
+ *
+ * Description:	Preprocess the token stream of the current context, using
+ *		its cache of headers, or a cache of its own if it has
+ *		none.  A unit without directives is left as it is.
+ */
+
+void preprocess()
+{
+    TokenStream &tokens = context->tokens;
+    unsigned last = tokens.kind.size() - 1;
+    Preprocessor pp;
+    Headers headers;
+    File file;
+
+
+    if (find(tokens.kind.begin(), tokens.kind.end(), HASH) ==
+	    tokens.kind.end())
+	return;
+
+    pp.headers = context->headers != nullptr ? context->headers : &headers;
+    pp.next = (unsigned long long) (context->limit - context->source) + 1;
+    pp.depth = 0;
+    pp.directives = 0;
+
+    file.tokens = &tokens;
+    file.ids = nullptr;
+    file.text = context->source;
+    file.base = 0;
+    file.directory = context->directory;
+
+    run(pp, file);
+
+    pp.out.kind.push_back(DONE);
+    pp.out.offset.push_back(tokens.offset[last]);
+    pp.out.length.push_back(tokens.length[last]);
+    pp.out.line.push_back(tokens.line[last]);
+    pp.out.id.push_back(0);
+
+    context->directives = pp.directives;
+    tokens = move(pp.out);
+}
@@ -0,0 +1,32 @@
+/*
+ * File:	preprocessor.h
+ *
+ * Description:	This file contains the public function declarations for
+ *		the preprocessor for Simple C.
+ *
+ *		The preprocessor works on the token stream of a unit once
+ *		it has been tokenized, rather than on its characters, and
+ *		is skipped altogether if the unit has no directives.  It
+ *		handles #include, object-like #define and #undef, and
+ *		#ifdef, #ifndef, #if with an integer, #else, and #endif,
+ *		which is enough for include guards.  Each directive must
+ *		be on a single line.  A #pragma is ignored, as is a line
+ *		marker left behind by another preprocessor.
+ *
+ *		Included headers come from a cache (see Headers.h), so
+ *		each is only tokenized once, and its tokens are spliced
+ *		into the stream of the unit.  A token keeps the line it
+ *		has in its own file, and a token of a macro takes the
+ *		line of the name it replaces.  Errors in directives are
+ *		reported before the unit is parsed, as they would be by a
+ *		separate preprocessor.
+ */
+
+# ifndef PREPROCESSOR_H
+# define PREPROCESSOR_H
+# include "lexer.h"
+
+void preprocess();
+bool guarded(const char *source, const TokenStream &tokens);
+
+# endif /* PREPROCESSOR_H */
@@ -0,0 +1,754 @@
+/*
+ * File:	scc.cpp
+ *
+ * Description:	This file contains the main program for the Simple C
+ *		compiler, which compiles a single unit with a context of
+ *		its own.  Everything else lives in the library, which can
+ *		just as well compile many units in one process.
+ *
+ *		Extra functionality:
+ *		- a batch mode, which compiles many files concurrently on a
+ *		  pool of threads, each to an output file of its own, and
+ *		  reports how long they took
+ *		- a cache of the code generated for each function, shared
+ *		  by every file compiled, so that only the functions that
+ *		  have changed since it was last compiled are compiled
+ *		  again
+ *		- a compile server, which stays up and compiles what is
+ *		  sent to it over a socket, and a client for it that can
+ *		  be used just like the compiler itself
+ *		- snapshots of declarations, which spare each file that
+ *		  begins with the same declarations from parsing them
+ *		- a preprocessor with #include, object-like macros, and
+ *		  include guards, which tokenizes each header only once
+ *		  however many files include it
+ *		- a language server, which checks each document as it is
+ *		  edited, parsing and checking again only the functions
+ *		  that an edit affected
+ *		- timers and counters for each phase of a compilation,
+ *		  with a report of them and a trace of every function on
+ *		  every thread, which a trace viewer can show
+ */
+
+# include <cerrno>
+# include <chrono>
+# include <climits>
+# include <csignal>
+# include <cstdio>
+# include <cstdlib>
+# include <cstring>
+# include <fstream>
+# include <iostream>
+# include <sstream>
+# include <mutex>
+# include <string>
+# include <vector>
+# include <algorithm>
+# include <getopt.h>
+# include <unistd.h>
+# include "AsmWriter.h"
+# include "Cache.h"
+# include "Headers.h"
+# include "CompilerContext.h"
+# include "LanguageServer.h"
+# include "Profile.h"
+# include "Server.h"
+# include "Snapshot.h"
+# include "ThreadPool.h"
+# include "heap.h"
+
+using namespace std;
+using namespace std::chrono;
+
+enum { SERVER = 256, CLIENT, LSP, TIME_REPORT, TRACE };
+
+static volatile sig_atomic_t stopping = 0;
+
+/* Everything a unit is compiled with, other than its files, in batch
+   mode.  The headers are shared by every unit of the batch. */
+
+struct Settings {
+    int level;
+    vector<string> roots, includes;
+    Cache *cache;
+    const Snapshot *snapshot;
+    Headers headers;
+};
+
+struct Unit {
+    string source, output;
+    string diagnostics;
+    size_t size;
+    double latency;
+    bool failed, done;
+};
+
+
+/*
+ * Function:	assembly
+ *
+ * Description:	Return the name of the assembly file for the given source
+ *		file: its name with the .c replaced by .s, or with .s
+ *		tacked on if it doesn't end in .c.
+ */
+
+static string assembly(const string &source)
+{
+    size_t n = source.size();
+
+    if (n > 2 && source.compare(n - 2, 2, ".c") == 0)
+	return source.substr(0, n - 2) + ".s";
+
+    return source + ".s";
+}
+
+
+/*
+ * Function:	manifest
+ *
+ * Description:	Add the units listed in the named manifest, one per line:
+ *		the source file, optionally followed by the output file.
+ *		Blank lines are ignored.  Return false if the manifest
+ *		cannot be read.
+ */
+
+static bool manifest(const char *path, vector<Unit> &units)
+{
+    ifstream in(path);
+    string line;
+    Unit unit = Unit();
+
+
+    if (!in)
+	return false;
+
+    while (getline(in, line)) {
+	istringstream fields(line);
+
+	if (!(fields >> unit.source))
+	    continue;
+
+	if (!(fields >> unit.output))
+	    unit.output = assembly(unit.source);
+
+	units.push_back(unit);
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	compile
+ *
+ * Description:	Compile the given unit with a context of its own, keeping
+ *		its diagnostics, each prefixed with the name of the
+ *		source, and noting how long it took.  The source is
+ *		tokenized by this thread alone, since the other threads
+ *		have units of their own to compile.  If any roots are
+ *		given, only what they reach is compiled.  If a cache or a
+ *		snapshot is given, the unit uses it.
+ */
+
+static void compile(Unit &unit, Settings &settings)
+{
+    steady_clock::time_point start = steady_clock::now();
+    ostringstream errors;
+    istringstream lines;
+    string line;
+
+
+    {
+	CompilerContext context(errors);
+	ThreadPool serial(1);
+
+	if (!context.open(unit.source.c_str())) {
+	    errors << strerror(errno) << endl;
+	    unit.failed = true;
+	} else if (!context.output(unit.output.c_str())) {
+	    errors << unit.output << ": " << strerror(errno) << endl;
+	    unit.failed = true;
+	} else {
+	    context.annotate(settings.level);
+
+	    for (unsigned i = 0; i < settings.roots.size(); i ++)
+		context.root(settings.roots[i]);
+
+	    for (unsigned i = 0; i < settings.includes.size(); i ++)
+		context.include(settings.includes[i]);
+
+	    if (settings.cache != nullptr)
+		context.use(*settings.cache);
+
+	    if (settings.snapshot != nullptr)
+		context.seed(*settings.snapshot);
+
+	    context.use(settings.headers);
+	    unit.size = context.limit - context.source;
+	    unit.failed = !context.compile(serial);
+	}
+    }
+
+    lines.str(errors.str());
+
+    while (getline(lines, line))
+	unit.diagnostics += unit.source + ": " + line + "\n";
+
+    unit.latency = duration<double>(steady_clock::now() - start).count();
+}
+
+
+/*
+ * Function:	summarize
+ *
+ * Description:	Report how many headers were tokenized, and how often one
+ *		that had already been tokenized was included.
+ */
+
+static void summarize(const Headers &headers)
+{
+    cerr << "headers: " << headers.tokenized() << " tokenized, ";
+    cerr << headers.reused() << " reused" << endl;
+}
+
+
+/*
+ * Function:	batch
+ *
+ * Description:	Compile each of the given units concurrently using the
+ *		given number of threads.  The diagnostics of each unit
+ *		are written together, in the order the units were given,
+ *		as soon as it and every unit before it are done.  With
+ *		STATISTICS, we finish with the throughput of the whole
+ *		batch and the spread of the time taken by each unit.
+ *		Return whether every unit could be compiled.
+ */
+
+static bool batch(vector<Unit> &units, unsigned threads,
+	Settings &settings, bool statistics)
+{
+    steady_clock::time_point start = steady_clock::now();
+    vector<double> latencies;
+    unsigned written = 0, slowest = 0;
+    size_t bytes = 0;
+    bool succeeded = true;
+    double elapsed;
+    mutex lock;
+
+
+    {
+	ThreadPool pool(threads);
+
+	for (unsigned i = 0; i < units.size(); i ++)
+	    pool.submit([&, i]() {
+		compile(units[i], settings);
+
+		lock_guard<mutex> guard(lock);
+		units[i].done = true;
+
+		while (written < units.size() && units[written].done)
+		    cerr << units[written ++].diagnostics;
+	    });
+
+	pool.wait();
+    }
+
+    elapsed = duration<double>(steady_clock::now() - start).count();
+
+    for (unsigned i = 0; i < units.size(); i ++) {
+	succeeded = succeeded && !units[i].failed;
+	bytes += units[i].size;
+	latencies.push_back(units[i].latency);
+
+	if (units[i].latency > units[slowest].latency)
+	    slowest = i;
+    }
+
+    if (statistics && !units.empty()) {
+	sort(latencies.begin(), latencies.end());
+	cerr << units.size() << " files, " << bytes << " bytes in ";
+	cerr << elapsed << " s: " << units.size() / elapsed << " files/s, ";
+	cerr << bytes / elapsed / 1e6 << " MB/s" << endl;
+	cerr << "latency: min " << latencies.front() * 1e3 << " ms, median ";
+	cerr << latencies[latencies.size() / 2] * 1e3 << " ms, 90% ";
+	cerr << latencies[latencies.size() * 9 / 10] * 1e3 << " ms, max ";
+	cerr << latencies.back() * 1e3 << " ms (";
+	cerr << units[slowest].source << ")" << endl;
+	cerr << Tree::count() << " nodes, " << allocations();
+	cerr << " heap allocations" << endl;
+	summarize(settings.headers);
+    }
+
+    return succeeded;
+}
+
+
+/*
+ * Function:	summarize
+ *
+ * Description:	Report how well the given cache did, once it has been
+ *		trimmed.
+ */
+
+static void summarize(const Cache &cache)
+{
+    cerr << "cache: " << cache.hits() << " hits, " << cache.misses();
+    cerr << " misses, " << cache.stored() << " stored, " << cache.evicted();
+    cerr << " evicted" << endl;
+}
+
+
+/*
+ * Function:	profile
+ *
+ * Description:	Write the report of the timers and counters to the
+ *		standard error if REPORT, and the trace to the named file
+ *		if there is one.
+ */
+
+static void profile(bool report, const char *trace)
+{
+    if (report)
+	Timer::report(cerr);
+
+    if (trace != nullptr && !Timer::trace(trace)) {
+	perror(trace);
+	exit(EXIT_FAILURE);
+    }
+}
+
+
+/*
+ * Function:	stop
+ *
+ * Description:	Tell the server to stop once it has answered the requests
+ *		it has accepted.
+ */
+
+static void stop(int)
+{
+    stopping = 1;
+}
+
+
+/*
+ * Function:	serve
+ *
+ * Description:	Answer compile requests on the socket at the given path
+ *		using the given number of threads, and the given cache and
+ *		snapshot if there are any, until we are interrupted or
+ *		terminated.
+ *		Only the calling thread takes those signals, so they
+ *		interrupt its wait for the next request.  Return false if
+ *		we could not listen at the path.
+ */
+
+static bool serve(const char *path, unsigned threads, Cache *cache,
+	const Snapshot *snapshot, bool statistics)
+{
+    struct sigaction action = {};
+    sigset_t signals;
+
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    ThreadPool pool(threads);
+    Server server(path, pool, cache, snapshot);
+
+    pthread_sigmask(SIG_UNBLOCK, &signals, nullptr);
+
+    if (!server.listen()) {
+	perror(path);
+	return false;
+    }
+
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    server.run(stopping);
+
+    if (cache != nullptr)
+	cache->trim();
+
+    if (statistics) {
+	cerr << server.requests() << " requests" << endl;
+	summarize(server.headers());
+
+	if (cache != nullptr)
+	    summarize(*cache);
+    }
+
+    return true;
+}
+
+
+/*
+ * Function:	absolute
+ *
+ * Description:	Return the given path as an absolute path, taking the
+ *		empty path to be the current directory.
+ */
+
+static string absolute(const string &path)
+{
+    char buffer[PATH_MAX];
+
+
+    if (!path.empty() && path[0] == '/')
+	return path;
+
+    if (getcwd(buffer, sizeof(buffer)) == nullptr)
+	return path;
+
+    return path.empty() ? buffer : string(buffer) + "/" + path;
+}
+
+
+/*
+ * Function:	request
+ *
+ * Description:	Have the server at the given path compile the given
+ *		source, which is in the given directory, with the given
+ *		settings, writing the code to the named output file, or
+ *		the standard output, and reporting any errors.  The
+ *		server may well be in another directory, so it is given
+ *		every directory as an absolute path.  Return whether
+ *		there was a server to do it, and set PARSED to whether
+ *		the source could be parsed and its code written.
+ */
+
+static bool request(const char *path, const string &source,
+	const string &directory, const char *output,
+	const Settings &settings, bool &parsed)
+{
+    Request request;
+    Reply reply;
+    AsmWriter writer;
+    ostream out(&writer);
+
+
+    request.source = source;
+    request.annotations = settings.level;
+    request.roots = settings.roots;
+    request.directory = absolute(directory);
+
+    for (unsigned i = 0; i < settings.includes.size(); i ++)
+	request.includes.push_back(absolute(settings.includes[i]));
+
+    if (!Server::request(path, request, reply))
+	return false;
+
+    if (output != nullptr && !writer.open(output)) {
+	perror(output);
+	exit(EXIT_FAILURE);
+    }
+
+    out << reply.assembly << flush;
+    cerr << reply.diagnostics;
+
+    if (writer.error() != 0) {
+	cerr << "cannot write assembly: " << strerror(writer.error());
+	cerr << endl;
+    }
+
+    parsed = reply.parsed && writer.error() == 0;
+    return true;
+}
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Analyze the named source file, or the standard input
+ *		stream if no file is given.  With -j, a large source is
+ *		tokenized, and its functions generated, using the given
+ *		number of threads.  With -o, the
+ *		code is written to the named file instead of the standard
+ *		output, and -a selects how much commentary goes with it.
+ *		Each -r names a root, and then only the functions that the
+ *		roots can reach are compiled.  With -c, the code of each
+ *		function is kept in the named cache directory, and reused
+ *		as long as the function has not changed.  The cache is
+ *		trimmed once it holds more than the number of megabytes
+ *		given with -C.  Each -I names a directory to look for
+ *		included headers in.
+ *
+ *		With -P, the source is instead compiled to a snapshot of
+ *		its declarations, written to the named file.  With -p, the
+ *		named snapshot is used, and a source that begins with the
+ *		same declarations has them declared straight from it.
+ *
+ *		With -b, each of the named files, and each of the files
+ *		listed in the manifest given with -m, is instead compiled
+ *		to an assembly file of its own, using the given number of
+ *		threads to compile that many files at once.
+ *
+ *		With --server, we instead answer compile requests on the
+ *		given socket, or on one in a directory of our own (see
+ *		Server::path), until we are interrupted, using the given
+ *		number of threads to answer that many at once and the
+ *		cache given with -c and the snapshot given with -p.  With
+ *		--client, the source is compiled by the server at the
+ *		given socket instead, exactly as if we had compiled it
+ *		ourselves.  If there is no server there, or it is not our
+ *		own, we do.  The cache and snapshot are the server's to
+ *		give, so a client takes neither -c nor -p.
+ *
+ *		With --lsp, we instead speak the Language Server Protocol
+ *		on the standard input and output, publishing the errors
+ *		of each document as it is edited, until the client tells
+ *		us to exit.  With -s, how long each check took is written
+ *		to the standard error.
+ *
+ *		With --time-report, how long each phase took on every
+ *		thread, and how much of everything it made, is written to
+ *		the standard error once we are done.  With --trace, each
+ *		phase of each function is written to the named file as a
+ *		trace, in the trace event format.
+ */
+
+int main(int argc, char *argv[])
+{
+    static const char *levels[] = { "none", "lines", "verbose" };
+    static const option options[] = {
+	{ "server", optional_argument, nullptr, SERVER },
+	{ "client", optional_argument, nullptr, CLIENT },
+	{ "lsp", no_argument, nullptr, LSP },
+	{ "time-report", no_argument, nullptr, TIME_REPORT },
+	{ "trace", required_argument, nullptr, TRACE },
+	{ nullptr, 0, nullptr, 0 },
+    };
+    const char *output = nullptr, *list = nullptr, *directory = nullptr;
+    const char *seed = nullptr, *save = nullptr, *reason;
+    const char *trace = nullptr;
+    string socket;
+    int mode = 0;
+    unsigned threads = 1, level = ANNOTATE_VERBOSE;
+    bool statistics = false, batched = false, report = false, succeeded;
+    size_t megabytes = 64;
+    Settings settings;
+    vector<Unit> units;
+    int c;
+
+
+    while ((c = getopt_long(argc, argv, "C:I:P:a:bc:j:m:o:p:r:s", options,
+		    0)) != -1)
+	if (c == SERVER || c == CLIENT || c == LSP) {
+	    mode = c;
+
+	    if (optarg != nullptr)
+		socket = optarg;
+	} else if (c == TIME_REPORT)
+	    report = true;
+	else if (c == TRACE)
+	    trace = optarg;
+	else if (c == 'j')
+	    threads = strtoul(optarg, NULL, 0);
+	else if (c == 'o')
+	    output = optarg;
+	else if (c == 's')
+	    statistics = true;
+	else if (c == 'b')
+	    batched = true;
+	else if (c == 'm')
+	    list = optarg;
+	else if (c == 'r')
+	    settings.roots.push_back(optarg);
+	else if (c == 'I')
+	    settings.includes.push_back(optarg);
+	else if (c == 'c')
+	    directory = optarg;
+	else if (c == 'C')
+	    megabytes = strtoul(optarg, NULL, 0);
+	else if (c == 'p')
+	    seed = optarg;
+	else if (c == 'P')
+	    save = optarg;
+	else if (c == 'a') {
+	    for (level = 0; level < 3; level ++)
+		if (strcmp(optarg, levels[level]) == 0)
+		    break;
+
+	    if (level == 3)
+		goto usage;
+	} else
+	    goto usage;
+
+    if ((batched ? output != nullptr : list != nullptr) ||
+	    (mode != 0 && batched) || (mode == SERVER && optind < argc) ||
+	    (save != nullptr && (mode != 0 || batched || output != nullptr ||
+	    !settings.roots.empty())) ||
+	    (mode == SERVER && !settings.includes.empty()) ||
+	    (mode == LSP && (optind < argc || output != nullptr ||
+	    !settings.roots.empty() || directory != nullptr ||
+	    seed != nullptr)) ||
+	    (mode == CLIENT && (directory != nullptr || seed != nullptr)) ||
+	    ((report || trace != nullptr) && mode != 0)) {
+    usage:
+	cerr << "usage: " << argv[0] << " [-a none|lines|verbose]";
+	cerr << " [-c cache [-C megabytes]] [-I directory ...] [-j threads]";
+	cerr << " [-o output] [-p snapshot] [-r root ...] [-s]";
+	cerr << " [--time-report] [--trace=file] [file]" << endl;
+	cerr << "       " << argv[0] << " -b [-a none|lines|verbose]";
+	cerr << " [-c cache [-C megabytes]] [-I directory ...] [-j threads]";
+	cerr << " [-m manifest] [-p snapshot] [-r root ...] [-s]";
+	cerr << " [--time-report] [--trace=file] [file ...]" << endl;
+	cerr << "       " << argv[0] << " -P snapshot [-I directory ...]";
+	cerr << " [-j threads] [-p snapshot] [--time-report] [--trace=file]";
+	cerr << " [file]" << endl;
+	cerr << "       " << argv[0] << " --server[=socket]";
+	cerr << " [-c cache [-C megabytes]] [-j threads] [-p snapshot]";
+	cerr << " [-s]" << endl;
+	cerr << "       " << argv[0] << " --client[=socket]";
+	cerr << " [-a none|lines|verbose] [-I directory ...] [-o output]";
+	cerr << " [-r root ...] [file]" << endl;
+	cerr << "       " << argv[0] << " --lsp [-I directory ...]";
+	cerr << " [-j threads] [-s]" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    Cache cache(directory != nullptr ? directory : "", megabytes << 20);
+
+    if (directory != nullptr && !cache.open()) {
+	perror(directory);
+	exit(EXIT_FAILURE);
+    }
+
+    Snapshot snapshot;
+
+    if (seed != nullptr && !snapshot.open(seed)) {
+	cerr << seed << ": not a snapshot" << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (report || trace != nullptr)
+	Timer::enable(trace != nullptr);
+
+    settings.level = level;
+    settings.cache = (directory != nullptr ? &cache : nullptr);
+    settings.snapshot = (seed != nullptr ? &snapshot : nullptr);
+
+    if ((mode == SERVER || mode == CLIENT) && socket.empty())
+	socket = Server::path();
+
+    if (mode == SERVER) {
+	if (socket.empty()) {
+	    cerr << "no private directory for the socket" << endl;
+	    exit(EXIT_FAILURE);
+	}
+
+	if (!serve(socket.c_str(), threads, settings.cache, settings.snapshot,
+		    statistics))
+	    exit(EXIT_FAILURE);
+
+	exit(EXIT_SUCCESS);
+    }
+
+    if (mode == LSP) {
+	ThreadPool pool(threads);
+	LanguageServer server(cin, cout, pool, settings.headers);
+
+	for (unsigned i = 0; i < settings.includes.size(); i ++)
+	    server.include(absolute(settings.includes[i]));
+
+	if (statistics)
+	    server.log(cerr);
+
+	exit(server.run());
+    }
+
+
+    if (batched) {
+	for (int i = optind; i < argc; i ++) {
+	    units.push_back(Unit());
+	    units.back().source = argv[i];
+	    units.back().output = assembly(argv[i]);
+	}
+
+	if (list != nullptr && !manifest(list, units)) {
+	    perror(list);
+	    exit(EXIT_FAILURE);
+	}
+
+	succeeded = batch(units, threads, settings, statistics);
+	profile(report, trace);
+
+	if (directory != nullptr) {
+	    cache.trim();
+
+	    if (statistics)
+		summarize(cache);
+	}
+
+	exit(succeeded ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    CompilerContext unit;
+
+    if (!unit.open(optind < argc ? argv[optind] : 0)) {
+	perror(argv[optind]);
+	exit(EXIT_FAILURE);
+    }
+
+    if (mode == CLIENT && request(socket.c_str(),
+		string(unit.source, unit.limit), unit.directory, output,
+		settings, succeeded))
+	exit(succeeded ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    if (output != nullptr && !unit.output(output)) {
+	perror(output);
+	exit(EXIT_FAILURE);
+    }
+
+    string discarded;
+    ThreadPool pool(threads);
+
+    if (save != nullptr)
+	unit.output(discarded);
+
+    unit.annotate(level);
+
+    for (unsigned i = 0; i < settings.roots.size(); i ++)
+	unit.root(settings.roots[i]);
+
+    for (unsigned i = 0; i < settings.includes.size(); i ++)
+	unit.include(settings.includes[i]);
+
+    if (directory != nullptr)
+	unit.use(cache);
+
+    if (seed != nullptr)
+	unit.seed(snapshot);
+
+    unit.use(settings.headers);
+
+    succeeded = unit.compile(pool);
+
+    if (succeeded && save != nullptr &&
+	    (reason = Snapshot::save(save, unit)) != nullptr) {
+	cerr << save << ": cannot snapshot: " << reason << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    if (directory != nullptr)
+	cache.trim();
+
+    profile(report, trace);
+
+    if (!succeeded)
+	exit(EXIT_FAILURE);
+
+    if (statistics) {
+	cerr << Tree::count() << " nodes, " << allocations();
+	cerr << " heap allocations" << endl;
+	summarize(settings.headers);
+
+	if (directory != nullptr)
+	    summarize(cache);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,63 @@
+/*
+ * File:	compile.cpp
+ *
+ * Description:	This file contains the main program of a driver for the
+ *		tests of the Simple C compiler, which compiles each named
+ *		source in turn with the compile function of the library,
+ *		each in a context of its own.  The code of each is written
+ *		to the standard output and its errors to the standard
+ *		error, just as the compiler would write them, so that
+ *		nothing one source leaves behind can go unnoticed in the
+ *		next.  The exit status is nonzero if any source had errors.
+ */
+
+# include <cstdlib>
+# include <fstream>
+# include <iostream>
+# include <iterator>
+# include <string>
+# include "CompilerContext.h"
+
+using namespace std;
+
+
+/*
+ * Function:	main
+ *
+ * Description:	Compile each named source with the library, with full
+ *		commentary, and write what it gives.
+ */
+
+int main(int argc, char *argv[])
+{
+    string source, assembly, diagnostics;
+    bool succeeded = true;
+
+
+    if (argc < 2) {
+	cerr << "usage: " << argv[0] << " file ..." << endl;
+	exit(EXIT_FAILURE);
+    }
+
+    for (int i = 1; i < argc; i ++) {
+	ifstream in(argv[i], ios::binary);
+
+	if (!in) {
+	    perror(argv[i]);
+	    exit(EXIT_FAILURE);
+	}
+
+	source.assign(istreambuf_iterator<char>(in),
+		istreambuf_iterator<char>());
+	assembly.clear();
+	diagnostics.clear();
+
+	if (!compile(source.data(), source.size(), assembly, diagnostics))
+	    succeeded = false;
+
+	cout << assembly << flush;
+	cerr << diagnostics << flush;
+    }
+
+    exit(succeeded ? EXIT_SUCCESS : EXIT_FAILURE);
+}
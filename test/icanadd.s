@@ -55,27 +55,27 @@ main:
 #iffin and iffin and yeah! C> ice cream! C>
 	movl	-20(%ebp), %eax
 	testl	%eax, %eax
-	je	.L2
-	pushl	$.L4
+	je	.Lmain.1
+	pushl	$.L0
 	call	printf
 	addl	$4, %esp
 #getting an int from a return.
 	movl	%eax, -24(%ebp)
-	jmp	.L3
-.L2:
-	pushl	$.L5
+	jmp	.Lmain.2
+.Lmain.1:
+	pushl	$.L1
 	call	printf
 	addl	$4, %esp
 #getting an int from a return.
 	movl	%eax, -20(%ebp)
-.L3:
+.Lmain.2:
 	pushl	-4(%ebp)
-	pushl	$.L6
+	pushl	$.L2
 	call	printf
 	addl	$8, %esp
 #getting an int from a return.
 	movl	%eax, -20(%ebp)
-.L1:
+.Lmain.0:
 	movl	%ebp, %esp
 	popl	%ebp
 	ret
@@ -84,6 +84,6 @@ main:
 	.set	main.size, 36
 
 	.data
-.L6:	.asciz	"a: %d\n"
-.L5:	.asciz	"good riddance\n"
-.L4:	.asciz	"hello\n"
+.L2:	.asciz	"a: %d\n"
+.L1:	.asciz	"good riddance\n"
+.L0:	.asciz	"hello\n"
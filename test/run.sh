@@ -0,0 +1,885 @@
+#!/bin/sh
+#
+# File:		run.sh
+#
+# Description:	Run the regression tests of the compiler, which is taken
+#		to be the scc beside this directory unless SCC names
+#		another.  The library is tested through the compile driver
+#		in this directory unless DRIVER names another, and only
+#		if it has been built.  Each test writes what it needs to a
+#		scratch directory, and its name is written along with
+#		whether it passed.  The exit status is nonzero if any test
+#		failed.
+#
+
+dir=$(dirname "$0")
+scc=${SCC:-$dir/../scc}
+driver=${DRIVER:-$dir/compile}
+scratch=$(mktemp -d) || exit 1
+trap 'rm -rf "$scratch"' EXIT
+failed=0
+
+
+# Note whether the named test passed, given the status of the command
+# that checked it.
+
+check() {
+	if [ "$2" -eq 0 ]; then
+		echo "ok	$1"
+	else
+		echo "FAILED	$1"
+		failed=1
+	fi
+}
+
+
+# A pointer type may have any number of levels of indirection.
+
+stars() {
+	awk -v n="$1" 'BEGIN {
+		printf "int "
+
+		for (i = 0; i < n; i ++)
+			printf "*"
+
+		print "x;"
+		print "int main(void) { return 0; }"
+	}' > "$scratch/stars.c"
+
+	"$scc" < "$scratch/stars.c" > /dev/null
+}
+
+stars 2000000
+check "2000000 levels of indirection" $?
+
+
+# The code for a sample program is exactly what was checked in, for any
+# number of threads.  The code for busserr.c is not checked, since it
+# declares a char, which the language does not have.
+
+golden() {
+	"$scc" -j "$2" < "$dir/$1.c" | cmp -s - "$dir/$1.s"
+}
+
+for threads in 1 4; do
+	golden icanadd $threads
+	check "icanadd.c with -j $threads" $?
+done
+
+
+# Compile the named source with one thread and with four, along with any
+# other arguments given, and check that the code, the diagnostics, and
+# the exit status are all the same.
+
+serial() {
+	source=$1
+	shift
+	"$scc" -j 1 "$@" "$source" > "$scratch/serial.s" \
+	    2> "$scratch/serial.err"
+	status=$?
+	"$scc" -j 4 "$@" "$source" > "$scratch/parallel.s" \
+	    2> "$scratch/parallel.err"
+	[ $? -eq $status ] &&
+	cmp -s "$scratch/serial.s" "$scratch/parallel.s" &&
+	cmp -s "$scratch/serial.err" "$scratch/parallel.err"
+}
+
+
+# A program of thousands of functions, each with its own strings and
+# reals to be numbered, compiles to the same code with any number of
+# threads, however much commentary goes along with it.
+
+sh "$dir/../bench/generate.sh" functions 3000 > "$scratch/many.c"
+
+for level in none lines verbose; do
+	serial "$scratch/many.c" -a $level
+	check "3000 functions with -a $level" $?
+done
+
+# A program with semantic errors in many of its bodies reports the same
+# errors in the same order with any number of threads.
+
+semantic() {
+	awk -v n=500 'BEGIN {
+		print "int printf();"
+
+		for (i = 0; i < n; i ++) {
+			print "int f" i "(int a)"
+			print "{"
+
+			if (i % 7 == 0)
+				print "    a = missing" i ";"
+
+			if (i % 11 == 0)
+				print "    a = &a;"
+
+			if (i % 13 == 0)
+				print "    a = f" i "(1, 2);"
+
+			print "    printf(\"%d\\n\", a);"
+			print "    return a * " i ";"
+			print "}"
+		}
+	}' > "$scratch/semantic.c"
+	serial "$scratch/semantic.c" &&
+	[ $(wc -l < "$scratch/serial.err") -eq 157 ]
+}
+
+semantic
+check "semantic errors in many bodies" $?
+
+# A source of a few megabytes is tokenized in parts on several threads.
+# Its comments are full of lines that look like the end of a function,
+# where a part would rather begin, and of quotes, and its strings are
+# full of comment delimiters and braces, so that some of the parts begin
+# within a comment and have to be tokenized again.  The line of the error
+# at the end shows that the lines were counted right across the parts.
+
+split() {
+	awk -v n=3000 'BEGIN {
+		print "int printf();"
+
+		for (i = 0; i < n; i ++) {
+			print ""
+			print "/*"
+
+			for (j = 0; j < 40; j ++) {
+				print " * " i " \"unbalanced " j
+
+				if (i % 3 == 0)
+					print "}"
+			}
+
+			print " */"
+			print ""
+			print "int f" i "(int a)"
+			print "{"
+			print "    printf(\"/* not a comment */ } %d\\n\", a);"
+			print "    printf(\"*/ }\\n\");"
+			print "    return a + " i ";"
+			print "}"
+		}
+
+		print ""
+		print "int main(void)"
+		print "{"
+		print "    return undeclared;"
+		print "}"
+	}' > "$scratch/split.c"
+}
+
+split
+
+for level in none lines verbose; do
+	serial "$scratch/split.c" -a $level
+	check "tokenizing in parts with -a $level" $?
+done
+
+# With one thread, a large source is tokenized a window at a time, and
+# the tokens that the parser is done with are dropped.  Errors in the
+# lexer and the checker come out just as they do with the whole source
+# tokenized at once, and the compile takes far less memory than the
+# tokens of the whole source would.
+
+windows() {
+	awk -v n=40000 'BEGIN {
+		for (i = 0; i < n; i ++) {
+			print "double f" i "(double d)"
+			print "{"
+
+			if (i % 997 == 0)
+				print "    d = 1.0e;"
+
+			if (i % 1009 == 0)
+				print "    d = &d;"
+
+			print "    return d * " i ".5 + f" i "(d - 1.0);"
+			print "}"
+		}
+	}' > "$scratch/windows.c"
+	serial "$scratch/windows.c" -a none || return 1
+
+	sh "$dir/../bench/generate.sh" functions 30000 > "$scratch/large.c"
+	"$scc" -j 4 "$scratch/large.c" > "$scratch/whole.s" &&
+	(ulimit -v 80000; "$scc" "$scratch/large.c" > "$scratch/windowed.s") &&
+	cmp -s "$scratch/whole.s" "$scratch/windowed.s"
+}
+
+windows
+check "tokenizing a window at a time" $?
+
+
+# The bodies after one with a syntax error may already have been parsed
+# on other threads, but nothing of theirs is reported, and one that takes
+# the size of a function is an error rather than a crash.  Only the
+# syntax error is reported, just as with a single thread.
+
+speculative() {
+	printf '%s\n' 'int printf();' 'int main(void)' '{' '    return ;' '}' \
+	    'int h(void)' '{' '    return sizeof printf;' '}' \
+	    > "$scratch/speculative.c"
+	"$scc" -j "$1" "$scratch/speculative.c" > /dev/null \
+	    2> "$scratch/speculative.err"
+	[ $? -eq 1 ] &&
+	echo "line 4: syntax error at ';'" | cmp -s - "$scratch/speculative.err"
+}
+
+for threads in 1 4; do
+	speculative $threads
+	check "syntax error before sizeof a function with -j $threads" $?
+done
+
+sizeof() {
+	printf '%s\n' 'int printf();' 'int h(void)' '{' \
+	    '    return sizeof printf;' '}' > "$scratch/sizeof.c"
+	"$scc" "$scratch/sizeof.c" 2>&1 > /dev/null |
+	    grep -q "^line 4: invalid operand to unary sizeof\$"
+}
+
+sizeof
+check "sizeof a function" $?
+
+# Nesting is limited only by memory, and the time taken is in proportion
+# to the depth: ten times as deep may take no more than twenty times as
+# long, which leaves plenty of room for noise.
+
+deep() {
+	awk -v kind="$1" -v n="$2" 'BEGIN {
+		print "int a;"
+		print "int main(void)"
+		print "{"
+
+		if (kind == "parentheses") {
+			printf "a = "
+			for (i = 0; i < n; i ++) printf "("
+			printf "a"
+			for (i = 0; i < n; i ++) printf " + 1)"
+			print ";"
+		} else if (kind == "operators") {
+			printf "a = a"
+			for (i = 0; i < n; i ++) printf " + a"
+			print ";"
+		} else if (kind == "blocks") {
+			for (i = 0; i < n; i ++) printf "{"
+			printf "a = 1;"
+			for (i = 0; i < n; i ++) printf "}"
+			print ""
+		} else if (kind == "ifs") {
+			for (i = 0; i < n; i ++) printf "if (a) "
+			print "a = 1;"
+		} else if (kind == "unary operators") {
+			printf "a = "
+			for (i = 0; i < n; i ++) printf "- !"
+			print "a;"
+		} else if (kind == "assignments") {
+			for (i = 0; i < n; i ++) printf "a = "
+			print "1;"
+		}
+
+		print "return a;"
+		print "}"
+	}' > "$scratch/deep.c"
+
+	"$scc" < "$scratch/deep.c" > /dev/null
+}
+
+linear() {
+	start=$(date +%s%N)
+	deep "$1" $(($2 / 10)) || return 1
+	middle=$(date +%s%N)
+	deep "$1" "$2" || return 1
+	end=$(date +%s%N)
+	[ $((end - middle)) -le $((20 * (middle - start))) ]
+}
+
+for kind in parentheses operators blocks ifs "unary operators" assignments
+do
+	linear "$kind" 1000000
+	check "1000000 nested $kind in linear time" $?
+done
+
+
+# Compiling a program makes no more than one heap allocation for every
+# four nodes of its trees.
+
+allocations() {
+	sh "$dir/../bench/generate.sh" functions 1000 > "$scratch/functions.c"
+	"$scc" -s "$scratch/functions.c" 2>&1 > /dev/null |
+	    awk '/ nodes, .* heap allocations$/ { found = 1; ok = $3 * 4 <= $1 }
+		END { exit !(found && ok) }'
+}
+
+allocations
+check "heap allocations per node" $?
+
+
+# An integer constant with a leading zero is octal, and one that is not
+# a valid octal or decimal constant, or is too large, is an error.
+
+integer() {
+	echo "int main(void) { return $1; }" > "$scratch/integer.c"
+	"$scc" < "$scratch/integer.c" 2> "$scratch/integer.err" |
+	    grep -q "^	movl	\$$2, %eax\$" ||
+	    grep -q "^line 1: $2\$" "$scratch/integer.err"
+}
+
+integer 010 8
+check "octal constant" $?
+integer 4294967295 4294967295
+check "largest constant" $?
+integer 09 "invalid digit in octal constant"
+check "invalid octal constant" $?
+integer 019 "invalid digit in octal constant"
+check "invalid octal constant with a valid digit" $?
+integer 4294967296 "integer constant is too large"
+check "constant too large" $?
+
+
+# With a root, exactly the functions that it reaches through calls are
+# compiled, and the errors in the others go unreported.  A root that is
+# not defined is an error, and then nothing is compiled.
+
+reach() {
+	printf '%s\n' 'int printf();' 'int leaf(int a) { return a; }' \
+	    'int down(int n) { if (n) return down(n - 1); return leaf(0); }' \
+	    'int unused(int a) { return leaf(a) + missing; }' \
+	    'int hidden(void) { return unused(1); }' \
+	    'int main(void) { printf("%d\n", down(4)); return leaf(2); }' \
+	    > "$scratch/reach.c"
+	"$scc" -j "$1" -r main "$scratch/reach.c" > "$scratch/reach.s" \
+	    2> "$scratch/reach.err" &&
+	[ ! -s "$scratch/reach.err" ] &&
+	[ "$(sed -n 's/^	\.global	//p' "$scratch/reach.s" | sort |
+	    tr '\n' ' ')" = "down leaf main " ]
+}
+
+undefined() {
+	"$scc" -r main -r nothere -r printf "$scratch/reach.c" \
+	    > "$scratch/reach.s" 2> "$scratch/reach.err"
+	[ $? -ne 0 ] && [ ! -s "$scratch/reach.s" ] &&
+	printf '%s\n' 'root nothere is not defined' \
+	    'root printf is not defined' | cmp -s - "$scratch/reach.err"
+}
+
+for threads in 1 4; do
+	reach $threads
+	check "functions reached from a root with -j $threads" $?
+done
+
+undefined
+check "undefined root" $?
+
+# Code from the cache is the same as code compiled afresh, and an entry
+# that has been cut short is compiled afresh rather than used.
+
+cache() {
+	sh "$dir/../bench/generate.sh" functions 20 > "$scratch/cached.c"
+	"$scc" "$scratch/cached.c" > "$scratch/fresh.s" &&
+	"$scc" -c "$scratch/cache" "$scratch/cached.c" > /dev/null &&
+	"$scc" -c "$scratch/cache" "$scratch/cached.c" > "$scratch/cached.s" &&
+	cmp -s "$scratch/fresh.s" "$scratch/cached.s" || return 1
+
+	for entry in "$scratch"/cache/*/*; do
+		head -c 100 "$entry" > "$scratch/entry"
+		mv "$scratch/entry" "$entry"
+	done
+
+	"$scc" -c "$scratch/cache" "$scratch/cached.c" > "$scratch/cached.s" &&
+	cmp -s "$scratch/fresh.s" "$scratch/cached.s"
+}
+
+cache
+check "cache with truncated entries" $?
+
+
+# A batch compiles each of its sources, whether named or listed in a
+# manifest, to exactly the code that compiling it alone gives, and the
+# diagnostics of each come out together and in order, each prefixed
+# with the name of its source.  One source with a syntax error fails the
+# batch, but not the others.
+
+batch() {
+	mkdir -p "$scratch/batch"
+	sh "$dir/../bench/generate.sh" functions 20 > "$scratch/batch/a.c"
+	printf '%s\n' 'int f(int a) { return a + missing; }' \
+	    'int g(void) { return &f; }' > "$scratch/batch/b.c"
+	printf '%s\n' 'int f(int a) { return a; }' 'int g(void) { return ; }' \
+	    > "$scratch/batch/c.c"
+	cp "$dir/icanadd.c" "$scratch/batch/d.c"
+	: > "$scratch/batch/expected.err"
+	status=0
+
+	for name in a b c d; do
+		source="$scratch/batch/$name.c"
+		"$scc" -o "$scratch/batch/$name.expected" "$source" \
+		    2> "$scratch/batch/$name.err" || status=1
+		sed "s|^|$source: |" "$scratch/batch/$name.err" \
+		    >> "$scratch/batch/expected.err"
+	done
+
+	printf '%s\n' "$scratch/batch/c.c" \
+	    "$scratch/batch/d.c $scratch/batch/d.out" > "$scratch/manifest"
+	"$scc" -b -j 4 -m "$scratch/manifest" "$scratch/batch/a.c" \
+	    "$scratch/batch/b.c" 2> "$scratch/batch/batch.err"
+	[ $? -ne 0 ] && [ $status -ne 0 ] &&
+	cmp -s "$scratch/batch/expected.err" "$scratch/batch/batch.err" &&
+	cmp -s "$scratch/batch/a.expected" "$scratch/batch/a.s" &&
+	cmp -s "$scratch/batch/b.expected" "$scratch/batch/b.s" &&
+	cmp -s "$scratch/batch/c.expected" "$scratch/batch/c.s" &&
+	cmp -s "$scratch/batch/d.expected" "$scratch/batch/d.out"
+}
+
+batch
+check "batch and separate compiles" $?
+
+
+# The library compiles a source to the same code and errors as scc does,
+# and a source compiled after another, even one with errors, is compiled
+# just as it is on its own.
+
+library() {
+	sh "$dir/../bench/generate.sh" functions 20 > "$scratch/library.c"
+	printf '%s\n' 'int f(int a) { return a + missing; }' \
+	    'int g(void) { return ; }' > "$scratch/wrong.c"
+	set -- "$scratch/library.c" "$scratch/wrong.c" \
+	    "$scratch/library.c" "$dir/icanadd.c"
+	: > "$scratch/expected.s"
+	: > "$scratch/expected.err"
+
+	for source; do
+		"$scc" "$source" >> "$scratch/expected.s" \
+		    2>> "$scratch/expected.err"
+	done
+
+	"$driver" "$@" > "$scratch/library.s" 2> "$scratch/library.err"
+	[ $? -ne 0 ] &&
+	cmp -s "$scratch/expected.s" "$scratch/library.s" &&
+	cmp -s "$scratch/expected.err" "$scratch/library.err"
+}
+
+if [ -x "$driver" ]; then
+	library
+	check "library and scc" $?
+fi
+
+
+# A source compiled by a server is compiled exactly as it would be by
+# the client itself, and so is one compiled with no server to send it to.
+
+server() {
+	sh "$dir/../bench/generate.sh" functions 20 > "$scratch/served.c"
+	"$scc" -a lines "$scratch/served.c" > "$scratch/local.s"
+	"$scc" --server="$scratch/socket" &
+	pid=$!
+
+	for i in 1 2 3 4 5 6 7 8 9 10; do
+		[ -S "$scratch/socket" ] && break
+		sleep 1
+	done
+
+	"$scc" --client="$scratch/socket" -a lines "$scratch/served.c" \
+	    > "$scratch/served.s" &&
+	cmp -s "$scratch/local.s" "$scratch/served.s"
+	status=$?
+
+	kill $pid
+	wait $pid
+	[ $status -eq 0 ] && [ ! -e "$scratch/socket" ] &&
+	"$scc" --client="$scratch/socket" -a lines "$scratch/served.c" \
+	    > "$scratch/served.s" &&
+	cmp -s "$scratch/local.s" "$scratch/served.s"
+}
+
+server
+check "server and client" $?
+
+
+# A client uses the cache and snapshot of the server, so it is not given
+# either of its own.
+
+conflict() {
+	"$scc" --client="$scratch/socket" "$@" "$scratch/served.c" \
+	    > /dev/null 2> "$scratch/conflict.err"
+	[ $? -ne 0 ] && grep -q "^usage: " "$scratch/conflict.err"
+}
+
+conflict -c "$scratch/cache"
+check "client with a cache" $?
+conflict -p "$scratch/snapshot"
+check "client with a snapshot" $?
+
+
+# With no socket named, a server listens in the runtime directory of the
+# user, but only if no one else can reach into it.
+
+private() {
+	mkdir -m 755 "$scratch/run"
+	XDG_RUNTIME_DIR="$scratch/run" "$scc" --server 2> /dev/null &&
+	    return 1
+	chmod 700 "$scratch/run"
+	XDG_RUNTIME_DIR="$scratch/run" "$scc" --server &
+	pid=$!
+
+	for i in 1 2 3 4 5 6 7 8 9 10; do
+		[ -S "$scratch/run/scc.sock" ] && break
+		sleep 1
+	done
+
+	XDG_RUNTIME_DIR="$scratch/run" "$scc" --client -a lines \
+	    "$scratch/served.c" > "$scratch/served.s" &&
+	cmp -s "$scratch/local.s" "$scratch/served.s" &&
+	[ -S "$scratch/run/scc.sock" ]
+	status=$?
+
+	kill $pid
+	wait $pid
+	return $status
+}
+
+private
+check "server in a private directory" $?
+
+
+# A server answers no request from another user, who compiles the source
+# alone instead.  Only root can be another user here.
+
+stranger() {
+	chmod 711 "$scratch"
+	mkdir -m 777 "$scratch/shared"
+	cp "$scratch/served.c" "$scratch/shared/served.c"
+	chmod 644 "$scratch/shared/served.c"
+	"$scc" -s --server="$scratch/shared/socket" 2> "$scratch/stranger.err" &
+	pid=$!
+
+	for i in 1 2 3 4 5 6 7 8 9 10; do
+		[ -S "$scratch/shared/socket" ] && break
+		sleep 1
+	done
+
+	chmod 777 "$scratch/shared/socket"
+	setpriv --reuid=65534 --regid=65534 --clear-groups "$scc" \
+	    --client="$scratch/shared/socket" -a lines \
+	    "$scratch/shared/served.c" > "$scratch/served.s" &&
+	cmp -s "$scratch/local.s" "$scratch/served.s"
+	status=$?
+
+	kill $pid
+	wait $pid
+	chmod 700 "$scratch"
+	[ $status -eq 0 ] && grep -q '^0 requests$' "$scratch/stranger.err"
+}
+
+if [ "$(id -u)" -eq 0 ] && command -v setpriv > /dev/null; then
+	stranger
+	check "server and another user" $?
+fi
+
+
+# A header is found in the directory of the file that includes it, or
+# in a directory given with -I, and a header with a guard that is
+# already defined is skipped.  The result compiles to the same code as
+# the source with every directive carried out by hand, and a batch that
+# includes the same headers over and over tokenizes each only once.
+
+headers() {
+	mkdir -p "$scratch/include" || return 1
+
+	cat > "$scratch/include/limits.h" <<-EOF
+	#ifndef LIMITS_H
+	#define LIMITS_H
+	#define LIMIT 100
+	int table[LIMIT];
+	#endif
+	EOF
+
+	cat > "$scratch/local.h" <<-EOF
+	#ifndef LOCAL_H
+	#define LOCAL_H
+	#include <limits.h>
+	#ifdef VERBOSE
+	int printf();
+	#else
+	int puts();
+	#endif
+	#endif
+	EOF
+
+	cat > "$scratch/included.c" <<-EOF
+	#define VERBOSE
+	#include "local.h"
+	#include <limits.h>
+	#include "local.h"
+
+	int main(void)
+	{
+	    printf("%d\n", table[LIMIT - 1]);
+	    return LIMIT;
+	}
+	EOF
+
+	cat > "$scratch/expanded.c" <<-EOF
+	int table[100];
+	int printf();
+
+	int main(void)
+	{
+	    printf("%d\n", table[100 - 1]);
+	    return 100;
+	}
+	EOF
+
+	"$scc" -a none -I "$scratch/include" "$scratch/included.c" \
+	    > "$scratch/included.s" &&
+	"$scc" -a none "$scratch/expanded.c" > "$scratch/expanded.s" &&
+	cmp -s "$scratch/included.s" "$scratch/expanded.s"
+}
+
+batched() {
+	cp "$scratch/included.c" "$scratch/again.c" &&
+	"$scc" -b -s -I "$scratch/include" "$scratch/included.c" \
+	    "$scratch/again.c" 2>&1 | grep -q "^headers: 2 tokenized"
+}
+
+missing() {
+	echo '#include "missing.h"' > "$scratch/missing.c"
+	"$scc" "$scratch/missing.c" 2>&1 > /dev/null |
+	    grep -q "^line 1: cannot open included file missing.h$"
+}
+
+headers
+check "included headers" $?
+batched
+check "headers tokenized once in a batch" $?
+missing
+check "missing header" $?
+
+
+# A # only starts a directive when it is the first token on its line.
+# Any other is ignored, whether or not the source has directives.
+
+stray() {
+	value=$1
+	shift
+	printf '%s\n' 'int main(void)' '{' '    return 2 ;' '}' \
+	    > "$scratch/plain.c"
+	printf '%s\n' "$@" 'int main(void)' '{' "    return $value # ;" '}' \
+	    > "$scratch/stray.c"
+	"$scc" "$scratch/plain.c" > "$scratch/plain.s" &&
+	"$scc" "$scratch/stray.c" 2>&1 | cmp -s - "$scratch/plain.s"
+}
+
+stray 2
+check "stray # without directives" $?
+stray N '# define N 2'
+check "stray # with directives" $?
+
+
+# A language server publishes the errors of a document when it is opened
+# and again each time it changes, whether all of it or only part of it
+# is sent.  Each message either way is framed with its length.  Here the
+# messages are written with a line break after some of their commas,
+# which are taken out before they are framed.
+
+frame() {
+	message=$(tr -d '\n')
+	printf 'Content-Length: %d\r\n\r\n%s' ${#message} "$message"
+}
+
+lsp() {
+	{
+		frame <<-EOF
+		{"jsonrpc":"2.0","id":1,"method":"initialize","params":{}}
+		EOF
+		frame <<-EOF
+		{"jsonrpc":"2.0","method":"initialized","params":{}}
+		EOF
+		frame <<-EOF
+		{"jsonrpc":"2.0","method":"textDocument/didOpen",
+		"params":{"textDocument":{"uri":"file:///tmp/lsp.c",
+		"languageId":"c","version":1,
+		"text":"int main(void)\\n{\\n    return x;\\n}\\n"}}}
+		EOF
+		frame <<-EOF
+		{"jsonrpc":"2.0","method":"textDocument/didChange",
+		"params":{"textDocument":{"uri":"file:///tmp/lsp.c","version":2},
+		"contentChanges":[{"text":
+		"int x;\\nint main(void)\\n{\\n    return x;\\n}\\n"}]}}
+		EOF
+		frame <<-EOF
+		{"jsonrpc":"2.0","method":"textDocument/didChange",
+		"params":{"textDocument":{"uri":"file:///tmp/lsp.c","version":3},
+		"contentChanges":[{"range":{"start":{"line":3,"character":11},
+		"end":{"line":3,"character":12}},"text":"y"}]}}
+		EOF
+		frame <<-EOF
+		{"jsonrpc":"2.0","id":2,"method":"shutdown"}
+		EOF
+		frame <<-EOF
+		{"jsonrpc":"2.0","method":"exit"}
+		EOF
+	} > "$scratch/lsp.in"
+
+	{
+		frame <<-EOF
+		{"jsonrpc":"2.0","id":1,"result":{"capabilities":
+		{"textDocumentSync":{"openClose":true,"change":2},
+		"positionEncoding":"utf-16"},"serverInfo":{"name":"scc"}}}
+		EOF
+		frame <<-EOF
+		{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics",
+		"params":{"uri":"file:///tmp/lsp.c","diagnostics":[{"range":
+		{"start":{"line":2,"character":0},"end":{"line":2,"character":13}},
+		"severity":1,"source":"scc","message":"x is undeclared"}]}}
+		EOF
+		frame <<-EOF
+		{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics",
+		"params":{"uri":"file:///tmp/lsp.c","diagnostics":[]}}
+		EOF
+		frame <<-EOF
+		{"jsonrpc":"2.0","method":"textDocument/publishDiagnostics",
+		"params":{"uri":"file:///tmp/lsp.c","diagnostics":[{"range":
+		{"start":{"line":3,"character":0},"end":{"line":3,"character":13}},
+		"severity":1,"source":"scc","message":"y is undeclared"}]}}
+		EOF
+		frame <<-EOF
+		{"jsonrpc":"2.0","id":2,"result":null}
+		EOF
+	} > "$scratch/lsp.expected"
+
+	"$scc" --lsp < "$scratch/lsp.in" > "$scratch/lsp.out" &&
+	cmp -s "$scratch/lsp.expected" "$scratch/lsp.out"
+}
+
+lsp
+check "language server transcript" $?
+
+
+# A message longer than a language server takes is answered with an error
+# rather than read, however long its header says it is.
+
+oversized() {
+	printf 'Content-Length: 99999999999999\r\n\r\n{}' |
+	    "$scc" --lsp > "$scratch/oversized.out"
+
+	[ $? -eq 1 ] &&
+	grep -q '"code":-32600,"message":"message too long"' \
+	    "$scratch/oversized.out"
+}
+
+oversized
+check "oversized language server message" $?
+
+
+# A source that begins with the source of a snapshot compiles to the same
+# code with the snapshot as without it.  A snapshot with any one byte
+# damaged is refused, and a source that ends within a comment cannot be
+# made a snapshot at all.
+
+snapshot() {
+	printf 'int printf();\nint x, *p, **q, a[10];\ndouble d, f();\n' \
+	    > "$scratch/prefix.c"
+	"$scc" -P "$scratch/prefix.snap" "$scratch/prefix.c" || return 1
+
+	cat "$scratch/prefix.c" - > "$scratch/seeded.c" <<-EOF
+	int main(void)
+	{
+	    printf("%d\n", x + *p + **q + a[3]);
+	    return f(2);
+	}
+	EOF
+
+	"$scc" "$scratch/seeded.c" > "$scratch/unseeded.s" &&
+	"$scc" -p "$scratch/prefix.snap" "$scratch/seeded.c" \
+	    > "$scratch/seeded.s" &&
+	cmp -s "$scratch/unseeded.s" "$scratch/seeded.s"
+}
+
+damaged() {
+	size=$(wc -c < "$scratch/prefix.snap")
+	offset=0
+
+	while [ $offset -lt $size ]; do
+		cp "$scratch/prefix.snap" "$scratch/damaged.snap"
+		printf '\377' | dd of="$scratch/damaged.snap" bs=1 \
+		    seek=$offset conv=notrunc 2> /dev/null
+		offset=$((offset + 1))
+		cmp -s "$scratch/prefix.snap" "$scratch/damaged.snap" &&
+		    continue
+		"$scc" -p "$scratch/damaged.snap" "$scratch/seeded.c" \
+		    > /dev/null 2> "$scratch/damaged.err"
+		[ $? -eq 1 ] && grep -q "not a snapshot" "$scratch/damaged.err" ||
+		    return 1
+	done
+}
+
+commented() {
+	printf 'int printf();\n/* open\n' > "$scratch/commented.c"
+	! "$scc" -P "$scratch/commented.snap" "$scratch/commented.c" \
+	    2> /dev/null
+}
+
+snapshot
+check "snapshot of a prefix" $?
+damaged
+check "damaged snapshot" $?
+commented
+check "snapshot ending within a comment" $?
+
+
+# A time report has a row for each phase and a total, and a trace has an
+# event for each function.
+
+profile() {
+	sh "$dir/../bench/generate.sh" functions 20 > "$scratch/profiled.c"
+	"$scc" --time-report --trace="$scratch/trace.json" \
+	    "$scratch/profiled.c" 2> "$scratch/report" > /dev/null || return 1
+
+	for row in lexing preprocessing parsing checking allocating \
+	    generating total; do
+		grep -q "^$row " "$scratch/report" || return 1
+	done
+
+	head -1 "$scratch/trace.json" | grep -q '^{"traceEvents":\[$' &&
+	grep -q '"name":"f19","cat":"generating"' "$scratch/trace.json"
+}
+
+profile
+check "time report and trace" $?
+
+
+# Code that cannot be written is an error, whether it is compiled here or
+# by a server.
+
+full() {
+	echo "int main(void) { return 0; }" > "$scratch/full.c"
+	"$scc" "$@" "$scratch/full.c" 2> "$scratch/full.err"
+	[ $? -ne 0 ] && grep -q "cannot write assembly" "$scratch/full.err"
+}
+
+if [ -w /dev/full ]; then
+	full -o /dev/full
+	check "output to a full device" $?
+	full > /dev/full
+	check "standard output to a full device" $?
+	echo "$scratch/full.c /dev/full" > "$scratch/manifest"
+	full -b -m "$scratch/manifest"
+	check "batch output to a full device" $?
+
+	"$scc" --server="$scratch/full.socket" &
+	pid=$!
+
+	for i in 1 2 3 4 5 6 7 8 9 10; do
+		[ -S "$scratch/full.socket" ] && break
+		sleep 1
+	done
+
+	full --client="$scratch/full.socket" -o /dev/full
+	check "served output to a full device" $?
+	full --client="$scratch/full.socket" > /dev/full
+	check "served standard output to a full device" $?
+	kill $pid
+	wait $pid
+fi
+
+
+exit $failed
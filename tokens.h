@@ -14,7 +14,7 @@ enum {
     ASSIGN = '=', LTN = '<', GTN = '>', PLUS = '+', MINUS = '-',
     STAR = '*', DIV = '/', REM = '%', ADDR = '&', NOT = '!', DOT = '.',
     LPAREN = '(', RPAREN = ')', LBRACK = '[', RBRACK = ']',
-    LBRACE = '{', RBRACE = '}', SEMI = ';', COMMA = ',',
+    LBRACE = '{', RBRACE = '}', SEMI = ';', COMMA = ',', HASH = '#',
 
     AUTO = 256, BREAK, CASE, CHAR, CONST, CONTINUE, DEFAULT, DO, DOUBLE,
     ELSE, ENUM, EXTERN, FLOAT, FOR, GOTO, IF, INT, LONG, REGISTER,